@@ -4,47 +4,99 @@
 #include <filesystem>
 #include <type_traits>
 #include <bit>
+#include <cstring>
+#include <span>
+#include <stdexcept>
 
 #include "../java_base.hpp"
 
+class ClassFormatError : public std::runtime_error {
+  public:
+    using std::runtime_error::runtime_error;
+};
+
+// Bounds-checked big-endian cursor over an in-memory class file image. The
+// image is never copied: read_bytes() hands out pointers into it, so the
+// owner of the bytes must outlive everything decoded from them.
 class ByteCodeReader {
   private:
-    std::fstream& file_binary_resource;
+    const raw_jvm_type::u1* const begin;
+    const raw_jvm_type::u1* const end;
+    const raw_jvm_type::u1* cursor;
+
+    void require(std::size_t need) const {
+        if (static_cast<std::size_t>(end - cursor) < need) {
+            throw ClassFormatError("truncated class file: need " + std::to_string(need) +
+                                   " bytes at offset " + std::to_string(position()));
+        }
+    }
 
   public:
     ByteCodeReader() = delete;
     ByteCodeReader(const ByteCodeReader&) = delete;
     ByteCodeReader& operator=(const ByteCodeReader&) = delete;
     ~ByteCodeReader() = default;
-    explicit ByteCodeReader(std::fstream& fms) : file_binary_resource(fms) {
+    ByteCodeReader(const raw_jvm_type::u1* data, std::size_t size)
+        : begin(data), end(data + size), cursor(data) {
+    }
+    explicit ByteCodeReader(std::span<const raw_jvm_type::u1> bytes)
+        : ByteCodeReader(bytes.data(), bytes.size()) {
     }
 
     void read_u1(raw_jvm_type::u1* const);
     void read_u2(raw_jvm_type::u2* const);
     void read_u4(raw_jvm_type::u4* const);
     void read_u8(raw_jvm_type::u8* const);
+
+    // borrow `length` bytes from the image and advance past them
+    const raw_jvm_type::u1* read_bytes(std::size_t length) {
+        require(length);
+        const raw_jvm_type::u1* bytes = cursor;
+        cursor += length;
+        return bytes;
+    }
+
+    void skip(std::size_t length) {
+        require(length);
+        cursor += length;
+    }
+
+    std::size_t position() const noexcept {
+        return static_cast<std::size_t>(cursor - begin);
+    }
+
+    std::size_t remaining() const noexcept {
+        return static_cast<std::size_t>(end - cursor);
+    }
 };
 
 inline void ByteCodeReader::read_u1(raw_jvm_type::u1* const u1_addr) {
-    this->file_binary_resource.read(reinterpret_cast<char*>(u1_addr), sizeof(raw_jvm_type::u1));
+    require(sizeof(raw_jvm_type::u1));
+    *u1_addr = *cursor++;
 }
 
 inline void ByteCodeReader::read_u2(raw_jvm_type::u2* const u2_addr) {
-    this->file_binary_resource.read(reinterpret_cast<char*>(u2_addr), sizeof(raw_jvm_type::u2));
+    require(sizeof(raw_jvm_type::u2));
+    std::memcpy(u2_addr, cursor, sizeof(raw_jvm_type::u2));
+    cursor += sizeof(raw_jvm_type::u2);
     if constexpr (std::endian::native == std::endian::little) {
-        *u2_addr = __builtin_bswap16(*u2_addr); 
+        *u2_addr = __builtin_bswap16(*u2_addr);
     }
 }
 
 inline void ByteCodeReader::read_u4(raw_jvm_type::u4* const u4_addr) {
-    this->file_binary_resource.read(reinterpret_cast<char*>(u4_addr), sizeof(raw_jvm_type::u4));
+    require(sizeof(raw_jvm_type::u4));
+    std::memcpy(u4_addr, cursor, sizeof(raw_jvm_type::u4));
+    cursor += sizeof(raw_jvm_type::u4);
     if constexpr (std::endian::native == std::endian::little) {
         *u4_addr = __builtin_bswap32(*u4_addr);
     }
 }
 
 inline void ByteCodeReader::read_u8(raw_jvm_type::u8* const u8_addr) {
-    this->file_binary_resource.read(reinterpret_cast<char*>(u8_addr), sizeof(raw_jvm_type::u8));
+    require(sizeof(raw_jvm_type::u8));
+    std::memcpy(u8_addr, cursor, sizeof(raw_jvm_type::u8));
+    cursor += sizeof(raw_jvm_type::u8);
     if constexpr (std::endian::native == std::endian::little) {
         *u8_addr = __builtin_bswap64(*u8_addr);
     }
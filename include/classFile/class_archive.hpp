@@ -0,0 +1,159 @@
+#pragma once
+
+#include <filesystem>
+#include <span>
+#include <string_view>
+
+#include "../java_base.hpp"
+#include "class_file.hpp"
+#include "class_file_source.hpp"
+
+namespace rt_jvm_data {
+    class InstanceKlass;
+}; // namespace rt_jvm_data
+
+namespace raw_jvm_data {
+
+    // On-disk description of one archived class. Offsets count from the start
+    // of the archive; the tables they point at only contain relative pointers,
+    // so the archive can be mapped at any address and used without fix-ups.
+    struct ArchivedClassRecord {
+        u8 name_offset;
+        u4 name_length;
+        u4 name_hash;
+        u8 image_offset;
+        u8 image_size;
+        u8 constant_pool_offset;
+        u8 interfaces_offset;
+        u8 fields_offset;
+        u8 methods_offset;
+        u8 attributes_offset;
+        // raw_value_type of every field, in class file order
+        u8 field_types_offset;
+        // ArchivedLinkage, 0 when the class was not linked when dumped
+        u8 linkage_offset;
+        u4 magic;
+        u2 minor_version;
+        u2 major_version;
+        u2 constant_pool_count;
+        u2 access_flags;
+        u2 this_class;
+        u2 super_class;
+        u2 interfaces_count;
+        u2 fields_count;
+        u2 methods_count;
+        u2 attributes_count;
+    };
+
+    // A method named by the record of its class and its position among the
+    // methods of that class; `klass` is NO_RECORD for an empty slot.
+    struct ArchivedMethodRef {
+        u4 klass;
+        u4 method;
+    };
+
+    struct ArchivedItableBlock {
+        u4 interface;
+        u4 first;
+    };
+
+    // What linking computed for a class: field layout, vtable and itable.
+    // Loading restores them when the class is linked against the same super
+    // and interfaces records, instead of building them again. Every table
+    // holds one entry per field, method or slot.
+    struct ArchivedLinkage {
+        static constexpr u4 NO_RECORD = ~u4(0);
+
+        u4 super;
+        u4 interfaces_count;
+        u8 interfaces_offset;
+        u4 instance_size;
+        u4 static_size;
+        u4 static_oop_count;
+        u4 oop_map_count;
+        // offset and count pairs
+        u8 oop_maps_offset;
+        // u4 per field
+        u8 field_offsets_offset;
+        // vtable and itable index pairs, std::int32_t per method
+        u8 method_indices_offset;
+        u4 vtable_length;
+        u4 itable_length;
+        u8 vtable_offset;
+        u8 itable_offset;
+        u4 itable_methods_length;
+        u8 itable_methods_offset;
+    };
+
+    // Class data sharing archive: parsed ClassFile tables plus the class images
+    // they point into, laid out in one file. Opening maps it read-only, so
+    // every VM on the host that uses the same archive shares its pages.
+    class SharedClassArchive {
+      public:
+        static constexpr u4 VERSION = 3;
+
+        struct Header {
+            char magic[8];
+            u4 version;
+            // sizes of the archived structs, rejects archives from another build
+            u4 layout;
+            u8 size;
+            u4 class_count;
+            u4 bucket_count;
+            u8 records_offset;
+            u8 buckets_offset;
+        };
+
+      private:
+        ClassFileSource_ptr image;
+        const Header* header = nullptr;
+        const ArchivedClassRecord* records = nullptr;
+        // open-addressed name index: record index + 1, 0 marks an empty bucket
+        const u4* buckets = nullptr;
+
+        bool in_range(u8 offset, u8 size) const noexcept;
+        // whether the relative pointers of a record's tables stay in the archive
+        bool check_pointers(const ArchivedClassRecord& record) const noexcept;
+        bool check_linkage(const ArchivedClassRecord& record) const noexcept;
+
+      public:
+        static u4 hash_name(std::string_view name) noexcept;
+        static u4 layout_fingerprint() noexcept;
+
+        // write `classes` into a new archive at `path`, with the linkage of
+        // those already linked
+        static void dump(const std::filesystem::path& path,
+                         std::span<const rt_jvm_data::InstanceKlass* const> classes);
+
+        explicit SharedClassArchive(const std::filesystem::path& path);
+        SharedClassArchive(const SharedClassArchive&) = delete;
+        SharedClassArchive& operator=(const SharedClassArchive&) = delete;
+
+        const ArchivedClassRecord* find(std::string_view name) const noexcept;
+
+        std::span<const ArchivedClassRecord> get_records() const noexcept {
+            return {records, header->class_count};
+        }
+
+        u4 index_of(const ArchivedClassRecord& record) const noexcept {
+            return static_cast<u4>(&record - records);
+        }
+
+        // null for a class dumped unlinked
+        const ArchivedLinkage* linkage_of(const ArchivedClassRecord& record) const noexcept {
+            return record.linkage_offset == 0 ? nullptr
+                                              : at<ArchivedLinkage>(record.linkage_offset);
+        }
+
+        std::string_view name_of(const ArchivedClassRecord& record) const noexcept {
+            return {at<char>(record.name_offset), record.name_length};
+        }
+
+        // the class file image, keeping the whole archive mapped
+        ClassFileSource_ptr image_of(const ArchivedClassRecord& record) const;
+
+        template <class T> const T* at(u8 offset) const noexcept {
+            return reinterpret_cast<const T*>(image->data() + offset);
+        }
+    };
+}; // namespace raw_jvm_data
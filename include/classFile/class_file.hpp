@@ -10,6 +10,10 @@
 
 #include "../java_base.hpp"
 #include "byte_code_reader.hpp"
+#include "class_file_source.hpp"
+#include "modified_utf8.hpp"
+#include "../utils/arena.hpp"
+#include "../utils/relative_ptr.hpp"
 
 namespace raw_jvm_data {
     using namespace raw_jvm_type;
@@ -39,10 +43,13 @@ namespace raw_jvm_data {
     constexpr u2 ACC_STATIC = 0x0008;
     constexpr u2 ACC_FINAL = 0x0010;
     constexpr u2 ACC_SYNCHRONIZED = 0x0020;
+    // the same bit on a class
+    constexpr u2 ACC_SUPER = 0x0020;
     constexpr u2 ACC_BRIDGE = 0x0040;
     constexpr u2 ACC_VOLATILE = 0x0040;
     constexpr u2 ACC_TRANSIENT = 0x0080;
     constexpr u2 ACC_NATIVE = 0x0100;
+    constexpr u2 ACC_INTERFACE = 0x0200;
     constexpr u2 ACC_ABSTRACT = 0x0400;
     constexpr u2 ACC_STRICT = 0x0800;
     constexpr u2 ACC_SYNTHETIC = 0x1000;
@@ -69,6 +76,9 @@ namespace raw_jvm_data {
     struct AttributeInfo;
 
     class ClassFile;
+    class SharedClassArchive;
+    struct ArchivedClassRecord;
+    struct ArchivedLinkage;
 
     using ConstantInfo_ptr = ConstantInfo*;
     using ConstantClass_ptr = ConstantClass*;
@@ -94,14 +104,13 @@ namespace raw_jvm_data {
 
     struct ConstantInfo {
         u1 tag;
-        friend fstream& operator>>(fstream& in, ConstantInfo& ci);
+        friend ByteCodeReader& operator>>(ByteCodeReader& in, ConstantInfo& ci);
     };
 
     struct ConstantClass : public ConstantInfo {
         u2 name_index;
-        friend fstream& operator>>(fstream& in, ConstantClass& ci) {
-            ByteCodeReader bcr(in);
-            bcr.read_u2(&ci.name_index);
+        friend ByteCodeReader& operator>>(ByteCodeReader& in, ConstantClass& ci) {
+            in.read_u2(&ci.name_index);
             return in;
         }
     };
@@ -109,10 +118,9 @@ namespace raw_jvm_data {
     struct ConstantFieldRef : public ConstantInfo {
         u2 name_index;
         u2 name_and_type_index;
-        friend fstream& operator>>(fstream& in, ConstantFieldRef& ci) {
-            ByteCodeReader bcr(in);
-            bcr.read_u2(&ci.name_index);
-            bcr.read_u2(&ci.name_and_type_index);
+        friend ByteCodeReader& operator>>(ByteCodeReader& in, ConstantFieldRef& ci) {
+            in.read_u2(&ci.name_index);
+            in.read_u2(&ci.name_and_type_index);
             return in;
         }
     };
@@ -120,10 +128,9 @@ namespace raw_jvm_data {
     struct ConstantMethodRef : public ConstantInfo {
         u2 name_index;
         u2 name_and_type_index;
-        friend fstream& operator>>(fstream& in, ConstantMethodRef& ci) {
-            ByteCodeReader bcr(in);
-            bcr.read_u2(&ci.name_index);
-            bcr.read_u2(&ci.name_and_type_index);
+        friend ByteCodeReader& operator>>(ByteCodeReader& in, ConstantMethodRef& ci) {
+            in.read_u2(&ci.name_index);
+            in.read_u2(&ci.name_and_type_index);
             return in;
         }
     };
@@ -131,37 +138,33 @@ namespace raw_jvm_data {
     struct ConstantInterfaceMethodRef : public ConstantInfo {
         u2 name_index;
         u2 name_and_type_index;
-        friend fstream& operator>>(fstream& in, ConstantInterfaceMethodRef& ci) {
-            ByteCodeReader bcr(in);
-            bcr.read_u2(&ci.name_index);
-            bcr.read_u2(&ci.name_and_type_index);
+        friend ByteCodeReader& operator>>(ByteCodeReader& in, ConstantInterfaceMethodRef& ci) {
+            in.read_u2(&ci.name_index);
+            in.read_u2(&ci.name_and_type_index);
             return in;
         }
     };
 
     struct ConstantString : public ConstantInfo {
         u2 string_index;
-        friend fstream& operator>>(fstream& in, ConstantString& ci) {
-            ByteCodeReader bcr(in);
-            bcr.read_u2(&ci.string_index);
+        friend ByteCodeReader& operator>>(ByteCodeReader& in, ConstantString& ci) {
+            in.read_u2(&ci.string_index);
             return in;
         }
     };
 
     struct ConstantInteger : public ConstantInfo {
         u4 bytes;
-        friend fstream& operator>>(fstream& in, ConstantInteger& ci) {
-            ByteCodeReader bcr(in);
-            bcr.read_u4(&ci.bytes);
+        friend ByteCodeReader& operator>>(ByteCodeReader& in, ConstantInteger& ci) {
+            in.read_u4(&ci.bytes);
             return in;
         }
     };
 
     struct ConstantFloat : public ConstantInfo {
         u4 bytes;
-        friend fstream& operator>>(fstream& in, ConstantFloat& ci) {
-            ByteCodeReader bcr(in);
-            bcr.read_u4(&ci.bytes);
+        friend ByteCodeReader& operator>>(ByteCodeReader& in, ConstantFloat& ci) {
+            in.read_u4(&ci.bytes);
             return in;
         }
     };
@@ -169,10 +172,9 @@ namespace raw_jvm_data {
     struct ConstantLong : public ConstantInfo {
         u4 high_bytes;
         u4 low_bytes;
-        friend fstream& operator>>(fstream& in, ConstantLong& ci) {
-            ByteCodeReader bcr(in);
-            bcr.read_u4(&ci.high_bytes);
-            bcr.read_u4(&ci.low_bytes);
+        friend ByteCodeReader& operator>>(ByteCodeReader& in, ConstantLong& ci) {
+            in.read_u4(&ci.high_bytes);
+            in.read_u4(&ci.low_bytes);
             return in;
         }
     };
@@ -180,10 +182,9 @@ namespace raw_jvm_data {
     struct ConstantDouble : public ConstantInfo {
         u4 high_bytes;
         u4 low_bytes;
-        friend fstream& operator>>(fstream& in, ConstantDouble& ci) {
-            ByteCodeReader bcr(in);
-            bcr.read_u4(&ci.high_bytes);
-            bcr.read_u4(&ci.low_bytes);
+        friend ByteCodeReader& operator>>(ByteCodeReader& in, ConstantDouble& ci) {
+            in.read_u4(&ci.high_bytes);
+            in.read_u4(&ci.low_bytes);
             return in;
         }
     };
@@ -191,62 +192,69 @@ namespace raw_jvm_data {
     struct ConstantNameAndType : public ConstantInfo {
         u2 name_index;
         u2 descriptor_index;
-        friend fstream& operator>>(fstream& in, ConstantNameAndType& ci) {
-            ByteCodeReader bcr(in);
-            bcr.read_u2(&ci.name_index);
-            bcr.read_u2(&ci.descriptor_index);
+        friend ByteCodeReader& operator>>(ByteCodeReader& in, ConstantNameAndType& ci) {
+            in.read_u2(&ci.name_index);
+            in.read_u2(&ci.descriptor_index);
             return in;
         }
     };
 
-    struct ConstantUtf8 : public ConstantInfo, public Printable {
+    struct ConstantUtf8 : public ConstantInfo {
         u2 length;
-        u1_ptr bytes;
+        // mutf8::hash of the bytes, taken while validating; fills the padding
+        u4 hash;
+        // points into the class file image, not NUL terminated
+        RelativePtr<const u1> bytes;
+
+        friend ByteCodeReader& operator>>(ByteCodeReader& in, ConstantUtf8& ci) {
+            in.read_u2(&ci.length);
+            const u1* data = in.read_bytes(ci.length);
+            auto scan = mutf8::scan({data, ci.length});
+            if (!scan.valid) throw ClassFormatError("malformed modified utf-8 constant");
+            ci.hash = scan.hash;
+            ci.bytes = data;
+            return in;
+        }
 
-        ~ConstantUtf8();
+        std::string_view view() const noexcept {
+            return {reinterpret_cast<const char*>(bytes.get()), length};
+        }
 
-        friend fstream& operator>>(fstream& in, ConstantUtf8& ci) {
-            ByteCodeReader bcr(in);
-            bcr.read_u2(&ci.length);
-            // to c string
-            ci.bytes = new u1[ci.length + 1]{0};
-            for (size_t index = 0; index < ci.length; index++) {
-                bcr.read_u1(&ci.bytes[index]);
-            }
-            return in;
+        std::span<const u1> span() const noexcept {
+            return {bytes.get(), length};
+        }
+
+        // decoded for java.lang.String, the constant itself stays in modified utf-8
+        std::u16string to_utf16() const {
+            return mutf8::to_utf16(span());
         }
 
-        friend ostream& operator<<(ostream& out, ConstantUtf8& ci) {
+        friend ostream& operator<<(ostream& out, const ConstantUtf8& ci) {
             for (size_t index = 0; index < ci.length; index++) {
                 out << ci.bytes[index];
             }
             return out;
         }
 
-        void print() const override {
-            char* tmp = new char[this->length + 1]{0};
-            memcpy(tmp, this->bytes, this->length * sizeof(u1));
-            spdlog::warn("read utf-8 constant info: {:}", tmp);
-            delete[] tmp;
+        void print() const {
+            spdlog::warn("read utf-8 constant info: {:}", this->view());
         }
     };
 
     struct ConstantMethodHandle : public ConstantInfo {
         u1 reference_kind;
         u2 reference_index;
-        friend fstream& operator>>(fstream& in, ConstantMethodHandle& ci) {
-            ByteCodeReader bcr(in);
-            bcr.read_u1(&ci.reference_kind);
-            bcr.read_u2(&ci.reference_index);
+        friend ByteCodeReader& operator>>(ByteCodeReader& in, ConstantMethodHandle& ci) {
+            in.read_u1(&ci.reference_kind);
+            in.read_u2(&ci.reference_index);
             return in;
         }
     };
 
     struct ConstantMethodType : public ConstantInfo {
         u2 descriptor_index;
-        friend fstream& operator>>(fstream& in, ConstantMethodType& ci) {
-            ByteCodeReader bcr(in);
-            bcr.read_u2(&ci.descriptor_index);
+        friend ByteCodeReader& operator>>(ByteCodeReader& in, ConstantMethodType& ci) {
+            in.read_u2(&ci.descriptor_index);
             return in;
         }
     };
@@ -254,30 +262,48 @@ namespace raw_jvm_data {
     struct ConstantInvokeDynamic : public ConstantInfo {
         u2 bootstrap_method_attr_index;
         u2 name_and_type_index;
-        friend fstream& operator>>(fstream& in, ConstantInvokeDynamic& ci) {
-            ByteCodeReader bcr(in);
-            bcr.read_u2(&ci.bootstrap_method_attr_index);
-            bcr.read_u2(&ci.name_and_type_index);
+        friend ByteCodeReader& operator>>(ByteCodeReader& in, ConstantInvokeDynamic& ci) {
+            in.read_u2(&ci.bootstrap_method_attr_index);
+            in.read_u2(&ci.name_and_type_index);
             return in;
         }
     };
 
+    // One constant pool slot. Every alternative starts with the ConstantInfo tag,
+    // so the pool is a flat array of fixed-size entries read through `info` first.
+    union ConstantPoolEntry {
+        ConstantInfo info;
+        ConstantClass klass;
+        ConstantFieldRef field_ref;
+        ConstantMethodRef method_ref;
+        ConstantInterfaceMethodRef interface_method_ref;
+        ConstantString string;
+        ConstantInteger integer;
+        ConstantFloat float_;
+        ConstantLong long_;
+        ConstantDouble double_;
+        ConstantNameAndType name_and_type;
+        ConstantUtf8 utf8;
+        ConstantMethodHandle method_handle;
+        ConstantMethodType method_type;
+        ConstantInvokeDynamic invoke_dynamic;
+    };
+
+    using ConstantPoolEntry_ptr = ConstantPoolEntry*;
+
+    static_assert(sizeof(ConstantPoolEntry) == 16, "constant pool entries should stay dense");
+    static_assert(std::is_trivially_destructible_v<ConstantPoolEntry>);
+
     struct AttributeInfo {
         u2 attribute_name_index;
         u4 attribute_length;
-        u1_ptr info;
-
-        ~AttributeInfo();
-
-        friend fstream& operator>>(fstream& in, AttributeInfo& ai) {
-            ByteCodeReader bcr(in);
-            bcr.read_u2(&ai.attribute_name_index);
-            bcr.read_u4(&ai.attribute_length);
-            // allocate new array
-            ai.info = new u1[ai.attribute_length];
-            for (u4 index = 0; index < ai.attribute_length; index++) {
-                bcr.read_u1(&ai.info[index]);
-            }
+        // points into the class file image
+        RelativePtr<const u1> info;
+
+        friend ByteCodeReader& operator>>(ByteCodeReader& in, AttributeInfo& ai) {
+            in.read_u2(&ai.attribute_name_index);
+            in.read_u4(&ai.attribute_length);
+            ai.info = in.read_bytes(ai.attribute_length);
             return in;
         }
     };
@@ -287,21 +313,14 @@ namespace raw_jvm_data {
         u2 name_index;
         u2 descriptor_index;
         u2 attribute_count;
-        AttributeInfo_ptr attributes;
-
-        ~FieldInfo();
-
-        friend fstream& operator>>(fstream& in, FieldInfo& fi) {
-            ByteCodeReader bcr(in);
-            bcr.read_u2(&fi.access_flags);
-            bcr.read_u2(&fi.name_index);
-            bcr.read_u2(&fi.descriptor_index);
-            bcr.read_u2(&fi.attribute_count);
-
-            fi.attributes = new AttributeInfo[fi.attribute_count];
-            for (u2 index = 0; index < fi.attribute_count; index++) {
-                in >> fi.attributes[index];
-            }
+        RelativePtr<AttributeInfo> attributes;
+
+        // reads the header only, ClassFile reads the attribute table into its arena
+        friend ByteCodeReader& operator>>(ByteCodeReader& in, FieldInfo& fi) {
+            in.read_u2(&fi.access_flags);
+            in.read_u2(&fi.name_index);
+            in.read_u2(&fi.descriptor_index);
+            in.read_u2(&fi.attribute_count);
             return in;
         }
     };
@@ -311,32 +330,27 @@ namespace raw_jvm_data {
         u2 name_index;
         u2 descriptor_index;
         u2 attribute_count;
-        AttributeInfo_ptr attributes;
-
-        ~MethodInfo();
-
-        friend fstream& operator>>(fstream& in, MethodInfo& mi) {
-            ByteCodeReader bcr(in);
-            bcr.read_u2(&mi.access_flags);
-            bcr.read_u2(&mi.name_index);
-            bcr.read_u2(&mi.descriptor_index);
-            bcr.read_u2(&mi.attribute_count);
-
-            mi.attributes = new AttributeInfo[mi.attribute_count];
-            for (u2 index = 0; index < mi.attribute_count; index++) {
-                in >> mi.attributes[index];
-            }
+        RelativePtr<AttributeInfo> attributes;
+
+        // reads the header only, ClassFile reads the attribute table into its arena
+        friend ByteCodeReader& operator>>(ByteCodeReader& in, MethodInfo& mi) {
+            in.read_u2(&mi.access_flags);
+            in.read_u2(&mi.name_index);
+            in.read_u2(&mi.descriptor_index);
+            in.read_u2(&mi.attribute_count);
             return in;
         }
     };
 
     class ClassFile : public Printable {
+        friend class SharedClassArchive;
+
       protected:
         u4 magic = 0;
         u2 minor_version = 0;
         u2 major_version = 0;
         u2 constant_pool_count = 0;
-        ConstantInfo_ptr* constant_pool = nullptr;
+        ConstantPoolEntry_ptr constant_pool = nullptr;
         u2 access_flags = 0;
         u2 this_class = 0;
         u2 super_class = 0;
@@ -349,16 +363,50 @@ namespace raw_jvm_data {
         u2 attributes_count = 0;
         AttributeInfo_ptr attributes = nullptr;
 
+        // image the utf8 constants and attribute bodies point into
+        ClassFileSource_ptr source;
+        // every table above lives here and is freed with the class in one go
+        Arena arena;
+
+        u1 cp_tag(const u2 index) const noexcept {
+            assert(index < this->constant_pool_count);
+            return this->constant_pool[index].info.tag;
+        }
+
+        // scans a table by name without touching any attribute body
+        const AttributeInfo* lookup_attribute(const AttributeInfo* table, u2 count,
+                                              std::string_view name) const noexcept {
+            for (u2 index = 0; index < count; index++) {
+                u2 name_index = table[index].attribute_name_index;
+                if (name_index < this->constant_pool_count && cp_tag(name_index) == CONSTANT_Utf8 &&
+                    this->constant_pool[name_index].utf8.view() == name) {
+                    return &table[index];
+                }
+            }
+            return nullptr;
+        }
+
       private:
-        ConstantInfo_ptr build_constant_info(fstream& in, u1 tag);
+        static void build_constant_info(ByteCodeReader& in, u1 tag, ConstantPoolEntry& entry);
+        AttributeInfo_ptr read_attributes(ByteCodeReader& in, u2 count);
+        void parse(ByteCodeReader& bcr);
 
       public:
-        ClassFile(fstream& in);
+        // `metadata`, when given, supplies the chunks of the arena
+        ClassFile(fstream& in, std::pmr::memory_resource* metadata = nullptr);
+        explicit ClassFile(ClassFileSource_ptr src, std::pmr::memory_resource* metadata = nullptr);
+        // adopts the tables of an archived class in place; they stay read-only
+        ClassFile(const SharedClassArchive& archive, const ArchivedClassRecord& record);
         ClassFile() = delete;
         ClassFile(const ClassFile&) = delete;
         ClassFile& operator=(const ClassFile&) = delete;
         ClassFile(ClassFile&&) = delete;
-        ~ClassFile();
+        ~ClassFile() = default;
+
+        const Arena& get_arena() const noexcept {
+            return arena;
+        }
+
         void print() const override {
             spdlog::info("############## class file start ##############");
             spdlog::info("class file magic number : {:X}", this->magic);
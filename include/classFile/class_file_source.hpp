@@ -0,0 +1,58 @@
+#pragma once
+
+#include <filesystem>
+#include <istream>
+#include <memory>
+#include <span>
+
+#include "../java_base.hpp"
+
+// Backing storage of one class file image. ClassFile keeps a reference to its
+// source and its utf8 constants and attribute bodies point straight into it.
+class ClassFileSource {
+  public:
+    enum class Storage { Mapped, Owned, Borrowed };
+
+  private:
+    const raw_jvm_type::u1* base = nullptr;
+    std::size_t length = 0;
+    Storage storage = Storage::Borrowed;
+    std::unique_ptr<raw_jvm_type::u1[]> owned;
+    std::shared_ptr<const void> keep_alive;
+
+    ClassFileSource() = default;
+
+  public:
+    ClassFileSource(const ClassFileSource&) = delete;
+    ClassFileSource& operator=(const ClassFileSource&) = delete;
+    ~ClassFileSource();
+
+    // mmap the whole file read-only
+    static std::shared_ptr<const ClassFileSource> map(const std::filesystem::path& path);
+    // drain the stream into one owned buffer
+    static std::shared_ptr<const ClassFileSource> read(std::istream& in);
+    // adopt a buffer produced elsewhere (e.g. inflated archive members)
+    static std::shared_ptr<const ClassFileSource> adopt(std::unique_ptr<raw_jvm_type::u1[]> bytes,
+                                                        std::size_t size);
+    // use caller-managed memory; `owner` is kept alive for as long as the source
+    static std::shared_ptr<const ClassFileSource>
+    borrow(std::span<const raw_jvm_type::u1> bytes, std::shared_ptr<const void> owner = nullptr);
+
+    const raw_jvm_type::u1* data() const noexcept {
+        return base;
+    }
+
+    std::size_t size() const noexcept {
+        return length;
+    }
+
+    std::span<const raw_jvm_type::u1> bytes() const noexcept {
+        return {base, length};
+    }
+
+    Storage get_storage() const noexcept {
+        return storage;
+    }
+};
+
+using ClassFileSource_ptr = std::shared_ptr<const ClassFileSource>;
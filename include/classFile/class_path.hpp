@@ -0,0 +1,65 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../java_base.hpp"
+#include "class_file_source.hpp"
+
+// One element of a classpath. Class names are binary names in internal form,
+// e.g. "java/lang/Object", without the ".class" suffix.
+class ClassPathEntry {
+  public:
+    virtual ~ClassPathEntry() = default;
+
+    // every class this entry can provide
+    virtual std::vector<std::string> class_names() const = 0;
+    // the class image, or nullptr when this entry does not have the class
+    virtual ClassFileSource_ptr open(const std::string& class_name) const = 0;
+    virtual std::string describe() const = 0;
+};
+
+using ClassPathEntry_ptr = std::unique_ptr<ClassPathEntry>;
+
+class DirectoryClassPathEntry : public ClassPathEntry {
+  private:
+    std::filesystem::path root;
+
+  public:
+    explicit DirectoryClassPathEntry(std::filesystem::path dir) : root(std::move(dir)) {
+    }
+
+    std::vector<std::string> class_names() const override;
+    ClassFileSource_ptr open(const std::string& class_name) const override;
+    std::string describe() const override {
+        return root.string();
+    }
+};
+
+class ClassPath {
+  private:
+    std::vector<ClassPathEntry_ptr> entries;
+
+  public:
+    ClassPath() = default;
+    ClassPath(ClassPath&&) = default;
+    ClassPath& operator=(ClassPath&&) = default;
+
+    // split a ':' separated classpath string into entries
+    static ClassPath parse(const std::string& classpath);
+    // pick the entry kind from what the path points at
+    static ClassPathEntry_ptr make_entry(const std::filesystem::path& path);
+
+    void add(ClassPathEntry_ptr entry) {
+        entries.emplace_back(std::move(entry));
+    }
+
+    const std::vector<ClassPathEntry_ptr>& get_entries() const noexcept {
+        return entries;
+    }
+
+    // first match in classpath order
+    ClassFileSource_ptr open(const std::string& class_name) const;
+};
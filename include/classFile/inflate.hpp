@@ -0,0 +1,22 @@
+#pragma once
+
+#include <span>
+#include <stdexcept>
+
+#include "../java_base.hpp"
+
+namespace zip {
+    using namespace raw_jvm_type;
+
+    class ZipFormatError : public std::runtime_error {
+      public:
+        using std::runtime_error::runtime_error;
+    };
+
+    // Decompress a raw DEFLATE stream (RFC 1951) that must expand to exactly
+    // out.size() bytes. Throws ZipFormatError on corrupt or mis-sized input.
+    void inflate(std::span<const u1> in, std::span<u1> out);
+
+    // IEEE CRC-32 as used by zip archives
+    u4 crc32(std::span<const u1> bytes, u4 crc = 0) noexcept;
+}; // namespace zip
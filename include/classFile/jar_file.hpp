@@ -0,0 +1,81 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "../java_base.hpp"
+#include "class_file_source.hpp"
+#include "class_path.hpp"
+#include "inflate.hpp"
+
+namespace zip {
+    // A zip/jar archive mapped once. Opening only reads the central directory
+    // into a hash index; member data is located and inflated on request.
+    class JarFile {
+      public:
+        static constexpr u2 METHOD_STORED = 0;
+        static constexpr u2 METHOD_DEFLATED = 8;
+
+        struct Entry {
+            u2 method;
+            u2 flags;
+            u4 crc;
+            u8 compressed_size;
+            u8 uncompressed_size;
+            u8 local_header_offset;
+        };
+
+      private:
+        std::filesystem::path path;
+        ClassFileSource_ptr image;
+        // keys point into the mapped central directory
+        std::unordered_map<std::string_view, Entry> index;
+
+        void read_central_directory();
+        std::span<const u1> member_data(const Entry& entry) const;
+
+      public:
+        explicit JarFile(std::filesystem::path archive);
+        JarFile(const JarFile&) = delete;
+        JarFile& operator=(const JarFile&) = delete;
+
+        const Entry* find(std::string_view member) const {
+            auto it = index.find(member);
+            return it == index.end() ? nullptr : &it->second;
+        }
+
+        std::vector<std::string_view> members() const;
+
+        // Stored members are returned in place, deflated ones in a fresh buffer;
+        // both are checked against their CRC-32. nullptr when the archive has
+        // no such member.
+        ClassFileSource_ptr open(std::string_view member) const;
+
+        std::size_t size() const noexcept {
+            return index.size();
+        }
+
+        const std::filesystem::path& get_path() const noexcept {
+            return path;
+        }
+    };
+}; // namespace zip
+
+class JarClassPathEntry : public ClassPathEntry {
+  private:
+    std::shared_ptr<zip::JarFile> jar;
+
+  public:
+    explicit JarClassPathEntry(const std::filesystem::path& archive)
+        : jar(std::make_shared<zip::JarFile>(archive)) {
+    }
+
+    std::vector<std::string> class_names() const override;
+    ClassFileSource_ptr open(const std::string& class_name) const override;
+    std::string describe() const override {
+        return jar->get_path().string();
+    }
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <span>
+#include <string>
+
+#include "../java_base.hpp"
+
+// Java modified UTF-8 (JVMS 4.4.7): no NUL byte, U+0000 is written as C0 80,
+// no four byte forms, supplementary characters are two encoded surrogates.
+namespace mutf8 {
+    using namespace raw_jvm_type;
+
+    struct ScanResult {
+        bool valid;
+        bool ascii;
+        // hash() of the bytes, computed in the same pass
+        u4 hash;
+        // chars of the UTF-16 form, only meaningful when valid
+        u4 utf16_length;
+    };
+
+    // h = 31 * h + byte over the raw bytes. For ASCII text this is exactly
+    // java.lang.String#hashCode, so a constant can seed its string's hash.
+    u4 hash(std::span<const u1> bytes) noexcept;
+
+    // validates and hashes in one pass, on the widest vector unit available
+    ScanResult scan(std::span<const u1> bytes) noexcept;
+
+    // the UTF-16 form for java.lang.String, throws ClassFormatError when invalid
+    std::u16string to_utf16(std::span<const u1> bytes);
+
+    // the kernels behind scan(), exposed so they can be checked against each other
+    namespace detail {
+        ScanResult scan_scalar(std::span<const u1> bytes) noexcept;
+        ScanResult scan_sse41(std::span<const u1> bytes) noexcept;
+        ScanResult scan_avx2(std::span<const u1> bytes) noexcept;
+        bool has_sse41() noexcept;
+        bool has_avx2() noexcept;
+    } // namespace detail
+}; // namespace mutf8
@@ -6,24 +6,157 @@
 #include "gc.hpp"
 #include "runtime/gc.hpp"
 
+#include <array>
+#include <functional>
+#include <span>
+#include <stdexcept>
+
+// Threaded dispatch jumps from handler to handler through a table of label
+// addresses, a GNU extension clang and gcc both have. Elsewhere, or when built
+// with -DJVM_THREADED_DISPATCH=0, the interpreter calls through the handlers table.
+#ifndef JVM_THREADED_DISPATCH
+#if defined(__GNUC__)
+#define JVM_THREADED_DISPATCH 1
+#else
+#define JVM_THREADED_DISPATCH 0
+#endif
+#endif
 
 namespace jvm {
+    class CompileBroker;
+
+    // opcodes by name, with a leading underscore since some names are keywords
+    enum Bytecode : raw_jvm_type::u1 {
+#define X(code, name, length) _##name = code,
+#include "byte_code_engine.def"
+#undef X
+    };
+
+    // A Java exception that left the outermost interpreted frame, or one a
+    // native method raises.
+    class JavaException : public std::runtime_error {
+      private:
+        oop::Ref exception;
+
+      public:
+        explicit JavaException(oop::Ref exception);
+
+        oop::Ref get_exception() const noexcept {
+            return exception;
+        }
+    };
+
+    // What the interpreter needs from the rest of the VM. `resolver` loads
+    // and links classes and interns strings; the interpreter initializes the
+    // classes itself. `heap` holds every object interpreted code allocates.
+    // `native` runs a native method on its arguments, the receiver first, and
+    // may throw JavaException; unset, native calls raise UnsatisfiedLinkError.
+    //
+    // Exceptions the VM raises itself, NullPointerException and the like, are
+    // instances of the java/lang classes found through `resolver`, made
+    // without running a constructor. When such a class cannot be found the
+    // interpreter throws NoClassDefFoundError.
+    struct Runtime {
+        enum class Dispatch { Threaded, Table, Cached };
+
+        rt_jvm_data::ConstantPoolResolver resolver;
+        oop::Heap* heap = nullptr;
+        std::function<Slot(const rt_jvm_data::MethodWrapper& method,
+                           std::span<const Slot> arguments)>
+            native;
+        // Table always works; Threaded, and Cached, which also keeps the top
+        // of the operand stack in registers, fall back to it without
+        // JVM_THREADED_DISPATCH
+        Dispatch dispatch = Dispatch::Threaded;
+        // queues the methods the interpreter finds hot for the JIT; unset,
+        // methods are only compiled when JitCompiler is asked to
+        CompileBroker* compiler = nullptr;
+    };
+
     class BytecodeEngine {
       public:
-        using Handler = void (*)(StackFrame&);
+        // What a running activation keeps in machine registers. Handlers take
+        // it by reference and are inlined into the dispatch loop, where it is
+        // a local; slow paths take and return it by value so that it never
+        // has to live in memory.
+        struct Registers {
+            const raw_jvm_type::u1* pc;
+            // one past the top of the operand stack
+            Slot* sp;
+            Slot* locals;
+            // start of the method's code, for branch targets and switch padding
+            const raw_jvm_type::u1* code;
+            StackFrame* frame;
+            const Runtime* runtime;
+            // the exception leaving the method once pc reaches `leave`
+            oop::Ref exception;
+        };
+        using Handler = void (*)(Registers&);
+
+        // how a method finished: its result in the first slot, zero for void,
+        // or the exception it threw
+        struct Outcome {
+            Slot value;
+            oop::Ref exception;
+        };
+
+        // Runs the method of `frame`, whose arguments are already in its first
+        // locals, from the frame's pc. An exception leaving the method comes
+        // back in the outcome. Classes and members are resolved through the
+        // frame's constant pool cache as they are reached.
+        static Outcome execute(StackFrame& frame, const Runtime& runtime);
+
+        // execute, throwing JavaException when an exception leaves the method
+        static Slot interpret(StackFrame& frame, const Runtime& runtime);
+
+        // Continues a frame that compiled code handed back at its pc, with its
+        // locals and its operand stack up to the frame's depth filled in. When
+        // `exception` is set it is thrown at pc first. The method must not be
+        // synchronized: the JIT leaves those to the interpreter.
+        static Outcome resume(StackFrame& frame, const Runtime& runtime, oop::Ref exception);
 
-        // 主解释循环
-        static void interpret(StackFrame& frame);
+        // What an invoke does once the method is selected: runs its native
+        // code when the JIT installed some, else interprets or calls it as a
+        // native method. The class of a static method must be initialized.
+        static Outcome call(const rt_jvm_data::MethodWrapper& method, const Slot* arguments,
+                            const Runtime& runtime, oop::Ref thread);
+
+        // JVMS 6.5 checkcast: whether a value of type `from` may be used as a `to`
+        static bool is_subtype(const rt_jvm_data::RawKlass* from, const rt_jvm_data::RawKlass* to);
+
+        // Calls `method` with `arguments`, the receiver first and long and
+        // double taking two slots; initializes the class of a static method
+        // first. Throws JavaException like interpret.
+        static Slot invoke(const rt_jvm_data::MethodWrapper& method,
+                           std::span<const Slot> arguments, const Runtime& runtime,
+                           oop::Ref thread = oop::Ref::null());
 
         // 方便调试/反汇编：根据 opcode 获取名字
         static const char* opcode_name(std::uint8_t opcode);
+        // the opcode and its operands, 0 for the switches and wide, whose
+        // length depends on where they are, and for unknown opcodes
+        static std::uint8_t opcode_length(std::uint8_t opcode);
+        // Length of the instruction at `pc` of `code`, 0 when it runs past the
+        // code or the opcode is unknown.
+        static std::size_t instruction_length(std::span<const std::uint8_t> code,
+                                              std::size_t pc) noexcept;
+
+        // Writes superinstructions over the sequences of `code` they stand
+        // for, as far as the instructions are there; InstanceKlass::link does
+        // for every method. Quickening fuses again as it completes sequences.
+        static void fuse(const rt_jvm_data::CodeInfo& code);
 
-#define X(code, name) static void op_##name(StackFrame& frame);
+#define X(code, name, length) static void op_##name(Registers& regs);
 #include "byte_code_engine.def"
 #undef X
 
       private:
         static std::array<Handler, 256> handlers;
+
+        static Outcome run(StackFrame& frame, const Runtime& runtime, oop::Ref exception);
+
+        static Registers run_threaded(Registers regs);
+        static Registers run_table(Registers regs);
+        static Registers run_cached(Registers regs);
     };
 };
-
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+
+#include "java_base.hpp"
+#include "klass.hpp"
+#include "oop.hpp"
+
+// What the interpreter and the JIT both read out of bytecode, the constant
+// pool cache and objects.
+namespace jvm {
+
+    // operands, big endian like the class file
+    inline raw_jvm_type::u2 u2_at(const raw_jvm_type::u1* p) noexcept {
+        return static_cast<raw_jvm_type::u2>(p[0] << 8 | p[1]);
+    }
+    inline std::int16_t s2_at(const raw_jvm_type::u1* p) noexcept {
+        return static_cast<std::int16_t>(u2_at(p));
+    }
+    inline std::int32_t s4_at(const raw_jvm_type::u1* p) noexcept {
+        return static_cast<std::int32_t>(static_cast<raw_jvm_type::u4>(p[0]) << 24 |
+                                         p[1] << 16 | p[2] << 8 | p[3]);
+    }
+
+    // operand stack and local variable slots a value of `type` takes
+    inline raw_jvm_type::u1 slots_of(rt_jvm_data::raw_value_type type) noexcept {
+        return type == rt_jvm_data::raw_value_type::Jlong ||
+                       type == rt_jvm_data::raw_value_type::Jdouble
+                   ? 2
+                   : 1;
+    }
+
+    // the ArrayKlass of an array, the InstanceKlass of anything else
+    inline const rt_jvm_data::RawKlass* type_of(const oop::BasicOop* object) noexcept {
+        return static_cast<const oop::InstanceOop*>(object)->kls_ptr;
+    }
+
+    // the type a Class constant names, null when it does not resolve
+    inline const rt_jvm_data::RawKlass*
+    class_type(const rt_jvm_data::CpCacheEntry* entry) noexcept {
+        if (entry == nullptr) return nullptr;
+        if (entry->klass != nullptr) return entry->klass;
+        return entry->array_klass;
+    }
+}; // namespace jvm
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "java_base.hpp"
+#include "klass.hpp"
+#include "system_dictionary.hpp"
+#include "../classFile/class_archive.hpp"
+#include "../classFile/class_path.hpp"
+#include "../utils/singleton.hpp"
+
+namespace rt_jvm_data {
+
+    struct BatchLoadResult {
+        std::size_t loaded = 0;
+        std::size_t duplicates = 0;
+        // "class name: reason" for every class that could not be parsed
+        std::vector<std::string> failures;
+    };
+
+    // Parses many classes at once on a pool of worker threads and publishes
+    // them into a shared dictionary.
+    class BatchClassLoader {
+      private:
+        SystemDictionary& dictionary;
+        unsigned worker_count;
+
+        // builds and publishes job 0 .. count-1 on the worker pool
+        BatchLoadResult run(std::size_t count,
+                            const std::function<std::string(std::size_t)>& name_of,
+                            const std::function<std::unique_ptr<InstanceKlass>(std::size_t)>& build);
+
+      public:
+        // `workers` == 0 uses one worker per hardware thread
+        explicit BatchClassLoader(SystemDictionary& dict = SystemDictionary::instance(),
+                                  unsigned workers = 0);
+
+        BatchLoadResult load_directory(const std::filesystem::path& dir);
+        // every class of every entry; a name found twice is taken from the earlier entry
+        BatchLoadResult load_classpath(const ClassPath& classpath);
+        // every class of a shared archive, without parsing the class files again
+        BatchLoadResult load_archive(const raw_jvm_data::SharedClassArchive& archive);
+
+        unsigned get_worker_count() const noexcept {
+            return worker_count;
+        }
+    };
+}; // namespace rt_jvm_data
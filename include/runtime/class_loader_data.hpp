@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "metaspace.hpp"
+#include "oop.hpp"
+#include "../utils/singleton.hpp"
+
+namespace rt_jvm_data {
+
+    class InstanceKlass;
+    class SystemDictionary;
+
+    // Runtime side of one class loader: its mirror and the metaspace holding
+    // the metadata of every class it defines. The bootstrap loader has none
+    // and is written as a null ClassLoaderData pointer; its classes use
+    // Metaspace::boot().
+    class ClassLoaderData {
+      private:
+        oop::Ref mirror;
+        Metaspace metaspace;
+
+        // loaders whose classes the classes of this one were linked against
+        // or resolved; they stay loaded as long as this one does
+        mutable std::mutex dependencies_mtx;
+        std::vector<const ClassLoaderData*> dependencies;
+
+      public:
+        explicit ClassLoaderData(oop::Ref mirror = oop::Ref::null()) noexcept : mirror(mirror) {
+        }
+
+        ClassLoaderData(const ClassLoaderData&) = delete;
+        ClassLoaderData& operator=(const ClassLoaderData&) = delete;
+
+        // the java/lang/ClassLoader object
+        oop::Ref get_mirror() const noexcept {
+            return mirror;
+        }
+
+        Metaspace& get_metaspace() noexcept {
+            return metaspace;
+        }
+        const Metaspace& get_metaspace() const noexcept {
+            return metaspace;
+        }
+
+        // Notes that a class of this loader refers to a class `target` defines.
+        // Nothing is recorded for the bootstrap loader, which is never
+        // unloaded, or for the loader itself.
+        void record_dependency(const ClassLoaderData* target);
+        std::vector<const ClassLoaderData*> get_dependencies() const;
+
+        // where the metadata of classes defined by `loader` goes
+        static Metaspace& metaspace_of(ClassLoaderData* loader) noexcept {
+            return loader == nullptr ? Metaspace::boot() : loader->metaspace;
+        }
+    };
+
+    // Every class loader of the VM except the bootstrap loader.
+    //
+    // A loader is unloaded once the collector finds its mirror unreachable and
+    // no loader still alive depends on it. Its klasses leave the dictionary,
+    // the unloading observers drop whatever compiled code and inline caches
+    // point at them, and then the klasses and the loader's metaspace are freed
+    // together. A loader without a mirror is never unloaded. The graph must
+    // outlive any dictionary still holding klasses of its loaders.
+    class ClassLoaderDataGraph : public Singleton<ClassLoaderDataGraph> {
+      public:
+        using IsAlive = std::function<bool(oop::Ref mirror)>;
+        // called with the klasses about to be freed, still intact
+        using UnloadingObserver = std::function<void(std::span<const InstanceKlass* const>)>;
+
+      private:
+        mutable std::mutex mtx;
+        std::vector<std::unique_ptr<ClassLoaderData>> loaders;
+        std::vector<std::pair<std::size_t, UnloadingObserver>> observers;
+        std::size_t next_observer = 0;
+
+      public:
+        ClassLoaderDataGraph() = default;
+
+        ClassLoaderData* add(oop::Ref mirror);
+        std::size_t size() const;
+
+        // Observers run newest first, so that one added by a part built on
+        // another runs before that one's. Returns the handle
+        // remove_unloading_observer takes; whoever adds an observer that
+        // outlives it removes it before going away.
+        std::size_t add_unloading_observer(UnloadingObserver observer);
+        void remove_unloading_observer(std::size_t handle);
+
+        // Unloads every loader that `is_alive` and the dependencies of the live
+        // loaders no longer keep, returning how many went. Meant for the end of
+        // a collection with the world stopped: no thread may be inside
+        // `dictionary` or hold a klass of an unloaded loader.
+        std::size_t do_unloading(const IsAlive& is_alive, SystemDictionary& dictionary);
+    };
+}; // namespace rt_jvm_data
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "class_loader_data.hpp"
+#include "jit_compiler.hpp"
+#include "klass.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <stop_token>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace jvm {
+    // the thresholds of the tiers and how many threads compile
+    struct CompilePolicy {
+        // from the interpreter to baseline code
+        TierThresholds baseline{1000, 10000};
+        // from baseline to optimized code, counted on from the above
+        TierThresholds optimized{10000, 100000};
+        std::size_t threads = 1;
+    };
+
+    // Tiered compilation. Every method starts out interpreted, and the
+    // interpreter counts its calls and loop back edges. Past the baseline
+    // thresholds the method is queued for the baseline JIT, whose code goes
+    // on counting; past the optimized ones it is queued again and compiled
+    // with the full pipeline. Compiler threads of their own take the hottest
+    // method queued first, and JitCompiler installs its code with a single
+    // atomic store: calls already running finish where they are, later calls
+    // take the new code.
+    //
+    // Threads running Java never wait for a compilation. Counting takes no
+    // lock and looks at the tier only when a counter reaches a threshold or a
+    // power of two; queueing a method takes a lock that the compiler threads
+    // only hold to push and pop, each in logarithmic time.
+    //
+    // When a class loader is unloaded, the methods of its classes leave the
+    // queue, and the unloading waits for those being compiled.
+    class CompileBroker {
+      private:
+        // how hot a method was when queued
+        struct Queued {
+            std::uint64_t hotness;
+            const rt_jvm_data::MethodWrapper* method;
+
+            bool operator<(const Queued& other) const noexcept {
+                return hotness < other.hotness;
+            }
+        };
+
+        CompilePolicy policy;
+        JitCompiler jit;
+        rt_jvm_data::ClassLoaderDataGraph& graph;
+        std::size_t observer;
+
+        std::mutex mtx;
+        // a method is queued once for each tier it moves to
+        std::condition_variable_any queued;
+        std::condition_variable idle;
+        // a compiler thread finished a method
+        std::condition_variable finished;
+        // a heap, the hottest method on top
+        std::vector<Queued> queue;
+        // taken off the queue while another thread compiled them, and queued
+        // again once it is done
+        std::vector<const rt_jvm_data::MethodWrapper*> deferred;
+        // what is in `queue` or `deferred`
+        std::unordered_set<const rt_jvm_data::MethodWrapper*> waiting;
+        // taken by a compiler thread; never compiled by two at once, so code
+        // is installed in the order of its tiers
+        std::vector<const rt_jvm_data::MethodWrapper*> compiling;
+        // last, so that they stop before the rest goes away
+        std::vector<std::jthread> threads;
+
+        // what `method` has to reach to leave `tier`, null at the top
+        const TierThresholds* next(rt_jvm_data::Tier tier) const noexcept {
+            switch (tier) {
+                case rt_jvm_data::Tier::Interpreted:
+                    return &policy.baseline;
+                case rt_jvm_data::Tier::Baseline:
+                    return &policy.optimized;
+                default:
+                    return nullptr;
+            }
+        }
+
+        void submit(const rt_jvm_data::MethodWrapper& method, rt_jvm_data::Tier from);
+        void push(const rt_jvm_data::MethodWrapper& method);
+        void work(std::stop_token stop);
+        void unload(std::span<const rt_jvm_data::InstanceKlass* const> klasses);
+
+      public:
+        // `graph` tells about the loaders unloaded and must outlive the broker
+        explicit CompileBroker(CompilePolicy policy = {},
+                               rt_jvm_data::ClassLoaderDataGraph& graph =
+                                   rt_jvm_data::ClassLoaderDataGraph::instance());
+        // Stops the compiler threads, letting each finish the method it is
+        // compiling, and uninstalls every method's code like ~JitCompiler.
+        ~CompileBroker();
+        CompileBroker(const CompileBroker&) = delete;
+        CompileBroker& operator=(const CompileBroker&) = delete;
+
+        // Whether a counter that just reached `count` is worth a call to
+        // profile: at a threshold, and at every power of two for the counts
+        // that went past one, through increments lost to other threads or
+        // while the method was in a lower tier.
+        bool due(raw_jvm_type::u4 count) const noexcept {
+            return (count & (count - 1)) == 0 || count == policy.baseline.invocations ||
+                   count == policy.baseline.backedges || count == policy.optimized.invocations ||
+                   count == policy.optimized.backedges;
+        }
+
+        // Queues `method` for its next tier once its counters reach the
+        // thresholds of that tier. Called after counting when due, from the
+        // interpreter and from baseline code.
+        void profile(const rt_jvm_data::MethodWrapper& method) {
+            rt_jvm_data::Tier tier = method.tier.load(std::memory_order_relaxed);
+            const TierThresholds* thresholds = next(tier);
+            if (thresholds == nullptr) return;
+            if (method.invocations.load(std::memory_order_relaxed) >= thresholds->invocations ||
+                method.backedges.load(std::memory_order_relaxed) >= thresholds->backedges) {
+                submit(method, tier);
+            }
+        }
+
+        // Blocks until nothing is queued or being compiled.
+        void wait_idle();
+
+        const CompilePolicy& get_policy() const noexcept {
+            return policy;
+        }
+    };
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include "java_base.hpp"
+
+namespace rt_jvm_data {
+
+    // `count` references stored back to back from `offset`
+    struct OopMapBlock {
+        raw_jvm_type::u4 offset;
+        raw_jvm_type::u4 count;
+
+        bool operator==(const OopMapBlock&) const noexcept = default;
+    };
+
+    // Where the fields of a class live. Instance offsets count from the start of
+    // the object's field area (InstanceOop::bytes), static offsets from the start
+    // of the class's static block.
+    struct FieldLayout {
+        // end of the last instance field, inherited ones included; a subclass
+        // continues from here and may fill the tail padding
+        raw_jvm_type::u4 instance_size = 0;
+        raw_jvm_type::u4 static_size = 0;
+        // every reference of an instance, the superclass blocks first
+        std::vector<OopMapBlock> oop_maps;
+        // static references come first in the static block
+        raw_jvm_type::u4 static_oop_count = 0;
+
+        // bytes to allocate for the field area of an instance
+        raw_jvm_type::u4 object_size() const noexcept {
+            return (instance_size + 7) & ~7u;
+        }
+    };
+
+    struct FieldShape {
+        // 1, 2, 4 or 8, fields are aligned to their size
+        raw_jvm_type::u1 size;
+        bool reference;
+        bool is_static;
+    };
+
+    // Lays out the fields declared by one class after those of `super`, which
+    // is null for a class without instance fields above it. Each group is
+    // packed widest first, references leading the 8 byte group so that they
+    // form one block per class; holes left by the superclass or by alignment
+    // are filled with narrower fields. offsets[i] receives the offset of
+    // fields[i].
+    FieldLayout layout_fields(std::span<const FieldShape> fields, const FieldLayout* super,
+                              std::span<raw_jvm_type::u4> offsets);
+}; // namespace rt_jvm_data
@@ -36,24 +36,28 @@ class ThreadRegistry : public Singleton<ThreadRegistry> {
     std::vector<std::shared_ptr<JavaThread>> snapshot();
 };
 
+// One local variable or operand stack entry. A slot is a machine word so that
+// a reference fits; long and double take two slots and live in the first.
 struct Slot {
-    raw_jvm_type::u4 raw{0};
+    raw_jvm_type::u8 raw{0};
 
-    Slot(raw_jvm_type::u4 v = 0) : raw(v) {
+    Slot(raw_jvm_type::u8 v = 0) : raw(v) {
     }
 
     template <class T> void write(const T& v) noexcept {
         using U = std::remove_cvref_t<T>;
         static_assert(std::is_trivially_copyable_v<U>, "T must be trivially copyable");
 
-        if constexpr (std::is_same_v<U, raw_jvm_type::u4>) {
-            raw = std::bit_cast<raw_jvm_type::u4>(v);
+        if constexpr (std::is_same_v<U, raw_jvm_type::u8>) {
+            raw = v;
+        } else if constexpr (std::is_same_v<U, raw_jvm_type::u4>) {
+            raw = static_cast<raw_jvm_type::u8>(v);
         } else if constexpr (std::is_same_v<U, raw_jvm_type::u2>) {
-            raw = static_cast<raw_jvm_type::u4>(std::bit_cast<raw_jvm_type::u2>(v));
+            raw = static_cast<raw_jvm_type::u8>(v);
         } else if constexpr (std::is_same_v<U, raw_jvm_type::u1>) {
-            raw = static_cast<raw_jvm_type::u4>(std::bit_cast<raw_jvm_type::u1>(v));
+            raw = static_cast<raw_jvm_type::u8>(v);
         } else {
-            static_assert(!sizeof(U), "Slot::write only supports u1/u2/u4");
+            static_assert(!sizeof(U), "Slot::write only supports u1/u2/u4/u8");
         }
     }
 
@@ -61,108 +65,121 @@ struct Slot {
         using U = std::remove_cvref_t<T>;
         static_assert(std::is_trivially_copyable_v<U>, "T must be trivially copyable");
 
-        if constexpr (std::is_same_v<U, raw_jvm_type::u4>) {
-            return std::bit_cast<U>(raw);
+        if constexpr (std::is_same_v<U, raw_jvm_type::u8>) {
+            return raw;
+        } else if constexpr (std::is_same_v<U, raw_jvm_type::u4>) {
+            return static_cast<U>(raw & 0xFFFFFFFFu);
         } else if constexpr (std::is_same_v<U, raw_jvm_type::u2>) {
-            return std::bit_cast<U>(static_cast<raw_jvm_type::u2>(raw & 0xFFFFu));
+            return static_cast<U>(raw & 0xFFFFu);
         } else if constexpr (std::is_same_v<U, raw_jvm_type::u1>) {
-            return std::bit_cast<U>(static_cast<raw_jvm_type::u1>(raw & 0xFFu));
+            return static_cast<U>(raw & 0xFFu);
         } else {
-            static_assert(!sizeof(U), "Slot::read only supports u1/u2/u4");
+            static_assert(!sizeof(U), "Slot::read only supports u1/u2/u4/u8");
         }
     }
 };
 
 class StackFrame {
   private:
-    struct OperandStack {
-        explicit OperandStack(int sz_bytes) : size(sz_bytes), top(0) {
-            // 用 max_align_t 保证对齐
-            data = static_cast<std::byte*>(
-                ::operator new (sz_bytes, std::align_val_t{alignof(std::max_align_t)}));
-        }
-
-        ~OperandStack() {
-            ::operator delete (data, std::align_val_t{alignof(std::max_align_t)});
-        }
-
-        OperandStack(const OperandStack&) = delete;
-        OperandStack& operator=(const OperandStack&) = delete;
-
-        template <class T> void push(T v) {
-            static_assert(std::is_trivially_copyable_v<T>);
-            std::size_t need = sizeof(T);
-            assert(top + need <= size);
-
-            std::memcpy(data + top, &v, need);
-            top += need;
-        }
-
-        template <class T> T pop() {
-            static_assert(std::is_trivially_copyable_v<T>);
-            std::size_t need = sizeof(T);
-            assert(top >= need);
-
-            top -= need;
-            T v{};
-            std::memcpy(&v, data + top, need);
-            return v;
-        }
-
-      private:
-        int size;
-        int top;
-        std::byte* data;
-    };
-
     raw_jvm_type::u4 pc{};
     raw_jvm_type::u2 max_locals;
     raw_jvm_type::u2 max_stack;
+    // the locals, then the operand stack
     std::vector<Slot> slots;
+    // operand stack slots in use; the interpreter keeps its own stack pointer
+    // while it runs the frame and stores it here at calls
+    raw_jvm_type::u2 depth = 0;
 
-    OperandStack op_stack;
     const rt_jvm_data::InstanceKlass& kls;
     oop::Ref jvm_thread;
+    // decoded Code attribute of the running method, null for hand made frames
+    const rt_jvm_data::CodeInfo* code = nullptr;
+    const rt_jvm_data::MethodWrapper* method = nullptr;
+
+    static constexpr raw_jvm_type::u2 width_of(std::size_t bytes) noexcept {
+        return bytes == sizeof(raw_jvm_type::u8) ? 2 : 1;
+    }
 
   public:
     explicit StackFrame(const raw_jvm_type::u2 max_locals_, const raw_jvm_type::u2 max_stacks_,
                         const rt_jvm_data::InstanceKlass& kls_, oop::Ref jvm_thread_)
         : pc(0), max_locals(max_locals_), max_stack(max_stacks_),
-          slots(static_cast<int>(max_locals_)), op_stack(max_stacks_), kls(kls_),
+          slots(static_cast<std::size_t>(max_locals_) + max_stacks_), kls(kls_),
           jvm_thread(jvm_thread_) {
     }
 
+    // frame for a method with a Code attribute, sized from its decoded header
+    explicit StackFrame(const rt_jvm_data::MethodWrapper& method_, oop::Ref jvm_thread_)
+        : StackFrame(method_.code_info->max_locals, method_.code_info->max_stack, *method_.kls,
+                     jvm_thread_) {
+        code = &*method_.code_info;
+        method = &method_;
+    }
+
+    raw_jvm_type::u4 get_pc() const noexcept {
+        return pc;
+    }
+    void set_pc(raw_jvm_type::u4 pc_) noexcept {
+        pc = pc_;
+    }
+
+    const rt_jvm_data::CodeInfo* get_code() const noexcept {
+        return code;
+    }
+    const rt_jvm_data::MethodWrapper* get_method() const noexcept {
+        return method;
+    }
+    const rt_jvm_data::InstanceKlass& get_klass() const noexcept {
+        return kls;
+    }
+    oop::Ref get_thread() const noexcept {
+        return jvm_thread;
+    }
+
+    Slot* locals() noexcept {
+        return slots.data();
+    }
+    Slot* stack() noexcept {
+        return slots.data() + max_locals;
+    }
+    raw_jvm_type::u2 get_depth() const noexcept {
+        return depth;
+    }
+    void set_depth(raw_jvm_type::u2 depth_) noexcept {
+        assert(depth_ <= max_stack);
+        depth = depth_;
+    }
+
+    // Moves pc to the handler for an exception thrown at the current pc. The
+    // operand stack is emptied for the handler, which pushes the exception
+    // itself. Returns false when the exception propagates to the caller.
+    template <class CatchPredicate> bool dispatch_exception(CatchPredicate&& catches) {
+        assert(code != nullptr);
+        const auto* handler = code->find_handler(pc, std::forward<CatchPredicate>(catches));
+        if (handler == nullptr) return false;
+        depth = 0;
+        pc = handler->handler_pc;
+        return true;
+    }
+
     template <raw_jvm_type::JvmWord T> T read(int index) const noexcept {
-        using U = std::remove_cvref_t<T>;
-        if constexpr (std::is_same_v<U, raw_jvm_type::u8>) {
-            const auto& lo = slots[index + 0];
-            const auto& hi = slots[index + 1];
-            raw_jvm_type::u8 lo32 = lo.read<raw_jvm_type::u4>();
-            raw_jvm_type::u8 hi32 = hi.read<raw_jvm_type::u4>();
-            return static_cast<U>((hi32 << 32) | lo32);
-        } else {
-            return slots[index].template read<U>();
-        }
+        return slots[index].template read<std::remove_cvref_t<T>>();
     }
 
     template <raw_jvm_type::JvmWord T> void write(const T& value, int index) noexcept {
-        using U = std::remove_cvref_t<T>;
-        if constexpr (std::is_same_v<U, raw_jvm_type::u8>) {
-            raw_jvm_type::u4 lo32 = static_cast<raw_jvm_type::u4>(value & 0xFFFFFFFFull);
-            raw_jvm_type::u4 hi32 = static_cast<raw_jvm_type::u4>((value >> 32) & 0xFFFFFFFFull);
-            slots[index + 0].write<raw_jvm_type::u4>(lo32);
-            slots[index + 1].write<raw_jvm_type::u4>(hi32);
-        } else {
-            slots[index].template write<U>(value);
-        }
+        slots[index].template write<std::remove_cvref_t<T>>(value);
     }
 
     template <raw_jvm_type::JvmWord T> void push(const T t) {
-        op_stack.push(t);
+        assert(depth + width_of(sizeof(T)) <= max_stack);
+        stack()[depth].write(t);
+        depth += width_of(sizeof(T));
     }
 
     template <raw_jvm_type::JvmWord T> T pop() {
-        return op_stack.pop<T>();
+        assert(depth >= width_of(sizeof(T)));
+        depth -= width_of(sizeof(T));
+        return stack()[depth].template read<T>();
     }
 };
 
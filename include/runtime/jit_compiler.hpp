@@ -0,0 +1,92 @@
+#pragma once
+
+#include "byte_code_engine.hpp"
+#include "class_loader_data.hpp"
+#include "klass.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+
+namespace llvm::orc {
+    class LLJIT;
+};
+
+namespace jvm {
+    // When a method moves up a tier: once either counter on its
+    // MethodWrapper reaches its threshold here.
+    struct TierThresholds {
+        raw_jvm_type::u4 invocations;
+        raw_jvm_type::u4 backedges;
+    };
+
+    // Baseline JIT. Translates the bytecode of a method to LLVM IR, a basic
+    // block per block of bytecode with the locals and the operand stack
+    // promoted to SSA values, compiles it with ORC LLJIT and installs the
+    // result as MethodWrapper::compiled, which BytecodeEngine::call runs from
+    // then on instead of the interpreter.
+    //
+    // Compiled code calls every method through BytecodeEngine::call, so
+    // compiled and interpreted methods call each other freely. What it does
+    // not do itself it leaves to the interpreter: at a constant nothing
+    // resolved yet, a class not initialized, an instruction that would throw
+    // or an exception a handler of the method may catch, and at monitors,
+    // jsr and wide, the compiled code stores its locals and operand stack in
+    // a StackFrame and BytecodeEngine::resume runs the rest of the activation.
+    //
+    // When a class loader is unloaded, the methods of its classes lose their
+    // code and are forgotten before the classes are freed.
+    class JitCompiler {
+      private:
+        std::unique_ptr<llvm::orc::LLJIT> jit;
+        // every method given code, reset again when the compiler goes away,
+        // and the methods being compiled
+        std::mutex installed_mtx;
+        std::condition_variable finished;
+        std::vector<const rt_jvm_data::MethodWrapper*> installed;
+        std::vector<const rt_jvm_data::MethodWrapper*> compiling;
+        // for unique symbol names
+        std::atomic<std::uint64_t> modules{0};
+
+        rt_jvm_data::ClassLoaderDataGraph& graph;
+        std::size_t observer;
+
+        rt_jvm_data::CompiledCode build(const rt_jvm_data::MethodWrapper& method,
+                                        rt_jvm_data::Tier tier, const TierThresholds* profile);
+        // waits for the methods of `klasses` being compiled, then uninstalls
+        // and forgets them
+        void unload(std::span<const rt_jvm_data::InstanceKlass* const> klasses);
+
+      public:
+        // `graph` tells about the loaders unloaded and must outlive the compiler
+        explicit JitCompiler(rt_jvm_data::ClassLoaderDataGraph& graph =
+                                 rt_jvm_data::ClassLoaderDataGraph::instance());
+        // Uninstalls the code of every method it compiled; the classes of
+        // those methods must still be there, and nothing may run the code.
+        ~JitCompiler();
+        JitCompiler(const JitCompiler&) = delete;
+        JitCompiler& operator=(const JitCompiler&) = delete;
+
+        // Whether compile takes `method`: one with verified code that is not
+        // synchronized, whose monitor the interpreter keeps.
+        static bool can_compile(const rt_jvm_data::MethodWrapper& method) noexcept;
+
+        // Compiles `method` against the constant pool cache entries resolved
+        // so far and installs the code, where calls already running keep
+        // interpreting or running the code it replaces. False when the method
+        // cannot be compiled, for code whose stack depths do not agree. May be
+        // called from any thread.
+        //
+        // Baseline code only gets mem2reg and some clean-up; with `profile`
+        // it also counts its calls and back edges on the method and hands it
+        // to Runtime::compiler once one of them reaches the threshold there.
+        // Optimized code goes through the full -O2 pipeline and counts nothing.
+        bool compile(const rt_jvm_data::MethodWrapper& method,
+                     rt_jvm_data::Tier tier = rt_jvm_data::Tier::Baseline,
+                     const TierThresholds* profile = nullptr);
+    };
+};
@@ -2,29 +2,38 @@
 
 #include "java_base.hpp"
 #include "runtime/oop.hpp"
-#include "string_pool.hpp"
+#include "field_layout.hpp"
+#include "signature.hpp"
+#include "symbol_table.hpp"
 #include "../classFile/class_file.hpp"
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+struct Slot;
+namespace jvm {
+    struct Runtime;
+};
 
 namespace rt_jvm_data {
 
-    enum class raw_value_type { Jbyte, Jchar, Jshort, Jint, Jfloat, Jdouble, Jreference };
-
-    static std::unordered_map<raw_value_type, raw_jvm_type::u1> TYPE_SIZE_REC{
-        {raw_value_type::Jbyte, 1},     {raw_value_type::Jchar, 2},  {raw_value_type::Jshort, 2},
-        {raw_value_type::Jint, 4},      {raw_value_type::Jfloat, 4}, {raw_value_type::Jdouble, 8},
-        {raw_value_type::Jreference, 8}};
-
-    static std::unordered_map<char, raw_value_type> TYPE_CHAC_REC{
-        {'B', raw_value_type::Jbyte},      {'C', raw_value_type::Jchar},
-        {'S', raw_value_type::Jshort},     {'I', raw_value_type::Jint},
-        {'F', raw_value_type::Jfloat},     {'D', raw_value_type::Jdouble},
-        {'L', raw_value_type::Jreference}, {'[', raw_value_type::Jreference}};
-
     [[nodiscard]] inline raw_jvm_type::u1 type_size_of(raw_value_type t) noexcept {
         using u1 = raw_jvm_type::u1;
 
         switch (t) {
+            case raw_value_type::Jboolean:
+                return u1{1};
             case raw_value_type::Jbyte:
                 return u1{1};
             case raw_value_type::Jchar:
@@ -33,6 +42,8 @@ namespace rt_jvm_data {
                 return u1{2};
             case raw_value_type::Jint:
                 return u1{4};
+            case raw_value_type::Jlong:
+                return u1{8};
             case raw_value_type::Jfloat:
                 return u1{4};
             case raw_value_type::Jdouble:
@@ -47,6 +58,8 @@ namespace rt_jvm_data {
 
     [[nodiscard]] inline raw_value_type char_to_raw_type(char c) {
         switch (c) {
+            case 'Z':
+                return raw_value_type::Jboolean;
             case 'B':
                 return raw_value_type::Jbyte;
             case 'C':
@@ -55,6 +68,8 @@ namespace rt_jvm_data {
                 return raw_value_type::Jshort;
             case 'I':
                 return raw_value_type::Jint;
+            case 'J':
+                return raw_value_type::Jlong;
             case 'F':
                 return raw_value_type::Jfloat;
             case 'D':
@@ -70,6 +85,8 @@ namespace rt_jvm_data {
 
     [[nodiscard]] inline char raw_type_to_char(raw_value_type t) {
         switch (t) {
+            case raw_value_type::Jboolean:
+                return 'Z';
             case raw_value_type::Jbyte:
                 return 'B';
             case raw_value_type::Jchar:
@@ -78,6 +95,8 @@ namespace rt_jvm_data {
                 return 'S';
             case raw_value_type::Jint:
                 return 'I';
+            case raw_value_type::Jlong:
+                return 'J';
             case raw_value_type::Jfloat:
                 return 'F';
             case raw_value_type::Jdouble:
@@ -90,43 +109,267 @@ namespace rt_jvm_data {
         }
     }
 
-    struct RuntimeConstantItem;
     struct MethodWrapper;
     struct FieldWrapper;
+    class ClassLoaderData;
     struct AttributeWrapper;
     class InstanceKlass;
+    class ArrayKlass;
 
-    using RuntimeConstantItem_ptr = RuntimeConstantItem*;
     using MethodWrapper_ptr = MethodWrapper*;
     using FieldWrapper_ptr = FieldWrapper*;
     using AttributeWrapper_ptr = AttributeWrapper*;
     using Klass_ptr = InstanceKlass*;
 
-    struct RuntimeConstantItem {};
+    // View of one attribute. Nothing is decoded up front: the body stays in the
+    // class file image until a consumer reads it through bytes() or reader().
+    struct AttributeWrapper {
+        const raw_jvm_data::AttributeInfo* aptr;
+        AttributeWrapper(const raw_jvm_data::AttributeInfo* aptr) noexcept;
+
+        std::span<const raw_jvm_type::u1> bytes() const noexcept {
+            return {aptr->info.get(), aptr->attribute_length};
+        }
 
-    struct RuntimeMethodRef : public RuntimeConstantItem {};
+        ByteCodeReader reader() const noexcept {
+            return ByteCodeReader(bytes());
+        }
+    };
 
-    struct AttributeWrapper {
-        raw_jvm_data::AttributeInfo_ptr aptr;
-        AttributeWrapper(const raw_jvm_data::AttributeInfo_ptr);
+    struct ExceptionHandler {
+        raw_jvm_type::u2 start_pc;
+        raw_jvm_type::u2 end_pc;
+        raw_jvm_type::u2 handler_pc;
+        // constant pool index of the caught class, 0 catches everything
+        raw_jvm_type::u2 catch_type;
+        // position in the class file table, which decides between overlapping handlers
+        raw_jvm_type::u2 order;
+        // largest end_pc of this entry and every entry sorted before it
+        raw_jvm_type::u2 covered_end;
+    };
+
+    // The Code attribute decoded once per method. The bytecode stays in the class
+    // file image; the exception table is sorted by start_pc for binary search.
+    struct CodeInfo {
+        raw_jvm_type::u2 max_stack = 0;
+        raw_jvm_type::u2 max_locals = 0;
+        std::span<const raw_jvm_type::u1> code;
+        // The copy of `code` the interpreter runs. Instructions in it are
+        // rewritten to their private _quick forms once their constant is
+        // resolved, also through a const method; everything else reads `code`.
+        mutable std::pmr::vector<raw_jvm_type::u1> quick_code;
+        std::pmr::vector<ExceptionHandler> exception_table;
+        // LineNumberTable bodies, only read when a line is asked for
+        std::pmr::vector<std::span<const raw_jvm_type::u1>> line_tables;
+        // StackMapTable body for the verifier, empty when the method has none
+        std::span<const raw_jvm_type::u1> stack_map_table;
+
+        CodeInfo(const InstanceKlass& kls, AttributeWrapper code_attr);
+
+        // The handler the JVM would pick for an exception thrown at `pc`: among the
+        // entries covering pc whose catch type satisfies `catches`, the first one
+        // in class file order. nullptr when the exception leaves the method.
+        template <class CatchPredicate>
+        const ExceptionHandler* find_handler(raw_jvm_type::u4 pc, CatchPredicate&& catches) const {
+            auto it = std::upper_bound(exception_table.begin(), exception_table.end(), pc,
+                                       [](raw_jvm_type::u4 value, const ExceptionHandler& h) {
+                                           return value < h.start_pc;
+                                       });
+
+            const ExceptionHandler* best = nullptr;
+            while (it != exception_table.begin()) {
+                --it;
+                // nothing at or before this entry reaches pc
+                if (it->covered_end <= pc) break;
+                if (pc < it->end_pc && (best == nullptr || it->order < best->order) &&
+                    catches(it->catch_type)) {
+                    best = &*it;
+                }
+            }
+            return best;
+        }
+
+        // source line of the instruction at `pc`, -1 without line information
+        int line_of(raw_jvm_type::u4 pc) const noexcept;
+    };
+
+    // (name, descriptor) of a method or field, what member resolution matches on
+    struct MemberKey {
+        Symbol name;
+        Symbol descriptor;
+
+        bool operator==(const MemberKey&) const noexcept = default;
+
+        // both ids in one word, for a multiplicative hash to spread
+        raw_jvm_type::u8 packed() const noexcept {
+            return static_cast<raw_jvm_type::u8>(name.id) << 32 | descriptor.id;
+        }
+    };
+
+    // Flat open addressing index from MemberKey to a position in a klass's
+    // member array. It is built once with the klass and only read afterwards,
+    // so lookups take no lock; keys sit in the slots and a probe touches one
+    // contiguous array.
+    class MemberIndex {
+      private:
+        struct Slot {
+            MemberKey key;
+            raw_jvm_type::u4 position;
+        };
+
+        // at most half full, empty slots have a null name
+        std::pmr::vector<Slot> slots;
+        unsigned shift = 64;
+
+        std::size_t home(MemberKey key) const noexcept {
+            return (key.packed() * 0x9E3779B97F4A7C15ull) >> shift;
+        }
+
+      public:
+        explicit MemberIndex(std::pmr::memory_resource* metadata) : slots(metadata) {
+        }
+
+        // the first of several equal keys wins
+        void build(std::span<const MemberKey> keys);
+
+        // position of `key` in the member array, -1 when absent
+        int find(MemberKey key) const noexcept {
+            if (slots.empty()) return -1;
+            for (std::size_t index = home(key);; index = (index + 1) & (slots.size() - 1)) {
+                const Slot& slot = slots[index];
+                if (slot.key == key) return static_cast<int>(slot.position);
+                if (!slot.key.name) return -1;
+            }
+        }
     };
 
+    // An atomic that copies its value along, for members of structures that
+    // are built in a vector before any other thread can see them.
+    template <class T> struct CopyableAtomic : std::atomic<T> {
+        CopyableAtomic(T value = T{}) noexcept : std::atomic<T>(value) {
+        }
+        CopyableAtomic(const CopyableAtomic& other) noexcept
+            : std::atomic<T>(other.load(std::memory_order_relaxed)) {
+        }
+        CopyableAtomic& operator=(const CopyableAtomic& other) noexcept {
+            this->store(other.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            return *this;
+        }
+    };
+
+    // Native code for a method, made by the JIT: runs the method on
+    // `arguments` like the interpreter would, stores its result in `result`
+    // and returns the exception leaving it, null when it returned.
+    using CompiledCode = oop::BasicOop* (*)(const ::Slot* arguments, const jvm::Runtime* runtime,
+                                            oop::BasicOop* thread, ::Slot* result);
+
+    // how far tiered compilation took a method: still interpreted, the
+    // baseline JIT's code, which goes on counting, or fully optimized code
+    enum class Tier : raw_jvm_type::u1 { Interpreted, Baseline, Optimized };
+
     struct MethodWrapper {
+        const InstanceKlass* kls;
         raw_jvm_data::MethodInfo_ptr mptr;
-        // late init
-        raw_jvm_type::u1_ptr code;
-        raw_jvm_type::u2 code_length;
-        std::unordered_map<std::string, AttributeWrapper> attributes;
+        Symbol name;
+        Symbol descriptor;
+        // the descriptor decoded, checked when the method is created
+        MethodSignature signature;
+        // absent for abstract and native methods
+        std::optional<CodeInfo> code_info;
+        // set by InstanceKlass::link once the verifier accepted the code;
+        // neither the interpreter nor the JIT runs a method without it
+        bool verified = false;
+        // Slot in the vtable of the declaring class and of every subclass, -1
+        // for static, private and initialisation methods, which are never
+        // selected virtually. Set by InstanceKlass::link.
+        int vtable_index = -1;
+        // position among the methods of the declaring interface, -1 outside interfaces
+        int itable_index = -1;
+        // the entry point once the JIT compiled the method, null while calls
+        // go to the interpreter; stored with release
+        mutable CopyableAtomic<CompiledCode> compiled{nullptr};
+        // Calls and taken backward branches, counted by the interpreter and
+        // by baseline code with relaxed loads and stores. Threads racing on
+        // a counter may lose counts, which only delays compilation.
+        mutable CopyableAtomic<raw_jvm_type::u4> invocations{0};
+        mutable CopyableAtomic<raw_jvm_type::u4> backedges{0};
+        // the tier the method is queued for or compiled at; CompileBroker
+        // only ever raises it
+        mutable CopyableAtomic<Tier> tier{Tier::Interpreted};
         MethodWrapper(const InstanceKlass&, const raw_jvm_data::MethodInfo_ptr);
+
+        std::optional<AttributeWrapper> get_attribute(std::string_view name) const noexcept;
     };
 
     struct FieldWrapper {
+        const InstanceKlass* kls;
         raw_jvm_data::FieldInfo_ptr fptr;
-        raw_jvm_type::u2 object_field_offset;
-        raw_jvm_type::u2 static_field_offset;
-        std::unordered_map<std::string, AttributeWrapper> attributes;
-        FieldWrapper(const InstanceKlass&, const raw_jvm_data::FieldInfo_ptr,
-                     const raw_jvm_type::u2, const raw_jvm_type::u2);
+        Symbol name;
+        Symbol descriptor;
+        raw_value_type type;
+        // into the instance field area, or the static block for static fields;
+        // assigned when the klass is linked
+        raw_jvm_type::u4 offset = 0;
+        FieldWrapper(const InstanceKlass&, const raw_jvm_data::FieldInfo_ptr, raw_value_type);
+
+        bool is_static() const noexcept {
+            return fptr->access_flags & raw_jvm_data::ACC_STATIC;
+        }
+
+        std::optional<AttributeWrapper> get_attribute(std::string_view name) const noexcept;
+    };
+
+    // One slot of a klass's constant pool cache, at the index of the constant
+    // it caches. The resolving thread fills the members for the constant's tag
+    // and then stores Resolved with release; readers that load Resolved with
+    // acquire use the members without a lock. A resolution that failed with a
+    // LinkageError stores Failed the same way, and every later attempt fails
+    // with that error (JVMS 5.4.3).
+    struct CpCacheEntry {
+        enum class State : raw_jvm_type::u1 { Unresolved, Resolving, Resolved, Failed };
+        std::atomic<State> state{State::Unresolved};
+
+        // Failed: the internal name of the error, or what the resolver threw
+        const char* error = nullptr;
+        std::exception_ptr thrown;
+
+        // Class: the klass; Fieldref: the declaring class of the field;
+        // Methodref and InterfaceMethodref: the declaring class of the method
+        const InstanceKlass* klass = nullptr;
+        // Class naming an array type: the array klass, and klass stays null
+        const ArrayKlass* array_klass = nullptr;
+        // Fieldref
+        const FieldWrapper* field = nullptr;
+        raw_jvm_type::u4 offset = 0;
+        raw_value_type type = raw_value_type::Jint;
+        // Methodref and InterfaceMethodref; vtable_index is -1 for methods
+        // that are not selected virtually
+        const MethodWrapper* method = nullptr;
+        int vtable_index = -1;
+        // Methodref and InterfaceMethodref: the method an invokespecial of
+        // this class runs, fixed once resolved
+        const MethodWrapper* special = nullptr;
+        // String: the interned java/lang/String
+        oop::Ref string;
+
+        bool is_resolved() const noexcept {
+            return state.load(std::memory_order_acquire) == State::Resolved;
+        }
+    };
+
+    // How a constant pool cache reaches the rest of the VM. `klass` returns a
+    // linked klass for an internal name, or null when it cannot be loaded;
+    // `string` returns the interned string for a literal. Both may be called
+    // from several threads at once and must give the same answer each time.
+    struct ConstantPoolResolver {
+        std::function<const InstanceKlass*(Symbol name)> klass;
+        std::function<oop::Ref(Symbol literal)> string;
+    };
+
+    // the class file found for a name defines a class of another name, or the
+    // class failed to initialize before
+    struct NoClassDefFoundError : std::runtime_error {
+        using std::runtime_error::runtime_error;
     };
 
     enum class KlassType {
@@ -139,6 +382,11 @@ namespace rt_jvm_data {
     class InstanceKlass;
     class ArrayKlass;
     class PrimitiveKlass;
+    class Verifier;
+
+    // Whether class `from` may be used where `to` is expected, both given as
+    // internal names. The verifier asks only for two distinct non-array classes.
+    using AssignabilityCheck = std::function<bool(std::string_view from, std::string_view to)>;
 
     using RawKlass_ptr = RawKlass*;
     using InstanceKlass_ptr = InstanceKlass*;
@@ -150,16 +398,27 @@ namespace rt_jvm_data {
         KlassType kls_type;
         oop::Ref mirror_ref;
 
-        std::string klass_name;
-        std::string wrapper_name;
+        std::pmr::string klass_name;
+        std::pmr::string wrapper_name;
+
+        // the klass of arrays of this one, made when first asked for
+        mutable std::atomic<ArrayKlass*> array_klass{nullptr};
+
+        explicit RawKlass(std::pmr::memory_resource* metadata = std::pmr::get_default_resource())
+            : klass_name(metadata), wrapper_name(metadata) {
+        }
+        ~RawKlass();
 
       public:
+        RawKlass(const RawKlass&) = delete;
+        RawKlass& operator=(const RawKlass&) = delete;
+
         std::string get_klass_name() const noexcept {
-            return klass_name;
+            return std::string(klass_name);
         }
 
         std::string get_wrapper_name() const noexcept {
-            return wrapper_name;
+            return std::string(wrapper_name);
         }
 
         KlassType get_klass_type() const noexcept {
@@ -173,6 +432,9 @@ namespace rt_jvm_data {
         oop::Ref get_ref() const noexcept {
             return mirror_ref;
         }
+
+        // the klass of arrays with components of this klass
+        const ArrayKlass* array_of() const;
     };
 
     template <class T>
@@ -184,28 +446,302 @@ namespace rt_jvm_data {
         friend struct MethodWrapper;
         friend struct FieldWrapper;
         friend struct AttributeWrapper;
+        friend struct CodeInfo;
         friend class ArrayKlass;
+        friend class Verifier;
+        friend class raw_jvm_data::SharedClassArchive;
+
+        // the defining loader, null for the bootstrap loader, and its metaspace
+        // where everything below is allocated
+        ClassLoaderData* loader;
+        std::pmr::memory_resource* metadata;
+
+        // indexed like the constant pool; entries are filled on first use and
+        // may be resolved through a const klass
+        std::span<CpCacheEntry> cp_cache;
+        // in class file order, indexed by (name, descriptor)
+        std::pmr::vector<MethodWrapper> rt_methods{metadata};
+        std::pmr::vector<FieldWrapper> rt_fields{metadata};
+        MemberIndex method_index{metadata};
+        MemberIndex field_index{metadata};
+
+        Symbol symbol_of(raw_jvm_type::u2 utf8_index) const;
+        // keeps the loader of `kls` loaded while this klass's loader is
+        void record_dependency(const InstanceKlass* kls) const;
+        MemberKey member_key(raw_jvm_data::ConstantNameAndType_ptr) const;
+
+        template <ConstantItemPtr T> T get_cp_item(const int index) const {
+            assert(index < this->constant_pool_count);
 
-        std::unordered_map<raw_jvm_type::u2, RuntimeConstantItem_ptr> translated_constant_pool;
-        std::unordered_map<std::string, MethodWrapper> rt_methods;
-        std::unordered_map<std::string, FieldWrapper> rt_fields;
-        std::unordered_map<std::string, AttributeWrapper> rt_attributes;
+            // every alternative of the entry union lives at the entry's address
+            return reinterpret_cast<T>(&this->constant_pool[index]);
+        }
 
-        std::string generate_function_id(raw_jvm_data::ConstantUtf8_ptr name_u8ptr,
-                                         raw_jvm_data::ConstantUtf8_ptr descri_u8ptr);
-        std::string generate_function_id(raw_jvm_data::ConstantNameAndType_ptr);
+        // `field_types` were archived with the class; when null they are
+        // parsed from the field descriptors
+        void build_runtime_data(const raw_jvm_type::u1* field_types = nullptr);
+        void layout_fields(const InstanceKlass* super);
+
+        const InstanceKlass* super_klass = nullptr;
+        FieldLayout field_layout;
+
+        // Method selected for every vtable slot: inherited, overriding, or an
+        // interface method the class does not declare (a default or an
+        // abstract "miranda" method).
+        std::pmr::vector<const MethodWrapper*> vtable{metadata};
+
+        // One block per implemented interface, superinterfaces and those of
+        // the superclass included; itable_methods[first + i] implements method
+        // i of `interface`, null when nothing does.
+        struct ItableBlock {
+            const InstanceKlass* interface;
+            raw_jvm_type::u4 first;
+        };
+        std::pmr::vector<ItableBlock> itable{metadata};
+        std::pmr::vector<const MethodWrapper*> itable_methods{metadata};
+        // the direct superinterfaces, in the order link was given them
+        std::pmr::vector<const InstanceKlass*> local_interfaces{metadata};
+
+        void build_vtable();
+        void build_itable(std::span<const InstanceKlass* const> interfaces);
+
+        // Where a class loaded from a shared archive sits in it; the mapping
+        // lives as long as the class file image. `linkage` is null for a class
+        // dumped unlinked.
+        struct ArchiveOrigin {
+            const raw_jvm_type::u1* base = nullptr;
+            raw_jvm_type::u4 record = 0;
+            const raw_jvm_data::ArchivedLinkage* linkage = nullptr;
+        } origin;
+        // Takes the field layout, vtable and itable from the archived linkage
+        // when it was computed against these very `super` and `interfaces`.
+        // Returns false, changing nothing, when they must be built instead.
+        bool restore_linkage(const InstanceKlass* super,
+                             std::span<const InstanceKlass* const> interfaces);
+        // What link verifies with when given no AssignabilityCheck: whether
+        // `from` is this class or one of its superclasses and `to` one of its
+        // own superclasses or interfaces. Classes outside that hierarchy are
+        // unknown here, and nothing is assignable to them.
+        bool known_assignable(std::string_view from, std::string_view to) const;
+
+        // the referenced class of a Class constant; this klass for its own name
+        const InstanceKlass* klass_at(raw_jvm_type::u2 class_index,
+                                      const ConstantPoolResolver& resolver) const;
+        // the klass of an array type given by its descriptor, null when the
+        // element class does not resolve
+        const ArrayKlass* array_klass_at(std::string_view descriptor,
+                                         const ConstantPoolResolver& resolver) const;
+        // fills an unresolved entry, returns false when the constant does not resolve
+        bool resolve_entry(raw_jvm_type::u2 index, CpCacheEntry& entry,
+                           const ConstantPoolResolver& resolver) const;
+        const CpCacheEntry* resolve_slow(raw_jvm_type::u2 index,
+                                         const ConstantPoolResolver& resolver) const;
+
+        std::once_flag link_once;
+        std::atomic<bool> linked{false};
+
+        // JVMS 5.5; a linked class starts out Uninitialized
+        enum class InitState : raw_jvm_type::u1 {
+            Uninitialized,
+            BeingInitialized,
+            Initialized,
+            Erroneous
+        };
+        mutable std::atomic<InitState> init_state{InitState::Uninitialized};
+        // the thread running the static initializers while BeingInitialized
+        mutable std::atomic<std::thread::id> init_thread{};
+        // the static fields, allocated and zeroed by link
+        std::byte* statics = nullptr;
+
+        void set_constant_values(const ConstantPoolResolver& resolver) const;
 
-        enum raw_value_type reslove_type(raw_jvm_data::ConstantUtf8_ptr);
-        enum raw_value_type reslove_type(raw_jvm_data::ConstantNameAndType_ptr);
+      public:
+        // `loader` is the defining loader, null for the bootstrap loader
+        InstanceKlass(std::fstream& in, ClassLoaderData* loader = nullptr);
+        explicit InstanceKlass(ClassFileSource_ptr src, ClassLoaderData* loader = nullptr);
+        InstanceKlass(const raw_jvm_data::SharedClassArchive& archive,
+                      const raw_jvm_data::ArchivedClassRecord& record,
+                      ClassLoaderData* loader = nullptr);
+        ~InstanceKlass();
+
+        ClassLoaderData* get_loader() const noexcept {
+            return loader;
+        }
 
-        template <ConstantItemPtr T> T get_cp_item(const int index) {
-            assert(index < this->constant_pool_count);
+        // nullptr when the class declares no such member; neither lookup allocates
+        const MethodWrapper* get_method(Symbol name, Symbol descriptor) const noexcept {
+            int position = method_index.find({name, descriptor});
+            return position < 0 ? nullptr : &rt_methods[position];
+        }
+        const MethodWrapper* get_method(std::string_view name,
+                                        std::string_view descriptor) const noexcept;
+        std::span<const MethodWrapper> get_methods() const noexcept {
+            return rt_methods;
+        }
 
-            return static_cast<T>(this->constant_pool[index]);
+        const FieldWrapper* get_field(Symbol name, Symbol descriptor) const noexcept {
+            int position = field_index.find({name, descriptor});
+            return position < 0 ? nullptr : &rt_fields[position];
+        }
+        // by name alone, a linear scan for callers that do not know the type
+        const FieldWrapper* get_field(std::string_view name) const noexcept;
+        std::span<const FieldWrapper> get_fields() const noexcept {
+            return rt_fields;
         }
 
-      public:
-        InstanceKlass(std::fstream& in);
+        // Lays out the fields after those of `super` and builds the vtable and
+        // itable from `super` and the direct `interfaces`, all of which must be
+        // linked already. `super` is null for java/lang/Object or a class
+        // linked on its own. A class loaded from a shared archive takes all of
+        // that from the archive when it was dumped linked the same way. Then
+        // verifies every method; runs once. Throws VerifyError and stays
+        // unlinked when a method is rejected. Class files older than 50 carry
+        // no stack maps, their frames are inferred instead.
+        // Without `assignable` the verifier only knows the hierarchy linked
+        // here and rejects assignments between classes outside it.
+        void link(const InstanceKlass* super = nullptr,
+                  std::span<const InstanceKlass* const> interfaces = {},
+                  const AssignabilityCheck& assignable = {});
+        bool is_linked() const noexcept {
+            return linked.load(std::memory_order_acquire);
+        }
+
+        const InstanceKlass* get_super() const noexcept {
+            return super_klass;
+        }
+
+        // Initializes the class (JVMS 5.5) once: its superclass first, then the
+        // static fields with a ConstantValue, then <clinit> through
+        // `run_clinit`. A thread asking while it initializes the class itself
+        // returns at once, other threads wait for it. When `run_clinit` throws
+        // the exception propagates and the class stays erroneous; later calls
+        // throw NoClassDefFoundError. The class must be linked.
+        void initialize(const ConstantPoolResolver& resolver,
+                        const std::function<void(const MethodWrapper& clinit)>& run_clinit) const;
+        bool is_initialized() const noexcept {
+            return init_state.load(std::memory_order_acquire) == InitState::Initialized;
+        }
+        // static field block, laid out like FieldLayout::static_size says
+        std::byte* get_statics() const noexcept {
+            return statics;
+        }
+        // field offsets, object size and reference maps; valid once linked
+        const FieldLayout& get_field_layout() const noexcept {
+            return field_layout;
+        }
+
+        bool is_interface() const noexcept {
+            return access_flags & raw_jvm_data::ACC_INTERFACE;
+        }
+        // internal names from the class file, the null symbol for java/lang/Object
+        Symbol get_super_name() const;
+        std::vector<Symbol> get_interface_names() const;
+
+        // Method resolution (JVMS 5.4.3.3 and 5.4.3.4): this class, its
+        // superclasses, then the superinterfaces; nullptr when nothing matches.
+        const MethodWrapper* resolve_method(Symbol name, Symbol descriptor) const noexcept;
+        // Field resolution (JVMS 5.4.3.2): this class, then its direct
+        // superinterfaces recursively, then its superclass the same way, so an
+        // interface field hides one of the superclass; nullptr when nothing
+        // matches.
+        const FieldWrapper* resolve_field(Symbol name, Symbol descriptor) const noexcept;
+
+        std::span<const MethodWrapper* const> get_vtable() const noexcept {
+            return vtable;
+        }
+        // invokevirtual: the method a receiver of this class runs for a
+        // resolved method whose vtable_index is `index`
+        const MethodWrapper* select_virtual(int index) const noexcept {
+            return vtable[index];
+        }
+        // invokeinterface: the implementation of the interface method
+        // `resolved`; nullptr when this class does not implement its interface
+        const MethodWrapper* select_interface(const MethodWrapper& resolved) const noexcept {
+            for (const auto& block : itable) {
+                if (block.interface == resolved.kls) {
+                    return itable_methods[block.first + resolved.itable_index];
+                }
+            }
+            return nullptr;
+        }
+        // whether `interface` is among the interfaces this class implements
+        bool implements(const InstanceKlass* interface) const noexcept {
+            return std::any_of(itable.begin(), itable.end(), [&](const ItableBlock& block) {
+                return block.interface == interface;
+            });
+        }
+
+        // Resolves the Class, Fieldref, Methodref, InterfaceMethodref or String
+        // constant at `index` once and returns its cache entry, nullptr when
+        // the class or member does not resolve; resolution_error then names
+        // the error. A class or member that did not resolve is not looked
+        // for again, and an exception the resolver threw is rethrown on every
+        // later call; a string is tried again. Concurrent callers for one
+        // entry wait for the thread resolving it, so the resolver must not
+        // come back to this entry. Once resolved, this is one acquire load.
+        const CpCacheEntry* resolve(raw_jvm_type::u2 index,
+                                    const ConstantPoolResolver& resolver) const {
+            assert(index > 0 && index < this->constant_pool_count);
+            const CpCacheEntry& entry = this->cp_cache[index];
+            if (entry.is_resolved()) return &entry;
+            return this->resolve_slow(index, resolver);
+        }
+        // The LinkageError resolving the constant at `index` failed with, by
+        // its internal name: NoClassDefFoundError, NoSuchFieldError or
+        // NoSuchMethodError. nullptr while it has not failed that way.
+        const char* resolution_error(raw_jvm_type::u2 index) const noexcept {
+            if (index == 0 || index >= this->constant_pool_count) return nullptr;
+            const CpCacheEntry& entry = this->cp_cache[index];
+            if (entry.state.load(std::memory_order_acquire) != CpCacheEntry::State::Failed) {
+                return nullptr;
+            }
+            return entry.error;
+        }
+        // the entry at `index` once resolve returned it, for quickened code
+        // that skips the check
+        const CpCacheEntry& resolved_entry(raw_jvm_type::u2 index) const noexcept {
+            assert(this->cp_cache[index].is_resolved());
+            return this->cp_cache[index];
+        }
+        // the entry at `index` if something resolved it already, without
+        // resolving it; null otherwise, and for indexes outside the pool
+        const CpCacheEntry* find_resolved(raw_jvm_type::u2 index) const noexcept {
+            if (index == 0 || index >= this->constant_pool_count) return nullptr;
+            const CpCacheEntry& entry = this->cp_cache[index];
+            return entry.is_resolved() ? &entry : nullptr;
+        }
+
+        raw_jvm_type::u2 get_major_version() const noexcept {
+            return major_version;
+        }
+        raw_jvm_type::u2 get_access_flags() const noexcept {
+            return access_flags;
+        }
+
+        // what ldc, checkcast and the exception table need from the constant
+        // pool beyond the cache: the tag of a constant, the internal name of a
+        // Class constant, and the bits of a Integer or Float and of a Long or
+        // Double constant
+        raw_jvm_type::u1 get_constant_tag(raw_jvm_type::u2 index) const noexcept {
+            return this->cp_tag(index);
+        }
+        Symbol get_class_name(raw_jvm_type::u2 class_index) const;
+        // the internal name of this class
+        Symbol get_name() const {
+            return this->get_class_name(this->this_class);
+        }
+        raw_jvm_type::u4 get_constant_bits(raw_jvm_type::u2 index) const noexcept {
+            assert(cp_tag(index) == raw_jvm_data::CONSTANT_Integer ||
+                   cp_tag(index) == raw_jvm_data::CONSTANT_Float);
+            return this->get_cp_item<raw_jvm_data::ConstantInteger_ptr>(index)->bytes;
+        }
+        raw_jvm_type::u8 get_constant_wide_bits(raw_jvm_type::u2 index) const noexcept {
+            assert(cp_tag(index) == raw_jvm_data::CONSTANT_Long ||
+                   cp_tag(index) == raw_jvm_data::CONSTANT_Double);
+            auto constant = this->get_cp_item<raw_jvm_data::ConstantLong_ptr>(index);
+            return static_cast<raw_jvm_type::u8>(constant->high_bytes) << 32 | constant->low_bytes;
+        }
+        std::optional<AttributeWrapper> get_attribute(std::string_view name) const noexcept;
 
       protected:
         std::string utf8cp_to_string(raw_jvm_data::ConstantUtf8_ptr ptr);
@@ -226,13 +762,18 @@ namespace rt_jvm_data {
         raw_value_type get_raw_type() const noexcept {
             return type;
         }
+
+        // one shared klass per primitive type, the components of its arrays;
+        // Jreference has none
+        static const PrimitiveKlass& of(raw_value_type type) noexcept;
     };
 
     class ArrayKlass : public RawKlass {
       private:
         friend class InstanceKlass;
 
-        const RawKlass_ptr klass_ptr;
+        // the innermost component: an instance or primitive klass
+        const RawKlass* const klass_ptr;
         const int dim;
 
         std::string wrapper_name;
@@ -242,20 +783,42 @@ namespace rt_jvm_data {
             char appendix = 'L';
             if (klass_ptr->get_klass_type() == KlassType::Primitive) {
                 appendix = raw_type_to_char(
-                    reinterpret_cast<PrimitiveKlass_ptr>(klass_ptr)->get_raw_type());
+                    static_cast<const PrimitiveKlass*>(klass_ptr)->get_raw_type());
 					wrapper += appendix;
 			} else {
                 wrapper += appendix;
-				wrapper += reinterpret_cast<PrimitiveKlass_ptr>(klass_ptr)->get_klass_name();
+				wrapper += klass_ptr->get_klass_name();
             }
             return wrapper;
         }
 
       public:
-        ArrayKlass(const RawKlass_ptr klass_ptr, const int dim_) noexcept
+        // named by its descriptor, [I or [[Ljava/lang/String;
+        ArrayKlass(const RawKlass* klass_ptr, const int dim_)
             : klass_ptr(klass_ptr), dim(dim_) {
             kls_type = KlassType::Array;
-            this->klass_name = klass_ptr->get_klass_name();
+            this->klass_name.assign(dim, '[');
+            if (klass_ptr->get_klass_type() == KlassType::Primitive) {
+                this->klass_name += raw_type_to_char(
+                    static_cast<const PrimitiveKlass*>(klass_ptr)->get_raw_type());
+            } else {
+                this->klass_name += 'L' + klass_ptr->get_klass_name() + ';';
+            }
+        }
+
+        const RawKlass* get_element() const noexcept {
+            return klass_ptr;
+        }
+        int get_dimensions() const noexcept {
+            return dim;
+        }
+        // the type of one component: the element, or an array klass of one
+        // dimension less
+        const RawKlass* get_component() const;
+        // bytes per component, 8 for references
+        raw_jvm_type::u4 component_size() const noexcept {
+            if (dim > 1 || klass_ptr->get_klass_type() != KlassType::Primitive) return 8;
+            return type_size_of(static_cast<const PrimitiveKlass*>(klass_ptr)->get_raw_type());
         }
 
         std::string get_wrapper_name() noexcept {
@@ -265,4 +828,10 @@ namespace rt_jvm_data {
             return wrapper_name;
         }
     };
-}; // namespace rt_jvm_data
\ No newline at end of file
+}; // namespace rt_jvm_data
+
+template <> struct std::hash<rt_jvm_data::MemberKey> {
+    std::size_t operator()(const rt_jvm_data::MemberKey& key) const noexcept {
+        return key.packed() * 0x9E3779B97F4A7C15ull >> 32;
+    }
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory_resource>
+#include <mutex>
+
+namespace rt_jvm_data {
+
+    // Class metadata of one loader: parsed tables, member arrays, vtables,
+    // names. Blocks are carved from large chunks so that the metadata of the
+    // classes a loader defines sits together, and everything is returned to
+    // the upstream resource at once when the loader goes away.
+    //
+    // Freed blocks up to small_limit are kept on exact size class free lists,
+    // larger ones on a first fit list; neither is given back before the
+    // metaspace dies. Requests above chunk_size / 4 get an upstream block of
+    // their own. All operations lock one mutex per metaspace, so loaders never
+    // contend with each other.
+    class Metaspace : public std::pmr::memory_resource {
+      public:
+        static constexpr std::size_t chunk_size = 64 * 1024;
+        static constexpr std::size_t granule = 16;
+        static constexpr std::size_t small_limit = 1024;
+
+        struct Stats {
+            // handed out and not freed, rounded up to granules
+            std::size_t used = 0;
+            // on the free lists, ready for reuse
+            std::size_t free = 0;
+            // taken from upstream: chunks and separate large blocks
+            std::size_t reserved = 0;
+            std::size_t chunks = 0;
+        };
+
+        explicit Metaspace(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+        ~Metaspace() override;
+
+        Metaspace(const Metaspace&) = delete;
+        Metaspace& operator=(const Metaspace&) = delete;
+
+        Stats stats() const;
+
+        // the bootstrap loader's, never destroyed so that klasses torn down
+        // during exit can still return their blocks
+        static Metaspace& boot();
+
+      private:
+        struct Chunk {
+            Chunk* next;
+            std::size_t size;
+        };
+        struct FreeBlock {
+            FreeBlock* next;
+            std::size_t size;
+        };
+        // precedes a block with its own upstream allocation
+        struct Large {
+            Large* prev;
+            Large* next;
+            // what was asked from upstream for header and block together
+            std::size_t total;
+            std::size_t align;
+        };
+
+        mutable std::mutex mtx;
+        std::pmr::memory_resource* upstream;
+        Chunk* chunks = nullptr;
+        std::byte* cursor = nullptr;
+        std::byte* limit = nullptr;
+        std::array<FreeBlock*, small_limit / granule> small_free{};
+        FreeBlock* medium_free = nullptr;
+        Large* large = nullptr;
+        Stats counters;
+
+        void release(std::byte* block, std::size_t size) noexcept;
+        std::byte* take_medium(std::size_t size) noexcept;
+        std::byte* bump(std::size_t size);
+        void free_large(Large* node) noexcept;
+
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+        void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+    };
+}; // namespace rt_jvm_data
@@ -5,24 +5,40 @@
 #include <chrono>
 #include <condition_variable>
 #include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <memory_resource>
 #include <mutex>
+#include <thread>
 #include <type_traits>
 #include <vector>
 #include <ctime>
 
+namespace rt_jvm_data {
+    class RawKlass;
+}; // namespace rt_jvm_data
+
 namespace oop {
     class Monitor {
       private:
         std::recursive_mutex rmtx;
         std::condition_variable cv;
+        // the thread inside and how many times it entered
+        std::atomic<std::thread::id> owner{};
+        raw_jvm_type::u4 count = 0;
 
       public:
         void enter() {
             rmtx.lock();
+            owner.store(std::this_thread::get_id(), std::memory_order_relaxed);
+            count++;
         }
-        void exit() {
+        // false, and nothing changes, when the calling thread is not inside
+        bool exit() {
+            if (owner.load(std::memory_order_relaxed) != std::this_thread::get_id()) return false;
+            if (--count == 0) owner.store(std::thread::id{}, std::memory_order_relaxed);
             rmtx.unlock();
+            return true;
         }
         void wait() {
             std::unique_lock<std::recursive_mutex> rul(rmtx);
@@ -84,19 +100,55 @@ namespace oop {
         explicit operator bool() const noexcept {
             return !isEmpty();
         }
+
+        bool operator==(const Ref&) const noexcept = default;
+
+        BasicOop* get() const noexcept {
+            return ptr;
+        }
+
+        template <class T> T* as() const noexcept {
+            return static_cast<T*>(ptr);
+        }
     };
 
-    class Klass;
-    using Klass_ptr = Klass*;
+    using Klass_ptr = const rt_jvm_data::RawKlass*;
 
     struct InstanceOop : BasicOop {
         Klass_ptr kls_ptr;
         std::byte bytes[0];
     };
 
+    // kls_ptr is the ArrayKlass of the array, which knows the component type
     struct ArrayOop : BasicOop {
-        Klass_ptr kls_ptr;        
+        Klass_ptr kls_ptr;
         int length;
-        std::byte bytes[0];
+        // long and double components need 8 byte alignment
+        alignas(8) std::byte bytes[0];
+    };
+
+    // Where objects come from until a collector manages the heap. Objects are
+    // zeroed and live as long as the heap does. Monitors are inflated when an
+    // object is first locked and belong to the heap as well.
+    class Heap {
+      private:
+        std::mutex mtx;
+        std::pmr::monotonic_buffer_resource memory;
+        std::vector<std::unique_ptr<Monitor>> monitors;
+
+        void* allocate(std::size_t bytes);
+
+      public:
+        Heap() = default;
+        Heap(const Heap&) = delete;
+        Heap& operator=(const Heap&) = delete;
+
+        // an instance with `field_bytes` of fields, FieldLayout::object_size()
+        Ref allocate_instance(Klass_ptr kls, raw_jvm_type::u4 field_bytes);
+        // `array_klass` is an ArrayKlass, `component_size` its component_size()
+        Ref allocate_array(Klass_ptr array_klass, std::int32_t length,
+                           raw_jvm_type::u4 component_size);
+
+        Monitor& monitor_of(Ref object);
     };
 }; // namespace oop
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <bitset>
+#include <memory_resource>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "java_base.hpp"
+
+namespace rt_jvm_data {
+
+    enum class raw_value_type {
+        Jboolean,
+        Jbyte,
+        Jchar,
+        Jshort,
+        Jint,
+        Jlong,
+        Jfloat,
+        Jdouble,
+        Jreference
+    };
+
+    // A method descriptor decoded once, with everything invocation needs to
+    // move arguments into a frame and a root scan needs to find references
+    // among them.
+    struct MethodSignature {
+        // declared parameters in order, the receiver not included
+        std::pmr::vector<raw_value_type> arguments;
+        // nullopt for void
+        std::optional<raw_value_type> return_type;
+        // local variables the arguments occupy on entry, the receiver of an
+        // instance method included; long and double take two
+        raw_jvm_type::u2 argument_slots = 0;
+        // bit i is set when local i holds a reference on entry
+        std::bitset<256> reference_slots;
+
+        // operand stack slots the return value takes in the caller
+        raw_jvm_type::u1 return_slots() const noexcept {
+            if (!return_type) return 0;
+            return *return_type == raw_value_type::Jlong || *return_type == raw_value_type::Jdouble
+                       ? 2
+                       : 1;
+        }
+
+        // nullopt for a malformed descriptor or one taking more than 255
+        // slots; `arguments` is allocated from `metadata`
+        static std::optional<MethodSignature>
+        parse(std::string_view descriptor, bool is_static,
+              std::pmr::memory_resource* metadata = std::pmr::get_default_resource());
+    };
+
+    // the type of a whole field descriptor, nullopt when it is malformed
+    std::optional<raw_value_type> parse_field_descriptor(std::string_view descriptor);
+    // The field type of `descriptor` that starts at `pos`, moving `pos` past
+    // it, so that the text passed over is that type's descriptor; nullopt when
+    // no well-formed type starts there.
+    std::optional<raw_value_type> next_field_type(std::string_view descriptor, std::size_t& pos);
+}; // namespace rt_jvm_data
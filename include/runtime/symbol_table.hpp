@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+#include "java_base.hpp"
+#include "../classFile/modified_utf8.hpp"
+#include "../utils/arena.hpp"
+
+// Handle to an interned string. Equal strings always get the same handle, so
+// comparing two symbols is a single integer compare. Id 0 is the null symbol.
+struct Symbol {
+    raw_jvm_type::u4 id = 0;
+
+    explicit operator bool() const noexcept {
+        return id != 0;
+    }
+
+    bool operator==(const Symbol&) const noexcept = default;
+
+    // the interned bytes, valid for the rest of the process
+    std::string_view view() const noexcept;
+    // mutf8::hash of view()
+    raw_jvm_type::u4 hash() const noexcept;
+};
+
+template <> struct std::hash<Symbol> {
+    std::size_t operator()(Symbol symbol) const noexcept {
+        return symbol.id;
+    }
+};
+
+// Process wide symbol table. Bytes live in an arena and are never moved or
+// freed; the index is an open addressing table of (hash, id) words.
+//
+// Hits never lock and never allocate: a probe reads the current table with
+// acquire loads only. Misses take `insert_mtx`, which also covers growth. A
+// grown table replaces the old one atomically and the old one is retired, not
+// freed, so a reader still probing it sees every symbol it could have seen
+// before and falls back to the locked path on a miss.
+class SymbolTable {
+  private:
+    struct Entry {
+        const char* bytes;
+        raw_jvm_type::u4 length;
+        raw_jvm_type::u4 hash;
+    };
+
+    struct Table {
+        // log2 of the slot count
+        unsigned shift;
+        std::size_t mask;
+        // hash << 32 | id, 0 when empty
+        std::unique_ptr<std::atomic<raw_jvm_type::u8>[]> slots;
+
+        explicit Table(unsigned log2);
+
+        std::size_t home(raw_jvm_type::u4 hash) const noexcept {
+            // Fibonacci hashing: mutf8::hash of similar names differs in few low bits
+            return static_cast<raw_jvm_type::u4>(hash * 0x9E3779B9u) >> (32 - shift);
+        }
+    };
+
+    // Entries are kept in segments of doubling size so that publishing a new
+    // one never moves the old ones; segment k holds base << k entries.
+    static constexpr unsigned segment_base_log2 = 10;
+    static constexpr unsigned segment_count = 33 - segment_base_log2;
+
+    struct State {
+        std::atomic<Table*> table;
+        std::atomic<Entry*> segments[segment_count] = {};
+        std::atomic<raw_jvm_type::u4> count{0};
+
+        std::mutex insert_mtx;
+        Arena bytes{64 * 1024};
+        std::vector<std::unique_ptr<Table>> tables;
+
+        State();
+        ~State();
+    };
+
+    static State state;
+
+    static const Entry& entry(raw_jvm_type::u4 id) noexcept {
+        // id 1 is the first entry of segment 0
+        raw_jvm_type::u8 biased = static_cast<raw_jvm_type::u8>(id) + (1u << segment_base_log2) - 1;
+        unsigned top = std::bit_width(biased) - 1;
+        Entry* segment = state.segments[top - segment_base_log2].load(std::memory_order_acquire);
+        return segment[biased - (raw_jvm_type::u8(1) << top)];
+    }
+
+    static Symbol find(const Table& table, std::string_view str, raw_jvm_type::u4 hash) noexcept;
+    static Symbol insert(std::string_view str, raw_jvm_type::u4 hash);
+    static void grow();
+
+    friend struct Symbol;
+
+  public:
+    SymbolTable() = delete;
+
+    // `hash` must be mutf8::hash of `str`, e.g. ConstantUtf8::hash
+    static Symbol intern(std::string_view str, raw_jvm_type::u4 hash);
+    static Symbol intern(std::string_view str) {
+        return intern(str, mutf8::hash({reinterpret_cast<const raw_jvm_type::u1*>(str.data()),
+                                        str.size()}));
+    }
+
+    // the symbol of `str` if it was ever interned, the null symbol otherwise
+    static Symbol lookup(std::string_view str) noexcept;
+
+    static std::size_t size() noexcept {
+        return state.count.load(std::memory_order_relaxed);
+    }
+};
+
+inline std::string_view Symbol::view() const noexcept {
+    if (id == 0) return {};
+    const auto& entry = SymbolTable::entry(id);
+    return {entry.bytes, entry.length};
+}
+
+inline raw_jvm_type::u4 Symbol::hash() const noexcept {
+    return id == 0 ? mutf8::hash({}) : SymbolTable::entry(id).hash;
+}
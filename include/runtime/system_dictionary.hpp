@@ -0,0 +1,137 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "java_base.hpp"
+#include "class_loader_data.hpp"
+#include "klass.hpp"
+#include "symbol_table.hpp"
+#include "../utils/singleton.hpp"
+
+namespace rt_jvm_data {
+
+    // a class that names itself as its own superclass or superinterface, found
+    // when the loading thread asks for the class it is loading
+    struct ClassCircularityError : std::runtime_error {
+        using std::runtime_error::runtime_error;
+    };
+
+    // Loaded klasses by (defining loader, binary name).
+    //
+    // Lookups never lock: each shard is an open addressing table of entry
+    // pointers read with acquire loads, grown like the symbol table by
+    // publishing a bigger table and retiring the old one. A shard's mutex is
+    // only held to add an entry, never while a class is parsed.
+    //
+    // An entry starts as a placeholder. The first thread to claim it loads the
+    // class; others asking for the same name wait on the entry alone, while
+    // threads loading other names are not held up at all.
+    //
+    // Entries and tables only go away in unlink, which runs with the world
+    // stopped when class loaders are unloaded.
+    class SystemDictionary : public Singleton<SystemDictionary> {
+      private:
+        struct Entry {
+            enum class State : raw_jvm_type::u1 { Free, Loading, Loaded };
+
+            const ClassLoaderData* loader;
+            Symbol name;
+            raw_jvm_type::u4 hash;
+            std::atomic<State> state{State::Free};
+            // the thread that claimed a Loading entry
+            std::atomic<std::thread::id> owner{};
+            std::atomic<InstanceKlass*> klass{nullptr};
+            std::unique_ptr<InstanceKlass> owned;
+
+            Entry(const ClassLoaderData* loader, Symbol name, raw_jvm_type::u4 hash) noexcept
+                : loader(loader), name(name), hash(hash) {
+            }
+        };
+
+        struct Table {
+            std::size_t mask;
+            std::unique_ptr<std::atomic<Entry*>[]> slots;
+
+            explicit Table(std::size_t capacity);
+
+            // into the first free slot from the entry's home; the caller holds
+            // the shard's mutex
+            void place(Entry* entry) noexcept;
+        };
+
+        struct Shard {
+            std::atomic<Table*> table;
+            mutable std::mutex insert_mtx;
+            // the live entries and every table since the last unlink; retired
+            // tables stay until then since a reader may still probe them
+            std::vector<std::unique_ptr<Entry>> entries;
+            std::vector<std::unique_ptr<Table>> tables;
+
+            Shard();
+
+            Entry* find(const ClassLoaderData* loader, Symbol name,
+                        raw_jvm_type::u4 hash) const noexcept;
+            // the entry for the key, added as a Free placeholder when missing
+            Entry& find_or_add(const ClassLoaderData* loader, Symbol name, raw_jvm_type::u4 hash);
+            // swaps in a table holding only `entries` and frees the others
+            void rebuild();
+        };
+
+        constexpr static unsigned shard_bits = 6;
+        std::array<Shard, std::size_t(1) << shard_bits> shards;
+
+        static raw_jvm_type::u4 hash_of(const ClassLoaderData* loader, Symbol name) noexcept;
+
+        Shard& shard_of(raw_jvm_type::u4 hash) noexcept {
+            return shards[hash >> (32 - shard_bits)];
+        }
+        const Shard& shard_of(raw_jvm_type::u4 hash) const noexcept {
+            return shards[hash >> (32 - shard_bits)];
+        }
+
+      public:
+        using LoadFunction = std::function<std::unique_ptr<InstanceKlass>()>;
+
+        SystemDictionary() = default;
+
+        // null when the class is not loaded, or still being loaded
+        InstanceKlass_ptr find(const ClassLoaderData* loader, Symbol name) const noexcept;
+        // by the bootstrap loader
+        InstanceKlass_ptr find(std::string_view name) const noexcept;
+
+        // The klass `loader` defines as `name`. Unless it is loaded already,
+        // exactly one thread calls `load`; concurrent callers for the same key
+        // wait for its outcome. `load` returns null when there is no such
+        // class, in which case this returns null and a later call tries again;
+        // an exception from `load` propagates the same way. Throws
+        // ClassCircularityError when `load` asks for the class it is loading
+        // and NoClassDefFoundError when it yields a class of another name.
+        InstanceKlass_ptr resolve_or_load(const ClassLoaderData* loader, Symbol name,
+                                          const LoadFunction& load);
+
+        // Registers an already parsed klass under its own name and defining
+        // loader. When the name is taken, `kls` is dropped and the existing
+        // klass returned.
+        InstanceKlass_ptr publish(std::unique_ptr<InstanceKlass> kls);
+
+        std::size_t size() const;
+        // every klass loaded so far, in no particular order
+        std::vector<InstanceKlass_ptr> snapshot() const;
+
+        // Removes every entry of the loaders `is_unloading` picks, returning
+        // their klasses to be freed by the caller, and drops the retired
+        // tables of every shard. The bootstrap loader is never asked about.
+        // Only safe while no other thread uses the dictionary.
+        std::vector<std::unique_ptr<InstanceKlass>>
+        unlink(const std::function<bool(const ClassLoaderData*)>& is_unloading);
+    };
+}; // namespace rt_jvm_data
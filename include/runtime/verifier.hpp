@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdexcept>
+#include <string_view>
+
+#include "java_base.hpp"
+#include "klass.hpp"
+
+namespace rt_jvm_data {
+
+    class VerifyError : public std::runtime_error {
+      public:
+        using std::runtime_error::runtime_error;
+    };
+
+    // Type-checking verifier (JVMS 4.10.1) for class files of version 50 and up.
+    // StackMapTable supplies the frame at every branch target and handler, so a
+    // method is checked in one linear pass with no dataflow iteration. Older
+    // class files have no stack maps; their frames are inferred by iterating to
+    // a fixed point (JVMS 4.10.2), without support for jsr/ret subroutines.
+    //
+    // Assignability between two unrelated classes needs their hierarchy. It is
+    // delegated to `assignable`; without one such assignments are rejected.
+    class Verifier {
+      private:
+        class MethodVerifier;
+
+        const InstanceKlass& kls;
+        AssignabilityCheck assignable;
+
+      public:
+        explicit Verifier(const InstanceKlass& kls, AssignabilityCheck assignable = {});
+
+        // throws VerifyError naming the method, the pc and the broken rule
+        void verify(const MethodWrapper& method) const;
+    };
+}; // namespace rt_jvm_data
@@ -22,8 +22,7 @@ namespace vm::memory {
         std::size_t offset = off;
 
         if constexpr (std::same_as<std::remove_cvref_t<Q>, oop::ArrayOop>) {
-            auto kls_ptr = static_cast<rt_jvm_data::PrimitiveKlass_ptr>(oop.kls_ptr);
-            offset *= rt_jvm_data::type_size_of(kls_ptr->get_raw_type());
+            offset *= static_cast<const rt_jvm_data::ArrayKlass*>(oop.kls_ptr)->component_size();
         }
 
         auto* bytes = reinterpret_cast<std::byte*>(oop.bytes);
@@ -37,8 +36,7 @@ namespace vm::memory {
         std::size_t offset = off;
 
         if constexpr (std::same_as<std::remove_cvref_t<Q>, oop::ArrayOop>) {
-            auto kls_ptr = static_cast<rt_jvm_data::PrimitiveKlass_ptr>(oop.kls_ptr);
-            offset *= rt_jvm_data::type_size_of(kls_ptr->get_raw_type());
+            offset *= static_cast<const rt_jvm_data::ArrayKlass*>(oop.kls_ptr)->component_size();
         }
 
         auto* bytes = reinterpret_cast<std::byte*>(oop.bytes);
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+
+// Bump-pointer arena. Memory is handed out from a short list of chunks and is
+// only released all at once when the arena dies, so everything placed here
+// must be trivially destructible. Chunks come from malloc, or from `upstream`
+// when one is given.
+class Arena {
+  private:
+    struct Chunk {
+        Chunk* next;
+        std::size_t size;
+    };
+
+  public:
+    static constexpr std::size_t min_chunk_size = 4096;
+
+  private:
+    std::pmr::memory_resource* upstream;
+    Chunk* head = nullptr;
+    std::byte* cursor = nullptr;
+    std::byte* limit = nullptr;
+    std::size_t next_chunk_size;
+    std::size_t used_bytes = 0;
+    std::size_t reserved_bytes = 0;
+    std::size_t chunks = 0;
+
+    void grow(std::size_t need) {
+        std::size_t size = next_chunk_size;
+        while (size < need + sizeof(Chunk) + alignof(std::max_align_t)) size *= 2;
+
+        auto* chunk = static_cast<Chunk*>(
+            upstream != nullptr ? upstream->allocate(size, alignof(std::max_align_t))
+                                : std::malloc(size));
+        if (chunk == nullptr) throw std::bad_alloc();
+        chunk->next = head;
+        chunk->size = size;
+        head = chunk;
+
+        cursor = reinterpret_cast<std::byte*>(chunk + 1);
+        limit = reinterpret_cast<std::byte*>(chunk) + size;
+        reserved_bytes += size;
+        chunks += 1;
+        next_chunk_size = size * 2;
+    }
+
+  public:
+    explicit Arena(std::size_t first_chunk = min_chunk_size,
+                   std::pmr::memory_resource* upstream = nullptr)
+        : upstream(upstream),
+          next_chunk_size(first_chunk < min_chunk_size ? min_chunk_size : first_chunk) {
+    }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    ~Arena() {
+        while (head != nullptr) {
+            Chunk* next = head->next;
+            if (upstream != nullptr) {
+                upstream->deallocate(head, head->size, alignof(std::max_align_t));
+            } else {
+                std::free(head);
+            }
+            head = next;
+        }
+    }
+
+    // size the first chunk before anything has been allocated
+    void reserve(std::size_t bytes) noexcept {
+        if (head == nullptr && bytes > next_chunk_size) next_chunk_size = bytes;
+    }
+
+    void* allocate(std::size_t bytes, std::size_t align = alignof(std::max_align_t)) {
+        auto aligned = [&] {
+            auto addr = reinterpret_cast<std::uintptr_t>(cursor);
+            return reinterpret_cast<std::byte*>((addr + align - 1) & ~(align - 1));
+        };
+
+        std::byte* p = cursor == nullptr ? nullptr : aligned();
+        if (p == nullptr || p + bytes > limit) {
+            grow(bytes + align);
+            p = aligned();
+        }
+        cursor = p + bytes;
+        used_bytes += bytes;
+        return p;
+    }
+
+    // value-initialised array, i.e. zeroed for the plain structs stored here
+    template <class T> T* allocate_array(std::size_t count) {
+        static_assert(std::is_trivially_destructible_v<T>, "arena never runs destructors");
+        if (count == 0) return nullptr;
+        auto* array = static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+        for (std::size_t index = 0; index < count; index++) ::new (array + index) T();
+        return array;
+    }
+
+    std::size_t used() const noexcept {
+        return used_bytes;
+    }
+
+    std::size_t reserved() const noexcept {
+        return reserved_bytes;
+    }
+
+    std::size_t chunk_count() const noexcept {
+        return chunks;
+    }
+};
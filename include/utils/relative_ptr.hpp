@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Pointer stored as the distance from its own address. Tables that only hold
+// relative pointers into the same block stay valid when the block is written
+// to disk and mapped back at another address. Copying would silently retarget
+// the pointer, so it is not copyable; 0 encodes nullptr.
+template <class T> class RelativePtr {
+  private:
+    std::int64_t offset;
+
+  public:
+    RelativePtr() = default;
+    RelativePtr(const RelativePtr&) = delete;
+    RelativePtr& operator=(const RelativePtr&) = delete;
+
+    RelativePtr& operator=(T* target) noexcept {
+        offset = target == nullptr ? 0
+                                   : static_cast<std::int64_t>(
+                                         reinterpret_cast<std::intptr_t>(target) -
+                                         reinterpret_cast<std::intptr_t>(this));
+        return *this;
+    }
+
+    T* get() const noexcept {
+        if (offset == 0) return nullptr;
+        return reinterpret_cast<T*>(reinterpret_cast<std::intptr_t>(this) + offset);
+    }
+
+    operator T*() const noexcept {
+        return get();
+    }
+
+    T* operator->() const noexcept {
+        return get();
+    }
+
+    T& operator[](std::size_t index) const noexcept {
+        return get()[index];
+    }
+};
@@ -1,3 +1,5 @@
+#pragma once
+
 #include "java_base.hpp"
 
 template <typename T> class Singleton {
@@ -0,0 +1,430 @@
+#include "classFile/class_archive.hpp"
+#include "runtime/klass.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <spdlog/spdlog.h>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+using namespace raw_jvm_data;
+
+namespace {
+    constexpr char ARCHIVE_MAGIC[8] = {'J', 'V', 'M', 'C', 'D', 'S', '\0', '\0'};
+
+    // Growable image of the archive under construction. Relative pointers are
+    // only written once a class' regions are all reserved, and they stay valid
+    // when the vector later reallocates since both ends move together.
+    class ArchiveBuilder {
+      private:
+        std::vector<u1> bytes;
+
+      public:
+        u8 reserve(std::size_t size, std::size_t align = 8) {
+            std::size_t offset = (bytes.size() + align - 1) & ~(align - 1);
+            bytes.resize(offset + size);
+            return offset;
+        }
+
+        template <class T> T* at(u8 offset) noexcept {
+            return reinterpret_cast<T*>(bytes.data() + offset);
+        }
+
+        const std::vector<u1>& get_bytes() const noexcept {
+            return bytes;
+        }
+    };
+
+    void copy_attributes(ArchiveBuilder& out, u8 table_offset, const AttributeInfo* table,
+                         u2 count, const u1* old_image, u8 image_offset) {
+        auto* archived = out.at<AttributeInfo>(table_offset);
+        for (u2 index = 0; index < count; index++) {
+            auto& attr = *::new (&archived[index]) AttributeInfo();
+            attr.attribute_name_index = table[index].attribute_name_index;
+            attr.attribute_length = table[index].attribute_length;
+            attr.info = out.at<const u1>(image_offset + (table[index].info.get() - old_image));
+        }
+    }
+} // namespace
+
+u4 SharedClassArchive::hash_name(std::string_view name) noexcept {
+    u4 hash = 2166136261u;
+    for (char c : name) {
+        hash ^= static_cast<u1>(c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+u4 SharedClassArchive::layout_fingerprint() noexcept {
+    u4 little = std::endian::native == std::endian::little ? 1 : 0;
+    return static_cast<u4>(sizeof(ConstantPoolEntry)) | static_cast<u4>(sizeof(FieldInfo)) << 8 |
+           static_cast<u4>(sizeof(AttributeInfo)) << 16 | static_cast<u4>(sizeof(void*)) << 24 |
+           little << 31;
+}
+
+void SharedClassArchive::dump(const std::filesystem::path& path,
+                              std::span<const rt_jvm_data::InstanceKlass* const> classes) {
+    using rt_jvm_data::InstanceKlass;
+    using rt_jvm_data::MethodWrapper;
+    constexpr u4 NO_RECORD = ArchivedLinkage::NO_RECORD;
+
+    ArchiveBuilder out;
+    u8 header_offset = out.reserve(sizeof(Header));
+    u8 records_offset = out.reserve(sizeof(ArchivedClassRecord) * classes.size());
+
+    std::unordered_map<const InstanceKlass*, u4> indices;
+    for (u4 cls = 0; cls < classes.size(); cls++) indices.emplace(classes[cls], cls);
+    auto record_of = [&](const InstanceKlass* kls) {
+        auto it = indices.find(kls);
+        return it == indices.end() ? NO_RECORD : it->second;
+    };
+    auto method_ref = [&](const MethodWrapper* method) -> ArchivedMethodRef {
+        if (method == nullptr) return {NO_RECORD, 0};
+        return {record_of(method->kls),
+                static_cast<u4>(method - method->kls->get_methods().data())};
+    };
+    // the linkage names classes by record, so all of them must be archived too
+    auto archivable = [&](const InstanceKlass& kls) {
+        auto archived = [&](const InstanceKlass* other) { return record_of(other) != NO_RECORD; };
+        auto archived_method = [&](const MethodWrapper* method) {
+            return method == nullptr || archived(method->kls);
+        };
+        return kls.is_linked() && (kls.super_klass == nullptr || archived(kls.super_klass)) &&
+               std::all_of(kls.local_interfaces.begin(), kls.local_interfaces.end(), archived) &&
+               std::all_of(kls.itable.begin(), kls.itable.end(),
+                           [&](const auto& block) { return archived(block.interface); }) &&
+               std::all_of(kls.vtable.begin(), kls.vtable.end(), archived_method) &&
+               std::all_of(kls.itable_methods.begin(), kls.itable_methods.end(),
+                           archived_method);
+    };
+
+    for (std::size_t cls = 0; cls < classes.size(); cls++) {
+        const InstanceKlass& kls = *classes[cls];
+        const ClassFile& cf = kls;
+        const u1* old_image = cf.source->data();
+
+        // reserve every region of the class first, fill them afterwards
+        ArchivedClassRecord record{};
+        record.image_size = cf.source->size();
+        record.image_offset = out.reserve(record.image_size);
+        record.constant_pool_offset =
+            out.reserve(sizeof(ConstantPoolEntry) * cf.constant_pool_count);
+        record.interfaces_offset = out.reserve(sizeof(u2) * cf.interfaces_count);
+        record.fields_offset = out.reserve(sizeof(FieldInfo) * cf.fields_count);
+        record.methods_offset = out.reserve(sizeof(MethodInfo) * cf.methods_count);
+        record.attributes_offset = out.reserve(sizeof(AttributeInfo) * cf.attributes_count);
+        record.field_types_offset = out.reserve(cf.fields_count, 1);
+        for (u2 index = 0; index < cf.fields_count; index++) {
+            out.at<u1>(record.field_types_offset)[index] =
+                static_cast<u1>(kls.get_fields()[index].type);
+        }
+
+        std::vector<u8> field_attributes(cf.fields_count), method_attributes(cf.methods_count);
+        for (u2 index = 0; index < cf.fields_count; index++) {
+            field_attributes[index] =
+                out.reserve(sizeof(AttributeInfo) * cf.fields[index].attribute_count);
+        }
+        for (u2 index = 0; index < cf.methods_count; index++) {
+            method_attributes[index] =
+                out.reserve(sizeof(AttributeInfo) * cf.methods[index].attribute_count);
+        }
+
+        std::string_view name =
+            cf.constant_pool[cf.constant_pool[cf.this_class].klass.name_index].utf8.view();
+        record.name_offset = out.reserve(name.size(), 1);
+        record.name_length = static_cast<u4>(name.size());
+        record.name_hash = hash_name(name);
+        std::memcpy(out.at<char>(record.name_offset), name.data(), name.size());
+
+        std::memcpy(out.at<u1>(record.image_offset), old_image, record.image_size);
+
+        // entries are plain bytes apart from the utf8 pointer, which is retargeted
+        auto* pool = out.at<ConstantPoolEntry>(record.constant_pool_offset);
+        std::memcpy(static_cast<void*>(pool), cf.constant_pool,
+                    sizeof(ConstantPoolEntry) * cf.constant_pool_count);
+        for (u2 index = 0; index < cf.constant_pool_count; index++) {
+            if (cf.constant_pool[index].info.tag != CONSTANT_Utf8) continue;
+            pool[index].utf8.bytes = out.at<const u1>(
+                record.image_offset + (cf.constant_pool[index].utf8.bytes.get() - old_image));
+        }
+
+        if (cf.interfaces_count > 0) {
+            std::memcpy(out.at<u2>(record.interfaces_offset), cf.interfaces,
+                        sizeof(u2) * cf.interfaces_count);
+        }
+
+        auto copy_members = [&](auto* archived, const auto* members, u2 count,
+                                const std::vector<u8>& tables) {
+            for (u2 index = 0; index < count; index++) {
+                auto& member = *::new (&archived[index])
+                    std::remove_cvref_t<decltype(members[index])>();
+                member.access_flags = members[index].access_flags;
+                member.name_index = members[index].name_index;
+                member.descriptor_index = members[index].descriptor_index;
+                member.attribute_count = members[index].attribute_count;
+                copy_attributes(out, tables[index], members[index].attributes.get(),
+                                members[index].attribute_count, old_image, record.image_offset);
+                member.attributes =
+                    member.attribute_count > 0 ? out.at<AttributeInfo>(tables[index]) : nullptr;
+            }
+        };
+        copy_members(out.at<FieldInfo>(record.fields_offset), cf.fields, cf.fields_count,
+                     field_attributes);
+        copy_members(out.at<MethodInfo>(record.methods_offset), cf.methods, cf.methods_count,
+                     method_attributes);
+        copy_attributes(out, record.attributes_offset, cf.attributes, cf.attributes_count,
+                        old_image, record.image_offset);
+
+        if (archivable(kls)) {
+            const auto& layout = kls.field_layout;
+            ArchivedLinkage linkage{};
+            record.linkage_offset = out.reserve(sizeof(ArchivedLinkage));
+            linkage.super = kls.super_klass == nullptr ? NO_RECORD : record_of(kls.super_klass);
+            linkage.interfaces_count = static_cast<u4>(kls.local_interfaces.size());
+            linkage.interfaces_offset = out.reserve(sizeof(u4) * linkage.interfaces_count);
+            linkage.instance_size = layout.instance_size;
+            linkage.static_size = layout.static_size;
+            linkage.static_oop_count = layout.static_oop_count;
+            linkage.oop_map_count = static_cast<u4>(layout.oop_maps.size());
+            linkage.oop_maps_offset = out.reserve(sizeof(u4) * 2 * linkage.oop_map_count);
+            linkage.field_offsets_offset = out.reserve(sizeof(u4) * cf.fields_count);
+            linkage.method_indices_offset =
+                out.reserve(sizeof(std::int32_t) * 2 * cf.methods_count);
+            linkage.vtable_length = static_cast<u4>(kls.vtable.size());
+            linkage.vtable_offset =
+                out.reserve(sizeof(ArchivedMethodRef) * linkage.vtable_length);
+            linkage.itable_length = static_cast<u4>(kls.itable.size());
+            linkage.itable_offset =
+                out.reserve(sizeof(ArchivedItableBlock) * linkage.itable_length);
+            linkage.itable_methods_length = static_cast<u4>(kls.itable_methods.size());
+            linkage.itable_methods_offset =
+                out.reserve(sizeof(ArchivedMethodRef) * linkage.itable_methods_length);
+
+            for (u4 index = 0; index < linkage.interfaces_count; index++) {
+                out.at<u4>(linkage.interfaces_offset)[index] =
+                    record_of(kls.local_interfaces[index]);
+            }
+            for (u4 index = 0; index < linkage.oop_map_count; index++) {
+                out.at<u4>(linkage.oop_maps_offset)[2 * index] = layout.oop_maps[index].offset;
+                out.at<u4>(linkage.oop_maps_offset)[2 * index + 1] = layout.oop_maps[index].count;
+            }
+            for (u2 index = 0; index < cf.fields_count; index++) {
+                out.at<u4>(linkage.field_offsets_offset)[index] = kls.get_fields()[index].offset;
+            }
+            for (u2 index = 0; index < cf.methods_count; index++) {
+                const auto& method = kls.get_methods()[index];
+                out.at<std::int32_t>(linkage.method_indices_offset)[2 * index] =
+                    method.vtable_index;
+                out.at<std::int32_t>(linkage.method_indices_offset)[2 * index + 1] =
+                    method.itable_index;
+            }
+            for (u4 index = 0; index < linkage.vtable_length; index++) {
+                out.at<ArchivedMethodRef>(linkage.vtable_offset)[index] =
+                    method_ref(kls.vtable[index]);
+            }
+            for (u4 index = 0; index < linkage.itable_length; index++) {
+                out.at<ArchivedItableBlock>(linkage.itable_offset)[index] = {
+                    record_of(kls.itable[index].interface), kls.itable[index].first};
+            }
+            for (u4 index = 0; index < linkage.itable_methods_length; index++) {
+                out.at<ArchivedMethodRef>(linkage.itable_methods_offset)[index] =
+                    method_ref(kls.itable_methods[index]);
+            }
+            *out.at<ArchivedLinkage>(record.linkage_offset) = linkage;
+        }
+
+        record.magic = cf.magic;
+        record.minor_version = cf.minor_version;
+        record.major_version = cf.major_version;
+        record.constant_pool_count = cf.constant_pool_count;
+        record.access_flags = cf.access_flags;
+        record.this_class = cf.this_class;
+        record.super_class = cf.super_class;
+        record.interfaces_count = cf.interfaces_count;
+        record.fields_count = cf.fields_count;
+        record.methods_count = cf.methods_count;
+        record.attributes_count = cf.attributes_count;
+        *out.at<ArchivedClassRecord>(records_offset + sizeof(ArchivedClassRecord) * cls) = record;
+    }
+
+    // power of two with at least half the buckets free
+    u4 bucket_count = 1;
+    while (bucket_count < classes.size() * 2) bucket_count <<= 1;
+    u8 buckets_offset = out.reserve(sizeof(u4) * bucket_count);
+    for (u4 cls = 0; cls < classes.size(); cls++) {
+        const auto& record =
+            *out.at<ArchivedClassRecord>(records_offset + sizeof(ArchivedClassRecord) * cls);
+        u4 slot = record.name_hash & (bucket_count - 1);
+        while (out.at<u4>(buckets_offset)[slot] != 0) slot = (slot + 1) & (bucket_count - 1);
+        out.at<u4>(buckets_offset)[slot] = cls + 1;
+    }
+
+    Header& header = *out.at<Header>(header_offset);
+    std::memcpy(header.magic, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC));
+    header.version = VERSION;
+    header.layout = layout_fingerprint();
+    header.size = out.get_bytes().size();
+    header.class_count = static_cast<u4>(classes.size());
+    header.bucket_count = bucket_count;
+    header.records_offset = records_offset;
+    header.buckets_offset = buckets_offset;
+
+    // write aside and rename so a running VM never maps a half written archive
+    auto tmp = path;
+    tmp += ".tmp";
+    {
+        std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(out.get_bytes().data()),
+                   static_cast<std::streamsize>(out.get_bytes().size()));
+        if (!file) throw std::system_error(errno, std::generic_category(), "write " + tmp.string());
+    }
+    std::filesystem::rename(tmp, path);
+    spdlog::info("dumped {} classes into shared archive {} ({} bytes)", classes.size(),
+                 path.string(), header.size);
+}
+
+SharedClassArchive::SharedClassArchive(const std::filesystem::path& path)
+    : image(ClassFileSource::map(path)) {
+    auto fail = [&](const char* why) {
+        throw ClassFormatError("unusable shared archive " + path.string() + ": " + why);
+    };
+
+    if (image->size() < sizeof(Header)) fail("truncated header");
+    header = at<Header>(0);
+    if (std::memcmp(header->magic, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC)) != 0) fail("bad magic");
+    if (header->version != VERSION) fail("version mismatch");
+    if (header->layout != layout_fingerprint()) fail("built for another VM layout");
+    if (header->size != image->size()) fail("size mismatch");
+
+    if (!in_range(header->records_offset, sizeof(ArchivedClassRecord) * header->class_count) ||
+        !in_range(header->buckets_offset, sizeof(u4) * header->bucket_count) ||
+        std::popcount(header->bucket_count) != 1 || header->bucket_count <= header->class_count) {
+        fail("corrupt directory");
+    }
+
+    records = at<ArchivedClassRecord>(header->records_offset);
+    buckets = at<u4>(header->buckets_offset);
+    for (const auto& record : get_records()) {
+        if (!in_range(record.name_offset, record.name_length) ||
+            !in_range(record.image_offset, record.image_size) ||
+            !in_range(record.constant_pool_offset,
+                      sizeof(ConstantPoolEntry) * record.constant_pool_count) ||
+            !in_range(record.interfaces_offset, sizeof(u2) * record.interfaces_count) ||
+            !in_range(record.fields_offset, sizeof(FieldInfo) * record.fields_count) ||
+            !in_range(record.methods_offset, sizeof(MethodInfo) * record.methods_count) ||
+            !in_range(record.attributes_offset, sizeof(AttributeInfo) * record.attributes_count) ||
+            !in_range(record.field_types_offset, record.fields_count)) {
+            fail("class record out of range");
+        }
+        if (!check_pointers(record)) fail("class table points outside its image");
+        if (record.linkage_offset != 0 && !check_linkage(record)) fail("corrupt class linkage");
+    }
+}
+
+bool SharedClassArchive::in_range(u8 offset, u8 size) const noexcept {
+    return offset <= image->size() && image->size() - offset >= size;
+}
+
+bool SharedClassArchive::check_pointers(const ArchivedClassRecord& record) const noexcept {
+    // the relative pointers of the tables must land in the class's own image
+    auto in_image = [&](const void* target, u8 size) {
+        auto begin = reinterpret_cast<std::uintptr_t>(at<u1>(record.image_offset));
+        auto address = reinterpret_cast<std::uintptr_t>(target);
+        return address >= begin && address - begin <= record.image_size &&
+               record.image_size - (address - begin) >= size;
+    };
+    auto attributes_ok = [&](const AttributeInfo* table, u2 count) {
+        for (u2 index = 0; index < count; index++) {
+            if (!in_image(table[index].info.get(), table[index].attribute_length)) return false;
+        }
+        return true;
+    };
+    // member attribute tables live in the archive, outside the image
+    auto members_ok = [&](const auto* members, u2 count) {
+        for (u2 index = 0; index < count; index++) {
+            u2 attribute_count = members[index].attribute_count;
+            if (attribute_count == 0) continue;
+            auto table = reinterpret_cast<std::uintptr_t>(members[index].attributes.get());
+            auto base = reinterpret_cast<std::uintptr_t>(image->data());
+            if (table < base || !in_range(table - base, sizeof(AttributeInfo) * attribute_count) ||
+                !attributes_ok(members[index].attributes.get(), attribute_count)) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    const auto* pool = at<ConstantPoolEntry>(record.constant_pool_offset);
+    for (u2 index = 1; index < record.constant_pool_count; index++) {
+        if (pool[index].info.tag == CONSTANT_Utf8 &&
+            !in_image(pool[index].utf8.bytes.get(), pool[index].utf8.length)) {
+            return false;
+        }
+    }
+    return members_ok(at<FieldInfo>(record.fields_offset), record.fields_count) &&
+           members_ok(at<MethodInfo>(record.methods_offset), record.methods_count) &&
+           attributes_ok(at<AttributeInfo>(record.attributes_offset), record.attributes_count);
+}
+
+bool SharedClassArchive::check_linkage(const ArchivedClassRecord& record) const noexcept {
+    constexpr u4 NO_RECORD = ArchivedLinkage::NO_RECORD;
+    if (!in_range(record.linkage_offset, sizeof(ArchivedLinkage))) return false;
+    const auto& linkage = *at<ArchivedLinkage>(record.linkage_offset);
+    if (!in_range(linkage.interfaces_offset, sizeof(u4) * u8(linkage.interfaces_count)) ||
+        !in_range(linkage.oop_maps_offset, sizeof(u4) * 2 * u8(linkage.oop_map_count)) ||
+        !in_range(linkage.field_offsets_offset, sizeof(u4) * record.fields_count) ||
+        !in_range(linkage.method_indices_offset,
+                  sizeof(std::int32_t) * 2 * record.methods_count) ||
+        !in_range(linkage.vtable_offset, sizeof(ArchivedMethodRef) * u8(linkage.vtable_length)) ||
+        !in_range(linkage.itable_offset,
+                  sizeof(ArchivedItableBlock) * u8(linkage.itable_length)) ||
+        !in_range(linkage.itable_methods_offset,
+                  sizeof(ArchivedMethodRef) * u8(linkage.itable_methods_length))) {
+        return false;
+    }
+
+    u4 count = header->class_count;
+    auto method_ok = [&](const ArchivedMethodRef& ref) {
+        return ref.klass == NO_RECORD ||
+               (ref.klass < count && ref.method < records[ref.klass].methods_count);
+    };
+    auto methods_ok = [&](u8 offset, u4 length) {
+        const auto* refs = at<ArchivedMethodRef>(offset);
+        return std::all_of(refs, refs + length, method_ok);
+    };
+    const auto* interfaces = at<u4>(linkage.interfaces_offset);
+    const auto* itable = at<ArchivedItableBlock>(linkage.itable_offset);
+    return (linkage.super == NO_RECORD || linkage.super < count) &&
+           std::all_of(interfaces, interfaces + linkage.interfaces_count,
+                       [&](u4 interface) { return interface < count; }) &&
+           std::all_of(itable, itable + linkage.itable_length,
+                       [&](const ArchivedItableBlock& block) {
+                           return block.interface < count &&
+                                  block.first <= linkage.itable_methods_length;
+                       }) &&
+           methods_ok(linkage.vtable_offset, linkage.vtable_length) &&
+           methods_ok(linkage.itable_methods_offset, linkage.itable_methods_length);
+}
+
+const ArchivedClassRecord* SharedClassArchive::find(std::string_view name) const noexcept {
+    u4 hash = hash_name(name);
+    u4 mask = header->bucket_count - 1;
+    // the table always has an empty bucket, the bound only guards a corrupt one
+    u4 slot = hash & mask;
+    for (u4 probes = 0; probes < header->bucket_count; probes++, slot = (slot + 1) & mask) {
+        u4 entry = buckets[slot];
+        if (entry == 0 || entry > header->class_count) return nullptr;
+
+        const auto& record = records[entry - 1];
+        if (record.name_hash == hash && name_of(record) == name) return &record;
+    }
+    return nullptr;
+}
+
+ClassFileSource_ptr SharedClassArchive::image_of(const ArchivedClassRecord& record) const {
+    return ClassFileSource::borrow({at<u1>(record.image_offset), record.image_size}, image);
+}
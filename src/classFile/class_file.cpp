@@ -1,5 +1,6 @@
 #include "classFile/class_file.hpp"
-#include "runtime/string_pool.hpp"
+#include "classFile/class_archive.hpp"
+#include "runtime/symbol_table.hpp"
 #include "java_base.hpp"
 #include <cassert>
 #include <cstddef>
@@ -11,76 +12,98 @@
 
 using namespace raw_jvm_data;
 
-ConstantUtf8::~ConstantUtf8() {
-    if (bytes != nullptr) delete[] bytes;
-}
-
-AttributeInfo::~AttributeInfo() {
-    if (info != nullptr) delete[] info;
-}
-
-FieldInfo::~FieldInfo() {
-    if (attributes != nullptr) delete[] attributes;
-}
-
-MethodInfo::~MethodInfo() {
-    if (attributes != nullptr) delete[] attributes;
-}
-
-ConstantInfo_ptr ClassFile::build_constant_info(fstream& in, u1 tag) {
-    ConstantInfo* info = nullptr;
-
-#define BUILD_CONSTANT(CONDITION, PTR_TYPE)                                                        \
+void ClassFile::build_constant_info(ByteCodeReader& in, u1 tag, ConstantPoolEntry& entry) {
+#define BUILD_CONSTANT(CONDITION, PTR_TYPE, MEMBER)                                                \
     case CONDITION: {                                                                              \
-        PTR_TYPE* ptr = new PTR_TYPE();                                                            \
-        ptr->tag = tag;                                                                            \
-        in >> *ptr;                                                                                \
-        info = ptr;                                                                                \
+        PTR_TYPE& item = *::new (&entry.MEMBER) PTR_TYPE();                                        \
+        item.tag = tag;                                                                            \
+        in >> item;                                                                                \
         break;                                                                                     \
     }
 
     switch (tag) {
-        BUILD_CONSTANT(CONSTANT_Class, ConstantClass);
-        BUILD_CONSTANT(CONSTANT_Fieldref, ConstantFieldRef);
-        BUILD_CONSTANT(CONSTANT_Methodref, ConstantMethodRef);
-        BUILD_CONSTANT(CONSTANT_InterfaceMethodref, ConstantInterfaceMethodRef);
-        BUILD_CONSTANT(CONSTANT_String, ConstantString);
-        BUILD_CONSTANT(CONSTANT_Integer, ConstantInteger);
-        BUILD_CONSTANT(CONSTANT_Float, ConstantFloat);
-        BUILD_CONSTANT(CONSTANT_Long, ConstantLong);
-        BUILD_CONSTANT(CONSTANT_Double, ConstantDouble);
-        BUILD_CONSTANT(CONSTANT_NameAndType, ConstantNameAndType);
-        BUILD_CONSTANT(CONSTANT_Utf8, ConstantUtf8);
-        BUILD_CONSTANT(CONSTANT_MethodHandle, ConstantMethodHandle);
-        BUILD_CONSTANT(CONSTANT_MethodType, ConstantMethodType);
-        BUILD_CONSTANT(CONSTANT_InvokeDynamic, ConstantInvokeDynamic);
+        BUILD_CONSTANT(CONSTANT_Class, ConstantClass, klass);
+        BUILD_CONSTANT(CONSTANT_Fieldref, ConstantFieldRef, field_ref);
+        BUILD_CONSTANT(CONSTANT_Methodref, ConstantMethodRef, method_ref);
+        BUILD_CONSTANT(CONSTANT_InterfaceMethodref, ConstantInterfaceMethodRef,
+                       interface_method_ref);
+        BUILD_CONSTANT(CONSTANT_String, ConstantString, string);
+        BUILD_CONSTANT(CONSTANT_Integer, ConstantInteger, integer);
+        BUILD_CONSTANT(CONSTANT_Float, ConstantFloat, float_);
+        BUILD_CONSTANT(CONSTANT_Long, ConstantLong, long_);
+        BUILD_CONSTANT(CONSTANT_Double, ConstantDouble, double_);
+        BUILD_CONSTANT(CONSTANT_NameAndType, ConstantNameAndType, name_and_type);
+        BUILD_CONSTANT(CONSTANT_Utf8, ConstantUtf8, utf8);
+        BUILD_CONSTANT(CONSTANT_MethodHandle, ConstantMethodHandle, method_handle);
+        BUILD_CONSTANT(CONSTANT_MethodType, ConstantMethodType, method_type);
+        BUILD_CONSTANT(CONSTANT_InvokeDynamic, ConstantInvokeDynamic, invoke_dynamic);
         default: {
             spdlog::error("cant resolve tag value: {:x}\n", tag);
-            assert(false);
+            throw ClassFormatError("unknown constant pool tag " + std::to_string(tag));
         }
     }
+#undef BUILD_CONSTANT
+}
 
-    assert(info != nullptr);
-    return info;
+AttributeInfo_ptr ClassFile::read_attributes(ByteCodeReader& in, u2 count) {
+    AttributeInfo_ptr table = this->arena.allocate_array<AttributeInfo>(count);
+    for (u2 index = 0; index < count; index++) {
+        in >> table[index];
+    }
+    return table;
 }
 
-ClassFile::ClassFile(std::fstream& in) {
-    ByteCodeReader bcr(in);
+ClassFile::ClassFile(std::fstream& in, std::pmr::memory_resource* metadata)
+    : ClassFile(ClassFileSource::read(in), metadata) {
+}
 
+ClassFile::ClassFile(ClassFileSource_ptr src, std::pmr::memory_resource* metadata)
+    : source(std::move(src)), arena(Arena::min_chunk_size, metadata) {
+    ByteCodeReader bcr(this->source->bytes());
+    this->parse(bcr);
+}
+
+ClassFile::ClassFile(const SharedClassArchive& archive, const ArchivedClassRecord& record)
+    : magic(record.magic), minor_version(record.minor_version),
+      major_version(record.major_version), constant_pool_count(record.constant_pool_count),
+      access_flags(record.access_flags), this_class(record.this_class),
+      super_class(record.super_class), interfaces_count(record.interfaces_count),
+      fields_count(record.fields_count), methods_count(record.methods_count),
+      attributes_count(record.attributes_count), source(archive.image_of(record)) {
+    // the mapping is read-only; the runtime never writes through these tables
+    this->constant_pool = const_cast<ConstantPoolEntry_ptr>(
+        archive.at<ConstantPoolEntry>(record.constant_pool_offset));
+    this->interfaces = const_cast<u2_ptr>(archive.at<u2>(record.interfaces_offset));
+    this->fields = const_cast<FieldInfo_ptr>(archive.at<FieldInfo>(record.fields_offset));
+    this->methods = const_cast<MethodInfo_ptr>(archive.at<MethodInfo>(record.methods_offset));
+    this->attributes =
+        const_cast<AttributeInfo_ptr>(archive.at<AttributeInfo>(record.attributes_offset));
+}
+
+void ClassFile::parse(ByteCodeReader& bcr) {
     bcr.read_u4(&this->magic);
-    bcr.read_u2(&this->major_version);
+    if (this->magic != 0xCAFEBABE) {
+        throw ClassFormatError("bad class file magic");
+    }
+    bcr.read_u2(&this->minor_version);
     bcr.read_u2(&this->major_version);
     bcr.read_u2(&this->constant_pool_count);
 
+    // The tables only point into the image, so they take far less than the
+    // image. The constant pool is the largest of them and the only one whose
+    // size is known this early: the first chunk holds it with room for the
+    // rest of a typical class, and the arena grows by chunks past that.
+    this->arena.reserve(sizeof(ConstantPoolEntry) * this->constant_pool_count +
+                        Arena::min_chunk_size);
+
     // input constant info, index 0 unused
-    this->constant_pool = new ConstantInfo_ptr[this->constant_pool_count + 1]{0};
+    this->constant_pool = this->arena.allocate_array<ConstantPoolEntry>(this->constant_pool_count);
     for (u2 index = 1; index < this->constant_pool_count; index++) {
         u1 tag = -1;
         bcr.read_u1(&tag);
-        this->constant_pool[index] = this->build_constant_info(in, tag);
+        this->build_constant_info(bcr, tag, this->constant_pool[index]);
 
-        if (this->constant_pool[index]->tag == CONSTANT_Double ||
-            this->constant_pool[index]->tag == CONSTANT_Long) {
+        if (tag == CONSTANT_Double || tag == CONSTANT_Long) {
             // Long and double occupy two constant pool positions
             index += 1;
         }
@@ -91,79 +114,27 @@ ClassFile::ClassFile(std::fstream& in) {
     bcr.read_u2(&this->super_class);
     bcr.read_u2(&this->interfaces_count);
 
-    if (this->interfaces_count > 0) {
-        this->interfaces = new u2[this->interfaces_count]{0};
-        for (u2 index = 0; index < this->interfaces_count; index++) {
-            bcr.read_u2(&this->interfaces[index]);
-        }
+    this->interfaces = this->arena.allocate_array<u2>(this->interfaces_count);
+    for (u2 index = 0; index < this->interfaces_count; index++) {
+        bcr.read_u2(&this->interfaces[index]);
     }
 
     bcr.read_u2(&this->fields_count);
-    if (this->fields_count > 0) {
-        this->fields = new FieldInfo[this->fields_count];
-        for (u2 index = 0; index < this->fields_count; index++) {
-            in >> this->fields[index];
-        }
+    this->fields = this->arena.allocate_array<FieldInfo>(this->fields_count);
+    for (u2 index = 0; index < this->fields_count; index++) {
+        auto& field = this->fields[index];
+        bcr >> field;
+        field.attributes = this->read_attributes(bcr, field.attribute_count);
     }
 
     bcr.read_u2(&this->methods_count);
-    if (this->methods_count > 0) {
-        this->methods = new MethodInfo[this->methods_count];
-        for (u2 index = 0; index < this->methods_count; index++) {
-            in >> this->methods[index];
-        }
+    this->methods = this->arena.allocate_array<MethodInfo>(this->methods_count);
+    for (u2 index = 0; index < this->methods_count; index++) {
+        auto& method = this->methods[index];
+        bcr >> method;
+        method.attributes = this->read_attributes(bcr, method.attribute_count);
     }
 
     bcr.read_u2(&this->attributes_count);
-    if (this->attributes_count > 0) {
-        this->attributes = new AttributeInfo[this->attributes_count];
-        for (u2 index = 0; index < this->attributes_count; index++) {
-            in >> this->attributes[index];
-        }
-    }
-}
-
-ClassFile::~ClassFile() {
-    if (this->constant_pool != nullptr) {
-
-        for (size_t index = 0; index < this->constant_pool_count; index++) {
-            auto ptr = this->constant_pool[index];
-            if (ptr != nullptr) {
-                switch (ptr->tag) {
-                    case CONSTANT_Utf8: {
-                        auto u8ptr = static_cast<ConstantUtf8_ptr>(ptr);
-                        delete u8ptr;
-                        break;
-                    }
-                    default: {
-                        delete ptr;
-                    }
-                }
-                this->constant_pool[index] = nullptr;
-            }
-        }
-        delete[] this->constant_pool;
-        this->constant_pool = nullptr;
-    }
-
-    if (this->interfaces != nullptr) {
-        delete[] this->interfaces;
-        this->interfaces = nullptr;
-    }
-
-    if (this->fields != nullptr) {
-        delete[] this->fields;
-        this->fields = nullptr;
-    }
-
-    if (this->methods != nullptr) {
-        delete[] this->methods;
-        this->methods = nullptr;
-    }
-
-    if (this->attributes != nullptr) {
-        delete[] this->attributes;
-        this->attributes = nullptr;
-    }
+    this->attributes = this->read_attributes(bcr, this->attributes_count);
 }
-
@@ -0,0 +1,92 @@
+#include "classFile/class_file_source.hpp"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iterator>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+
+using raw_jvm_type::u1;
+
+ClassFileSource::~ClassFileSource() {
+    if (storage == Storage::Mapped && base != nullptr) {
+        ::munmap(const_cast<u1*>(base), length);
+    }
+}
+
+ClassFileSource_ptr ClassFileSource::map(const std::filesystem::path& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "open " + path.string());
+    }
+
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+        int err = errno;
+        ::close(fd);
+        throw std::system_error(err, std::generic_category(), "stat " + path.string());
+    }
+
+    std::shared_ptr<ClassFileSource> src(new ClassFileSource());
+    src->length = static_cast<std::size_t>(st.st_size);
+    if (src->length > 0) {
+        void* addr = ::mmap(nullptr, src->length, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            int err = errno;
+            ::close(fd);
+            throw std::system_error(err, std::generic_category(), "mmap " + path.string());
+        }
+        src->base = static_cast<const u1*>(addr);
+        src->storage = Storage::Mapped;
+    }
+    // the mapping stays valid after the descriptor is closed
+    ::close(fd);
+    return src;
+}
+
+ClassFileSource_ptr ClassFileSource::read(std::istream& in) {
+    std::shared_ptr<ClassFileSource> src(new ClassFileSource());
+
+    // seekable streams are sized up front so the image is read in one call
+    auto start = in.tellg();
+    in.seekg(0, std::ios::end);
+    auto stop = in.tellg();
+    if (start != std::streampos(-1) && stop != std::streampos(-1) && stop >= start) {
+        in.seekg(start);
+        src->length = static_cast<std::size_t>(stop - start);
+        src->owned.reset(new u1[src->length]);
+        in.read(reinterpret_cast<char*>(src->owned.get()), static_cast<std::streamsize>(src->length));
+        src->length = static_cast<std::size_t>(in.gcount());
+    } else {
+        in.clear();
+        std::string buffer(std::istreambuf_iterator<char>(in), {});
+        src->length = buffer.size();
+        src->owned.reset(new u1[src->length]);
+        std::memcpy(src->owned.get(), buffer.data(), buffer.size());
+    }
+
+    src->base = src->owned.get();
+    src->storage = Storage::Owned;
+    return src;
+}
+
+ClassFileSource_ptr ClassFileSource::adopt(std::unique_ptr<u1[]> bytes, std::size_t size) {
+    std::shared_ptr<ClassFileSource> src(new ClassFileSource());
+    src->owned = std::move(bytes);
+    src->base = src->owned.get();
+    src->length = size;
+    src->storage = Storage::Owned;
+    return src;
+}
+
+ClassFileSource_ptr ClassFileSource::borrow(std::span<const u1> bytes,
+                                            std::shared_ptr<const void> owner) {
+    std::shared_ptr<ClassFileSource> src(new ClassFileSource());
+    src->base = bytes.data();
+    src->length = bytes.size();
+    src->storage = Storage::Borrowed;
+    src->keep_alive = std::move(owner);
+    return src;
+}
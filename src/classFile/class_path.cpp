@@ -0,0 +1,60 @@
+#include "classFile/class_path.hpp"
+#include "classFile/jar_file.hpp"
+#include <spdlog/spdlog.h>
+#include <sstream>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+static constexpr std::string_view class_suffix = ".class";
+
+std::vector<std::string> DirectoryClassPathEntry::class_names() const {
+    std::vector<std::string> names;
+    std::error_code ec;
+    for (auto it = fs::recursive_directory_iterator(root, ec); !ec && it != fs::end(it);
+         it.increment(ec)) {
+        if (!it->is_regular_file()) continue;
+
+        std::string relative = it->path().lexically_relative(root).generic_string();
+        if (!relative.ends_with(class_suffix)) continue;
+        relative.resize(relative.size() - class_suffix.size());
+        names.emplace_back(std::move(relative));
+    }
+    if (ec) {
+        spdlog::error("can't list classpath directory {}: {}", root.string(), ec.message());
+    }
+    return names;
+}
+
+ClassFileSource_ptr DirectoryClassPathEntry::open(const std::string& class_name) const {
+    fs::path file = root / (class_name + std::string(class_suffix));
+    std::error_code ec;
+    if (!fs::is_regular_file(file, ec)) return nullptr;
+    return ClassFileSource::map(file);
+}
+
+ClassPathEntry_ptr ClassPath::make_entry(const fs::path& path) {
+    auto ext = path.extension();
+    if ((ext == ".jar" || ext == ".zip") && fs::is_regular_file(path)) {
+        return std::make_unique<JarClassPathEntry>(path);
+    }
+    return std::make_unique<DirectoryClassPathEntry>(path);
+}
+
+ClassPath ClassPath::parse(const std::string& classpath) {
+    ClassPath cp;
+    std::stringstream ss(classpath);
+    std::string item;
+    while (std::getline(ss, item, ':')) {
+        if (item.empty()) continue;
+        cp.add(make_entry(item));
+    }
+    return cp;
+}
+
+ClassFileSource_ptr ClassPath::open(const std::string& class_name) const {
+    for (const auto& entry : entries) {
+        if (auto src = entry->open(class_name)) return src;
+    }
+    return nullptr;
+}
@@ -0,0 +1,324 @@
+#include "classFile/inflate.hpp"
+#include <array>
+#include <cstring>
+
+using namespace zip;
+
+namespace {
+    constexpr int fast_bits = 9;
+    constexpr int max_bits = 15;
+
+    // Canonical Huffman decoder. Codes up to fast_bits long resolve with one
+    // table probe, longer ones walk the per-length limits.
+    struct Huffman {
+        u2 fast[1 << fast_bits];
+        u2 first_code[max_bits + 2];
+        u4 max_code[max_bits + 2];
+        u2 first_symbol[max_bits + 2];
+        u1 size[288];
+        u2 value[288];
+
+        void build(const u1* lengths, int count) {
+            int sizes[max_bits + 2] = {0};
+            int next_code[max_bits + 2];
+            std::memset(fast, 0, sizeof(fast));
+
+            for (int index = 0; index < count; index++) sizes[lengths[index]]++;
+            sizes[0] = 0;
+
+            int code = 0, symbols = 0;
+            for (int bits = 1; bits <= max_bits; bits++) {
+                next_code[bits] = code;
+                first_code[bits] = static_cast<u2>(code);
+                first_symbol[bits] = static_cast<u2>(symbols);
+                code += sizes[bits];
+                if (sizes[bits] != 0 && code - 1 >= (1 << bits)) {
+                    throw ZipFormatError("oversubscribed huffman code");
+                }
+                max_code[bits] = static_cast<u4>(code) << (16 - bits);
+                code <<= 1;
+                symbols += sizes[bits];
+            }
+            max_code[max_bits + 1] = 0x10000;
+
+            for (int symbol = 0; symbol < count; symbol++) {
+                int bits = lengths[symbol];
+                if (bits == 0) continue;
+
+                int slot = next_code[bits] - first_code[bits] + first_symbol[bits];
+                size[slot] = static_cast<u1>(bits);
+                value[slot] = static_cast<u2>(symbol);
+                if (bits <= fast_bits) {
+                    for (int fill = reverse(next_code[bits], bits); fill < (1 << fast_bits);
+                         fill += 1 << bits) {
+                        fast[fill] = static_cast<u2>((bits << fast_bits) | symbol);
+                    }
+                }
+                next_code[bits]++;
+            }
+        }
+
+        static int reverse(int code, int bits) noexcept {
+            int result = 0;
+            for (int index = 0; index < bits; index++) {
+                result = (result << 1) | (code & 1);
+                code >>= 1;
+            }
+            return result;
+        }
+    };
+
+    class BitReader {
+      private:
+        const u1* cursor;
+        const u1* end;
+        u8 buffer = 0;
+        int count = 0;
+        // zero bytes fed after the end of input; a few are legal look-ahead
+        int overrun = 0;
+
+        void refill() noexcept {
+            while (count <= 56) {
+                u8 byte = 0;
+                if (cursor < end) {
+                    byte = *cursor++;
+                } else {
+                    overrun++;
+                }
+                buffer |= byte << count;
+                count += 8;
+            }
+        }
+
+      public:
+        explicit BitReader(std::span<const u1> in) : cursor(in.data()), end(in.data() + in.size()) {
+        }
+
+        u4 bits(int n) {
+            if (count < n) refill();
+            u4 v = static_cast<u4>(buffer & ((u8{1} << n) - 1));
+            buffer >>= n;
+            count -= n;
+            check();
+            return v;
+        }
+
+        int decode(const Huffman& h) {
+            if (count < 16) refill();
+            int entry = h.fast[buffer & ((1 << fast_bits) - 1)];
+            if (entry != 0) {
+                int bits = entry >> fast_bits;
+                buffer >>= bits;
+                count -= bits;
+                check();
+                return entry & ((1 << fast_bits) - 1);
+            }
+
+            int code = Huffman::reverse(static_cast<int>(buffer & 0xFFFF), 16);
+            int bits = fast_bits + 1;
+            while (bits <= max_bits && static_cast<u4>(code) >= h.max_code[bits]) bits++;
+            if (bits > max_bits) throw ZipFormatError("bad huffman code");
+
+            int slot = (code >> (16 - bits)) - h.first_code[bits] + h.first_symbol[bits];
+            if (slot < 0 || slot >= 288 || h.size[slot] != bits) {
+                throw ZipFormatError("bad huffman code");
+            }
+            buffer >>= bits;
+            count -= bits;
+            check();
+            return h.value[slot];
+        }
+
+        void align_to_byte() noexcept {
+            int drop = count & 7;
+            buffer >>= drop;
+            count -= drop;
+        }
+
+        // hand whole bytes to a stored block, draining the bit buffer first
+        void copy(u1* out, std::size_t n) {
+            while (n > 0 && count >= 8) {
+                *out++ = static_cast<u1>(buffer & 0xFF);
+                buffer >>= 8;
+                count -= 8;
+                n--;
+            }
+            check();
+            if (static_cast<std::size_t>(end - cursor) < n) {
+                throw ZipFormatError("truncated stored block");
+            }
+            std::memcpy(out, cursor, n);
+            cursor += n;
+        }
+
+        void check() const {
+            // bits still buffered cover the padding, anything beyond is real overrun
+            if (overrun * 8 > count) throw ZipFormatError("truncated deflate stream");
+        }
+    };
+
+    constexpr u2 length_base[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                    31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    constexpr u1 length_extra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                     2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    constexpr u2 dist_base[30] = {1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+                                  33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+                                  1025, 1537, 2049, 3073, 4097, 6145,  8193,  12289, 16385, 24577};
+    constexpr u1 dist_extra[30] = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                   6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+    constexpr u1 code_length_order[19] = {16, 17, 18, 0, 8,  7, 9,  6, 10, 5,
+                                          11, 4,  12, 3, 13, 2, 14, 1, 15};
+
+    const Huffman& fixed_literals() {
+        static const Huffman h = [] {
+            Huffman t;
+            u1 lengths[288];
+            for (int index = 0; index < 144; index++) lengths[index] = 8;
+            for (int index = 144; index < 256; index++) lengths[index] = 9;
+            for (int index = 256; index < 280; index++) lengths[index] = 7;
+            for (int index = 280; index < 288; index++) lengths[index] = 8;
+            t.build(lengths, 288);
+            return t;
+        }();
+        return h;
+    }
+
+    const Huffman& fixed_distances() {
+        static const Huffman h = [] {
+            Huffman t;
+            u1 lengths[30];
+            for (auto& length : lengths) length = 5;
+            t.build(lengths, 30);
+            return t;
+        }();
+        return h;
+    }
+
+    void read_dynamic_tables(BitReader& br, Huffman& literals, Huffman& distances) {
+        int hlit = static_cast<int>(br.bits(5)) + 257;
+        int hdist = static_cast<int>(br.bits(5)) + 1;
+        int hclen = static_cast<int>(br.bits(4)) + 4;
+        if (hlit > 286 || hdist > 30) throw ZipFormatError("bad dynamic block header");
+
+        u1 code_lengths[19] = {0};
+        for (int index = 0; index < hclen; index++) {
+            code_lengths[code_length_order[index]] = static_cast<u1>(br.bits(3));
+        }
+        Huffman code_length_huffman;
+        code_length_huffman.build(code_lengths, 19);
+
+        u1 lengths[286 + 30] = {0};
+        int filled = 0;
+        while (filled < hlit + hdist) {
+            int symbol = br.decode(code_length_huffman);
+            if (symbol < 16) {
+                lengths[filled++] = static_cast<u1>(symbol);
+                continue;
+            }
+
+            int repeat = 0;
+            u1 fill = 0;
+            if (symbol == 16) {
+                if (filled == 0) throw ZipFormatError("repeat with no previous length");
+                fill = lengths[filled - 1];
+                repeat = 3 + static_cast<int>(br.bits(2));
+            } else if (symbol == 17) {
+                repeat = 3 + static_cast<int>(br.bits(3));
+            } else {
+                repeat = 11 + static_cast<int>(br.bits(7));
+            }
+            if (filled + repeat > hlit + hdist) throw ZipFormatError("code lengths overflow");
+            std::memset(lengths + filled, fill, repeat);
+            filled += repeat;
+        }
+        if (lengths[256] == 0) throw ZipFormatError("missing end of block code");
+
+        literals.build(lengths, hlit);
+        distances.build(lengths + hlit, hdist);
+    }
+} // namespace
+
+void zip::inflate(std::span<const u1> in, std::span<u1> out) {
+    BitReader br(in);
+    u1* const begin = out.data();
+    u1* const end = out.data() + out.size();
+    u1* dst = begin;
+
+    Huffman dynamic_literals, dynamic_distances;
+    bool final_block = false;
+    while (!final_block) {
+        final_block = br.bits(1) != 0;
+        u4 type = br.bits(2);
+
+        if (type == 0) {
+            br.align_to_byte();
+            u4 len = br.bits(16);
+            u4 nlen = br.bits(16);
+            if ((len ^ 0xFFFF) != nlen) throw ZipFormatError("corrupt stored block length");
+            if (static_cast<std::size_t>(end - dst) < len) throw ZipFormatError("output overflow");
+            br.copy(dst, len);
+            dst += len;
+            continue;
+        }
+
+        const Huffman* literals = &fixed_literals();
+        const Huffman* distances = &fixed_distances();
+        if (type == 2) {
+            read_dynamic_tables(br, dynamic_literals, dynamic_distances);
+            literals = &dynamic_literals;
+            distances = &dynamic_distances;
+        } else if (type != 1) {
+            throw ZipFormatError("reserved deflate block type");
+        }
+
+        for (;;) {
+            int symbol = br.decode(*literals);
+            if (symbol < 256) {
+                if (dst == end) throw ZipFormatError("output overflow");
+                *dst++ = static_cast<u1>(symbol);
+                continue;
+            }
+            if (symbol == 256) break;
+
+            symbol -= 257;
+            if (symbol >= 29) throw ZipFormatError("bad length symbol");
+            std::size_t length = length_base[symbol] + br.bits(length_extra[symbol]);
+
+            int dist_symbol = br.decode(*distances);
+            if (dist_symbol >= 30) throw ZipFormatError("bad distance symbol");
+            std::size_t distance = dist_base[dist_symbol] + br.bits(dist_extra[dist_symbol]);
+
+            if (distance > static_cast<std::size_t>(dst - begin)) {
+                throw ZipFormatError("distance before start of output");
+            }
+            if (length > static_cast<std::size_t>(end - dst)) throw ZipFormatError("output overflow");
+
+            const u1* from = dst - distance;
+            if (distance >= length) {
+                std::memcpy(dst, from, length);
+                dst += length;
+            } else {
+                // overlapping copy repeats the last `distance` bytes
+                while (length-- > 0) *dst++ = *from++;
+            }
+        }
+    }
+
+    if (dst != end) throw ZipFormatError("deflate stream shorter than expected size");
+}
+
+u4 zip::crc32(std::span<const u1> bytes, u4 crc) noexcept {
+    static const std::array<u4, 256> table = [] {
+        std::array<u4, 256> t{};
+        for (u4 index = 0; index < 256; index++) {
+            u4 c = index;
+            for (int bit = 0; bit < 8; bit++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[index] = c;
+        }
+        return t;
+    }();
+
+    crc = ~crc;
+    for (u1 byte : bytes) crc = table[(crc ^ byte) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
@@ -0,0 +1,213 @@
+#include "classFile/jar_file.hpp"
+#include <spdlog/spdlog.h>
+
+using namespace zip;
+
+namespace {
+    constexpr u4 EOCD_SIGNATURE = 0x06054b50;
+    constexpr u4 ZIP64_LOCATOR_SIGNATURE = 0x07064b50;
+    constexpr u4 ZIP64_EOCD_SIGNATURE = 0x06064b50;
+    constexpr u4 CENTRAL_SIGNATURE = 0x02014b50;
+    constexpr u4 LOCAL_SIGNATURE = 0x04034b50;
+    constexpr u2 ZIP64_EXTRA_ID = 0x0001;
+
+    constexpr std::size_t EOCD_SIZE = 22;
+    constexpr std::size_t ZIP64_LOCATOR_SIZE = 20;
+    constexpr std::size_t CENTRAL_SIZE = 46;
+    constexpr std::size_t LOCAL_SIZE = 30;
+    constexpr u2 DATA_DESCRIPTOR_FLAG = 0x8;
+    // deflate emits at least a couple of bits per 258 byte match
+    constexpr u8 MAX_DEFLATE_RATIO = 1032;
+
+    // zip fields are little endian
+    template <class T> T load(std::span<const u1> image, u8 offset) {
+        if (offset > image.size() || image.size() - offset < sizeof(T)) {
+            throw ZipFormatError("zip structure runs past the end of the archive");
+        }
+        T v = 0;
+        for (std::size_t index = 0; index < sizeof(T); index++) {
+            v |= static_cast<T>(image[offset + index]) << (8 * index);
+        }
+        return v;
+    }
+
+    constexpr std::string_view class_suffix = ".class";
+} // namespace
+
+JarFile::JarFile(std::filesystem::path archive) : path(std::move(archive)) {
+    image = ClassFileSource::map(path);
+    read_central_directory();
+}
+
+void JarFile::read_central_directory() {
+    auto bytes = image->bytes();
+    if (bytes.size() < EOCD_SIZE) throw ZipFormatError("not a zip archive: " + path.string());
+
+    // the end record sits behind an optional comment of at most 64K
+    u8 eocd = bytes.size() - EOCD_SIZE;
+    u8 lowest = eocd > 0xFFFF ? eocd - 0xFFFF : 0;
+    while (load<u4>(bytes, eocd) != EOCD_SIGNATURE) {
+        if (eocd == lowest) throw ZipFormatError("no end of central directory: " + path.string());
+        eocd--;
+    }
+
+    u8 entries = load<u2>(bytes, eocd + 10);
+    u8 cd_size = load<u4>(bytes, eocd + 12);
+    u8 cd_offset = load<u4>(bytes, eocd + 16);
+
+    if (entries == 0xFFFF || cd_size == 0xFFFFFFFF || cd_offset == 0xFFFFFFFF) {
+        if (eocd < ZIP64_LOCATOR_SIZE ||
+            load<u4>(bytes, eocd - ZIP64_LOCATOR_SIZE) != ZIP64_LOCATOR_SIGNATURE) {
+            throw ZipFormatError("missing zip64 locator: " + path.string());
+        }
+        u8 zip64_eocd = load<u8>(bytes, eocd - ZIP64_LOCATOR_SIZE + 8);
+        if (load<u4>(bytes, zip64_eocd) != ZIP64_EOCD_SIGNATURE) {
+            throw ZipFormatError("bad zip64 end record: " + path.string());
+        }
+        entries = load<u8>(bytes, zip64_eocd + 32);
+        cd_size = load<u8>(bytes, zip64_eocd + 40);
+        cd_offset = load<u8>(bytes, zip64_eocd + 48);
+    }
+
+    if (cd_offset > bytes.size() || bytes.size() - cd_offset < cd_size) {
+        throw ZipFormatError("central directory out of range: " + path.string());
+    }
+
+    index.reserve(entries);
+    u8 cursor = cd_offset;
+    for (u8 count = 0; count < entries; count++) {
+        if (load<u4>(bytes, cursor) != CENTRAL_SIGNATURE) {
+            throw ZipFormatError("bad central directory entry: " + path.string());
+        }
+
+        Entry entry{};
+        entry.flags = load<u2>(bytes, cursor + 8);
+        entry.method = load<u2>(bytes, cursor + 10);
+        entry.crc = load<u4>(bytes, cursor + 16);
+        entry.compressed_size = load<u4>(bytes, cursor + 20);
+        entry.uncompressed_size = load<u4>(bytes, cursor + 24);
+        u2 name_length = load<u2>(bytes, cursor + 28);
+        u2 extra_length = load<u2>(bytes, cursor + 30);
+        u2 comment_length = load<u2>(bytes, cursor + 32);
+        entry.local_header_offset = load<u4>(bytes, cursor + 42);
+
+        u8 name_offset = cursor + CENTRAL_SIZE;
+        u8 extra_offset = name_offset + name_length;
+        if (extra_offset + extra_length > bytes.size()) {
+            throw ZipFormatError("central directory entry out of range: " + path.string());
+        }
+
+        // zip64 extra field carries only the values saturated in the fixed part
+        for (u8 extra = extra_offset; extra + 4 <= extra_offset + extra_length;) {
+            u2 id = load<u2>(bytes, extra);
+            u2 size = load<u2>(bytes, extra + 2);
+            if (id == ZIP64_EXTRA_ID) {
+                u8 field = extra + 4;
+                if (entry.uncompressed_size == 0xFFFFFFFF) {
+                    entry.uncompressed_size = load<u8>(bytes, field);
+                    field += 8;
+                }
+                if (entry.compressed_size == 0xFFFFFFFF) {
+                    entry.compressed_size = load<u8>(bytes, field);
+                    field += 8;
+                }
+                if (entry.local_header_offset == 0xFFFFFFFF) {
+                    entry.local_header_offset = load<u8>(bytes, field);
+                }
+            }
+            extra += 4 + size;
+        }
+
+        std::string_view name(reinterpret_cast<const char*>(bytes.data() + name_offset),
+                              name_length);
+        index.try_emplace(name, entry);
+        cursor = extra_offset + extra_length + comment_length;
+    }
+}
+
+std::span<const u1> JarFile::member_data(const Entry& entry) const {
+    auto bytes = image->bytes();
+    u8 header = entry.local_header_offset;
+    if (load<u4>(bytes, header) != LOCAL_SIGNATURE) {
+        throw ZipFormatError("bad local file header: " + path.string());
+    }
+    // without a data descriptor the local header repeats the sizes; a
+    // saturated value defers to its zip64 extra field
+    if (!(entry.flags & DATA_DESCRIPTOR_FLAG)) {
+        u4 compressed = load<u4>(bytes, header + 18);
+        u4 uncompressed = load<u4>(bytes, header + 22);
+        if ((compressed != 0xFFFFFFFF && compressed != entry.compressed_size) ||
+            (uncompressed != 0xFFFFFFFF && uncompressed != entry.uncompressed_size)) {
+            throw ZipFormatError("local header disagrees with central directory: " +
+                                 path.string());
+        }
+    }
+    // the local extra field may differ from the central one
+    u8 data = header + LOCAL_SIZE + load<u2>(bytes, header + 26) + load<u2>(bytes, header + 28);
+    if (data > bytes.size() || bytes.size() - data < entry.compressed_size) {
+        throw ZipFormatError("member data out of range: " + path.string());
+    }
+    return bytes.subspan(data, entry.compressed_size);
+}
+
+std::vector<std::string_view> JarFile::members() const {
+    std::vector<std::string_view> names;
+    names.reserve(index.size());
+    for (const auto& [name, entry] : index) names.push_back(name);
+    return names;
+}
+
+ClassFileSource_ptr JarFile::open(std::string_view member) const {
+    const Entry* entry = find(member);
+    if (entry == nullptr) return nullptr;
+
+    if (entry->flags & 0x1) {
+        throw ZipFormatError("encrypted member " + std::string(member) + " in " + path.string());
+    }
+
+    auto data = member_data(*entry);
+    switch (entry->method) {
+        case METHOD_STORED: {
+            if (entry->compressed_size != entry->uncompressed_size) {
+                throw ZipFormatError("stored member size mismatch: " + std::string(member));
+            }
+            if (crc32(data) != entry->crc) {
+                throw ZipFormatError("crc mismatch in " + std::string(member));
+            }
+            // zero copy: the member keeps the whole archive mapping alive
+            return ClassFileSource::borrow(data, image);
+        }
+        case METHOD_DEFLATED: {
+            // the size is only a claim of the archive; bound it before allocating
+            if (entry->uncompressed_size / MAX_DEFLATE_RATIO > entry->compressed_size) {
+                throw ZipFormatError("implausible uncompressed size for " + std::string(member));
+            }
+            std::unique_ptr<u1[]> buffer(new u1[entry->uncompressed_size]);
+            std::span<u1> out(buffer.get(), entry->uncompressed_size);
+            inflate(data, out);
+            if (crc32(out) != entry->crc) {
+                throw ZipFormatError("crc mismatch in " + std::string(member));
+            }
+            return ClassFileSource::adopt(std::move(buffer), out.size());
+        }
+        default: {
+            spdlog::error("unsupported compression method {} for {}", entry->method, member);
+            throw ZipFormatError("unsupported compression method " +
+                                 std::to_string(entry->method));
+        }
+    }
+}
+
+std::vector<std::string> JarClassPathEntry::class_names() const {
+    std::vector<std::string> names;
+    for (auto member : jar->members()) {
+        if (!member.ends_with(class_suffix) || member.starts_with("META-INF/")) continue;
+        member.remove_suffix(class_suffix.size());
+        names.emplace_back(member);
+    }
+    return names;
+}
+
+ClassFileSource_ptr JarClassPathEntry::open(const std::string& class_name) const {
+    return jar->open(class_name + std::string(class_suffix));
+}
@@ -0,0 +1,239 @@
+#include "classFile/modified_utf8.hpp"
+#include "classFile/byte_code_reader.hpp"
+#include <array>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MUTF8_X86 1
+#endif
+
+using namespace mutf8;
+
+namespace {
+    constexpr std::array<u4, 33> pow31 = [] {
+        std::array<u4, 33> powers{};
+        powers[0] = 1;
+        for (std::size_t index = 1; index < powers.size(); index++) {
+            powers[index] = powers[index - 1] * 31u;
+        }
+        return powers;
+    }();
+
+    // Consumes one character starting at `at`, folding its bytes into the hash.
+    // Returns false on a malformed sequence.
+    inline bool scalar_step(const u1* bytes, std::size_t size, std::size_t& at, ScanResult& r) {
+        u1 lead = bytes[at];
+        std::size_t width;
+        if (lead >= 0x01 && lead <= 0x7F) {
+            width = 1;
+        } else if ((lead & 0xE0) == 0xC0) {
+            width = 2;
+            if (at + 1 >= size || (bytes[at + 1] & 0xC0) != 0x80) return false;
+            // C0 80 is the encoded NUL, every other overlong form is rejected
+            if (lead < 0xC2 && !(lead == 0xC0 && bytes[at + 1] == 0x80)) return false;
+        } else if ((lead & 0xF0) == 0xE0) {
+            width = 3;
+            if (at + 2 >= size || (bytes[at + 1] & 0xC0) != 0x80 ||
+                (bytes[at + 2] & 0xC0) != 0x80) {
+                return false;
+            }
+            if (lead == 0xE0 && bytes[at + 1] < 0xA0) return false;
+        } else {
+            // NUL, a stray continuation byte or a four byte form
+            return false;
+        }
+
+        for (std::size_t index = 0; index < width; index++) {
+            r.hash = r.hash * 31u + bytes[at + index];
+        }
+        r.ascii &= width == 1;
+        r.utf16_length += 1;
+        at += width;
+        return true;
+    }
+
+    // scalar_step until `stop`, the tail or the first error
+    inline bool scalar_until(const u1* bytes, std::size_t size, std::size_t& at, std::size_t stop,
+                             ScanResult& r) {
+        while (at < stop && at < size) {
+            if (!scalar_step(bytes, size, at, r)) return false;
+        }
+        return true;
+    }
+
+    constexpr ScanResult invalid{false, false, 0, 0};
+} // namespace
+
+u4 mutf8::hash(std::span<const u1> bytes) noexcept {
+    u4 h = 0;
+    for (u1 b : bytes) h = h * 31u + b;
+    return h;
+}
+
+ScanResult mutf8::detail::scan_scalar(std::span<const u1> bytes) noexcept {
+    ScanResult r{true, true, 0, 0};
+    std::size_t at = 0;
+    if (!scalar_until(bytes.data(), bytes.size(), at, bytes.size(), r)) return invalid;
+    return r;
+}
+
+#ifdef MUTF8_X86
+
+bool mutf8::detail::has_sse41() noexcept {
+    return __builtin_cpu_supports("sse4.1");
+}
+
+bool mutf8::detail::has_avx2() noexcept {
+    return __builtin_cpu_supports("avx2");
+}
+
+// Blocks of plain ASCII without NUL are checked with two compares and hashed as
+// sum(b[k] * 31^(n-1-k)); a block holding anything else is walked scalar.
+__attribute__((target("sse4.1"))) ScanResult
+mutf8::detail::scan_sse41(std::span<const u1> bytes) noexcept {
+    const u1* data = bytes.data();
+    const std::size_t size = bytes.size();
+    ScanResult r{true, true, 0, 0};
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i p0 = _mm_setr_epi32(pow31[15], pow31[14], pow31[13], pow31[12]);
+    const __m128i p1 = _mm_setr_epi32(pow31[11], pow31[10], pow31[9], pow31[8]);
+    const __m128i p2 = _mm_setr_epi32(pow31[7], pow31[6], pow31[5], pow31[4]);
+    const __m128i p3 = _mm_setr_epi32(pow31[3], pow31[2], pow31[1], pow31[0]);
+
+    std::size_t at = 0;
+    while (at + 16 <= size) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + at));
+        if ((_mm_movemask_epi8(v) | _mm_movemask_epi8(_mm_cmpeq_epi8(v, zero))) != 0) {
+            if (!scalar_until(data, size, at, at + 16, r)) return invalid;
+            continue;
+        }
+
+        __m128i sum = _mm_mullo_epi32(_mm_cvtepu8_epi32(v), p0);
+        sum = _mm_add_epi32(sum, _mm_mullo_epi32(_mm_cvtepu8_epi32(_mm_srli_si128(v, 4)), p1));
+        sum = _mm_add_epi32(sum, _mm_mullo_epi32(_mm_cvtepu8_epi32(_mm_srli_si128(v, 8)), p2));
+        sum = _mm_add_epi32(sum, _mm_mullo_epi32(_mm_cvtepu8_epi32(_mm_srli_si128(v, 12)), p3));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+
+        r.hash = r.hash * pow31[16] + static_cast<u4>(_mm_cvtsi128_si32(sum));
+        r.utf16_length += 16;
+        at += 16;
+    }
+
+    if (!scalar_until(data, size, at, size, r)) return invalid;
+    return r;
+}
+
+__attribute__((target("avx2"))) ScanResult
+mutf8::detail::scan_avx2(std::span<const u1> bytes) noexcept {
+    const u1* data = bytes.data();
+    const std::size_t size = bytes.size();
+    ScanResult r{true, true, 0, 0};
+
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i powers[4];
+    for (int quarter = 0; quarter < 4; quarter++) {
+        alignas(32) u4 lanes[8];
+        for (int lane = 0; lane < 8; lane++) lanes[lane] = pow31[31 - quarter * 8 - lane];
+        powers[quarter] = _mm256_load_si256(reinterpret_cast<const __m256i*>(lanes));
+    }
+
+    std::size_t at = 0;
+    while (at + 32 <= size) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + at));
+        if ((_mm256_movemask_epi8(v) | _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, zero))) != 0) {
+            if (!scalar_until(data, size, at, at + 32, r)) return invalid;
+            continue;
+        }
+
+        __m128i lo = _mm256_castsi256_si128(v);
+        __m128i hi = _mm256_extracti128_si256(v, 1);
+        __m256i sum = _mm256_mullo_epi32(_mm256_cvtepu8_epi32(lo), powers[0]);
+        sum = _mm256_add_epi32(
+            sum, _mm256_mullo_epi32(_mm256_cvtepu8_epi32(_mm_srli_si128(lo, 8)), powers[1]));
+        sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(_mm256_cvtepu8_epi32(hi), powers[2]));
+        sum = _mm256_add_epi32(
+            sum, _mm256_mullo_epi32(_mm256_cvtepu8_epi32(_mm_srli_si128(hi, 8)), powers[3]));
+
+        __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+
+        r.hash = r.hash * pow31[32] + static_cast<u4>(_mm_cvtsi128_si32(half));
+        r.utf16_length += 32;
+        at += 32;
+    }
+
+    if (!scalar_until(data, size, at, size, r)) return invalid;
+    return r;
+}
+
+#else
+
+bool mutf8::detail::has_sse41() noexcept {
+    return false;
+}
+
+bool mutf8::detail::has_avx2() noexcept {
+    return false;
+}
+
+ScanResult mutf8::detail::scan_sse41(std::span<const u1> bytes) noexcept {
+    return scan_scalar(bytes);
+}
+
+ScanResult mutf8::detail::scan_avx2(std::span<const u1> bytes) noexcept {
+    return scan_scalar(bytes);
+}
+
+#endif
+
+ScanResult mutf8::scan(std::span<const u1> bytes) noexcept {
+    using Kernel = ScanResult (*)(std::span<const u1>) noexcept;
+    static const Kernel kernel = detail::has_avx2()    ? &detail::scan_avx2
+                                 : detail::has_sse41() ? &detail::scan_sse41
+                                                       : &detail::scan_scalar;
+    return kernel(bytes);
+}
+
+std::u16string mutf8::to_utf16(std::span<const u1> bytes) {
+    ScanResult r = scan(bytes);
+    if (!r.valid) throw ClassFormatError("malformed modified utf-8");
+
+    std::u16string out(r.utf16_length, u'\0');
+    char16_t* dst = out.data();
+    const u1* src = bytes.data();
+    const u1* end = src + bytes.size();
+
+    if (r.ascii) {
+#ifdef MUTF8_X86
+        // SSE2 is part of x86-64, widen 16 bytes at a time
+        const __m128i zero = _mm_setzero_si128();
+        for (; end - src >= 16; src += 16, dst += 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_unpacklo_epi8(v, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 8), _mm_unpackhi_epi8(v, zero));
+        }
+#endif
+        while (src < end) *dst++ = *src++;
+        return out;
+    }
+
+    // validated above, so every sequence is complete
+    while (src < end) {
+        u1 lead = *src;
+        if (lead < 0x80) {
+            *dst++ = lead;
+            src += 1;
+        } else if ((lead & 0xE0) == 0xC0) {
+            *dst++ = static_cast<char16_t>(((lead & 0x1F) << 6) | (src[1] & 0x3F));
+            src += 2;
+        } else {
+            *dst++ = static_cast<char16_t>(((lead & 0x0F) << 12) | ((src[1] & 0x3F) << 6) |
+                                           (src[2] & 0x3F));
+            src += 3;
+        }
+    }
+    return out;
+}
@@ -1,13 +1,61 @@
+#include "classFile/class_archive.hpp"
 #include "classFile/class_file.hpp"
+#include "classFile/class_path.hpp"
+#include "runtime/class_loader.hpp"
 #include "runtime/gc.hpp"
-#include "runtime/string_pool.hpp"
+#include "runtime/symbol_table.hpp"
 #include "runtime/vm_fwd.hpp"
 #include <limits>
 #include <memory>
 #include <numeric>
+#include <string_view>
 #include <thread>
 
 using namespace vm::memory;
-int main(void) {
 
-}
\ No newline at end of file
+// -cp <path>                     classes to load
+// -Xshare:dump                   load the class path and write it to the archive
+// -Xshare:on                     load the archive instead of parsing the class path
+// -XX:SharedArchiveFile=<file>   archive location, classes.jsa by default
+int main(int argc, char** argv) {
+    std::string classpath;
+    std::string archive_file = "classes.jsa";
+    std::string_view share_mode;
+
+    for (int index = 1; index < argc; index++) {
+        std::string_view arg = argv[index];
+        if ((arg == "-cp" || arg == "-classpath") && index + 1 < argc) {
+            classpath = argv[++index];
+        } else if (arg.starts_with("-Xshare:")) {
+            share_mode = arg.substr(8);
+        } else if (arg.starts_with("-XX:SharedArchiveFile=")) {
+            archive_file = arg.substr(22);
+        } else {
+            spdlog::error("unrecognized option {}", arg);
+            return 1;
+        }
+    }
+
+    auto& dictionary = rt_jvm_data::SystemDictionary::instance();
+    rt_jvm_data::BatchClassLoader loader(dictionary);
+    try {
+        if (share_mode == "on") {
+            raw_jvm_data::SharedClassArchive archive(archive_file);
+            auto result = loader.load_archive(archive);
+            spdlog::info("loaded {} classes from {}", result.loaded, archive_file);
+            return result.failures.empty() ? 0 : 1;
+        }
+
+        auto result = loader.load_classpath(ClassPath::parse(classpath));
+        spdlog::info("loaded {} classes from the class path", result.loaded);
+        if (share_mode == "dump") {
+            std::vector<const rt_jvm_data::InstanceKlass*> classes;
+            for (auto kls : dictionary.snapshot()) classes.push_back(kls);
+            raw_jvm_data::SharedClassArchive::dump(archive_file, classes);
+        }
+        return result.failures.empty() ? 0 : 1;
+    } catch (const std::exception& e) {
+        spdlog::error("{}", e.what());
+        return 1;
+    }
+}
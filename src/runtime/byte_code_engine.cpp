@@ -1,14 +1,1049 @@
 #include "runtime/byte_code_engine.hpp"
+#include "runtime/byte_code_helpers.hpp"
+#include "runtime/compile_broker.hpp"
 
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <mutex>
 #include <stdexcept>
 #include <string>
 
 namespace jvm {
 
+    using namespace raw_jvm_type;
+    using raw_jvm_data::ACC_ABSTRACT;
+    using raw_jvm_data::ACC_INTERFACE;
+    using raw_jvm_data::ACC_NATIVE;
+    using raw_jvm_data::ACC_STATIC;
+    using raw_jvm_data::ACC_SYNCHRONIZED;
+    using rt_jvm_data::ArrayKlass;
+    using rt_jvm_data::CodeInfo;
+    using rt_jvm_data::CpCacheEntry;
+    using rt_jvm_data::InstanceKlass;
+    using rt_jvm_data::KlassType;
+    using rt_jvm_data::MethodWrapper;
+    using rt_jvm_data::PrimitiveKlass;
+    using rt_jvm_data::RawKlass;
+    using rt_jvm_data::raw_value_type;
+    using Registers = BytecodeEngine::Registers;
+    using Outcome = BytecodeEngine::Outcome;
+
+    namespace {
+        // where pc goes when the activation is over
+        constexpr u1 leave_code[] = {_leave};
+
+        // Interpreted frames nest on the C++ stack; past this much of it below
+        // the outermost one a call raises StackOverflowError. Threads get 8 MB
+        // by default on Linux.
+        constexpr std::uintptr_t max_stack_bytes = 4 << 20;
+        // where the outermost interpreted frame of the thread started, 0 outside
+        thread_local std::uintptr_t stack_base = 0;
+
+        inline std::uintptr_t stack_position() noexcept {
+            return reinterpret_cast<std::uintptr_t>(__builtin_frame_address(0));
+        }
+
+        // sets stack_base for the outermost frame of the thread, interpreted
+        // or compiled
+        struct Outermost {
+            bool outermost = stack_base == 0;
+            Outermost() {
+                if (outermost) stack_base = stack_position();
+            }
+            ~Outermost() {
+                if (outermost) stack_base = 0;
+            }
+            Outermost(const Outermost&) = delete;
+            Outermost& operator=(const Outermost&) = delete;
+        };
+
+        // Dispatch reads the opcode with acquire: quicken publishes a _quick
+        // opcode with release after its operands, while other threads may be
+        // running the same code.
+        inline u1 opcode_at(const u1* pc) noexcept {
+            return __atomic_load_n(pc, __ATOMIC_ACQUIRE);
+        }
+
+        constexpr std::array<u1, 256> lengths = [] {
+            std::array<u1, 256> table{};
+#define X(code, name, length) table[code] = length;
+#include "runtime/byte_code_engine.def"
+#undef X
+            return table;
+        }();
+
+        // Slot contents: an int or float in the low half, a long, double or
+        // reference in the whole word
+        inline std::int32_t int_at(const Slot* slot) noexcept {
+            return static_cast<std::int32_t>(static_cast<u4>(slot->raw));
+        }
+        inline void set_int(Slot* slot, std::int32_t value) noexcept {
+            slot->raw = static_cast<u4>(value);
+        }
+        inline std::int64_t long_at(const Slot* slot) noexcept {
+            return static_cast<std::int64_t>(slot->raw);
+        }
+        inline void set_long(Slot* slot, std::int64_t value) noexcept {
+            slot->raw = static_cast<u8>(value);
+        }
+        inline float float_at(const Slot* slot) noexcept {
+            return std::bit_cast<float>(static_cast<u4>(slot->raw));
+        }
+        inline void set_float(Slot* slot, float value) noexcept {
+            slot->raw = std::bit_cast<u4>(value);
+        }
+        inline double double_at(const Slot* slot) noexcept {
+            return std::bit_cast<double>(slot->raw);
+        }
+        inline void set_double(Slot* slot, double value) noexcept {
+            slot->raw = std::bit_cast<u8>(value);
+        }
+        inline oop::BasicOop* ref_at(const Slot* slot) noexcept {
+            return reinterpret_cast<oop::BasicOop*>(slot->raw);
+        }
+        inline void set_ref(Slot* slot, const oop::BasicOop* value) noexcept {
+            slot->raw = reinterpret_cast<u8>(value);
+        }
+
+        // two's complement arithmetic without signed overflow
+        inline std::int32_t wrap(u4 value) noexcept {
+            return static_cast<std::int32_t>(value);
+        }
+        inline std::int64_t wrap(u8 value) noexcept {
+            return static_cast<std::int64_t>(value);
+        }
+
+        // f2i, d2l and the like: NaN is 0, out of range values saturate
+        template <class To, class From> To java_cast(From value) noexcept {
+            if (std::isnan(value)) return 0;
+            if (value >= static_cast<From>(std::numeric_limits<To>::max())) {
+                return std::numeric_limits<To>::max();
+            }
+            if (value <= static_cast<From>(std::numeric_limits<To>::min())) {
+                return std::numeric_limits<To>::min();
+            }
+            return static_cast<To>(value);
+        }
+
+        // fcmpl and dcmpl push -1 for NaN, fcmpg and dcmpg 1
+        template <class T> std::int32_t compare(T a, T b, std::int32_t nan) noexcept {
+            if (a > b) return 1;
+            if (a == b) return 0;
+            if (a < b) return -1;
+            return nan;
+        }
+
+        // a field or component of type `type` as an operand stack value
+        inline Slot load_value(const std::byte* at, raw_value_type type) noexcept {
+            Slot slot;
+            switch (type) {
+                case raw_value_type::Jboolean:
+                    slot.raw = *reinterpret_cast<const u1*>(at);
+                    break;
+                case raw_value_type::Jbyte:
+                    set_int(&slot, *reinterpret_cast<const std::int8_t*>(at));
+                    break;
+                case raw_value_type::Jchar: {
+                    u2 value;
+                    std::memcpy(&value, at, sizeof(value));
+                    slot.raw = value;
+                    break;
+                }
+                case raw_value_type::Jshort: {
+                    std::int16_t value;
+                    std::memcpy(&value, at, sizeof(value));
+                    set_int(&slot, value);
+                    break;
+                }
+                case raw_value_type::Jint:
+                case raw_value_type::Jfloat: {
+                    u4 value;
+                    std::memcpy(&value, at, sizeof(value));
+                    slot.raw = value;
+                    break;
+                }
+                case raw_value_type::Jlong:
+                case raw_value_type::Jdouble:
+                case raw_value_type::Jreference:
+                    std::memcpy(&slot.raw, at, sizeof(slot.raw));
+                    break;
+            }
+            return slot;
+        }
+
+        // ints narrowed to the field, booleans to their lowest bit
+        inline void store_value(std::byte* at, raw_value_type type, Slot slot) noexcept {
+            switch (type) {
+                case raw_value_type::Jboolean:
+                    *reinterpret_cast<u1*>(at) = slot.raw & 1;
+                    break;
+                case raw_value_type::Jbyte:
+                    *reinterpret_cast<u1*>(at) = static_cast<u1>(slot.raw);
+                    break;
+                case raw_value_type::Jchar:
+                case raw_value_type::Jshort: {
+                    auto value = static_cast<u2>(slot.raw);
+                    std::memcpy(at, &value, sizeof(value));
+                    break;
+                }
+                case raw_value_type::Jint:
+                case raw_value_type::Jfloat: {
+                    auto value = static_cast<u4>(slot.raw);
+                    std::memcpy(at, &value, sizeof(value));
+                    break;
+                }
+                case raw_value_type::Jlong:
+                case raw_value_type::Jdouble:
+                case raw_value_type::Jreference:
+                    std::memcpy(at, &slot.raw, sizeof(slot.raw));
+                    break;
+            }
+        }
+
+        inline std::byte* field_address(oop::BasicOop* object, u4 offset) noexcept {
+            return static_cast<oop::InstanceOop*>(object)->bytes + offset;
+        }
+
+        inline oop::ArrayOop* as_array(oop::BasicOop* object) noexcept {
+            return static_cast<oop::ArrayOop*>(object);
+        }
+
+        bool is_named(const InstanceKlass* kls, std::string_view name) {
+            return kls->get_name().view() == name;
+        }
+
+        // JVMS 6.5 checkcast: whether a value of type `from` may be used as a `to`
+        bool is_subtype(const RawKlass* from, const RawKlass* to) {
+            if (from == to) return true;
+            switch (to->get_klass_type()) {
+                case KlassType::Instance: {
+                    auto* target = static_cast<const InstanceKlass*>(to);
+                    if (from->get_klass_type() == KlassType::Array) {
+                        return is_named(target, "java/lang/Object") ||
+                               is_named(target, "java/lang/Cloneable") ||
+                               is_named(target, "java/io/Serializable");
+                    }
+                    if (from->get_klass_type() != KlassType::Instance) return false;
+                    auto* source = static_cast<const InstanceKlass*>(from);
+                    if (target->is_interface()) return source->implements(target);
+                    for (auto* kls = source; kls != nullptr; kls = kls->get_super()) {
+                        if (kls == target) return true;
+                    }
+                    // interfaces have no superclass of their own
+                    return source->is_interface() && is_named(target, "java/lang/Object");
+                }
+                case KlassType::Array: {
+                    if (from->get_klass_type() != KlassType::Array) return false;
+                    const RawKlass* source = static_cast<const ArrayKlass*>(from)->get_component();
+                    const RawKlass* target = static_cast<const ArrayKlass*>(to)->get_component();
+                    if (source->get_klass_type() == KlassType::Primitive ||
+                        target->get_klass_type() == KlassType::Primitive) {
+                        return source == target;
+                    }
+                    return is_subtype(source, target);
+                }
+                case KlassType::Primitive:
+                    return false;
+            }
+            return false;
+        }
+
+        oop::Ref allocate_instance(const Runtime& runtime, const InstanceKlass& kls) {
+            assert(runtime.heap != nullptr);
+            return runtime.heap->allocate_instance(&kls, kls.get_field_layout().object_size());
+        }
+
+        oop::Ref allocate_array(const Runtime& runtime, const ArrayKlass& kls,
+                                std::int32_t length) {
+            assert(runtime.heap != nullptr);
+            return runtime.heap->allocate_array(&kls, length, kls.component_size());
+        }
+
+        Outcome call(const MethodWrapper& method, const Slot* arguments, const Runtime& runtime,
+                     oop::Ref thread);
+
+        // Initializes `kls` running <clinit> in the interpreter; an exception
+        // from it is thrown as JavaException.
+        void initialize(const InstanceKlass& kls, const Runtime& runtime, oop::Ref thread) {
+            kls.initialize(runtime.resolver, [&](const MethodWrapper& clinit) {
+                Outcome outcome = call(clinit, nullptr, runtime, thread);
+                if (outcome.exception) throw JavaException(outcome.exception);
+            });
+        }
+
+        // An exception of class `name` made by the VM, without a constructor.
+        oop::Ref make_throwable(const Runtime& runtime, std::string_view name, oop::Ref thread) {
+            const InstanceKlass* kls = nullptr;
+            if (runtime.resolver.klass) kls = runtime.resolver.klass(SymbolTable::intern(name));
+            if (kls == nullptr) throw rt_jvm_data::NoClassDefFoundError(std::string(name));
+            initialize(*kls, runtime, thread);
+            return allocate_instance(runtime, *kls);
+        }
+
+        // Throws `exception` at pc: moves to the handler that catches it, or
+        // to leave when it propagates to the caller.
+        Registers raise(Registers r, oop::Ref exception) {
+            StackFrame& frame = *r.frame;
+            frame.set_pc(static_cast<u4>(r.pc - r.code));
+            const RawKlass* type = type_of(exception.get());
+            const InstanceKlass& kls = frame.get_klass();
+            bool caught = frame.dispatch_exception([&](u2 catch_type) {
+                if (catch_type == 0) return true;
+                const CpCacheEntry* entry = kls.resolve(catch_type, r.runtime->resolver);
+                return entry != nullptr && entry->klass != nullptr &&
+                       is_subtype(type, entry->klass);
+            });
+            if (!caught) {
+                r.exception = exception;
+                r.pc = leave_code;
+                return r;
+            }
+            r.pc = r.code + frame.get_pc();
+            r.sp = frame.stack();
+            set_ref(r.sp++, exception.get());
+            return r;
+        }
+
+        Registers raise(Registers r, std::string_view name) {
+            try {
+                return raise(r, make_throwable(*r.runtime, name, r.frame->get_thread()));
+            } catch (const JavaException& e) {
+                // the exception class failed to initialize
+                return raise(r, e.get_exception());
+            }
+        }
+
+        // Registers after initializing `kls`, pc moved to a handler when that threw
+        Registers initialize(Registers r, const InstanceKlass& kls) {
+            try {
+                initialize(kls, *r.runtime, r.frame->get_thread());
+            } catch (const JavaException& e) {
+                return raise(r, e.get_exception());
+            } catch (const rt_jvm_data::NoClassDefFoundError&) {
+                return raise(r, "java/lang/NoClassDefFoundError");
+            }
+            return r;
+        }
+
+        // The instruction at pc as the class file has it. Slow paths read their
+        // operands here, since a thread quickening the instruction may change
+        // its operand bytes in quick_code under them.
+        inline const u1* original(const Registers& r) noexcept {
+            return r.frame->get_code()->code.data() + (r.pc - r.code);
+        }
+
+        // Raises what resolving the constant at `index` failed with, the same
+        // LinkageError on every attempt; InternalError for a string the
+        // resolver did not give.
+        Registers unresolved(Registers r, u2 index) {
+            const char* error = r.frame->get_klass().resolution_error(index);
+            return raise(r, error != nullptr ? error : "java/lang/InternalError");
+        }
+        // the same for the constant at the operand of the instruction at pc
+        Registers unresolved(Registers r) {
+            return unresolved(r, u2_at(original(r) + 1));
+        }
+
+        // the resolved cache entry a _quick instruction names
+        inline const CpCacheEntry& quick_entry(const Registers& r) noexcept {
+            return r.frame->get_klass().resolved_entry(u2_at(r.pc + 1));
+        }
+
+        // A superinstruction and the instructions it stands for, from
+        // byte_code_superinstructions.def
+        struct Superinstruction {
+            u1 opcode;
+            u1 count;
+            std::array<u1, 3> instructions;
+        };
+
+#define INSTRUCTIONS(_1, _2, _3, instructions, ...) instructions
+#define INSTRUCTIONS2(a, b) 2, {_##a, _##b}
+#define INSTRUCTIONS3(a, b, c) 3, {_##a, _##b, _##c}
+        constexpr Superinstruction superinstructions[] = {
+#define S(code, name, length, ...)                                                                 \
+    {code, INSTRUCTIONS(__VA_ARGS__, INSTRUCTIONS3, INSTRUCTIONS2, )(__VA_ARGS__)},
+#include "runtime/byte_code_superinstructions.def"
+#undef S
+        };
+#undef INSTRUCTIONS
+#undef INSTRUCTIONS2
+#undef INSTRUCTIONS3
+
+        // bytes from the first instruction of `super` to past the last
+        constexpr std::size_t covered(const Superinstruction& super) noexcept {
+            std::size_t bytes = 0;
+            for (u1 index = 0; index < super.count; index++) {
+                bytes += lengths[super.instructions[index]];
+            }
+            return bytes;
+        }
+
+        // the first instruction of a superinstruction, other opcodes themselves
+        constexpr std::array<u1, 256> first_instructions = [] {
+            std::array<u1, 256> table{};
+            for (unsigned opcode = 0; opcode < 256; opcode++) table[opcode] = opcode;
+            for (const auto& super : superinstructions) {
+                table[super.opcode] = super.instructions[0];
+            }
+            return table;
+        }();
+
+        // The longest superinstruction whose instructions all follow from
+        // `pc`, null when there is none. A superinstruction already written
+        // over one of them stands for its first instruction, so a longer
+        // sequence may overlap a shorter one fused before.
+        const Superinstruction* superinstruction_at(std::span<const u1> code,
+                                                    std::size_t pc) noexcept {
+            const Superinstruction* longest = nullptr;
+            u1 opcode = first_instructions[opcode_at(&code[pc])];
+            for (const auto& super : superinstructions) {
+                if (super.instructions[0] != opcode) continue;
+                if (longest != nullptr && super.count <= longest->count) continue;
+                std::size_t at = pc;
+                u1 matched = 0;
+                while (matched < super.count && at < code.size() &&
+                       first_instructions[opcode_at(&code[at])] == super.instructions[matched]) {
+                    at += lengths[super.instructions[matched++]];
+                }
+                if (matched == super.count) longest = &super;
+            }
+            return longest;
+        }
+
+        // Writes superinstructions over the sequences they stand for that
+        // start up to `end`, walking from the start of the code. The walk
+        // steps over the instructions a superinstruction covers, so walking
+        // the same code again finds what the last walk did. Like quicken it
+        // only changes opcodes, and publishes them with release.
+        void fuse_sequences(std::span<u1> code, std::size_t end) noexcept {
+            for (std::size_t pc = 0; pc < code.size() && pc <= end;) {
+                std::size_t length = BytecodeEngine::instruction_length(code, pc);
+                if (length == 0) return;
+                if (const Superinstruction* super = superinstruction_at(code, pc)) {
+                    if (code[pc] != super->opcode) {
+                        __atomic_store_n(&code[pc], super->opcode, __ATOMIC_RELEASE);
+                    }
+                    length = covered(*super);
+                }
+                pc += length;
+            }
+        }
+
+        std::mutex quicken_lock;
+
+        // Rewrites the instruction at pc to `quick`, and its operands to
+        // `operands` when there are any, then fuses what that makes possible.
+        // Of the threads that get here for one instruction the first one
+        // does, writing the operands before it publishes the opcode; the
+        // others find the opcode changed.
+        void quicken(const Registers& r, u1 quick, std::span<const u1> operands = {}) {
+            const CodeInfo& info = *r.frame->get_code();
+            auto offset = static_cast<std::size_t>(r.pc - r.code);
+            u1* at = info.quick_code.data() + offset;
+            if (opcode_at(at) != info.code[offset]) return;
+            std::lock_guard<std::mutex> lock(quicken_lock);
+            if (*at != info.code[offset]) return;
+            std::copy(operands.begin(), operands.end(), at + 1);
+            __atomic_store_n(at, quick, __ATOMIC_RELEASE);
+            // the instruction may complete a sequence starting at or before it
+            fuse_sequences(info.quick_code, offset);
+        }
+        void quicken(const Registers& r, u1 quick, u2 operand) {
+            const u1 bytes[] = {static_cast<u1>(operand >> 8), static_cast<u1>(operand)};
+            quicken(r, quick, bytes);
+        }
+
+        // Runs `method` on the arguments at the top of the stack and pushes
+        // its result, then moves past the invoke of `length` bytes.
+        Registers invoke_method(Registers r, const MethodWrapper& method, u1 length) {
+            Slot* arguments = r.sp - method.signature.argument_slots;
+            r.frame->set_pc(static_cast<u4>(r.pc - r.code));
+            r.frame->set_depth(static_cast<u2>(arguments - r.frame->stack()));
+            Outcome outcome = call(method, arguments, *r.runtime, r.frame->get_thread());
+            if (outcome.exception) return raise(r, outcome.exception);
+            r.sp = arguments;
+            if (u1 slots = method.signature.return_slots()) {
+                *r.sp = outcome.value;
+                r.sp += slots;
+            }
+            r.pc += length;
+            return r;
+        }
+
+        const MethodWrapper* resolve_method(const Registers& r) {
+            const CpCacheEntry* entry =
+                r.frame->get_klass().resolve(u2_at(original(r) + 1), r.runtime->resolver);
+            return entry == nullptr ? nullptr : entry->method;
+        }
+
+        // invokevirtual, invokespecial and invokeinterface: the entry of the
+        // resolved method, null with pc at a handler when it did not resolve
+        // or is static, since a static method leaves the receiver out of its
+        // slots
+        const CpCacheEntry* instance_method(Registers& r) {
+            const CpCacheEntry* entry =
+                r.frame->get_klass().resolve(u2_at(original(r) + 1), r.runtime->resolver);
+            if (entry == nullptr || entry->method == nullptr) {
+                r = unresolved(r);
+                return nullptr;
+            }
+            if (entry->method->mptr->access_flags & ACC_STATIC) {
+                r = raise(r, "java/lang/IncompatibleClassChangeError");
+                return nullptr;
+            }
+            return entry;
+        }
+
+        // a method selected by vtable index, or an Object method of an array
+        Registers invoke_virtual(Registers r, const MethodWrapper* method, u1 length) {
+            const oop::BasicOop* receiver = ref_at(r.sp - method->signature.argument_slots);
+            if (receiver == nullptr) return raise(r, "java/lang/NullPointerException");
+            const RawKlass* type = type_of(receiver);
+            if (method->vtable_index >= 0 && type->get_klass_type() == KlassType::Instance) {
+                method = static_cast<const InstanceKlass*>(type)->select_virtual(
+                    method->vtable_index);
+            }
+            return invoke_method(r, *method, length);
+        }
+
+        Registers invoke_virtual(Registers r) {
+            const CpCacheEntry* entry = instance_method(r);
+            if (entry == nullptr) return r;
+            const MethodWrapper* method = entry->method;
+            u2 slots = method->signature.argument_slots;
+            if (method->vtable_index >= 0 && method->vtable_index <= 0xFF && slots <= 0xFF) {
+                auto index = static_cast<u2>(method->vtable_index);
+                quicken(r, _invokevirtual_quick, static_cast<u2>(index << 8 | slots));
+            } else {
+                quicken(r, _invokevirtual_quick_w);
+            }
+            return invoke_virtual(r, method, 3);
+        }
+
+        Registers invoke_nonvirtual(Registers r, const MethodWrapper& method) {
+            if (ref_at(r.sp - method.signature.argument_slots) == nullptr) {
+                return raise(r, "java/lang/NullPointerException");
+            }
+            return invoke_method(r, method, 3);
+        }
+
+        Registers invoke_special(Registers r) {
+            const CpCacheEntry* entry = instance_method(r);
+            if (entry == nullptr) return r;
+            quicken(r, _invokenonvirtual_quick);
+            return invoke_nonvirtual(r, *entry->special);
+        }
+
+        Registers invoke_static(Registers r) {
+            const MethodWrapper* method = resolve_method(r);
+            if (method == nullptr) return unresolved(r);
+            if (!(method->mptr->access_flags & ACC_STATIC)) {
+                return raise(r, "java/lang/IncompatibleClassChangeError");
+            }
+            if (!method->kls->is_initialized()) {
+                const u1* pc = r.pc;
+                r = initialize(r, *method->kls);
+                if (r.pc != pc) return r;
+            }
+            // not while <clinit> of the class runs on this thread
+            if (method->kls->is_initialized()) quicken(r, _invokestatic_quick);
+            return invoke_method(r, *method, 3);
+        }
+
+        Registers invoke_interface(Registers r, const MethodWrapper* method) {
+            const oop::BasicOop* receiver = ref_at(r.sp - method->signature.argument_slots);
+            if (receiver == nullptr) return raise(r, "java/lang/NullPointerException");
+            const RawKlass* type = type_of(receiver);
+            if (type->get_klass_type() == KlassType::Instance) {
+                auto* kls = static_cast<const InstanceKlass*>(type);
+                if (method->itable_index >= 0) {
+                    method = kls->select_interface(*method);
+                } else if (method->vtable_index >= 0) {
+                    // a java/lang/Object method called through an interface
+                    method = kls->select_virtual(method->vtable_index);
+                }
+            }
+            if (method == nullptr) return raise(r, "java/lang/IncompatibleClassChangeError");
+            return invoke_method(r, *method, 5);
+        }
+
+        Registers invoke_interface(Registers r) {
+            const CpCacheEntry* entry = instance_method(r);
+            if (entry == nullptr) return r;
+            quicken(r, _invokeinterface_quick);
+            return invoke_interface(r, entry->method);
+        }
+
+        // getstatic and putstatic: the entry with its class initialized, null
+        // with pc at a handler when that threw, the field did not resolve or
+        // it is an instance field
+        const CpCacheEntry* static_field(Registers& r) {
+            const CpCacheEntry* entry =
+                r.frame->get_klass().resolve(u2_at(original(r) + 1), r.runtime->resolver);
+            if (entry == nullptr) {
+                r = unresolved(r);
+                return nullptr;
+            }
+            if (!entry->field->is_static()) {
+                r = raise(r, "java/lang/IncompatibleClassChangeError");
+                return nullptr;
+            }
+            if (!entry->klass->is_initialized()) {
+                const u1* pc = r.pc;
+                r = initialize(r, *entry->klass);
+                if (r.pc != pc) return nullptr;
+            }
+            return entry;
+        }
+
+        inline void load_static(Registers& r, const CpCacheEntry& entry) {
+            *r.sp = load_value(entry.klass->get_statics() + entry.offset, entry.type);
+            r.sp += slots_of(entry.type);
+            r.pc += 3;
+        }
+
+        inline void store_static(Registers& r, const CpCacheEntry& entry) {
+            r.sp -= slots_of(entry.type);
+            store_value(entry.klass->get_statics() + entry.offset, entry.type, *r.sp);
+            r.pc += 3;
+        }
+
+        Registers get_static(Registers r) {
+            const CpCacheEntry* entry = static_field(r);
+            if (entry == nullptr) return r;
+            if (entry->klass->is_initialized()) quicken(r, _getstatic_quick);
+            load_static(r, *entry);
+            return r;
+        }
+
+        Registers put_static(Registers r) {
+            const CpCacheEntry* entry = static_field(r);
+            if (entry == nullptr) return r;
+            if (entry->klass->is_initialized()) quicken(r, _putstatic_quick);
+            store_static(r, *entry);
+            return r;
+        }
+
+        // getfield and putfield of a field of `type` at `offset`; the _quick
+        // forms pass a constant type
+        [[gnu::always_inline]] inline void load_field(Registers& r, u4 offset,
+                                                      raw_value_type type) {
+            oop::BasicOop* object = ref_at(r.sp - 1);
+            if (object == nullptr) [[unlikely]] {
+                r = raise(r, "java/lang/NullPointerException");
+                return;
+            }
+            r.sp[-1] = load_value(field_address(object, offset), type);
+            r.sp += slots_of(type) - 1;
+            r.pc += 3;
+        }
+
+        [[gnu::always_inline]] inline void store_field(Registers& r, u4 offset,
+                                                       raw_value_type type) {
+            u1 slots = slots_of(type);
+            oop::BasicOop* object = ref_at(r.sp - slots - 1);
+            if (object == nullptr) [[unlikely]] {
+                r = raise(r, "java/lang/NullPointerException");
+                return;
+            }
+            store_value(field_address(object, offset), type, r.sp[-slots]);
+            r.sp -= slots + 1;
+            r.pc += 3;
+        }
+
+        // Quickens getfield or putfield to one of `forms`, for an int or float,
+        // a long or double, and a reference field with the offset as operand,
+        // or to the last one that keeps the constant pool index.
+        void quicken_field(const Registers& r, const CpCacheEntry& entry, const u1 (&forms)[4]) {
+            if (entry.offset > 0xFFFF) return quicken(r, forms[3]);
+            auto offset = static_cast<u2>(entry.offset);
+            switch (entry.type) {
+                case raw_value_type::Jint:
+                case raw_value_type::Jfloat:
+                    return quicken(r, forms[0], offset);
+                case raw_value_type::Jlong:
+                case raw_value_type::Jdouble:
+                    return quicken(r, forms[1], offset);
+                case raw_value_type::Jreference:
+                    return quicken(r, forms[2], offset);
+                default:
+                    return quicken(r, forms[3]);
+            }
+        }
+
+        Registers get_field(Registers r) {
+            const CpCacheEntry* entry =
+                r.frame->get_klass().resolve(u2_at(original(r) + 1), r.runtime->resolver);
+            if (entry == nullptr) return unresolved(r);
+            if (entry->field->is_static()) {
+                return raise(r, "java/lang/IncompatibleClassChangeError");
+            }
+            quicken_field(r, *entry,
+                          {_getfield_quick, _getfield2_quick, _agetfield_quick, _getfield_quick_w});
+            load_field(r, entry->offset, entry->type);
+            return r;
+        }
+
+        Registers put_field(Registers r) {
+            const CpCacheEntry* entry =
+                r.frame->get_klass().resolve(u2_at(original(r) + 1), r.runtime->resolver);
+            if (entry == nullptr) return unresolved(r);
+            if (entry->field->is_static()) {
+                return raise(r, "java/lang/IncompatibleClassChangeError");
+            }
+            quicken_field(r, *entry,
+                          {_putfield_quick, _putfield2_quick, _aputfield_quick, _putfield_quick_w});
+            store_field(r, entry->offset, entry->type);
+            return r;
+        }
+
+        // the String or the mirror of the Class a resolved constant names
+        inline oop::BasicOop* reference_constant(const CpCacheEntry& entry) noexcept {
+            if (entry.string) return entry.string.get();
+            return class_type(&entry)->get_ref().get();
+        }
+
+        // ldc and ldc_w of a String, a Class or a number
+        Registers load_constant(Registers r, u1 length) {
+            const InstanceKlass& kls = r.frame->get_klass();
+            u2 index = length == 2 ? original(r)[1] : u2_at(original(r) + 1);
+            switch (kls.get_constant_tag(index)) {
+                case raw_jvm_data::CONSTANT_Integer:
+                case raw_jvm_data::CONSTANT_Float:
+                    quicken(r, length == 2 ? _ldc_quick : _ldc_w_quick);
+                    r.sp->raw = kls.get_constant_bits(index);
+                    break;
+                case raw_jvm_data::CONSTANT_String:
+                case raw_jvm_data::CONSTANT_Class: {
+                    const CpCacheEntry* entry = kls.resolve(index, r.runtime->resolver);
+                    if (entry == nullptr) return unresolved(r, index);
+                    quicken(r, length == 2 ? _aldc_quick : _aldc_w_quick);
+                    set_ref(r.sp, reference_constant(*entry));
+                    break;
+                }
+                default:
+                    // MethodType and MethodHandle need java.lang.invoke
+                    return raise(r, "java/lang/IncompatibleClassChangeError");
+            }
+            r.sp += 1;
+            r.pc += length;
+            return r;
+        }
+
+        Registers new_instance(Registers r) {
+            const CpCacheEntry* entry =
+                r.frame->get_klass().resolve(u2_at(original(r) + 1), r.runtime->resolver);
+            if (entry == nullptr) return unresolved(r);
+            if (entry->klass == nullptr) return raise(r, "java/lang/NoClassDefFoundError");
+            const InstanceKlass& kls = *entry->klass;
+            if (kls.get_access_flags() & (ACC_INTERFACE | ACC_ABSTRACT)) {
+                return raise(r, "java/lang/InstantiationError");
+            }
+            if (!kls.is_initialized()) {
+                const u1* pc = r.pc;
+                r = initialize(r, kls);
+                if (r.pc != pc) return r;
+            }
+            if (kls.is_initialized()) quicken(r, _new_quick);
+            set_ref(r.sp++, allocate_instance(*r.runtime, kls).get());
+            r.pc += 3;
+            return r;
+        }
+
+        Registers new_array(Registers r, const ArrayKlass& kls, u1 length) {
+            std::int32_t count = int_at(r.sp - 1);
+            if (count < 0) return raise(r, "java/lang/NegativeArraySizeException");
+            set_ref(r.sp - 1, allocate_array(*r.runtime, kls, count).get());
+            r.pc += length;
+            return r;
+        }
+
+        Registers new_object_array(Registers r) {
+            const RawKlass* component = class_type(
+                r.frame->get_klass().resolve(u2_at(original(r) + 1), r.runtime->resolver));
+            if (component == nullptr) return unresolved(r);
+            quicken(r, _anewarray_quick);
+            return new_array(r, *component->array_of(), 3);
+        }
+
+        oop::Ref new_multi_array(const Runtime& runtime, const ArrayKlass& kls,
+                                 const Slot* counts, int dimensions) {
+            std::int32_t count = int_at(counts);
+            oop::Ref array = allocate_array(runtime, kls, count);
+            if (dimensions == 1) return array;
+            auto* component = static_cast<const ArrayKlass*>(kls.get_component());
+            for (std::int32_t index = 0; index < count; index++) {
+                oop::Ref inner = new_multi_array(runtime, *component, counts + 1, dimensions - 1);
+                std::memcpy(as_array(array.get())->bytes + index * sizeof(oop::BasicOop*),
+                            &inner, sizeof(oop::BasicOop*));
+            }
+            return array;
+        }
+
+        Registers multi_array(Registers r) {
+            u1 dimensions = r.pc[3];
+            const CpCacheEntry* entry =
+                r.frame->get_klass().resolve(u2_at(r.pc + 1), r.runtime->resolver);
+            if (entry == nullptr) return unresolved(r);
+            if (entry->array_klass == nullptr) return raise(r, "java/lang/NoClassDefFoundError");
+            Slot* counts = r.sp - dimensions;
+            for (int index = 0; index < dimensions; index++) {
+                if (int_at(counts + index) < 0) {
+                    return raise(r, "java/lang/NegativeArraySizeException");
+                }
+            }
+            oop::Ref array = new_multi_array(*r.runtime, *entry->array_klass, counts, dimensions);
+            r.sp = counts;
+            set_ref(r.sp++, array.get());
+            r.pc += 4;
+            return r;
+        }
+
+        // checkcast and instanceof against the class at the operand, quickened
+        // to `quick` once it resolves
+        const RawKlass* target_type(Registers& r, u1 quick) {
+            const RawKlass* target = class_type(
+                r.frame->get_klass().resolve(u2_at(original(r) + 1), r.runtime->resolver));
+            if (target == nullptr) {
+                r = unresolved(r);
+                return nullptr;
+            }
+            quicken(r, quick);
+            return target;
+        }
+
+        Registers check_cast(Registers r) {
+            const oop::BasicOop* object = ref_at(r.sp - 1);
+            if (object != nullptr) {
+                const RawKlass* target = target_type(r, _checkcast_quick);
+                if (target == nullptr) return r;
+                if (!is_subtype(type_of(object), target)) {
+                    return raise(r, "java/lang/ClassCastException");
+                }
+            }
+            r.pc += 3;
+            return r;
+        }
+
+        Registers instance_of(Registers r) {
+            const oop::BasicOop* object = ref_at(r.sp - 1);
+            bool result = false;
+            if (object != nullptr) {
+                const RawKlass* target = target_type(r, _instanceof_quick);
+                if (target == nullptr) return r;
+                result = is_subtype(type_of(object), target);
+            }
+            set_int(r.sp - 1, result);
+            r.pc += 3;
+            return r;
+        }
+
+        Registers monitor_exit(Registers r) {
+            oop::BasicOop* object = ref_at(r.sp - 1);
+            if (object == nullptr) return raise(r, "java/lang/NullPointerException");
+            if (!r.runtime->heap->monitor_of(oop::Ref(object)).exit()) {
+                return raise(r, "java/lang/IllegalMonitorStateException");
+            }
+            r.sp -= 1;
+            r.pc += 1;
+            return r;
+        }
+
+        [[noreturn]] void illegal(const Registers& r) {
+            throw std::runtime_error("Unknown opcode: " + std::to_string(*r.pc));
+        }
+
+        // The component at the index below the top `value_slots` of the stack,
+        // null with pc at a handler for a null array or an index out of bounds.
+        inline std::byte* component(Registers& r, u1 value_slots, u4 size) {
+            oop::BasicOop* array = ref_at(r.sp - value_slots - 2);
+            std::int32_t index = int_at(r.sp - value_slots - 1);
+            if (array == nullptr) [[unlikely]] {
+                r = raise(r, "java/lang/NullPointerException");
+                return nullptr;
+            }
+            if (static_cast<u4>(index) >= static_cast<u4>(as_array(array)->length)) [[unlikely]] {
+                r = raise(r, "java/lang/ArrayIndexOutOfBoundsException");
+                return nullptr;
+            }
+            return as_array(array)->bytes + static_cast<std::size_t>(index) * size;
+        }
+
+        template <raw_value_type type> inline void array_load(Registers& r) {
+            std::byte* at = component(r, 0, rt_jvm_data::type_size_of(type));
+            if (at == nullptr) return;
+            r.sp[-2] = load_value(at, type);
+            r.sp += slots_of(type) - 2;
+            r.pc += 1;
+        }
+
+        template <raw_value_type type> inline void array_store(Registers& r) {
+            u1 slots = slots_of(type);
+            std::byte* at = component(r, slots, rt_jvm_data::type_size_of(type));
+            if (at == nullptr) return;
+            store_value(at, type, r.sp[-slots]);
+            r.sp -= slots + 2;
+            r.pc += 1;
+        }
+
+        Registers reference_array_store(Registers r) {
+            std::byte* at = component(r, 1, sizeof(oop::BasicOop*));
+            if (at == nullptr) return r;
+            const oop::BasicOop* value = ref_at(r.sp - 1);
+            if (value != nullptr) {
+                auto* kls = static_cast<const ArrayKlass*>(type_of(ref_at(r.sp - 3)));
+                if (!is_subtype(type_of(value), kls->get_component())) {
+                    return raise(r, "java/lang/ArrayStoreException");
+                }
+            }
+            std::memcpy(at, &value, sizeof(value));
+            r.sp -= 3;
+            r.pc += 1;
+            return r;
+        }
+
+        // The monitor a synchronized method holds while it runs, released
+        // however it ends.
+        class MethodMonitor {
+          private:
+            oop::Monitor* monitor = nullptr;
+
+          public:
+            MethodMonitor(StackFrame& frame, const Runtime& runtime) {
+                const MethodWrapper& method = *frame.get_method();
+                if (!(method.mptr->access_flags & ACC_SYNCHRONIZED)) return;
+                oop::Ref lock = method.mptr->access_flags & ACC_STATIC
+                                    ? frame.get_klass().get_ref()
+                                    : oop::Ref(ref_at(frame.locals()));
+                if (!lock) {
+                    throw std::runtime_error("synchronized static method of a class without "
+                                             "a mirror: " +
+                                             frame.get_klass().get_klass_name());
+                }
+                monitor = &runtime.heap->monitor_of(lock);
+                monitor->enter();
+            }
+            ~MethodMonitor() {
+                if (monitor != nullptr) monitor->exit();
+            }
+            MethodMonitor(const MethodMonitor&) = delete;
+            MethodMonitor& operator=(const MethodMonitor&) = delete;
+        };
+
+        // Counts a call of, or a loop back edge in, `method` running
+        // interpreted, and lets Runtime::compiler see whether it got hot when
+        // the count is due.
+        inline void count(const MethodWrapper& method, std::atomic<u4>& counter,
+                          const Runtime& runtime) {
+            u4 counted = counter.load(std::memory_order_relaxed) + 1;
+            counter.store(counted, std::memory_order_relaxed);
+            if (runtime.compiler != nullptr && runtime.compiler->due(counted)) {
+                runtime.compiler->profile(method);
+            }
+        }
+
+        // Moves pc by `offset`. A jump that does not go forward closes a loop.
+        inline void jump(BytecodeEngine::Registers& r, std::int32_t offset) {
+            r.pc += offset;
+            if (offset <= 0) {
+                const MethodWrapper& method = *r.frame->get_method();
+                count(method, method.backedges, *r.runtime);
+            }
+        }
+
+        // the two-byte branches: to pc plus the operand when `taken`, else
+        // to the next instruction
+        inline void branch(BytecodeEngine::Registers& r, bool taken) {
+            if (taken) {
+                jump(r, s2_at(r.pc + 1));
+            } else {
+                r.pc += 3;
+            }
+        }
+
+        Outcome call(const MethodWrapper& method, const Slot* arguments, const Runtime& runtime,
+                     oop::Ref thread) {
+            u2 flags = method.mptr->access_flags;
+            if (flags & ACC_NATIVE) {
+                if (!runtime.native) {
+                    return {{}, make_throwable(runtime, "java/lang/UnsatisfiedLinkError", thread)};
+                }
+                try {
+                    return {runtime.native(method, {arguments, method.signature.argument_slots}),
+                            oop::Ref::null()};
+                } catch (const JavaException& e) {
+                    return {{}, e.get_exception()};
+                }
+            }
+            if (!method.code_info) {
+                return {{}, make_throwable(runtime, "java/lang/AbstractMethodError", thread)};
+            }
+            if (stack_base != 0 && stack_base - stack_position() > max_stack_bytes) {
+                return {{}, make_throwable(runtime, "java/lang/StackOverflowError", thread)};
+            }
+            if (auto compiled = method.compiled.load(std::memory_order_acquire)) {
+                Outermost outermost;
+                Slot result;
+                oop::BasicOop* exception = compiled(arguments, &runtime, thread.get(), &result);
+                return {result, oop::Ref(exception)};
+            }
+            count(method, method.invocations, runtime);
+            StackFrame frame(method, thread);
+            std::copy_n(arguments, method.signature.argument_slots, frame.locals());
+            return BytecodeEngine::execute(frame, runtime);
+        }
+
+        // What the cached loop's kernels work with: slots held in registers
+        // rather than on the operand stack, and instruction lengths known at
+        // compile time.
+        inline std::int32_t int_of(Slot slot) noexcept {
+            return int_at(&slot);
+        }
+        inline u4 bits_of(Slot slot) noexcept {
+            return static_cast<u4>(slot.raw);
+        }
+        inline float float_of(Slot slot) noexcept {
+            return float_at(&slot);
+        }
+        inline oop::BasicOop* ref_of(Slot slot) noexcept {
+            return ref_at(&slot);
+        }
+        inline Slot int_value(std::int32_t value) noexcept {
+            Slot slot;
+            set_int(&slot, value);
+            return slot;
+        }
+        inline Slot float_value(float value) noexcept {
+            Slot slot;
+            set_float(&slot, value);
+            return slot;
+        }
+
+        // a null array or an index outside it
+        inline bool out_of_bounds(Slot array, Slot index) noexcept {
+            return ref_of(array) == nullptr ||
+                   bits_of(index) >= static_cast<u4>(as_array(ref_of(array))->length);
+        }
+        inline Slot element(Slot array, Slot index, raw_value_type type) noexcept {
+            return load_value(as_array(ref_of(array))->bytes +
+                                  static_cast<std::size_t>(int_of(index)) *
+                                      rt_jvm_data::type_size_of(type),
+                              type);
+        }
+    }; // namespace
+
+    JavaException::JavaException(oop::Ref exception)
+        : std::runtime_error("uncaught " + type_of(exception.get())->get_klass_name()),
+          exception(exception) {
+    }
+
     // === bytecode -> handler 表 ===
     std::array<BytecodeEngine::Handler, 256> BytecodeEngine::handlers = [] {
         std::array<BytecodeEngine::Handler, 256> a{}; // 全部初始化为 nullptr
-#define X(code, name) a[code] = &BytecodeEngine::op_##name;
+#define X(code, name, length) a[code] = &BytecodeEngine::op_##name;
 #include "runtime/byte_code_engine.def"
 #undef X
         return a;
@@ -17,7 +1052,7 @@ namespace jvm {
     // === bytecode -> 名字（调试用）===
     const char* BytecodeEngine::opcode_name(std::uint8_t opcode) {
         switch (opcode) {
-#define X(code, name)                                                                              \
+#define X(code, name, length)                                                                      \
     case code:                                                                                     \
         return #name;
 #include "runtime/byte_code_engine.def"
@@ -27,45 +1062,1431 @@ namespace jvm {
         }
     }
 
-    // === 解释循环实现 ===
+    std::uint8_t BytecodeEngine::opcode_length(std::uint8_t opcode) {
+        switch (opcode) {
+#define X(code, name, length)                                                                      \
+    case code:                                                                                     \
+        return length;
+#include "runtime/byte_code_engine.def"
+#undef X
+            default:
+                return 0;
+        }
+    }
 
-    void BytecodeEngine::interpret(StackFrame& frame) {
-        // TODO
-        // while (!frame.halted) {
-        //     std::uint8_t opcode = fetch_u1(frame);
-        //     Handler h = handlers[opcode];
-        //     if (!h) {
-        //         throw std::runtime_error("Unknown opcode: " + std::to_string(opcode));
-        //     }
-        //     h(frame);
-        // }
+    std::size_t BytecodeEngine::instruction_length(std::span<const std::uint8_t> code,
+                                                   std::size_t pc) noexcept {
+        u1 opcode = opcode_at(&code[pc]);
+        std::size_t length = lengths[opcode];
+        if (opcode == _wide) {
+            length = pc + 1 < code.size() && code[pc + 1] == _iinc ? 6 : 4;
+        } else if (opcode == _tableswitch || opcode == _lookupswitch) {
+            std::size_t operands = (pc + 4) & ~std::size_t{3};
+            bool dense = opcode == _tableswitch;
+            if (operands + (dense ? 12 : 8) > code.size()) return 0;
+            std::int64_t count = s4_at(&code[operands + 4]);
+            if (dense) count = s4_at(&code[operands + 8]) - count + 1;
+            if (count < 0) return 0;
+            length = operands - pc + (dense ? 12 + 4 * count : 8 + 8 * count);
+        }
+        return length != 0 && pc + length <= code.size() ? length : 0;
+    }
+
+    void BytecodeEngine::fuse(const CodeInfo& code) {
+        std::lock_guard<std::mutex> lock(quicken_lock);
+        fuse_sequences(code.quick_code, code.quick_code.size());
     }
 
     // === 各个字节码对应的 handler 实现 ===
+    //
+    // Every handler leaves pc at the next instruction, at a branch target, at
+    // an exception handler, or at leave. Handlers are inlined into the
+    // threaded loop; the table loop calls them through their addresses.
+
+#define HANDLER(name)                                                                              \
+    [[gnu::always_inline]] inline void BytecodeEngine::op_##name([[maybe_unused]] Registers& r)
 
-    void BytecodeEngine::op_nop(StackFrame&) {
-        // 什么也不做
+    HANDLER(nop) {
+        r.pc += 1;
     }
 
-    void BytecodeEngine::op_iconst_m1(StackFrame& frame) {
+    // --- constants ---
+
+    HANDLER(aconst_null) {
+        set_ref(r.sp++, nullptr);
+        r.pc += 1;
+    }
+
+#define ICONST(name, value)                                                                        \
+    HANDLER(name) {                                                                                \
+        set_int(r.sp++, value);                                                                    \
+        r.pc += 1;                                                                                 \
+    }
+    ICONST(iconst_m1, -1)
+    ICONST(iconst_0, 0)
+    ICONST(iconst_1, 1)
+    ICONST(iconst_2, 2)
+    ICONST(iconst_3, 3)
+    ICONST(iconst_4, 4)
+    ICONST(iconst_5, 5)
+#undef ICONST
+
+    HANDLER(lconst_0) {
+        set_long(r.sp, 0);
+        r.sp += 2;
+        r.pc += 1;
+    }
+    HANDLER(lconst_1) {
+        set_long(r.sp, 1);
+        r.sp += 2;
+        r.pc += 1;
     }
-    void BytecodeEngine::op_iconst_0(StackFrame& frame) {
+    HANDLER(fconst_0) {
+        set_float(r.sp++, 0.0f);
+        r.pc += 1;
     }
-    void BytecodeEngine::op_iconst_1(StackFrame& frame) {
+    HANDLER(fconst_1) {
+        set_float(r.sp++, 1.0f);
+        r.pc += 1;
     }
-    void BytecodeEngine::op_iconst_2(StackFrame& frame) {
+    HANDLER(fconst_2) {
+        set_float(r.sp++, 2.0f);
+        r.pc += 1;
     }
-    void BytecodeEngine::op_iconst_3(StackFrame& frame) {
+    HANDLER(dconst_0) {
+        set_double(r.sp, 0.0);
+        r.sp += 2;
+        r.pc += 1;
     }
-    void BytecodeEngine::op_iconst_4(StackFrame& frame) {
+    HANDLER(dconst_1) {
+        set_double(r.sp, 1.0);
+        r.sp += 2;
+        r.pc += 1;
+    }
+
+    HANDLER(bipush) {
+        set_int(r.sp++, static_cast<std::int8_t>(r.pc[1]));
+        r.pc += 2;
+    }
+    HANDLER(sipush) {
+        set_int(r.sp++, s2_at(r.pc + 1));
+        r.pc += 3;
+    }
+
+    HANDLER(ldc) {
+        r = load_constant(r, 2);
+    }
+    HANDLER(ldc_w) {
+        r = load_constant(r, 3);
+    }
+    HANDLER(ldc2_w) {
+        r.sp->raw = r.frame->get_klass().get_constant_wide_bits(u2_at(r.pc + 1));
+        r.sp += 2;
+        r.pc += 3;
+    }
+
+    // --- loads and stores of locals ---
+
+#define LOAD(name, index, slots)                                                                   \
+    HANDLER(name) {                                                                                \
+        *r.sp = r.locals[index];                                                                   \
+        r.sp += slots;                                                                             \
+        r.pc += 1;                                                                                 \
+    }
+#define STORE(name, index, slots)                                                                  \
+    HANDLER(name) {                                                                                \
+        r.sp -= slots;                                                                             \
+        r.locals[index] = *r.sp;                                                                   \
+        r.pc += 1;                                                                                 \
+    }
+
+    HANDLER(iload) {
+        *r.sp++ = r.locals[r.pc[1]];
+        r.pc += 2;
+    }
+    HANDLER(lload) {
+        *r.sp = r.locals[r.pc[1]];
+        r.sp += 2;
+        r.pc += 2;
+    }
+    HANDLER(fload) {
+        *r.sp++ = r.locals[r.pc[1]];
+        r.pc += 2;
+    }
+    HANDLER(dload) {
+        *r.sp = r.locals[r.pc[1]];
+        r.sp += 2;
+        r.pc += 2;
+    }
+    HANDLER(aload) {
+        *r.sp++ = r.locals[r.pc[1]];
+        r.pc += 2;
+    }
+    LOAD(iload_0, 0, 1)
+    LOAD(iload_1, 1, 1)
+    LOAD(iload_2, 2, 1)
+    LOAD(iload_3, 3, 1)
+    LOAD(lload_0, 0, 2)
+    LOAD(lload_1, 1, 2)
+    LOAD(lload_2, 2, 2)
+    LOAD(lload_3, 3, 2)
+    LOAD(fload_0, 0, 1)
+    LOAD(fload_1, 1, 1)
+    LOAD(fload_2, 2, 1)
+    LOAD(fload_3, 3, 1)
+    LOAD(dload_0, 0, 2)
+    LOAD(dload_1, 1, 2)
+    LOAD(dload_2, 2, 2)
+    LOAD(dload_3, 3, 2)
+    LOAD(aload_0, 0, 1)
+    LOAD(aload_1, 1, 1)
+    LOAD(aload_2, 2, 1)
+    LOAD(aload_3, 3, 1)
+
+    HANDLER(istore) {
+        r.locals[r.pc[1]] = *--r.sp;
+        r.pc += 2;
+    }
+    HANDLER(lstore) {
+        r.sp -= 2;
+        r.locals[r.pc[1]] = *r.sp;
+        r.pc += 2;
+    }
+    HANDLER(fstore) {
+        r.locals[r.pc[1]] = *--r.sp;
+        r.pc += 2;
+    }
+    HANDLER(dstore) {
+        r.sp -= 2;
+        r.locals[r.pc[1]] = *r.sp;
+        r.pc += 2;
+    }
+    HANDLER(astore) {
+        r.locals[r.pc[1]] = *--r.sp;
+        r.pc += 2;
+    }
+    STORE(istore_0, 0, 1)
+    STORE(istore_1, 1, 1)
+    STORE(istore_2, 2, 1)
+    STORE(istore_3, 3, 1)
+    STORE(lstore_0, 0, 2)
+    STORE(lstore_1, 1, 2)
+    STORE(lstore_2, 2, 2)
+    STORE(lstore_3, 3, 2)
+    STORE(fstore_0, 0, 1)
+    STORE(fstore_1, 1, 1)
+    STORE(fstore_2, 2, 1)
+    STORE(fstore_3, 3, 1)
+    STORE(dstore_0, 0, 2)
+    STORE(dstore_1, 1, 2)
+    STORE(dstore_2, 2, 2)
+    STORE(dstore_3, 3, 2)
+    STORE(astore_0, 0, 1)
+    STORE(astore_1, 1, 1)
+    STORE(astore_2, 2, 1)
+    STORE(astore_3, 3, 1)
+#undef LOAD
+#undef STORE
+
+    // --- arrays ---
+
+    HANDLER(iaload) {
+        array_load<raw_value_type::Jint>(r);
     }
-    void BytecodeEngine::op_iconst_5(StackFrame& frame) {
+    HANDLER(laload) {
+        array_load<raw_value_type::Jlong>(r);
+    }
+    HANDLER(faload) {
+        array_load<raw_value_type::Jfloat>(r);
+    }
+    HANDLER(daload) {
+        array_load<raw_value_type::Jdouble>(r);
+    }
+    HANDLER(aaload) {
+        array_load<raw_value_type::Jreference>(r);
+    }
+    HANDLER(baload) {
+        // byte and boolean arrays share the instruction, booleans hold 0 or 1
+        array_load<raw_value_type::Jbyte>(r);
+    }
+    HANDLER(caload) {
+        array_load<raw_value_type::Jchar>(r);
+    }
+    HANDLER(saload) {
+        array_load<raw_value_type::Jshort>(r);
+    }
+
+    HANDLER(iastore) {
+        array_store<raw_value_type::Jint>(r);
+    }
+    HANDLER(lastore) {
+        array_store<raw_value_type::Jlong>(r);
+    }
+    HANDLER(fastore) {
+        array_store<raw_value_type::Jfloat>(r);
+    }
+    HANDLER(dastore) {
+        array_store<raw_value_type::Jdouble>(r);
+    }
+    HANDLER(aastore) {
+        r = reference_array_store(r);
+    }
+    HANDLER(bastore) {
+        static const ArrayKlass* booleans =
+            PrimitiveKlass::of(raw_value_type::Jboolean).array_of();
+        const oop::BasicOop* array = ref_at(r.sp - 3);
+        if (array != nullptr && type_of(array) == booleans) {
+            array_store<raw_value_type::Jboolean>(r);
+        } else {
+            array_store<raw_value_type::Jbyte>(r);
+        }
+    }
+    HANDLER(castore) {
+        array_store<raw_value_type::Jchar>(r);
+    }
+    HANDLER(sastore) {
+        array_store<raw_value_type::Jshort>(r);
+    }
+
+    // --- the operand stack ---
+    //
+    // Category 2 values take two slots, so these move slots and never look
+    // at what is in them.
+
+    HANDLER(pop) {
+        r.sp -= 1;
+        r.pc += 1;
+    }
+    HANDLER(pop2) {
+        r.sp -= 2;
+        r.pc += 1;
+    }
+    HANDLER(dup) {
+        r.sp[0] = r.sp[-1];
+        r.sp += 1;
+        r.pc += 1;
+    }
+    HANDLER(dup_x1) {
+        Slot v1 = r.sp[-1], v2 = r.sp[-2];
+        r.sp[-2] = v1;
+        r.sp[-1] = v2;
+        r.sp[0] = v1;
+        r.sp += 1;
+        r.pc += 1;
+    }
+    HANDLER(dup_x2) {
+        Slot v1 = r.sp[-1], v2 = r.sp[-2], v3 = r.sp[-3];
+        r.sp[-3] = v1;
+        r.sp[-2] = v3;
+        r.sp[-1] = v2;
+        r.sp[0] = v1;
+        r.sp += 1;
+        r.pc += 1;
+    }
+    HANDLER(dup2) {
+        r.sp[0] = r.sp[-2];
+        r.sp[1] = r.sp[-1];
+        r.sp += 2;
+        r.pc += 1;
+    }
+    HANDLER(dup2_x1) {
+        Slot v1 = r.sp[-1], v2 = r.sp[-2], v3 = r.sp[-3];
+        r.sp[-3] = v2;
+        r.sp[-2] = v1;
+        r.sp[-1] = v3;
+        r.sp[0] = v2;
+        r.sp[1] = v1;
+        r.sp += 2;
+        r.pc += 1;
+    }
+    HANDLER(dup2_x2) {
+        Slot v1 = r.sp[-1], v2 = r.sp[-2], v3 = r.sp[-3], v4 = r.sp[-4];
+        r.sp[-4] = v2;
+        r.sp[-3] = v1;
+        r.sp[-2] = v4;
+        r.sp[-1] = v3;
+        r.sp[0] = v2;
+        r.sp[1] = v1;
+        r.sp += 2;
+        r.pc += 1;
+    }
+    HANDLER(swap) {
+        Slot v1 = r.sp[-1];
+        r.sp[-1] = r.sp[-2];
+        r.sp[-2] = v1;
+        r.pc += 1;
+    }
+
+    // --- arithmetic ---
+
+#define INT_BINARY(name, expression)                                                               \
+    HANDLER(name) {                                                                                \
+        std::int32_t a = int_at(r.sp - 2), b = int_at(r.sp - 1);                                   \
+        set_int(r.sp - 2, expression);                                                             \
+        r.sp -= 1;                                                                                 \
+        r.pc += 1;                                                                                 \
+    }
+#define LONG_BINARY(name, expression)                                                              \
+    HANDLER(name) {                                                                                \
+        std::int64_t a = long_at(r.sp - 4), b = long_at(r.sp - 2);                                 \
+        set_long(r.sp - 4, expression);                                                            \
+        r.sp -= 2;                                                                                 \
+        r.pc += 1;                                                                                 \
+    }
+#define LONG_SHIFT(name, expression)                                                               \
+    HANDLER(name) {                                                                                \
+        std::int64_t a = long_at(r.sp - 3);                                                        \
+        std::int32_t b = int_at(r.sp - 1) & 63;                                                    \
+        set_long(r.sp - 3, expression);                                                            \
+        r.sp -= 1;                                                                                 \
+        r.pc += 1;                                                                                 \
+    }
+#define FLOAT_BINARY(name, expression)                                                             \
+    HANDLER(name) {                                                                                \
+        float a = float_at(r.sp - 2), b = float_at(r.sp - 1);                                      \
+        set_float(r.sp - 2, expression);                                                           \
+        r.sp -= 1;                                                                                 \
+        r.pc += 1;                                                                                 \
+    }
+#define DOUBLE_BINARY(name, expression)                                                            \
+    HANDLER(name) {                                                                                \
+        double a = double_at(r.sp - 4), b = double_at(r.sp - 2);                                   \
+        set_double(r.sp - 4, expression);                                                          \
+        r.sp -= 2;                                                                                 \
+        r.pc += 1;                                                                                 \
+    }
+
+    INT_BINARY(iadd, wrap(static_cast<u4>(a) + static_cast<u4>(b)))
+    INT_BINARY(isub, wrap(static_cast<u4>(a) - static_cast<u4>(b)))
+    INT_BINARY(imul, wrap(static_cast<u4>(a) * static_cast<u4>(b)))
+    INT_BINARY(ishl, wrap(static_cast<u4>(a) << (b & 31)))
+    INT_BINARY(ishr, a >> (b & 31))
+    INT_BINARY(iushr, wrap(static_cast<u4>(a) >> (b & 31)))
+    INT_BINARY(iand, a & b)
+    INT_BINARY(ior, a | b)
+    INT_BINARY(ixor, a ^ b)
+    LONG_BINARY(ladd, wrap(static_cast<u8>(a) + static_cast<u8>(b)))
+    LONG_BINARY(lsub, wrap(static_cast<u8>(a) - static_cast<u8>(b)))
+    LONG_BINARY(lmul, wrap(static_cast<u8>(a) * static_cast<u8>(b)))
+    LONG_BINARY(land, a & b)
+    LONG_BINARY(lor, a | b)
+    LONG_BINARY(lxor, a ^ b)
+    LONG_SHIFT(lshl, wrap(static_cast<u8>(a) << b))
+    LONG_SHIFT(lshr, a >> b)
+    LONG_SHIFT(lushr, wrap(static_cast<u8>(a) >> b))
+    FLOAT_BINARY(fadd, a + b)
+    FLOAT_BINARY(fsub, a - b)
+    FLOAT_BINARY(fmul, a * b)
+    FLOAT_BINARY(fdiv, a / b)
+    FLOAT_BINARY(frem, std::fmod(a, b))
+    DOUBLE_BINARY(dadd, a + b)
+    DOUBLE_BINARY(dsub, a - b)
+    DOUBLE_BINARY(dmul, a * b)
+    DOUBLE_BINARY(ddiv, a / b)
+    DOUBLE_BINARY(drem, std::fmod(a, b))
+#undef INT_BINARY
+#undef LONG_BINARY
+#undef LONG_SHIFT
+#undef FLOAT_BINARY
+#undef DOUBLE_BINARY
+
+    // the minimum divided by -1 overflows back to the minimum, its remainder is 0
+    HANDLER(idiv) {
+        std::int32_t a = int_at(r.sp - 2), b = int_at(r.sp - 1);
+        if (b == 0) [[unlikely]] {
+            r = raise(r, "java/lang/ArithmeticException");
+            return;
+        }
+        set_int(r.sp - 2, b == -1 ? wrap(0u - static_cast<u4>(a)) : a / b);
+        r.sp -= 1;
+        r.pc += 1;
+    }
+    HANDLER(irem) {
+        std::int32_t a = int_at(r.sp - 2), b = int_at(r.sp - 1);
+        if (b == 0) [[unlikely]] {
+            r = raise(r, "java/lang/ArithmeticException");
+            return;
+        }
+        set_int(r.sp - 2, b == -1 ? 0 : a % b);
+        r.sp -= 1;
+        r.pc += 1;
+    }
+    HANDLER(ldiv) {
+        std::int64_t a = long_at(r.sp - 4), b = long_at(r.sp - 2);
+        if (b == 0) [[unlikely]] {
+            r = raise(r, "java/lang/ArithmeticException");
+            return;
+        }
+        set_long(r.sp - 4, b == -1 ? wrap(0ull - static_cast<u8>(a)) : a / b);
+        r.sp -= 2;
+        r.pc += 1;
+    }
+    HANDLER(lrem) {
+        std::int64_t a = long_at(r.sp - 4), b = long_at(r.sp - 2);
+        if (b == 0) [[unlikely]] {
+            r = raise(r, "java/lang/ArithmeticException");
+            return;
+        }
+        set_long(r.sp - 4, b == -1 ? 0 : a % b);
+        r.sp -= 2;
+        r.pc += 1;
+    }
+
+    HANDLER(ineg) {
+        set_int(r.sp - 1, wrap(0u - static_cast<u4>(int_at(r.sp - 1))));
+        r.pc += 1;
+    }
+    HANDLER(lneg) {
+        set_long(r.sp - 2, wrap(0ull - static_cast<u8>(long_at(r.sp - 2))));
+        r.pc += 1;
+    }
+    HANDLER(fneg) {
+        set_float(r.sp - 1, -float_at(r.sp - 1));
+        r.pc += 1;
+    }
+    HANDLER(dneg) {
+        set_double(r.sp - 2, -double_at(r.sp - 2));
+        r.pc += 1;
+    }
+
+    HANDLER(iinc) {
+        Slot* local = r.locals + r.pc[1];
+        set_int(local, wrap(static_cast<u4>(int_at(local)) +
+                            static_cast<u4>(static_cast<std::int8_t>(r.pc[2]))));
+        r.pc += 3;
+    }
+
+    // --- conversions ---
+
+    HANDLER(i2l) {
+        set_long(r.sp - 1, int_at(r.sp - 1));
+        r.sp += 1;
+        r.pc += 1;
+    }
+    HANDLER(i2f) {
+        set_float(r.sp - 1, static_cast<float>(int_at(r.sp - 1)));
+        r.pc += 1;
+    }
+    HANDLER(i2d) {
+        set_double(r.sp - 1, int_at(r.sp - 1));
+        r.sp += 1;
+        r.pc += 1;
+    }
+    HANDLER(l2i) {
+        set_int(r.sp - 2, static_cast<std::int32_t>(long_at(r.sp - 2)));
+        r.sp -= 1;
+        r.pc += 1;
+    }
+    HANDLER(l2f) {
+        set_float(r.sp - 2, static_cast<float>(long_at(r.sp - 2)));
+        r.sp -= 1;
+        r.pc += 1;
+    }
+    HANDLER(l2d) {
+        set_double(r.sp - 2, static_cast<double>(long_at(r.sp - 2)));
+        r.pc += 1;
+    }
+    HANDLER(f2i) {
+        set_int(r.sp - 1, java_cast<std::int32_t>(float_at(r.sp - 1)));
+        r.pc += 1;
+    }
+    HANDLER(f2l) {
+        set_long(r.sp - 1, java_cast<std::int64_t>(float_at(r.sp - 1)));
+        r.sp += 1;
+        r.pc += 1;
+    }
+    HANDLER(f2d) {
+        set_double(r.sp - 1, float_at(r.sp - 1));
+        r.sp += 1;
+        r.pc += 1;
+    }
+    HANDLER(d2i) {
+        set_int(r.sp - 2, java_cast<std::int32_t>(double_at(r.sp - 2)));
+        r.sp -= 1;
+        r.pc += 1;
+    }
+    HANDLER(d2l) {
+        set_long(r.sp - 2, java_cast<std::int64_t>(double_at(r.sp - 2)));
+        r.pc += 1;
+    }
+    HANDLER(d2f) {
+        set_float(r.sp - 2, static_cast<float>(double_at(r.sp - 2)));
+        r.sp -= 1;
+        r.pc += 1;
+    }
+    HANDLER(i2b) {
+        set_int(r.sp - 1, static_cast<std::int8_t>(int_at(r.sp - 1)));
+        r.pc += 1;
+    }
+    HANDLER(i2c) {
+        set_int(r.sp - 1, static_cast<u2>(int_at(r.sp - 1)));
+        r.pc += 1;
+    }
+    HANDLER(i2s) {
+        set_int(r.sp - 1, static_cast<std::int16_t>(int_at(r.sp - 1)));
+        r.pc += 1;
+    }
+
+    // --- comparisons and branches ---
+
+    HANDLER(lcmp) {
+        std::int64_t a = long_at(r.sp - 4), b = long_at(r.sp - 2);
+        set_int(r.sp - 4, (a > b) - (a < b));
+        r.sp -= 3;
+        r.pc += 1;
+    }
+    HANDLER(fcmpl) {
+        set_int(r.sp - 2, compare(float_at(r.sp - 2), float_at(r.sp - 1), -1));
+        r.sp -= 1;
+        r.pc += 1;
+    }
+    HANDLER(fcmpg) {
+        set_int(r.sp - 2, compare(float_at(r.sp - 2), float_at(r.sp - 1), 1));
+        r.sp -= 1;
+        r.pc += 1;
+    }
+    HANDLER(dcmpl) {
+        set_int(r.sp - 4, compare(double_at(r.sp - 4), double_at(r.sp - 2), -1));
+        r.sp -= 3;
+        r.pc += 1;
+    }
+    HANDLER(dcmpg) {
+        set_int(r.sp - 4, compare(double_at(r.sp - 4), double_at(r.sp - 2), 1));
+        r.sp -= 3;
+        r.pc += 1;
+    }
+
+#define IF(name, condition)                                                                        \
+    HANDLER(name) {                                                                                \
+        std::int32_t a = int_at(--r.sp);                                                           \
+        branch(r, condition);                                                                      \
+    }
+#define IF_ICMP(name, condition)                                                                   \
+    HANDLER(name) {                                                                                \
+        std::int32_t a = int_at(r.sp - 2), b = int_at(r.sp - 1);                                   \
+        r.sp -= 2;                                                                                 \
+        branch(r, condition);                                                                      \
+    }
+
+    IF(ifeq, a == 0)
+    IF(ifne, a != 0)
+    IF(iflt, a < 0)
+    IF(ifge, a >= 0)
+    IF(ifgt, a > 0)
+    IF(ifle, a <= 0)
+    IF_ICMP(if_icmpeq, a == b)
+    IF_ICMP(if_icmpne, a != b)
+    IF_ICMP(if_icmplt, a < b)
+    IF_ICMP(if_icmpge, a >= b)
+    IF_ICMP(if_icmpgt, a > b)
+    IF_ICMP(if_icmple, a <= b)
+#undef IF
+#undef IF_ICMP
+
+    HANDLER(if_acmpeq) {
+        r.sp -= 2;
+        branch(r, r.sp[0].raw == r.sp[1].raw);
+    }
+    HANDLER(if_acmpne) {
+        r.sp -= 2;
+        branch(r, r.sp[0].raw != r.sp[1].raw);
+    }
+
+    HANDLER(ifnull) {
+        branch(r, ref_at(--r.sp) == nullptr);
+    }
+    HANDLER(ifnonnull) {
+        branch(r, ref_at(--r.sp) != nullptr);
+    }
+
+    HANDLER(goto) {
+        jump(r, s2_at(r.pc + 1));
+    }
+    HANDLER(goto_w) {
+        jump(r, s4_at(r.pc + 1));
+    }
+    // return addresses are offsets into the code
+    HANDLER(jsr) {
+        (r.sp++)->raw = static_cast<u8>(r.pc + 3 - r.code);
+        r.pc += s2_at(r.pc + 1);
+    }
+    HANDLER(jsr_w) {
+        (r.sp++)->raw = static_cast<u8>(r.pc + 5 - r.code);
+        r.pc += s4_at(r.pc + 1);
+    }
+    HANDLER(ret) {
+        r.pc = r.code + r.locals[r.pc[1]].raw;
+    }
+
+    // the operands start at the next multiple of four from the code start
+    HANDLER(tableswitch) {
+        const u1* operands = r.code + ((r.pc - r.code + 4) & ~std::ptrdiff_t{3});
+        std::int32_t key = int_at(--r.sp);
+        std::int32_t low = s4_at(operands + 4), high = s4_at(operands + 8);
+        if (key < low || key > high) {
+            r.pc += s4_at(operands);
+        } else {
+            r.pc += s4_at(operands + 12 + 4 * (static_cast<std::int64_t>(key) - low));
+        }
+    }
+    // match-offset pairs are sorted by match
+    HANDLER(lookupswitch) {
+        const u1* operands = r.code + ((r.pc - r.code + 4) & ~std::ptrdiff_t{3});
+        std::int32_t key = int_at(--r.sp);
+        std::int32_t low = 0, high = s4_at(operands + 4) - 1;
+        const u1* pairs = operands + 8;
+        while (low <= high) {
+            std::int32_t middle = low + (high - low) / 2;
+            std::int32_t match = s4_at(pairs + 8 * middle);
+            if (match == key) {
+                r.pc += s4_at(pairs + 8 * middle + 4);
+                return;
+            }
+            if (match < key) {
+                low = middle + 1;
+            } else {
+                high = middle - 1;
+            }
+        }
+        r.pc += s4_at(operands);
+    }
+
+    // --- returns ---
+    //
+    // The value stays at the top of the stack, where execute picks it up.
+
+    HANDLER(ireturn) {
+        r.pc = leave_code;
+    }
+    HANDLER(lreturn) {
+        r.pc = leave_code;
+    }
+    HANDLER(freturn) {
+        r.pc = leave_code;
+    }
+    HANDLER(dreturn) {
+        r.pc = leave_code;
+    }
+    HANDLER(areturn) {
+        r.pc = leave_code;
+    }
+    HANDLER(return) {
+        r.pc = leave_code;
+    }
+
+    // --- fields and invocation ---
+
+    HANDLER(getstatic) {
+        r = get_static(r);
+    }
+    HANDLER(putstatic) {
+        r = put_static(r);
+    }
+    HANDLER(getfield) {
+        r = get_field(r);
+    }
+    HANDLER(putfield) {
+        r = put_field(r);
+    }
+    HANDLER(invokevirtual) {
+        r = invoke_virtual(r);
+    }
+    HANDLER(invokespecial) {
+        r = invoke_special(r);
+    }
+    HANDLER(invokestatic) {
+        r = invoke_static(r);
+    }
+    HANDLER(invokeinterface) {
+        r = invoke_interface(r);
+    }
+    // call sites are bootstrapped by java.lang.invoke, which this VM lacks
+    HANDLER(invokedynamic) {
+        r = raise(r, "java/lang/BootstrapMethodError");
+    }
+
+    // --- objects ---
+
+    HANDLER(new) {
+        r = new_instance(r);
+    }
+    HANDLER(newarray) {
+        raw_value_type type;
+        switch (r.pc[1]) {
+            case 4:
+                type = raw_value_type::Jboolean;
+                break;
+            case 5:
+                type = raw_value_type::Jchar;
+                break;
+            case 6:
+                type = raw_value_type::Jfloat;
+                break;
+            case 7:
+                type = raw_value_type::Jdouble;
+                break;
+            case 8:
+                type = raw_value_type::Jbyte;
+                break;
+            case 9:
+                type = raw_value_type::Jshort;
+                break;
+            case 10:
+                type = raw_value_type::Jint;
+                break;
+            case 11:
+                type = raw_value_type::Jlong;
+                break;
+            default:
+                illegal(r);
+        }
+        r = new_array(r, *PrimitiveKlass::of(type).array_of(), 2);
+    }
+    HANDLER(anewarray) {
+        r = new_object_array(r);
+    }
+    HANDLER(multianewarray) {
+        r = multi_array(r);
+    }
+    HANDLER(arraylength) {
+        oop::BasicOop* array = ref_at(r.sp - 1);
+        if (array == nullptr) [[unlikely]] {
+            r = raise(r, "java/lang/NullPointerException");
+            return;
+        }
+        set_int(r.sp - 1, as_array(array)->length);
+        r.pc += 1;
+    }
+    HANDLER(athrow) {
+        oop::BasicOop* exception = ref_at(r.sp - 1);
+        if (exception == nullptr) {
+            r = raise(r, "java/lang/NullPointerException");
+        } else {
+            r = raise(r, oop::Ref(exception));
+        }
+    }
+    HANDLER(checkcast) {
+        r = check_cast(r);
+    }
+    HANDLER(instanceof) {
+        r = instance_of(r);
+    }
+    HANDLER(monitorenter) {
+        oop::BasicOop* object = ref_at(r.sp - 1);
+        if (object == nullptr) [[unlikely]] {
+            r = raise(r, "java/lang/NullPointerException");
+            return;
+        }
+        r.runtime->heap->monitor_of(oop::Ref(object)).enter();
+        r.sp -= 1;
+        r.pc += 1;
+    }
+    HANDLER(monitorexit) {
+        r = monitor_exit(r);
+    }
+
+    HANDLER(wide) {
+        u2 index = u2_at(r.pc + 2);
+        switch (r.pc[1]) {
+            case _iload:
+            case _fload:
+            case _aload:
+                *r.sp++ = r.locals[index];
+                break;
+            case _lload:
+            case _dload:
+                *r.sp = r.locals[index];
+                r.sp += 2;
+                break;
+            case _istore:
+            case _fstore:
+            case _astore:
+                r.locals[index] = *--r.sp;
+                break;
+            case _lstore:
+            case _dstore:
+                r.sp -= 2;
+                r.locals[index] = *r.sp;
+                break;
+            case _ret:
+                r.pc = r.code + r.locals[index].raw;
+                return;
+            case _iinc:
+                set_int(r.locals + index, wrap(static_cast<u4>(int_at(r.locals + index)) +
+                                               static_cast<u4>(s2_at(r.pc + 4))));
+                r.pc += 6;
+                return;
+            default:
+                illegal(r);
+        }
+        r.pc += 4;
+    }
+
+    // --- quickened instructions ---
+    //
+    // What the slow paths above rewrite instructions to once they resolved
+    // their constant: no resolution, initialization or type checks remain.
+
+    HANDLER(ldc_quick) {
+        r.sp->raw = r.frame->get_klass().get_constant_bits(r.pc[1]);
+        r.sp += 1;
+        r.pc += 2;
+    }
+    HANDLER(ldc_w_quick) {
+        r.sp->raw = r.frame->get_klass().get_constant_bits(u2_at(r.pc + 1));
+        r.sp += 1;
+        r.pc += 3;
+    }
+    HANDLER(aldc_quick) {
+        set_ref(r.sp++, reference_constant(r.frame->get_klass().resolved_entry(r.pc[1])));
+        r.pc += 2;
+    }
+    HANDLER(aldc_w_quick) {
+        set_ref(r.sp++, reference_constant(quick_entry(r)));
+        r.pc += 3;
+    }
+
+    HANDLER(getfield_quick) {
+        load_field(r, u2_at(r.pc + 1), raw_value_type::Jint);
+    }
+    HANDLER(getfield2_quick) {
+        load_field(r, u2_at(r.pc + 1), raw_value_type::Jlong);
+    }
+    HANDLER(agetfield_quick) {
+        load_field(r, u2_at(r.pc + 1), raw_value_type::Jreference);
+    }
+    HANDLER(getfield_quick_w) {
+        const CpCacheEntry& entry = quick_entry(r);
+        load_field(r, entry.offset, entry.type);
+    }
+    HANDLER(putfield_quick) {
+        store_field(r, u2_at(r.pc + 1), raw_value_type::Jint);
+    }
+    HANDLER(putfield2_quick) {
+        store_field(r, u2_at(r.pc + 1), raw_value_type::Jlong);
+    }
+    HANDLER(aputfield_quick) {
+        store_field(r, u2_at(r.pc + 1), raw_value_type::Jreference);
+    }
+    HANDLER(putfield_quick_w) {
+        const CpCacheEntry& entry = quick_entry(r);
+        store_field(r, entry.offset, entry.type);
+    }
+    HANDLER(getstatic_quick) {
+        load_static(r, quick_entry(r));
+    }
+    HANDLER(putstatic_quick) {
+        store_static(r, quick_entry(r));
+    }
+
+    HANDLER(invokevirtual_quick) {
+        const oop::BasicOop* receiver = ref_at(r.sp - r.pc[2]);
+        if (receiver == nullptr) [[unlikely]] {
+            r = raise(r, "java/lang/NullPointerException");
+            return;
+        }
+        const RawKlass* type = type_of(receiver);
+        if (type->get_klass_type() != KlassType::Instance) [[unlikely]] {
+            // arrays run the Object method the slow path resolves
+            r = invoke_virtual(r);
+            return;
+        }
+        r = invoke_method(r, *static_cast<const InstanceKlass*>(type)->select_virtual(r.pc[1]), 3);
+    }
+    HANDLER(invokevirtual_quick_w) {
+        r = invoke_virtual(r, quick_entry(r).method, 3);
+    }
+    HANDLER(invokenonvirtual_quick) {
+        r = invoke_nonvirtual(r, *quick_entry(r).special);
+    }
+    HANDLER(invokestatic_quick) {
+        r = invoke_method(r, *quick_entry(r).method, 3);
+    }
+    HANDLER(invokeinterface_quick) {
+        r = invoke_interface(r, quick_entry(r).method);
+    }
+
+    HANDLER(new_quick) {
+        set_ref(r.sp++, allocate_instance(*r.runtime, *quick_entry(r).klass).get());
+        r.pc += 3;
+    }
+    HANDLER(anewarray_quick) {
+        r = new_array(r, *class_type(&quick_entry(r))->array_of(), 3);
+    }
+    HANDLER(checkcast_quick) {
+        const oop::BasicOop* object = ref_at(r.sp - 1);
+        if (object != nullptr && !is_subtype(type_of(object), class_type(&quick_entry(r)))) {
+            r = raise(r, "java/lang/ClassCastException");
+            return;
+        }
+        r.pc += 3;
+    }
+    HANDLER(instanceof_quick) {
+        const oop::BasicOop* object = ref_at(r.sp - 1);
+        set_int(r.sp - 1,
+                object != nullptr && is_subtype(type_of(object), class_type(&quick_entry(r))));
+        r.pc += 3;
+    }
+
+    // never dispatched: both loops stop when they reach it
+    HANDLER(leave) {
+    }
+
+    // --- superinstructions ---
+    //
+    // The handlers of the instructions one after the other, up to the first
+    // that leaves pc anywhere but at the next one: on a branch taken, a
+    // return or an exception.
+#define STEP(name)                                                                                 \
+    {                                                                                              \
+        const u1* next = r.pc + lengths[_##name];                                                  \
+        op_##name(r);                                                                              \
+        if (r.pc != next) return;                                                                  \
+    }
+#define FUSE(_1, _2, _3, fuse, ...) fuse
+#define FUSE2(a, b) STEP(a) op_##b(r);
+#define FUSE3(a, b, c) STEP(a) STEP(b) op_##c(r);
+#define S(code, name, length, ...)                                                                 \
+    HANDLER(name) {                                                                                \
+        FUSE(__VA_ARGS__, FUSE3, FUSE2, )(__VA_ARGS__)                                             \
+    }
+#include "runtime/byte_code_superinstructions.def"
+#undef S
+#undef FUSE
+#undef FUSE2
+#undef FUSE3
+#undef STEP
+
+    // === 解释循环实现 ===
+
+    BytecodeEngine::Registers BytecodeEngine::run_threaded(Registers r) {
+#if JVM_THREADED_DISPATCH
+        // label addresses in .def order, then a lambda without labels of its
+        // own spreads them over the 256 opcodes
+        static const void* const labels[] = {
+#define X(code, name, length) &&do_##name,
+#include "runtime/byte_code_engine.def"
+#undef X
+            &&do_illegal};
+        static const std::array<const void*, 256> targets = [](const void* const* labels,
+                                                               std::size_t count) {
+            std::array<const void*, 256> table;
+            table.fill(labels[count - 1]);
+            int position = 0;
+#define X(code, name, length) table[code] = labels[position++];
+#include "runtime/byte_code_engine.def"
+#undef X
+            return table;
+        }(labels, std::size(labels));
+
+#define DISPATCH() goto* targets[opcode_at(r.pc)]
+        DISPATCH();
+#define X(code, name, length)                                                                      \
+    do_##name:                                                                                     \
+    if (code == _leave) return r;                                                                  \
+    op_##name(r);                                                                                  \
+    DISPATCH();
+#include "runtime/byte_code_engine.def"
+#undef X
+#undef DISPATCH
+    do_illegal:
+        illegal(r);
+#else
+        return run_table(r);
+#endif
+    }
+
+    BytecodeEngine::Registers BytecodeEngine::run_table(Registers r) {
+        for (u1 opcode; (opcode = opcode_at(r.pc)) != _leave;) {
+            Handler handler = handlers[opcode];
+            if (!handler) illegal(r);
+            handler(r);
+        }
+        return r;
+    }
+
+    // === 栈顶缓存解释循环 ===
+    //
+    // The cached loop keeps the top of the operand stack in registers: in
+    // state 0 everything is in memory, in state 1 the top slot is in `tos`,
+    // in state 2 the slot below it is in `nos`. Every opcode has a table
+    // entry per state. The instructions below have kernels that run on the
+    // registers; the rest, long and double arithmetic among them, spill the
+    // cache and run their handler in state 0. By how a kernel uses the stack:
+    //   PUSH(name, value)             pushes one slot
+    //   UNARY(name, guard, value)     replaces the top slot `a`
+    //   BINARY(name, guard, value)    replaces `a` and the slot `b` above it
+    //   POP(name, statement)          takes `a`; the statement moves pc
+    //   POP2(name, guard, statement)  takes `a` and `b`; the statement moves pc
+    //   KEEP(name)                    runs the handler, which leaves the stack alone
+    //   DUP(name)                     duplicates the top slot
+    // When `guard` holds the instruction spills and runs its handler instead,
+    // which raises the exception.
+#define CACHED_INSTRUCTIONS(PUSH, UNARY, BINARY, POP, POP2, KEEP, DUP)                             \
+    PUSH(aconst_null, Slot{})                                                                      \
+    PUSH(iconst_m1, int_value(-1))                                                                 \
+    PUSH(iconst_0, int_value(0))                                                                   \
+    PUSH(iconst_1, int_value(1))                                                                   \
+    PUSH(iconst_2, int_value(2))                                                                   \
+    PUSH(iconst_3, int_value(3))                                                                   \
+    PUSH(iconst_4, int_value(4))                                                                   \
+    PUSH(iconst_5, int_value(5))                                                                   \
+    PUSH(fconst_0, float_value(0.0f))                                                              \
+    PUSH(fconst_1, float_value(1.0f))                                                              \
+    PUSH(fconst_2, float_value(2.0f))                                                              \
+    PUSH(bipush, int_value(static_cast<std::int8_t>(r.pc[1])))                                     \
+    PUSH(sipush, int_value(s2_at(r.pc + 1)))                                                       \
+    PUSH(ldc_quick, Slot(r.frame->get_klass().get_constant_bits(r.pc[1])))                         \
+    PUSH(iload, r.locals[r.pc[1]])                                                                 \
+    PUSH(iload_0, r.locals[0])                                                                     \
+    PUSH(iload_1, r.locals[1])                                                                     \
+    PUSH(iload_2, r.locals[2])                                                                     \
+    PUSH(iload_3, r.locals[3])                                                                     \
+    PUSH(fload, r.locals[r.pc[1]])                                                                 \
+    PUSH(fload_0, r.locals[0])                                                                     \
+    PUSH(fload_1, r.locals[1])                                                                     \
+    PUSH(fload_2, r.locals[2])                                                                     \
+    PUSH(fload_3, r.locals[3])                                                                     \
+    PUSH(aload, r.locals[r.pc[1]])                                                                 \
+    PUSH(aload_0, r.locals[0])                                                                     \
+    PUSH(aload_1, r.locals[1])                                                                     \
+    PUSH(aload_2, r.locals[2])                                                                     \
+    PUSH(aload_3, r.locals[3])                                                                     \
+    UNARY(ineg, false, int_value(wrap(0u - bits_of(a))))                                           \
+    UNARY(fneg, false, float_value(-float_of(a)))                                                  \
+    UNARY(i2f, false, float_value(static_cast<float>(int_of(a))))                                  \
+    UNARY(f2i, false, int_value(java_cast<std::int32_t>(float_of(a))))                             \
+    UNARY(i2b, false, int_value(static_cast<std::int8_t>(int_of(a))))                              \
+    UNARY(i2c, false, int_value(static_cast<u2>(int_of(a))))                                       \
+    UNARY(i2s, false, int_value(static_cast<std::int16_t>(int_of(a))))                             \
+    UNARY(arraylength, ref_of(a) == nullptr, int_value(as_array(ref_of(a))->length))               \
+    UNARY(getfield_quick, ref_of(a) == nullptr,                                                    \
+          load_value(field_address(ref_of(a), u2_at(r.pc + 1)), raw_value_type::Jint))             \
+    UNARY(agetfield_quick, ref_of(a) == nullptr,                                                   \
+          load_value(field_address(ref_of(a), u2_at(r.pc + 1)), raw_value_type::Jreference))       \
+    BINARY(iadd, false, int_value(wrap(bits_of(a) + bits_of(b))))                                  \
+    BINARY(isub, false, int_value(wrap(bits_of(a) - bits_of(b))))                                  \
+    BINARY(imul, false, int_value(wrap(bits_of(a) * bits_of(b))))                                  \
+    BINARY(idiv, int_of(b) == 0,                                                                   \
+           int_value(int_of(b) == -1 ? wrap(0u - bits_of(a)) : int_of(a) / int_of(b)))             \
+    BINARY(irem, int_of(b) == 0, int_value(int_of(b) == -1 ? 0 : int_of(a) % int_of(b)))           \
+    BINARY(ishl, false, int_value(wrap(bits_of(a) << (int_of(b) & 31))))                           \
+    BINARY(ishr, false, int_value(int_of(a) >> (int_of(b) & 31)))                                  \
+    BINARY(iushr, false, int_value(wrap(bits_of(a) >> (int_of(b) & 31))))                          \
+    BINARY(iand, false, int_value(int_of(a) & int_of(b)))                                          \
+    BINARY(ior, false, int_value(int_of(a) | int_of(b)))                                           \
+    BINARY(ixor, false, int_value(int_of(a) ^ int_of(b)))                                          \
+    BINARY(fadd, false, float_value(float_of(a) + float_of(b)))                                    \
+    BINARY(fsub, false, float_value(float_of(a) - float_of(b)))                                    \
+    BINARY(fmul, false, float_value(float_of(a) * float_of(b)))                                    \
+    BINARY(fdiv, false, float_value(float_of(a) / float_of(b)))                                    \
+    BINARY(fcmpl, false, int_value(compare(float_of(a), float_of(b), -1)))                         \
+    BINARY(fcmpg, false, int_value(compare(float_of(a), float_of(b), 1)))                          \
+    BINARY(iaload, out_of_bounds(a, b), element(a, b, raw_value_type::Jint))                       \
+    BINARY(faload, out_of_bounds(a, b), element(a, b, raw_value_type::Jfloat))                     \
+    BINARY(aaload, out_of_bounds(a, b), element(a, b, raw_value_type::Jreference))                 \
+    BINARY(baload, out_of_bounds(a, b), element(a, b, raw_value_type::Jbyte))                      \
+    BINARY(caload, out_of_bounds(a, b), element(a, b, raw_value_type::Jchar))                      \
+    BINARY(saload, out_of_bounds(a, b), element(a, b, raw_value_type::Jshort))                     \
+    POP(istore, r.locals[r.pc[1]] = a; r.pc += 2)                                                  \
+    POP(istore_0, r.locals[0] = a; r.pc += 1)                                                      \
+    POP(istore_1, r.locals[1] = a; r.pc += 1)                                                      \
+    POP(istore_2, r.locals[2] = a; r.pc += 1)                                                      \
+    POP(istore_3, r.locals[3] = a; r.pc += 1)                                                      \
+    POP(fstore, r.locals[r.pc[1]] = a; r.pc += 2)                                                  \
+    POP(fstore_0, r.locals[0] = a; r.pc += 1)                                                      \
+    POP(fstore_1, r.locals[1] = a; r.pc += 1)                                                      \
+    POP(fstore_2, r.locals[2] = a; r.pc += 1)                                                      \
+    POP(fstore_3, r.locals[3] = a; r.pc += 1)                                                      \
+    POP(astore, r.locals[r.pc[1]] = a; r.pc += 2)                                                  \
+    POP(astore_0, r.locals[0] = a; r.pc += 1)                                                      \
+    POP(astore_1, r.locals[1] = a; r.pc += 1)                                                      \
+    POP(astore_2, r.locals[2] = a; r.pc += 1)                                                      \
+    POP(astore_3, r.locals[3] = a; r.pc += 1)                                                      \
+    POP(pop, r.pc += 1)                                                                            \
+    POP(ifeq, branch(r, int_of(a) == 0))                                                           \
+    POP(ifne, branch(r, int_of(a) != 0))                                                           \
+    POP(iflt, branch(r, int_of(a) < 0))                                                            \
+    POP(ifge, branch(r, int_of(a) >= 0))                                                           \
+    POP(ifgt, branch(r, int_of(a) > 0))                                                            \
+    POP(ifle, branch(r, int_of(a) <= 0))                                                           \
+    POP(ifnull, branch(r, ref_of(a) == nullptr))                                                   \
+    POP(ifnonnull, branch(r, ref_of(a) != nullptr))                                                \
+    POP2(if_icmpeq, false, branch(r, int_of(a) == int_of(b)))                                      \
+    POP2(if_icmpne, false, branch(r, int_of(a) != int_of(b)))                                      \
+    POP2(if_icmplt, false, branch(r, int_of(a) < int_of(b)))                                       \
+    POP2(if_icmpge, false, branch(r, int_of(a) >= int_of(b)))                                      \
+    POP2(if_icmpgt, false, branch(r, int_of(a) > int_of(b)))                                       \
+    POP2(if_icmple, false, branch(r, int_of(a) <= int_of(b)))                                      \
+    POP2(if_acmpeq, false, branch(r, a.raw == b.raw))                                              \
+    POP2(if_acmpne, false, branch(r, a.raw != b.raw))                                              \
+    POP2(putfield_quick, ref_of(a) == nullptr,                                                     \
+         store_value(field_address(ref_of(a), u2_at(r.pc + 1)), raw_value_type::Jint, b);          \
+         r.pc += 3)                                                                                \
+    POP2(aputfield_quick, ref_of(a) == nullptr,                                                    \
+         store_value(field_address(ref_of(a), u2_at(r.pc + 1)), raw_value_type::Jreference, b);    \
+         r.pc += 3)                                                                                \
+    KEEP(nop)                                                                                      \
+    KEEP(iinc)                                                                                     \
+    KEEP(goto)                                                                                     \
+    KEEP(goto_w)                                                                                   \
+    DUP(dup)
+
+    BytecodeEngine::Registers BytecodeEngine::run_cached(Registers r) {
+#if JVM_THREADED_DISPATCH
+        Slot tos, nos;
+
+        // every handler entered in state 0, 1 and 2, in .def order, then the
+        // kernels; a lambda without labels of its own spreads them over a
+        // table per state
+        static const void* const labels[] = {
+#define X(code, name, length) &&spill0_##name, &&spill1_##name, &&spill2_##name,
+#include "runtime/byte_code_engine.def"
+#undef X
+            &&do_illegal};
+#define LABELS(name, ...) &&cached0_##name, &&cached1_##name, &&cached2_##name,
+        static const void* const kernels[] = {
+            CACHED_INSTRUCTIONS(LABELS, LABELS, LABELS, LABELS, LABELS, LABELS, LABELS)};
+#undef LABELS
+#define OPCODE(name, ...) _##name,
+        static constexpr u1 cached[] = {
+            CACHED_INSTRUCTIONS(OPCODE, OPCODE, OPCODE, OPCODE, OPCODE, OPCODE, OPCODE)};
+#undef OPCODE
+        static const auto targets = [](const void* const* labels, std::size_t count,
+                                       const void* const* kernels) {
+            std::array<std::array<const void*, 256>, 3> table;
+            for (auto& state : table) state.fill(labels[count - 1]);
+            std::size_t position = 0;
+#define X(code, name, length)                                                                      \
+    for (auto& state : table) state[code] = labels[position++];
+#include "runtime/byte_code_engine.def"
+#undef X
+            // superinstructions keep their handlers and are entered spilled,
+            // even those starting with a kernel: one dispatch for the sequence
+            position = 0;
+            for (u1 opcode : cached) {
+                for (auto& state : table) state[opcode] = kernels[position++];
+            }
+            return table;
+        }(labels, std::size(labels), kernels);
+
+#define DISPATCH(state) goto* targets[state][opcode_at(r.pc)]
+#define NEXT(name, state)                                                                          \
+    r.pc += lengths[_##name];                                                                      \
+    DISPATCH(state)
+        DISPATCH(0);
+
+        // spilling state 2 falls through spilling state 1
+#define X(code, name, length)                                                                      \
+    spill2_##name:                                                                                 \
+    *r.sp++ = nos;                                                                                 \
+    spill1_##name:                                                                                 \
+    *r.sp++ = tos;                                                                                 \
+    spill0_##name:                                                                                 \
+    if (code == _leave) return r;                                                                  \
+    op_##name(r);                                                                                  \
+    DISPATCH(0);
+#include "runtime/byte_code_engine.def"
+#undef X
+
+#define PUSH(name, value)                                                                          \
+    cached0_##name:                                                                                \
+    tos = (value);                                                                                 \
+    NEXT(name, 1);                                                                                 \
+    cached1_##name:                                                                                \
+    nos = tos;                                                                                     \
+    tos = (value);                                                                                 \
+    NEXT(name, 2);                                                                                 \
+    cached2_##name:                                                                                \
+    *r.sp++ = nos;                                                                                 \
+    nos = tos;                                                                                     \
+    tos = (value);                                                                                 \
+    NEXT(name, 2);
+#define UNARY(name, guard, value)                                                                  \
+    cached0_##name : {                                                                             \
+        Slot a = r.sp[-1];                                                                         \
+        if (guard) goto spill0_##name;                                                             \
+        r.sp -= 1;                                                                                 \
+        tos = (value);                                                                             \
+    }                                                                                              \
+    NEXT(name, 1);                                                                                 \
+    cached1_##name : {                                                                             \
+        Slot a = tos;                                                                              \
+        if (guard) goto spill1_##name;                                                             \
+        tos = (value);                                                                             \
+    }                                                                                              \
+    NEXT(name, 1);                                                                                 \
+    cached2_##name : {                                                                             \
+        Slot a = tos;                                                                              \
+        if (guard) goto spill2_##name;                                                             \
+        tos = (value);                                                                             \
+    }                                                                                              \
+    NEXT(name, 2);
+#define BINARY(name, guard, value)                                                                 \
+    cached0_##name : {                                                                             \
+        Slot a = r.sp[-2], b = r.sp[-1];                                                           \
+        if (guard) goto spill0_##name;                                                             \
+        r.sp -= 2;                                                                                 \
+        tos = (value);                                                                             \
+    }                                                                                              \
+    NEXT(name, 1);                                                                                 \
+    cached1_##name : {                                                                             \
+        Slot a = r.sp[-1], b = tos;                                                                \
+        if (guard) goto spill1_##name;                                                             \
+        r.sp -= 1;                                                                                 \
+        tos = (value);                                                                             \
+    }                                                                                              \
+    NEXT(name, 1);                                                                                 \
+    cached2_##name : {                                                                             \
+        Slot a = nos, b = tos;                                                                     \
+        if (guard) goto spill2_##name;                                                             \
+        tos = (value);                                                                             \
+    }                                                                                              \
+    NEXT(name, 1);
+#define POP(name, ...)                                                                             \
+    cached0_##name : {                                                                             \
+        [[maybe_unused]] Slot a = *--r.sp;                                                         \
+        __VA_ARGS__;                                                                               \
+    }                                                                                              \
+    DISPATCH(0);                                                                                   \
+    cached1_##name : {                                                                             \
+        [[maybe_unused]] Slot a = tos;                                                             \
+        __VA_ARGS__;                                                                               \
+    }                                                                                              \
+    DISPATCH(0);                                                                                   \
+    cached2_##name : {                                                                             \
+        [[maybe_unused]] Slot a = tos;                                                             \
+        tos = nos;                                                                                 \
+        __VA_ARGS__;                                                                               \
+    }                                                                                              \
+    DISPATCH(1);
+#define POP2(name, guard, ...)                                                                     \
+    cached0_##name : {                                                                             \
+        Slot a = r.sp[-2], b = r.sp[-1];                                                           \
+        if (guard) goto spill0_##name;                                                             \
+        r.sp -= 2;                                                                                 \
+        __VA_ARGS__;                                                                               \
+    }                                                                                              \
+    DISPATCH(0);                                                                                   \
+    cached1_##name : {                                                                             \
+        Slot a = r.sp[-1], b = tos;                                                                \
+        if (guard) goto spill1_##name;                                                             \
+        r.sp -= 1;                                                                                 \
+        __VA_ARGS__;                                                                               \
+    }                                                                                              \
+    DISPATCH(0);                                                                                   \
+    cached2_##name : {                                                                             \
+        Slot a = nos, b = tos;                                                                     \
+        if (guard) goto spill2_##name;                                                             \
+        __VA_ARGS__;                                                                               \
+    }                                                                                              \
+    DISPATCH(0);
+#define KEEP(name)                                                                                 \
+    cached0_##name:                                                                                \
+    op_##name(r);                                                                                  \
+    DISPATCH(0);                                                                                   \
+    cached1_##name:                                                                                \
+    op_##name(r);                                                                                  \
+    DISPATCH(1);                                                                                   \
+    cached2_##name:                                                                                \
+    op_##name(r);                                                                                  \
+    DISPATCH(2);
+#define DUP(name)                                                                                  \
+    cached0_##name:                                                                                \
+    tos = r.sp[-1];                                                                                \
+    NEXT(name, 1);                                                                                 \
+    cached1_##name:                                                                                \
+    nos = tos;                                                                                     \
+    NEXT(name, 2);                                                                                 \
+    cached2_##name:                                                                                \
+    *r.sp++ = nos;                                                                                 \
+    nos = tos;                                                                                     \
+    NEXT(name, 2);
+        CACHED_INSTRUCTIONS(PUSH, UNARY, BINARY, POP, POP2, KEEP, DUP)
+#undef PUSH
+#undef UNARY
+#undef BINARY
+#undef POP
+#undef POP2
+#undef KEEP
+#undef DUP
+#undef NEXT
+#undef DISPATCH
+    do_illegal:
+        illegal(r);
+#else
+        return run_table(r);
+#endif
+    }
+#undef CACHED_INSTRUCTIONS
+
+    BytecodeEngine::Outcome BytecodeEngine::run(StackFrame& frame, const Runtime& runtime,
+                                                oop::Ref exception) {
+        assert(frame.get_method() != nullptr);
+        const MethodWrapper& method = *frame.get_method();
+        Outermost outermost;
+
+        const u1* code = frame.get_code()->quick_code.data();
+        Registers r{code + frame.get_pc(), frame.stack() + frame.get_depth(), frame.locals(), code,
+                    &frame, &runtime, oop::Ref::null()};
+        if (exception) r = raise(r, exception);
+        switch (runtime.dispatch) {
+            case Runtime::Dispatch::Threaded:
+                r = run_threaded(r);
+                break;
+            case Runtime::Dispatch::Table:
+                r = run_table(r);
+                break;
+            case Runtime::Dispatch::Cached:
+                r = run_cached(r);
+                break;
+        }
+
+        if (r.exception) return {{}, r.exception};
+        u1 slots = method.signature.return_slots();
+        return {slots == 0 ? Slot{} : r.sp[-slots], oop::Ref::null()};
+    }
+
+    BytecodeEngine::Outcome BytecodeEngine::execute(StackFrame& frame, const Runtime& runtime) {
+        assert(frame.get_method() != nullptr);
+        // code the verifier never accepted may index past its locals or stack
+        if (!frame.get_method()->verified) {
+            return {{}, make_throwable(runtime, "java/lang/VerifyError", frame.get_thread())};
+        }
+        MethodMonitor monitor(frame, runtime);
+        return run(frame, runtime, oop::Ref::null());
+    }
+
+    BytecodeEngine::Outcome BytecodeEngine::resume(StackFrame& frame, const Runtime& runtime,
+                                                   oop::Ref exception) {
+        assert(frame.get_method() != nullptr);
+        assert(!(frame.get_method()->mptr->access_flags & ACC_SYNCHRONIZED));
+        return run(frame, runtime, exception);
+    }
+
+    BytecodeEngine::Outcome BytecodeEngine::call(const MethodWrapper& method,
+                                                 const Slot* arguments, const Runtime& runtime,
+                                                 oop::Ref thread) {
+        return jvm::call(method, arguments, runtime, thread);
+    }
+
+    bool BytecodeEngine::is_subtype(const RawKlass* from, const RawKlass* to) {
+        return jvm::is_subtype(from, to);
     }
 
-    void BytecodeEngine::op_iadd(StackFrame& frame) {
+    Slot BytecodeEngine::interpret(StackFrame& frame, const Runtime& runtime) {
+        Outcome outcome = execute(frame, runtime);
+        if (outcome.exception) throw JavaException(outcome.exception);
+        return outcome.value;
     }
 
-    void BytecodeEngine::op_ireturn(StackFrame& frame) {
+    Slot BytecodeEngine::invoke(const MethodWrapper& method, std::span<const Slot> arguments,
+                                const Runtime& runtime, oop::Ref thread) {
+        assert(arguments.size() == method.signature.argument_slots);
+        if (method.mptr->access_flags & ACC_STATIC) initialize(*method.kls, runtime, thread);
+        Outcome outcome = call(method, arguments.data(), runtime, thread);
+        if (outcome.exception) throw JavaException(outcome.exception);
+        return outcome.value;
     }
 
 } // namespace jvm
@@ -0,0 +1,94 @@
+#include "runtime/class_loader.hpp"
+#include <atomic>
+#include <mutex>
+#include <spdlog/spdlog.h>
+#include <thread>
+#include <unordered_set>
+
+using namespace rt_jvm_data;
+
+BatchClassLoader::BatchClassLoader(SystemDictionary& dict, unsigned workers)
+    : dictionary(dict), worker_count(workers) {
+    if (worker_count == 0) worker_count = std::max(1u, std::thread::hardware_concurrency());
+}
+
+BatchLoadResult BatchClassLoader::load_directory(const std::filesystem::path& dir) {
+    ClassPath cp;
+    cp.add(std::make_unique<DirectoryClassPathEntry>(dir));
+    return load_classpath(cp);
+}
+
+BatchLoadResult BatchClassLoader::load_classpath(const ClassPath& classpath) {
+    struct Job {
+        const ClassPathEntry* entry;
+        std::string name;
+    };
+
+    // enumerate up front so workers only ever touch an atomic cursor
+    std::vector<Job> jobs;
+    std::unordered_set<std::string> seen;
+    for (const auto& entry : classpath.get_entries()) {
+        for (auto& name : entry->class_names()) {
+            if (seen.insert(name).second) jobs.push_back({entry.get(), std::move(name)});
+        }
+    }
+
+    return run(
+        jobs.size(), [&](std::size_t index) { return jobs[index].name; },
+        [&](std::size_t index) {
+            const auto& job = jobs[index];
+            auto src = job.entry->open(job.name);
+            if (src == nullptr) throw std::runtime_error("vanished from " + job.entry->describe());
+            return std::make_unique<InstanceKlass>(std::move(src));
+        });
+}
+
+BatchLoadResult BatchClassLoader::load_archive(const raw_jvm_data::SharedClassArchive& archive) {
+    auto records = archive.get_records();
+    return run(
+        records.size(),
+        [&](std::size_t index) { return std::string(archive.name_of(records[index])); },
+        [&](std::size_t index) { return std::make_unique<InstanceKlass>(archive, records[index]); });
+}
+
+BatchLoadResult BatchClassLoader::run(
+    std::size_t count, const std::function<std::string(std::size_t)>& name_of,
+    const std::function<std::unique_ptr<InstanceKlass>(std::size_t)>& build) {
+    BatchLoadResult result;
+    std::atomic<std::size_t> next{0};
+    std::atomic<std::size_t> loaded{0};
+    std::atomic<std::size_t> duplicates{0};
+    std::mutex failures_mtx;
+
+    auto work = [&] {
+        for (std::size_t index = next.fetch_add(1, std::memory_order_relaxed); index < count;
+             index = next.fetch_add(1, std::memory_order_relaxed)) {
+            try {
+                auto kls = build(index);
+                InstanceKlass* raw = kls.get();
+                if (dictionary.publish(std::move(kls)) == raw) {
+                    loaded.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    duplicates.fetch_add(1, std::memory_order_relaxed);
+                }
+            } catch (const std::exception& e) {
+                auto name = name_of(index);
+                spdlog::error("can't load class {}: {}", name, e.what());
+                std::lock_guard<std::mutex> lk(failures_mtx);
+                result.failures.emplace_back(name + ": " + e.what());
+            }
+        }
+    };
+
+    {
+        // the calling thread is one of the workers
+        std::size_t helpers = std::min<std::size_t>(worker_count, count);
+        std::vector<std::jthread> pool;
+        for (std::size_t index = 1; index < helpers; index++) pool.emplace_back(work);
+        work();
+    }
+
+    result.loaded = loaded.load();
+    result.duplicates = duplicates.load();
+    return result;
+}
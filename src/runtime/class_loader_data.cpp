@@ -0,0 +1,91 @@
+#include "runtime/class_loader_data.hpp"
+#include "runtime/system_dictionary.hpp"
+#include <algorithm>
+#include <iterator>
+#include <unordered_set>
+
+using namespace rt_jvm_data;
+
+void ClassLoaderData::record_dependency(const ClassLoaderData* target) {
+    if (target == nullptr || target == this) return;
+    std::lock_guard<std::mutex> lock(dependencies_mtx);
+    if (std::find(dependencies.begin(), dependencies.end(), target) == dependencies.end()) {
+        dependencies.push_back(target);
+    }
+}
+
+std::vector<const ClassLoaderData*> ClassLoaderData::get_dependencies() const {
+    std::lock_guard<std::mutex> lock(dependencies_mtx);
+    return dependencies;
+}
+
+ClassLoaderData* ClassLoaderDataGraph::add(oop::Ref mirror) {
+    std::lock_guard<std::mutex> lock(mtx);
+    return loaders.emplace_back(std::make_unique<ClassLoaderData>(mirror)).get();
+}
+
+std::size_t ClassLoaderDataGraph::size() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return loaders.size();
+}
+
+std::size_t ClassLoaderDataGraph::add_unloading_observer(UnloadingObserver observer) {
+    std::lock_guard<std::mutex> lock(mtx);
+    observers.emplace_back(next_observer, std::move(observer));
+    return next_observer++;
+}
+
+void ClassLoaderDataGraph::remove_unloading_observer(std::size_t handle) {
+    std::lock_guard<std::mutex> lock(mtx);
+    std::erase_if(observers, [&](const auto& entry) { return entry.first == handle; });
+}
+
+std::size_t ClassLoaderDataGraph::do_unloading(const IsAlive& is_alive,
+                                               SystemDictionary& dictionary) {
+    std::vector<std::unique_ptr<ClassLoaderData>> dead;
+    std::vector<std::pair<std::size_t, UnloadingObserver>> notify;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        // alive through their mirrors, then whatever a live loader depends on
+        std::unordered_set<const ClassLoaderData*> live;
+        std::vector<const ClassLoaderData*> worklist;
+        for (const auto& loader : loaders) {
+            oop::Ref mirror = loader->get_mirror();
+            if (mirror && !is_alive(mirror)) continue;
+            live.insert(loader.get());
+            worklist.push_back(loader.get());
+        }
+        while (!worklist.empty()) {
+            const ClassLoaderData* loader = worklist.back();
+            worklist.pop_back();
+            for (const auto* target : loader->get_dependencies()) {
+                if (live.insert(target).second) worklist.push_back(target);
+            }
+        }
+
+        auto split = std::stable_partition(loaders.begin(), loaders.end(), [&](const auto& loader) {
+            return live.contains(loader.get());
+        });
+        std::move(split, loaders.end(), std::back_inserter(dead));
+        loaders.erase(split, loaders.end());
+        notify = observers;
+    }
+    if (dead.empty()) return 0;
+
+    std::unordered_set<const ClassLoaderData*> unloading;
+    for (const auto& loader : dead) unloading.insert(loader.get());
+    auto klasses = dictionary.unlink(
+        [&](const ClassLoaderData* loader) { return unloading.contains(loader); });
+
+    std::vector<const InstanceKlass*> unlinked;
+    unlinked.reserve(klasses.size());
+    for (const auto& kls : klasses) unlinked.push_back(kls.get());
+    for (auto it = notify.rbegin(); it != notify.rend(); ++it) it->second(unlinked);
+
+    // the klasses first, they hand their blocks back to the metaspaces that
+    // are then released chunk by chunk with their loaders
+    klasses.clear();
+    std::size_t count = dead.size();
+    dead.clear();
+    return count;
+}
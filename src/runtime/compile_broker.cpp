@@ -0,0 +1,131 @@
+#include "runtime/compile_broker.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <string>
+
+namespace jvm {
+    using rt_jvm_data::InstanceKlass;
+    using rt_jvm_data::MethodWrapper;
+    using rt_jvm_data::Tier;
+
+    namespace {
+        // what the compiler threads go by: the hottest method first, as hot
+        // as it was when queued
+        inline std::uint64_t hotness(const MethodWrapper& method) noexcept {
+            return std::uint64_t{method.invocations.load(std::memory_order_relaxed)} +
+                   method.backedges.load(std::memory_order_relaxed);
+        }
+
+        inline Tier above(Tier tier) noexcept {
+            return static_cast<Tier>(static_cast<raw_jvm_type::u1>(tier) + 1);
+        }
+    }; // namespace
+
+    CompileBroker::CompileBroker(CompilePolicy policy_, rt_jvm_data::ClassLoaderDataGraph& graph_)
+        : policy(policy_), jit(graph_), graph(graph_) {
+        // added after the compiler's, so it runs first
+        observer = graph.add_unloading_observer(
+            [this](std::span<const InstanceKlass* const> klasses) { unload(klasses); });
+        for (std::size_t index = 0; index < std::max<std::size_t>(policy.threads, 1); index++) {
+            threads.emplace_back([this](std::stop_token stop) { work(stop); });
+        }
+    }
+
+    CompileBroker::~CompileBroker() {
+        graph.remove_unloading_observer(observer);
+        for (auto& thread : threads) thread.request_stop();
+        threads.clear();
+    }
+
+    void CompileBroker::submit(const MethodWrapper& method, Tier from) {
+        if (!JitCompiler::can_compile(method)) {
+            method.tier.store(Tier::Optimized, std::memory_order_relaxed);
+            return;
+        }
+        {
+            std::lock_guard lock(mtx);
+            // one thread moves the method up, however many see it hot; under
+            // the lock, so that wait_idle never sees it moved but not queued
+            if (!method.tier.compare_exchange_strong(from, above(from),
+                                                     std::memory_order_relaxed)) {
+                return;
+            }
+            // a method still queued is compiled for the tier it reached by then
+            if (!waiting.insert(&method).second) return;
+            push(method);
+        }
+        queued.notify_one();
+    }
+
+    void CompileBroker::push(const MethodWrapper& method) {
+        queue.push_back({hotness(method), &method});
+        std::push_heap(queue.begin(), queue.end());
+    }
+
+    void CompileBroker::work(std::stop_token stop) {
+        std::unique_lock lock(mtx);
+        while (true) {
+            if (!queued.wait(lock, stop, [this] { return !queue.empty(); })) return;
+            std::pop_heap(queue.begin(), queue.end());
+            const MethodWrapper& method = *queue.back().method;
+            queue.pop_back();
+            if (std::find(compiling.begin(), compiling.end(), &method) != compiling.end()) {
+                deferred.push_back(&method);
+                continue;
+            }
+            waiting.erase(&method);
+            compiling.push_back(&method);
+            lock.unlock();
+
+            Tier tier = method.tier.load(std::memory_order_relaxed);
+            bool compiled = false;
+            try {
+                compiled = jit.compile(method, tier,
+                                       tier == Tier::Baseline ? &policy.optimized : nullptr);
+            } catch (const std::exception& e) {
+                spdlog::error("can't compile {}.{}: {}", method.kls->get_klass_name(),
+                              method.name.view(), e.what());
+            }
+            // never queued again, whatever code it has stays
+            if (!compiled) method.tier.store(Tier::Optimized, std::memory_order_relaxed);
+
+            lock.lock();
+            compiling.erase(std::find(compiling.begin(), compiling.end(), &method));
+            // queued again while it was compiled, for its next tier
+            if (auto it = std::find(deferred.begin(), deferred.end(), &method);
+                it != deferred.end()) {
+                deferred.erase(it);
+                push(method);
+                queued.notify_one();
+            }
+            finished.notify_all();
+            if (queue.empty() && compiling.empty()) idle.notify_all();
+        }
+    }
+
+    void CompileBroker::unload(std::span<const InstanceKlass* const> klasses) {
+        std::unordered_set<const InstanceKlass*> unloading(klasses.begin(), klasses.end());
+        auto unloaded = [&](const MethodWrapper* method) {
+            return unloading.contains(method->kls);
+        };
+        std::unique_lock lock(mtx);
+        std::erase_if(queue, [&](const Queued& entry) { return unloaded(entry.method); });
+        std::make_heap(queue.begin(), queue.end());
+        std::erase_if(deferred, unloaded);
+        std::erase_if(waiting, unloaded);
+        // a compiler thread may still hold one; JitCompiler drops its code after
+        finished.wait(lock, [&] {
+            return std::none_of(compiling.begin(), compiling.end(), unloaded);
+        });
+        if (queue.empty() && compiling.empty()) idle.notify_all();
+    }
+
+    void CompileBroker::wait_idle() {
+        std::unique_lock lock(mtx);
+        idle.wait(lock, [this] { return queue.empty() && compiling.empty(); });
+    }
+}; // namespace jvm
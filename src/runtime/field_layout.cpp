@@ -0,0 +1,93 @@
+#include "runtime/field_layout.hpp"
+#include <array>
+#include <cassert>
+
+using namespace rt_jvm_data;
+using namespace raw_jvm_type;
+
+namespace {
+    // size classes widest first; index 0 holds references, index 1 other 8 byte fields
+    constexpr std::array<u4, 5> class_size = {8, 8, 4, 2, 1};
+
+    std::size_t class_of(const FieldShape& field) noexcept {
+        if (field.reference) return 0;
+        switch (field.size) {
+            case 8:
+                return 1;
+            case 4:
+                return 2;
+            case 2:
+                return 3;
+            default:
+                assert(field.size == 1);
+                return 4;
+        }
+    }
+
+    // Places one block of fields from `offset` on; returns its end. The first
+    // reference offset and the reference count go to `oops`.
+    u4 place_block(std::span<const FieldShape> fields, bool statics, u4 offset,
+                   std::span<u4> offsets, OopMapBlock& oops) {
+        std::array<std::vector<std::size_t>, class_size.size()> groups;
+        for (std::size_t index = 0; index < fields.size(); index++) {
+            if (fields[index].is_static != statics) continue;
+            groups[class_of(fields[index])].push_back(index);
+        }
+        std::array<std::size_t, class_size.size()> placed{};
+
+        auto place = [&](std::size_t group) {
+            offsets[groups[group][placed[group]++]] = offset;
+            offset += class_size[group];
+        };
+
+        oops = {0, static_cast<u4>(groups[0].size())};
+        for (std::size_t group = 0; group < class_size.size(); group++) {
+            if (placed[group] == groups[group].size()) continue;
+
+            u4 align = class_size[group];
+            // fill the hole before this group with the widest narrower fields that fit
+            while (offset % align != 0) {
+                u4 hole_end = (offset + align - 1) & ~(align - 1);
+                std::size_t filler = group + 1;
+                auto fits = [&](std::size_t candidate) {
+                    return placed[candidate] < groups[candidate].size() &&
+                           offset % class_size[candidate] == 0 &&
+                           offset + class_size[candidate] <= hole_end;
+                };
+                while (filler < class_size.size() && !fits(filler)) filler++;
+                if (filler == class_size.size()) {
+                    offset = hole_end;
+                    break;
+                }
+                place(filler);
+            }
+
+            if (group == 0) oops.offset = offset;
+            while (placed[group] < groups[group].size()) place(group);
+        }
+        return offset;
+    }
+}; // namespace
+
+FieldLayout rt_jvm_data::layout_fields(std::span<const FieldShape> fields, const FieldLayout* super,
+                                       std::span<u4> offsets) {
+    assert(offsets.size() == fields.size());
+    FieldLayout layout;
+    if (super != nullptr) layout.oop_maps = super->oop_maps;
+
+    OopMapBlock oops;
+    layout.instance_size =
+        place_block(fields, false, super == nullptr ? 0 : super->instance_size, offsets, oops);
+    if (oops.count != 0) {
+        auto& maps = layout.oop_maps;
+        if (!maps.empty() && maps.back().offset + 8 * maps.back().count == oops.offset) {
+            maps.back().count += oops.count;
+        } else {
+            maps.push_back(oops);
+        }
+    }
+
+    layout.static_size = place_block(fields, true, 0, offsets, oops);
+    layout.static_oop_count = oops.count;
+    return layout;
+}
@@ -0,0 +1,1678 @@
+#include "runtime/jit_compiler.hpp"
+
+#include "runtime/byte_code_helpers.hpp"
+#include "runtime/compile_broker.hpp"
+
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Intrinsics.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Transforms/InstCombine/InstCombine.h>
+#include <llvm/Transforms/Scalar/SimplifyCFG.h>
+#include <llvm/Transforms/Utils/Mem2Reg.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <initializer_list>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+
+namespace jvm {
+
+    using namespace raw_jvm_type;
+    using raw_jvm_data::ACC_ABSTRACT;
+    using raw_jvm_data::ACC_INTERFACE;
+    using raw_jvm_data::ACC_STATIC;
+    using raw_jvm_data::ACC_SYNCHRONIZED;
+    using raw_jvm_data::ACC_VOLATILE;
+    using rt_jvm_data::ArrayKlass;
+    using rt_jvm_data::CodeInfo;
+    using rt_jvm_data::CompiledCode;
+    using rt_jvm_data::CpCacheEntry;
+    using rt_jvm_data::InstanceKlass;
+    using rt_jvm_data::KlassType;
+    using rt_jvm_data::MethodWrapper;
+    using rt_jvm_data::PrimitiveKlass;
+    using rt_jvm_data::RawKlass;
+    using rt_jvm_data::Tier;
+    using rt_jvm_data::raw_value_type;
+    using Outcome = BytecodeEngine::Outcome;
+
+    namespace {
+        // where compiled code finds the parts of an object it reads itself
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Winvalid-offsetof"
+        constexpr std::size_t klass_offset = offsetof(oop::InstanceOop, kls_ptr);
+        constexpr std::size_t fields_offset = offsetof(oop::InstanceOop, bytes);
+        constexpr std::size_t length_offset = offsetof(oop::ArrayOop, length);
+        constexpr std::size_t components_offset = offsetof(oop::ArrayOop, bytes);
+        static_assert(offsetof(oop::ArrayOop, kls_ptr) == klass_offset);
+#pragma GCC diagnostic pop
+
+        // === 编译代码调用的运行时函数 ===
+
+        // Hands the activation to the interpreter at `pc`. `state` holds the
+        // locals, then `depth` operand stack slots.
+        oop::BasicOop* deoptimize(const MethodWrapper* method, const Runtime* runtime,
+                                  oop::BasicOop* thread, const Slot* state, u4 pc, u4 depth,
+                                  oop::BasicOop* exception, Slot* result) {
+            StackFrame frame(*method, oop::Ref(thread));
+            u2 max_locals = method->code_info->max_locals;
+            std::copy_n(state, max_locals, frame.locals());
+            std::copy_n(state + max_locals, depth, frame.stack());
+            frame.set_pc(pc);
+            frame.set_depth(static_cast<u2>(depth));
+            Outcome outcome = BytecodeEngine::resume(frame, *runtime, oop::Ref(exception));
+            *result = outcome.value;
+            return outcome.exception.get();
+        }
+
+        // how the invoke helper picks the method and how the call went
+        enum Selection : u4 { Direct, Virtual, Interface };
+        enum Status : u4 { Returned, Threw, Deoptimize };
+
+        // Selects the method for the receiver in arguments[0] like the
+        // interpreter does and calls it. Returns Threw with the exception in
+        // `result`, or Deoptimize before calling when the interpreter is to
+        // raise IncompatibleClassChangeError itself.
+        u4 invoke(const MethodWrapper* method, u4 selection, const Slot* arguments,
+                  const Runtime* runtime, oop::BasicOop* thread, Slot* result) {
+            if (selection != Direct) {
+                const RawKlass* type = type_of(reinterpret_cast<oop::BasicOop*>(arguments->raw));
+                if (type->get_klass_type() == KlassType::Instance) {
+                    auto* kls = static_cast<const InstanceKlass*>(type);
+                    if (selection == Interface && method->itable_index >= 0) {
+                        method = kls->select_interface(*method);
+                    } else if (method->vtable_index >= 0) {
+                        method = kls->select_virtual(method->vtable_index);
+                    }
+                }
+                if (method == nullptr) return Deoptimize;
+            }
+            Outcome outcome = BytecodeEngine::call(*method, arguments, *runtime, oop::Ref(thread));
+            if (outcome.exception) {
+                result->raw = reinterpret_cast<u8>(outcome.exception.get());
+                return Threw;
+            }
+            *result = outcome.value;
+            return Returned;
+        }
+
+        oop::BasicOop* allocate_instance(const InstanceKlass* kls, const Runtime* runtime) {
+            return runtime->heap
+                ->allocate_instance(kls, kls->get_field_layout().object_size())
+                .get();
+        }
+
+        oop::BasicOop* allocate_array(const ArrayKlass* kls, std::int32_t length,
+                                      const Runtime* runtime) {
+            return runtime->heap->allocate_array(kls, length, kls->component_size()).get();
+        }
+
+        u4 is_subtype(const RawKlass* from, const RawKlass* to) {
+            return BytecodeEngine::is_subtype(from, to);
+        }
+
+        // baseline code whose counters reached the thresholds it was compiled with
+        void tier_up(const MethodWrapper* method, const Runtime* runtime) {
+            if (runtime->compiler != nullptr) runtime->compiler->profile(*method);
+        }
+
+        // aastore: whether `value` may go into `array`
+        u4 is_storable(const oop::BasicOop* array, const oop::BasicOop* value) {
+            auto* kls = static_cast<const ArrayKlass*>(type_of(array));
+            return BytecodeEngine::is_subtype(type_of(value), kls->get_component());
+        }
+
+        // volatile fields are read and written as seq_cst atomics, which
+        // keeps LLVM from caching them in registers
+        inline bool volatile_field(const CpCacheEntry& entry) noexcept {
+            return entry.field != nullptr && (entry.field->fptr->access_flags & ACC_VOLATILE);
+        }
+
+        // === 字节码到 LLVM IR ===
+
+        // Builds the function for one method. Every local and operand stack
+        // slot is an i64 alloca holding the slot's raw bits, ints zero
+        // extended as in the interpreter; mem2reg turns them into SSA values.
+        // The operand stack depth of each instruction is known while
+        // translating, so no stack pointer is left at run time.
+        class Translator {
+          private:
+            const MethodWrapper& method;
+            const InstanceKlass& kls;
+            const CodeInfo& info;
+            // what the code counts toward, null for code that does not count
+            const TierThresholds* profile;
+            // the code as the class file has it, neither quickened nor fused
+            std::span<const u1> code;
+
+            llvm::LLVMContext& context;
+            llvm::IRBuilder<> ir;
+            llvm::Function* function = nullptr;
+            llvm::Type* i8;
+            llvm::Type* i16;
+            llvm::Type* i32;
+            llvm::Type* i64;
+            llvm::Type* f32;
+            llvm::Type* f64;
+            llvm::PointerType* pointer;
+            llvm::PointerType* slot_pointer;
+
+            llvm::Value* arguments = nullptr;
+            llvm::Value* runtime = nullptr;
+            llvm::Value* thread = nullptr;
+            llvm::Value* result = nullptr;
+            std::vector<llvm::AllocaInst*> locals;
+            std::vector<llvm::AllocaInst*> stack;
+            // what deoptimize and invoke take, the locals and stack or the arguments
+            llvm::AllocaInst* state = nullptr;
+            llvm::AllocaInst* call_arguments = nullptr;
+            llvm::AllocaInst* call_result = nullptr;
+
+            struct Block {
+                llvm::BasicBlock* block;
+                int depth;
+            };
+            std::vector<bool> leaders;
+            std::map<u4, Block> blocks;
+            std::vector<u4> pending;
+
+            // the instruction being translated and the stack depth before it
+            u4 pc = 0;
+            int start_depth = 0;
+            int depth = 0;
+            // where checks of the instruction deoptimize to, made on first use
+            llvm::BasicBlock* deopt = nullptr;
+            bool failed = false;
+
+          public:
+            Translator(const MethodWrapper& method_, llvm::Module& module, const std::string& name,
+                       const TierThresholds* profile_)
+                : method(method_), kls(*method_.kls), info(*method_.code_info), profile(profile_),
+                  code(info.code), context(module.getContext()), ir(context) {
+                i8 = ir.getInt8Ty();
+                i16 = ir.getInt16Ty();
+                i32 = ir.getInt32Ty();
+                i64 = ir.getInt64Ty();
+                f32 = ir.getFloatTy();
+                f64 = ir.getDoubleTy();
+                pointer = ir.getInt8PtrTy();
+                slot_pointer = i64->getPointerTo();
+
+                auto* type = llvm::FunctionType::get(
+                    pointer, {slot_pointer, pointer, pointer, slot_pointer}, false);
+                function = llvm::Function::Create(type, llvm::Function::ExternalLinkage, name,
+                                                  module);
+                // helpers called from the code may throw C++ exceptions
+                function->addFnAttr(llvm::Attribute::UWTable);
+                auto arg = function->arg_begin();
+                arguments = &*arg++;
+                runtime = &*arg++;
+                thread = &*arg++;
+                result = &*arg;
+            }
+
+            // false when the code cannot be compiled
+            bool translate() {
+                if (!find_leaders()) return false;
+                ir.SetInsertPoint(llvm::BasicBlock::Create(context, "entry", function));
+                u2 max_locals = info.max_locals;
+                u2 max_stack = info.max_stack;
+                for (u2 index = 0; index < max_locals; index++) {
+                    locals.push_back(ir.CreateAlloca(i64));
+                }
+                for (u2 index = 0; index < max_stack; index++) {
+                    stack.push_back(ir.CreateAlloca(i64));
+                }
+                state = ir.CreateAlloca(i64, ir.getInt32(max_locals + max_stack));
+                call_arguments = ir.CreateAlloca(i64, ir.getInt32(std::max<u2>(max_stack, 1)));
+                call_result = ir.CreateAlloca(i64);
+                u2 argument_slots = method.signature.argument_slots;
+                if (argument_slots > max_locals) return false;
+                for (u2 index = 0; index < max_locals; index++) {
+                    llvm::Value* value = ir.getInt64(0);
+                    if (index < argument_slots) {
+                        value = ir.CreateLoad(i64, ir.CreateConstGEP1_32(i64, arguments, index));
+                    }
+                    ir.CreateStore(value, locals[index]);
+                }
+                for (auto* slot : stack) ir.CreateStore(ir.getInt64(0), slot);
+                if (profile != nullptr) count(method.invocations, profile->invocations);
+                ir.CreateBr(block_at(0, 0));
+
+                while (!pending.empty() && !failed) {
+                    u4 at = pending.back();
+                    pending.pop_back();
+                    translate_block(at);
+                }
+                if (failed) return false;
+                if (llvm::verifyFunction(*function, &llvm::errs())) {
+                    throw std::runtime_error("JIT made invalid code for " +
+                                             kls.get_klass_name() + "." +
+                                             std::string(method.name.view()));
+                }
+                return true;
+            }
+
+          private:
+            // === 基本块 ===
+
+            // the length of the instruction at `at`, 0 when it runs past the end
+            u4 length_at(u4 at) const {
+                return static_cast<u4>(BytecodeEngine::instruction_length(code, at));
+            }
+
+            // every branch target of the instruction at `at`
+            std::vector<std::int64_t> targets(u4 at) const {
+                u1 opcode = code[at];
+                if ((opcode >= _ifeq && opcode <= _goto) || opcode == _ifnull ||
+                    opcode == _ifnonnull) {
+                    return {at + static_cast<std::int64_t>(s2_at(&code[at + 1]))};
+                }
+                if (opcode == _goto_w) {
+                    return {at + static_cast<std::int64_t>(s4_at(&code[at + 1]))};
+                }
+                std::vector<std::int64_t> result;
+                u4 operands = (at + 4) & ~3u;
+                if (opcode == _tableswitch) {
+                    std::int32_t low = s4_at(&code[operands + 4]);
+                    std::int32_t high = s4_at(&code[operands + 8]);
+                    result.push_back(at + static_cast<std::int64_t>(s4_at(&code[operands])));
+                    for (std::int64_t key = low; key <= high; key++) {
+                        u4 offset = operands + 12 + static_cast<u4>(key - low) * 4;
+                        result.push_back(at + static_cast<std::int64_t>(s4_at(&code[offset])));
+                    }
+                } else if (opcode == _lookupswitch) {
+                    std::int32_t pairs = s4_at(&code[operands + 4]);
+                    result.push_back(at + static_cast<std::int64_t>(s4_at(&code[operands])));
+                    for (std::int32_t index = 0; index < pairs; index++) {
+                        u4 offset = operands + 12 + static_cast<u4>(index) * 8;
+                        result.push_back(at + static_cast<std::int64_t>(s4_at(&code[offset])));
+                    }
+                }
+                return result;
+            }
+
+            // Marks where blocks start: branch targets and what follows a
+            // branch. False for code that does not decode.
+            bool find_leaders() {
+                leaders.assign(code.size(), false);
+                std::vector<bool> starts(code.size(), false);
+                std::vector<std::int64_t> all;
+                for (u4 at = 0; at < code.size();) {
+                    u4 length = length_at(at);
+                    if (length == 0) return false;
+                    starts[at] = true;
+                    auto found = targets(at);
+                    if (!found.empty() && at + length < code.size()) leaders[at + length] = true;
+                    all.insert(all.end(), found.begin(), found.end());
+                    at += length;
+                }
+                for (std::int64_t target : all) {
+                    if (target < 0 || target >= static_cast<std::int64_t>(code.size()) ||
+                        !starts[target]) {
+                        return false;
+                    }
+                    leaders[target] = true;
+                }
+                return true;
+            }
+
+            // the block at `target`, queued for translation the first time;
+            // every way into a block must agree on the stack depth
+            llvm::BasicBlock* block_at(u4 target, int entry_depth) {
+                auto it = blocks.find(target);
+                if (it != blocks.end()) {
+                    if (it->second.depth != entry_depth) failed = true;
+                    return it->second.block;
+                }
+                auto* block =
+                    llvm::BasicBlock::Create(context, "pc" + std::to_string(target), function);
+                blocks.emplace(target, Block{block, entry_depth});
+                pending.push_back(target);
+                return block;
+            }
+
+            void translate_block(u4 at) {
+                const Block& block = blocks.at(at);
+                ir.SetInsertPoint(block.block);
+                depth = block.depth;
+                while (true) {
+                    pc = at;
+                    start_depth = depth;
+                    deopt = nullptr;
+                    bool ended = instruction();
+                    if (failed || ended) return;
+                    at += length_at(at);
+                    if (at >= code.size()) {
+                        // falls off the end of the code
+                        failed = true;
+                        return;
+                    }
+                    if (leaders[at]) {
+                        ir.CreateBr(block_at(at, depth));
+                        return;
+                    }
+                }
+            }
+
+            // === 操作数栈与局部变量 ===
+
+            llvm::Value* pop() {
+                if (depth < 1) {
+                    failed = true;
+                    return ir.getInt64(0);
+                }
+                return ir.CreateLoad(i64, stack[--depth]);
+            }
+            void push(llvm::Value* raw) {
+                if (depth >= static_cast<int>(stack.size())) {
+                    failed = true;
+                    return;
+                }
+                ir.CreateStore(raw, stack[depth++]);
+            }
+            // long and double live in the first of their two slots
+            llvm::Value* pop2() {
+                if (depth < 2) {
+                    failed = true;
+                    return ir.getInt64(0);
+                }
+                depth -= 2;
+                return ir.CreateLoad(i64, stack[depth]);
+            }
+            void push2(llvm::Value* raw) {
+                if (depth + 2 > static_cast<int>(stack.size())) {
+                    failed = true;
+                    return;
+                }
+                ir.CreateStore(raw, stack[depth]);
+                depth += 2;
+            }
+            llvm::Value* pop_value(u1 slots) {
+                return slots == 2 ? pop2() : pop();
+            }
+            void push_value(llvm::Value* raw, u1 slots) {
+                if (slots == 2) {
+                    push2(raw);
+                } else {
+                    push(raw);
+                }
+            }
+
+            llvm::Value* pop_int() {
+                return ir.CreateTrunc(pop(), i32);
+            }
+            void push_int(llvm::Value* value) {
+                push(ir.CreateZExt(value, i64));
+            }
+            llvm::Value* pop_float() {
+                return ir.CreateBitCast(pop_int(), f32);
+            }
+            void push_float(llvm::Value* value) {
+                push_int(ir.CreateBitCast(value, i32));
+            }
+            llvm::Value* pop_double() {
+                return ir.CreateBitCast(pop2(), f64);
+            }
+            void push_double(llvm::Value* value) {
+                push2(ir.CreateBitCast(value, i64));
+            }
+
+            llvm::AllocaInst* local(u4 index) {
+                if (index >= locals.size()) {
+                    failed = true;
+                    return call_result;
+                }
+                return locals[index];
+            }
+
+            // the stack slot `from_top` below the top, without popping it
+            llvm::Value* peek(int from_top) {
+                if (depth - 1 - from_top < 0) {
+                    failed = true;
+                    return ir.getInt64(0);
+                }
+                return ir.CreateLoad(i64, stack[depth - 1 - from_top]);
+            }
+
+            // Replaces the top `count` slots, numbered from the deepest, by
+            // the slots `order` names: the dup and swap family.
+            void shuffle(int count, std::initializer_list<int> order) {
+                if (depth < count) {
+                    failed = true;
+                    return;
+                }
+                std::vector<llvm::Value*> taken;
+                for (int index = depth - count; index < depth; index++) {
+                    taken.push_back(ir.CreateLoad(i64, stack[index]));
+                }
+                depth -= count;
+                for (int index : order) push(taken[index]);
+            }
+
+            // === 常量与内存访问 ===
+
+            llvm::Value* address_constant(const void* address) {
+                return llvm::ConstantExpr::getIntToPtr(
+                    ir.getInt64(reinterpret_cast<std::uintptr_t>(address)), pointer);
+            }
+
+            // a call to a helper of this file by its address
+            llvm::Value* call(const void* helper, llvm::Type* returns,
+                              std::initializer_list<llvm::Value*> values) {
+                std::vector<llvm::Type*> types;
+                for (llvm::Value* value : values) types.push_back(value->getType());
+                auto* type = llvm::FunctionType::get(returns, types, false);
+                auto* callee = llvm::ConstantExpr::getIntToPtr(
+                    ir.getInt64(reinterpret_cast<std::uintptr_t>(helper)), type->getPointerTo());
+                return ir.CreateCall(type, callee, values);
+            }
+
+            // Adds one to `counter` like the interpreter, with relaxed loads
+            // and stores, and calls tier_up when it reaches `threshold` and
+            // at each power of two past it, like CompileBroker::due.
+            void count(std::atomic<u4>& counter, u4 threshold) {
+                llvm::Value* address = ir.CreateBitCast(address_constant(&counter),
+                                                        i32->getPointerTo());
+                auto* value = ir.CreateAlignedLoad(i32, address, llvm::Align(4));
+                value->setAtomic(llvm::AtomicOrdering::Monotonic);
+                llvm::Value* counted = ir.CreateAdd(value, ir.getInt32(1));
+                ir.CreateAlignedStore(counted, address, llvm::Align(4))
+                    ->setAtomic(llvm::AtomicOrdering::Monotonic);
+                auto* hot = llvm::BasicBlock::Create(context, "hot", function);
+                auto* next = llvm::BasicBlock::Create(context, "", function);
+                llvm::Value* power = ir.CreateICmpEQ(
+                    ir.CreateAnd(counted, ir.CreateSub(counted, ir.getInt32(1))), ir.getInt32(0));
+                llvm::Value* past = ir.CreateICmpUGT(counted, ir.getInt32(threshold));
+                llvm::Value* due = ir.CreateOr(ir.CreateICmpEQ(counted, ir.getInt32(threshold)),
+                                               ir.CreateAnd(power, past));
+                ir.CreateCondBr(due, hot, next);
+                ir.SetInsertPoint(hot);
+                call(reinterpret_cast<const void*>(&tier_up), ir.getVoidTy(),
+                     {address_constant(&method), runtime});
+                ir.CreateBr(next);
+                ir.SetInsertPoint(next);
+            }
+
+            // `base`, a raw reference, plus `offset` bytes
+            llvm::Value* at(llvm::Value* base, std::size_t offset) {
+                llvm::Value* object = base->getType() == pointer ? base
+                                                                 : ir.CreateIntToPtr(base, pointer);
+                return ir.CreateConstGEP1_64(i8, object, offset);
+            }
+
+            // a field or component of `type` as a slot, like load_value
+            llvm::Value* load(llvm::Value* address, raw_value_type type, bool is_volatile) {
+                llvm::Type* memory;
+                switch (type) {
+                    case raw_value_type::Jboolean:
+                    case raw_value_type::Jbyte:
+                        memory = i8;
+                        break;
+                    case raw_value_type::Jchar:
+                    case raw_value_type::Jshort:
+                        memory = i16;
+                        break;
+                    case raw_value_type::Jint:
+                    case raw_value_type::Jfloat:
+                        memory = i32;
+                        break;
+                    default:
+                        memory = i64;
+                        break;
+                }
+                auto* value = ir.CreateAlignedLoad(
+                    memory, ir.CreateBitCast(address, memory->getPointerTo()),
+                    llvm::Align(is_volatile ? memory->getIntegerBitWidth() / 8 : 1));
+                if (is_volatile) value->setAtomic(llvm::AtomicOrdering::SequentiallyConsistent);
+                switch (type) {
+                    case raw_value_type::Jbyte:
+                    case raw_value_type::Jshort:
+                        return ir.CreateZExt(ir.CreateSExt(value, i32), i64);
+                    default:
+                        return ir.CreateZExt(value, i64);
+                }
+            }
+
+            // ints narrowed to the field, booleans to their lowest bit
+            void store(llvm::Value* address, raw_value_type type, llvm::Value* raw,
+                       bool is_volatile) {
+                llvm::Value* value;
+                switch (type) {
+                    case raw_value_type::Jboolean:
+                        value = ir.CreateAnd(ir.CreateTrunc(raw, i8), 1);
+                        break;
+                    case raw_value_type::Jbyte:
+                        value = ir.CreateTrunc(raw, i8);
+                        break;
+                    case raw_value_type::Jchar:
+                    case raw_value_type::Jshort:
+                        value = ir.CreateTrunc(raw, i16);
+                        break;
+                    case raw_value_type::Jint:
+                    case raw_value_type::Jfloat:
+                        value = ir.CreateTrunc(raw, i32);
+                        break;
+                    default:
+                        value = raw;
+                        break;
+                }
+                store_bits(address, value, is_volatile);
+            }
+
+            void store_bits(llvm::Value* address, llvm::Value* value, bool is_volatile) {
+                llvm::Type* memory = value->getType();
+                auto* stored = ir.CreateAlignedStore(
+                    value, ir.CreateBitCast(address, memory->getPointerTo()),
+                    llvm::Align(is_volatile ? memory->getIntegerBitWidth() / 8 : 1));
+                if (is_volatile) stored->setAtomic(llvm::AtomicOrdering::SequentiallyConsistent);
+            }
+
+            // === 回到解释器 ===
+
+            // Stores the locals and the first `slots` stack slots in `state`,
+            // hands them to the interpreter at pc and returns what it returns.
+            void emit_deoptimize(int slots, llvm::Value* exception) {
+                for (std::size_t index = 0; index < locals.size(); index++) {
+                    ir.CreateStore(ir.CreateLoad(i64, locals[index]),
+                                   ir.CreateConstGEP1_64(i64, state, index));
+                }
+                for (int index = 0; index < slots; index++) {
+                    ir.CreateStore(ir.CreateLoad(i64, stack[index]),
+                                   ir.CreateConstGEP1_64(i64, state, locals.size() + index));
+                }
+                llvm::Value* thrown = call(reinterpret_cast<const void*>(&deoptimize), pointer,
+                                           {address_constant(&method), runtime, thread, state,
+                                            ir.getInt32(pc), ir.getInt32(slots), exception,
+                                            result});
+                ir.CreateRet(thrown);
+            }
+
+            // the block running the current instruction in the interpreter
+            // from its start
+            llvm::BasicBlock* deoptimize_block() {
+                if (deopt != nullptr) return deopt;
+                llvm::BasicBlock* current = ir.GetInsertBlock();
+                deopt = llvm::BasicBlock::Create(context, "deopt" + std::to_string(pc), function);
+                ir.SetInsertPoint(deopt);
+                emit_deoptimize(start_depth, llvm::ConstantPointerNull::get(pointer));
+                ir.SetInsertPoint(current);
+                return deopt;
+            }
+
+            // leaves the instruction to the interpreter when `condition` holds
+            void deoptimize_if(llvm::Value* condition) {
+                auto* next = llvm::BasicBlock::Create(context, "", function);
+                ir.CreateCondBr(condition, deoptimize_block(), next);
+                ir.SetInsertPoint(next);
+            }
+
+            // leaves the rest of the activation to the interpreter; ends the block
+            bool interpret() {
+                ir.CreateBr(deoptimize_block());
+                return true;
+            }
+
+            void null_check(llvm::Value* raw) {
+                deoptimize_if(ir.CreateICmpEQ(raw, ir.getInt64(0)));
+            }
+
+            // whether an exception at pc may be caught in this method
+            bool covered() const {
+                return std::any_of(info.exception_table.begin(), info.exception_table.end(),
+                                   [&](const auto& handler) {
+                                       return handler.start_pc <= pc && pc < handler.end_pc;
+                                   });
+            }
+
+            // === 指令 ===
+
+            bool branch(llvm::Value* condition, u4 target) {
+                u4 next = pc + length_at(pc);
+                if (profile == nullptr || target > pc) {
+                    ir.CreateCondBr(condition, block_at(target, depth), block_at(next, depth));
+                    return true;
+                }
+                auto* taken = llvm::BasicBlock::Create(context, "", function);
+                ir.CreateCondBr(condition, taken, block_at(next, depth));
+                ir.SetInsertPoint(taken);
+                return jump(target);
+            }
+
+            // a branch that does not go forward closes a loop
+            bool jump(u4 target) {
+                if (profile != nullptr && target <= pc) count(method.backedges, profile->backedges);
+                ir.CreateBr(block_at(target, depth));
+                return true;
+            }
+
+            bool compare_zero(llvm::CmpInst::Predicate predicate) {
+                llvm::Value* value = pop_int();
+                u4 target = static_cast<u4>(pc + s2_at(&code[pc + 1]));
+                return branch(ir.CreateICmp(predicate, value, ir.getInt32(0)), target);
+            }
+
+            bool compare_ints(llvm::CmpInst::Predicate predicate) {
+                llvm::Value* right = pop_int();
+                llvm::Value* left = pop_int();
+                u4 target = static_cast<u4>(pc + s2_at(&code[pc + 1]));
+                return branch(ir.CreateICmp(predicate, left, right), target);
+            }
+
+            bool compare_references(llvm::CmpInst::Predicate predicate) {
+                llvm::Value* right = pop();
+                llvm::Value* left = pop();
+                u4 target = static_cast<u4>(pc + s2_at(&code[pc + 1]));
+                return branch(ir.CreateICmp(predicate, left, right), target);
+            }
+
+            bool compare_null(llvm::CmpInst::Predicate predicate) {
+                llvm::Value* value = pop();
+                u4 target = static_cast<u4>(pc + s2_at(&code[pc + 1]));
+                return branch(ir.CreateICmp(predicate, value, ir.getInt64(0)), target);
+            }
+
+            bool table_switch() {
+                u4 operands = (pc + 4) & ~3u;
+                std::int32_t low = s4_at(&code[operands + 4]);
+                std::int32_t high = s4_at(&code[operands + 8]);
+                llvm::Value* key = pop_int();
+                auto* otherwise = block_at(pc + s4_at(&code[operands]), depth);
+                auto* instruction =
+                    ir.CreateSwitch(key, otherwise, static_cast<unsigned>(high - low + 1));
+                for (std::int64_t match = low; match <= high; match++) {
+                    u4 offset = operands + 12 + static_cast<u4>(match - low) * 4;
+                    instruction->addCase(ir.getInt32(static_cast<u4>(match)),
+                                         block_at(pc + s4_at(&code[offset]), depth));
+                }
+                return true;
+            }
+
+            bool lookup_switch() {
+                u4 operands = (pc + 4) & ~3u;
+                std::int32_t pairs = s4_at(&code[operands + 4]);
+                llvm::Value* key = pop_int();
+                auto* otherwise = block_at(pc + s4_at(&code[operands]), depth);
+                auto* instruction = ir.CreateSwitch(key, otherwise, static_cast<unsigned>(pairs));
+                for (std::int32_t index = 0; index < pairs; index++) {
+                    u4 offset = operands + 8 + static_cast<u4>(index) * 8;
+                    auto match = static_cast<u4>(s4_at(&code[offset]));
+                    // javac never repeats a key; a repeated one is dead
+                    if (instruction->findCaseValue(ir.getInt32(match)) !=
+                        instruction->case_default()) {
+                        continue;
+                    }
+                    instruction->addCase(ir.getInt32(match),
+                                         block_at(pc + s4_at(&code[offset + 4]), depth));
+                }
+                return true;
+            }
+
+            bool return_value(u1 slots) {
+                llvm::Value* value = slots == 0 ? ir.getInt64(0) : pop_value(slots);
+                ir.CreateStore(value, result);
+                ir.CreateRet(llvm::ConstantPointerNull::get(pointer));
+                return true;
+            }
+
+            // idiv, irem, ldiv and lrem; the interpreter throws for a zero divisor
+            void divide(llvm::Type* type, bool remainder) {
+                llvm::Value* divisor = type == i32 ? pop_int() : pop2();
+                llvm::Value* dividend = type == i32 ? pop_int() : pop2();
+                deoptimize_if(ir.CreateICmpEQ(divisor, llvm::ConstantInt::get(type, 0)));
+                // MIN_VALUE / -1 overflows to MIN_VALUE, which sdiv leaves undefined
+                llvm::Value* minus_one =
+                    ir.CreateICmpEQ(divisor, llvm::ConstantInt::getSigned(type, -1));
+                llvm::Value* safe =
+                    ir.CreateSelect(minus_one, llvm::ConstantInt::get(type, 1), divisor);
+                llvm::Value* value =
+                    remainder
+                        ? ir.CreateSelect(minus_one, llvm::ConstantInt::get(type, 0),
+                                          ir.CreateSRem(dividend, safe))
+                        : ir.CreateSelect(minus_one, ir.CreateNeg(dividend),
+                                          ir.CreateSDiv(dividend, safe));
+                if (type == i32) {
+                    push_int(value);
+                } else {
+                    push2(value);
+                }
+            }
+
+            // fcmpl and dcmpl push -1 for NaN, fcmpg and dcmpg 1
+            void compare_floats(llvm::Type* type, std::int32_t nan) {
+                llvm::Value* right = type == f32 ? pop_float() : pop_double();
+                llvm::Value* left = type == f32 ? pop_float() : pop_double();
+                llvm::Value* value = ir.CreateSelect(
+                    ir.CreateFCmpOGT(left, right), ir.getInt32(1),
+                    ir.CreateSelect(ir.CreateFCmpOEQ(left, right), ir.getInt32(0),
+                                    ir.CreateSelect(ir.CreateFCmpOLT(left, right),
+                                                    ir.getInt32(static_cast<u4>(-1)),
+                                                    ir.getInt32(static_cast<u4>(nan)))));
+                push_int(value);
+            }
+
+            // f2i and the like: NaN is 0, out of range values saturate
+            llvm::Value* saturate(llvm::Value* value, llvm::Type* to) {
+                return ir.CreateIntrinsic(llvm::Intrinsic::fptosi_sat, {to, value->getType()},
+                                          {value});
+            }
+
+            // the address of a component of `size` bytes, after checking the
+            // array for null and the index against its length
+            llvm::Value* component(llvm::Value* array, llvm::Value* index, u4 size) {
+                null_check(array);
+                llvm::Value* length =
+                    ir.CreateAlignedLoad(i32, ir.CreateBitCast(at(array, length_offset),
+                                                               i32->getPointerTo()),
+                                         llvm::Align(4));
+                deoptimize_if(ir.CreateICmpUGE(index, length));
+                llvm::Value* offset = ir.CreateMul(ir.CreateZExt(index, i64), ir.getInt64(size));
+                return ir.CreateGEP(i8, at(array, components_offset), offset);
+            }
+
+            void array_load(raw_value_type type) {
+                llvm::Value* index = pop_int();
+                llvm::Value* array = pop();
+                llvm::Value* address = component(array, index, rt_jvm_data::type_size_of(type));
+                push_value(load(address, type, false), slots_of(type));
+            }
+
+            void array_store(raw_value_type type) {
+                llvm::Value* value = pop_value(slots_of(type));
+                llvm::Value* index = pop_int();
+                llvm::Value* array = pop();
+                llvm::Value* address = component(array, index, rt_jvm_data::type_size_of(type));
+                store(address, type, value, false);
+            }
+
+            llvm::Value* klass_of(llvm::Value* object) {
+                return ir.CreateAlignedLoad(
+                    i64, ir.CreateBitCast(at(object, klass_offset), slot_pointer), llvm::Align(8));
+            }
+
+            // the entry at the u2 operand, null when nothing resolved it yet
+            const CpCacheEntry* entry() const {
+                return kls.find_resolved(u2_at(&code[pc + 1]));
+            }
+
+            bool load_constant(u2 index) {
+                switch (kls.get_constant_tag(index)) {
+                    case raw_jvm_data::CONSTANT_Integer:
+                    case raw_jvm_data::CONSTANT_Float:
+                        push(ir.getInt64(kls.get_constant_bits(index)));
+                        return false;
+                    case raw_jvm_data::CONSTANT_String:
+                    case raw_jvm_data::CONSTANT_Class: {
+                        const CpCacheEntry* constant = kls.find_resolved(index);
+                        const oop::BasicOop* reference = nullptr;
+                        if (constant != nullptr && constant->string) {
+                            reference = constant->string.get();
+                        } else if (const RawKlass* type = class_type(constant)) {
+                            reference = type->get_ref().get();
+                        }
+                        if (reference == nullptr) return interpret();
+                        push(ir.getInt64(reinterpret_cast<std::uintptr_t>(reference)));
+                        return false;
+                    }
+                    default:
+                        return interpret();
+                }
+            }
+
+            bool static_field(bool put) {
+                const CpCacheEntry* field = entry();
+                // the interpreter raises IncompatibleClassChangeError for an instance field
+                if (field == nullptr || field->klass == nullptr || !field->field->is_static() ||
+                    !field->klass->is_initialized()) {
+                    return interpret();
+                }
+                bool is_volatile = volatile_field(*field);
+                llvm::Value* address =
+                    address_constant(field->klass->get_statics() + field->offset);
+                if (put) {
+                    store(address, field->type, pop_value(slots_of(field->type)), is_volatile);
+                } else {
+                    push_value(load(address, field->type, is_volatile), slots_of(field->type));
+                }
+                return false;
+            }
+
+            bool instance_field(bool put) {
+                const CpCacheEntry* field = entry();
+                if (field == nullptr || field->field->is_static()) return interpret();
+                bool is_volatile = volatile_field(*field);
+                u1 slots = slots_of(field->type);
+                llvm::Value* value = put ? pop_value(slots) : nullptr;
+                llvm::Value* object = pop();
+                null_check(object);
+                llvm::Value* address = at(object, fields_offset + field->offset);
+                if (put) {
+                    store(address, field->type, value, is_volatile);
+                } else {
+                    push_value(load(address, field->type, is_volatile), slots);
+                }
+                return false;
+            }
+
+            // Calls `target` on the arguments at the top of the stack through
+            // the invoke helper. An exception a handler here may catch goes to
+            // the interpreter, any other one leaves the method.
+            bool invoke(const MethodWrapper& target, Selection selection) {
+                u2 slots = target.signature.argument_slots;
+                if (slots > depth) {
+                    failed = true;
+                    return true;
+                }
+                bool has_receiver = !(target.mptr->access_flags & ACC_STATIC);
+                if (has_receiver) null_check(peek(slots - 1));
+                for (u2 index = 0; index < slots; index++) {
+                    ir.CreateStore(ir.CreateLoad(i64, stack[depth - slots + index]),
+                                   ir.CreateConstGEP1_32(i64, call_arguments, index));
+                }
+                llvm::Value* status =
+                    call(reinterpret_cast<const void*>(&jvm::invoke), i32,
+                         {address_constant(&target), ir.getInt32(selection), call_arguments,
+                          runtime, thread, call_result});
+
+                auto* returned = llvm::BasicBlock::Create(context, "", function);
+                auto* threw = llvm::BasicBlock::Create(context, "", function);
+                auto* instruction = ir.CreateSwitch(status, deoptimize_block(), 2);
+                instruction->addCase(ir.getInt32(Returned), returned);
+                instruction->addCase(ir.getInt32(Threw), threw);
+
+                ir.SetInsertPoint(threw);
+                llvm::Value* exception =
+                    ir.CreateIntToPtr(ir.CreateLoad(i64, call_result), pointer);
+                if (covered()) {
+                    emit_deoptimize(start_depth, exception);
+                } else {
+                    ir.CreateRet(exception);
+                }
+
+                ir.SetInsertPoint(returned);
+                depth -= slots;
+                if (u1 returns = target.signature.return_slots()) {
+                    push_value(ir.CreateLoad(i64, call_result), returns);
+                }
+                return false;
+            }
+
+            // The method an invokevirtual, invokespecial or invokeinterface
+            // resolved to. Null when it is not resolved yet or is static,
+            // which the interpreter throws for.
+            const MethodWrapper* instance_method() const {
+                const CpCacheEntry* target = entry();
+                if (target == nullptr || target->method == nullptr ||
+                    target->method->mptr->access_flags & ACC_STATIC) {
+                    return nullptr;
+                }
+                return target->method;
+            }
+
+            bool new_instance() {
+                const CpCacheEntry* type = entry();
+                if (type == nullptr || type->klass == nullptr ||
+                    type->klass->get_access_flags() & (ACC_INTERFACE | ACC_ABSTRACT) ||
+                    !type->klass->is_initialized()) {
+                    return interpret();
+                }
+                push(ir.CreatePtrToInt(
+                    call(reinterpret_cast<const void*>(&allocate_instance), pointer,
+                         {address_constant(type->klass), runtime}),
+                    i64));
+                return false;
+            }
+
+            void new_array(const ArrayKlass* array_klass) {
+                llvm::Value* count = pop_int();
+                deoptimize_if(ir.CreateICmpSLT(count, ir.getInt32(0)));
+                push(ir.CreatePtrToInt(
+                    call(reinterpret_cast<const void*>(&allocate_array), pointer,
+                         {address_constant(array_klass), count, runtime}),
+                    i64));
+            }
+
+            // whether the non-null `object` is a `target`, without a call
+            // when it is one exactly
+            llvm::Value* is_instance(llvm::Value* object, const RawKlass* target) {
+                llvm::Value* type = klass_of(object);
+                llvm::Value* expected = ir.getInt64(reinterpret_cast<std::uintptr_t>(target));
+                llvm::BasicBlock* from = ir.GetInsertBlock();
+                auto* slow = llvm::BasicBlock::Create(context, "", function);
+                auto* done = llvm::BasicBlock::Create(context, "", function);
+                ir.CreateCondBr(ir.CreateICmpEQ(type, expected), done, slow);
+                ir.SetInsertPoint(slow);
+                llvm::Value* answer = ir.CreateICmpNE(
+                    call(reinterpret_cast<const void*>(&is_subtype), i32,
+                         {ir.CreateIntToPtr(type, pointer), address_constant(target)}),
+                    ir.getInt32(0));
+                ir.CreateBr(done);
+                ir.SetInsertPoint(done);
+                auto* phi = ir.CreatePHI(ir.getInt1Ty(), 2);
+                phi->addIncoming(ir.getTrue(), from);
+                phi->addIncoming(answer, slow);
+                return phi;
+            }
+
+            bool check_cast(bool push_answer) {
+                const RawKlass* target = class_type(entry());
+                if (target == nullptr) return interpret();
+                llvm::Value* object = push_answer ? pop() : peek(0);
+                llvm::BasicBlock* from = ir.GetInsertBlock();
+                auto* test = llvm::BasicBlock::Create(context, "", function);
+                auto* done = llvm::BasicBlock::Create(context, "", function);
+                ir.CreateCondBr(ir.CreateICmpEQ(object, ir.getInt64(0)), done, test);
+                ir.SetInsertPoint(test);
+                llvm::Value* answer = is_instance(object, target);
+                if (!push_answer) deoptimize_if(ir.CreateNot(answer));
+                llvm::BasicBlock* tested = ir.GetInsertBlock();
+                ir.CreateBr(done);
+                ir.SetInsertPoint(done);
+                if (push_answer) {
+                    auto* phi = ir.CreatePHI(ir.getInt1Ty(), 2);
+                    phi->addIncoming(ir.getFalse(), from);
+                    phi->addIncoming(answer, tested);
+                    push_int(phi);
+                }
+                return false;
+            }
+
+            void reference_array_store() {
+                llvm::Value* value = pop();
+                llvm::Value* index = pop_int();
+                llvm::Value* array = pop();
+                llvm::Value* address = component(array, index, sizeof(oop::BasicOop*));
+                auto* check = llvm::BasicBlock::Create(context, "", function);
+                auto* done = llvm::BasicBlock::Create(context, "", function);
+                ir.CreateCondBr(ir.CreateICmpEQ(value, ir.getInt64(0)), done, check);
+                ir.SetInsertPoint(check);
+                llvm::Value* storable =
+                    call(reinterpret_cast<const void*>(&is_storable), i32,
+                         {ir.CreateIntToPtr(array, pointer), ir.CreateIntToPtr(value, pointer)});
+                deoptimize_if(ir.CreateICmpEQ(storable, ir.getInt32(0)));
+                ir.CreateBr(done);
+                ir.SetInsertPoint(done);
+                store_bits(address, value, false);
+            }
+
+            // byte and boolean arrays share bastore, booleans keep the lowest bit
+            void byte_array_store() {
+                static const ArrayKlass* booleans =
+                    PrimitiveKlass::of(raw_value_type::Jboolean).array_of();
+                llvm::Value* value = ir.CreateTrunc(pop(), i8);
+                llvm::Value* index = pop_int();
+                llvm::Value* array = pop();
+                llvm::Value* address = component(array, index, 1);
+                llvm::Value* is_boolean = ir.CreateICmpEQ(
+                    klass_of(array), ir.getInt64(reinterpret_cast<std::uintptr_t>(booleans)));
+                store_bits(address, ir.CreateSelect(is_boolean, ir.CreateAnd(value, 1), value),
+                           false);
+            }
+
+            // Translates the instruction at pc; true when it ended the block.
+            bool instruction() {
+                u1 opcode = code[pc];
+                switch (opcode) {
+                    case _nop:
+                        return false;
+                    case _aconst_null:
+                        push(ir.getInt64(0));
+                        return false;
+                    case _iconst_m1:
+                    case _iconst_0:
+                    case _iconst_1:
+                    case _iconst_2:
+                    case _iconst_3:
+                    case _iconst_4:
+                    case _iconst_5:
+                        push_int(ir.getInt32(static_cast<u4>(opcode - _iconst_0)));
+                        return false;
+                    case _lconst_0:
+                    case _lconst_1:
+                        push2(ir.getInt64(opcode - _lconst_0));
+                        return false;
+                    case _fconst_0:
+                    case _fconst_1:
+                    case _fconst_2:
+                        push_float(llvm::ConstantFP::get(f32, opcode - _fconst_0));
+                        return false;
+                    case _dconst_0:
+                    case _dconst_1:
+                        push_double(llvm::ConstantFP::get(f64, opcode - _dconst_0));
+                        return false;
+                    case _bipush:
+                        push_int(
+                            ir.getInt32(static_cast<u4>(static_cast<std::int8_t>(code[pc + 1]))));
+                        return false;
+                    case _sipush:
+                        push_int(ir.getInt32(static_cast<u4>(s2_at(&code[pc + 1]))));
+                        return false;
+                    case _ldc:
+                        return load_constant(code[pc + 1]);
+                    case _ldc_w:
+                        return load_constant(u2_at(&code[pc + 1]));
+                    case _ldc2_w:
+                        push2(ir.getInt64(kls.get_constant_wide_bits(u2_at(&code[pc + 1]))));
+                        return false;
+
+                    case _iload:
+                    case _fload:
+                    case _aload:
+                        push(ir.CreateLoad(i64, local(code[pc + 1])));
+                        return false;
+                    case _lload:
+                    case _dload:
+                        push2(ir.CreateLoad(i64, local(code[pc + 1])));
+                        return false;
+                    case _iload_0:
+                    case _iload_1:
+                    case _iload_2:
+                    case _iload_3:
+                        push(ir.CreateLoad(i64, local(opcode - _iload_0)));
+                        return false;
+                    case _lload_0:
+                    case _lload_1:
+                    case _lload_2:
+                    case _lload_3:
+                        push2(ir.CreateLoad(i64, local(opcode - _lload_0)));
+                        return false;
+                    case _fload_0:
+                    case _fload_1:
+                    case _fload_2:
+                    case _fload_3:
+                        push(ir.CreateLoad(i64, local(opcode - _fload_0)));
+                        return false;
+                    case _dload_0:
+                    case _dload_1:
+                    case _dload_2:
+                    case _dload_3:
+                        push2(ir.CreateLoad(i64, local(opcode - _dload_0)));
+                        return false;
+                    case _aload_0:
+                    case _aload_1:
+                    case _aload_2:
+                    case _aload_3:
+                        push(ir.CreateLoad(i64, local(opcode - _aload_0)));
+                        return false;
+
+                    case _iaload:
+                        array_load(raw_value_type::Jint);
+                        return false;
+                    case _laload:
+                        array_load(raw_value_type::Jlong);
+                        return false;
+                    case _faload:
+                        array_load(raw_value_type::Jfloat);
+                        return false;
+                    case _daload:
+                        array_load(raw_value_type::Jdouble);
+                        return false;
+                    case _aaload:
+                        array_load(raw_value_type::Jreference);
+                        return false;
+                    case _baload:
+                        // booleans hold 0 or 1, which loads the same either way
+                        array_load(raw_value_type::Jbyte);
+                        return false;
+                    case _caload:
+                        array_load(raw_value_type::Jchar);
+                        return false;
+                    case _saload:
+                        array_load(raw_value_type::Jshort);
+                        return false;
+
+                    case _istore:
+                    case _fstore:
+                    case _astore:
+                        ir.CreateStore(pop(), local(code[pc + 1]));
+                        return false;
+                    case _lstore:
+                    case _dstore:
+                        ir.CreateStore(pop2(), local(code[pc + 1]));
+                        return false;
+                    case _istore_0:
+                    case _istore_1:
+                    case _istore_2:
+                    case _istore_3:
+                        ir.CreateStore(pop(), local(opcode - _istore_0));
+                        return false;
+                    case _lstore_0:
+                    case _lstore_1:
+                    case _lstore_2:
+                    case _lstore_3:
+                        ir.CreateStore(pop2(), local(opcode - _lstore_0));
+                        return false;
+                    case _fstore_0:
+                    case _fstore_1:
+                    case _fstore_2:
+                    case _fstore_3:
+                        ir.CreateStore(pop(), local(opcode - _fstore_0));
+                        return false;
+                    case _dstore_0:
+                    case _dstore_1:
+                    case _dstore_2:
+                    case _dstore_3:
+                        ir.CreateStore(pop2(), local(opcode - _dstore_0));
+                        return false;
+                    case _astore_0:
+                    case _astore_1:
+                    case _astore_2:
+                    case _astore_3:
+                        ir.CreateStore(pop(), local(opcode - _astore_0));
+                        return false;
+
+                    case _iastore:
+                        array_store(raw_value_type::Jint);
+                        return false;
+                    case _lastore:
+                        array_store(raw_value_type::Jlong);
+                        return false;
+                    case _fastore:
+                        array_store(raw_value_type::Jfloat);
+                        return false;
+                    case _dastore:
+                        array_store(raw_value_type::Jdouble);
+                        return false;
+                    case _aastore:
+                        reference_array_store();
+                        return false;
+                    case _bastore:
+                        byte_array_store();
+                        return false;
+                    case _castore:
+                        array_store(raw_value_type::Jchar);
+                        return false;
+                    case _sastore:
+                        array_store(raw_value_type::Jshort);
+                        return false;
+
+                    case _pop:
+                        pop();
+                        return false;
+                    case _pop2:
+                        pop2();
+                        return false;
+                    case _dup:
+                        shuffle(1, {0, 0});
+                        return false;
+                    case _dup_x1:
+                        shuffle(2, {1, 0, 1});
+                        return false;
+                    case _dup_x2:
+                        shuffle(3, {2, 0, 1, 2});
+                        return false;
+                    case _dup2:
+                        shuffle(2, {0, 1, 0, 1});
+                        return false;
+                    case _dup2_x1:
+                        shuffle(3, {1, 2, 0, 1, 2});
+                        return false;
+                    case _dup2_x2:
+                        shuffle(4, {2, 3, 0, 1, 2, 3});
+                        return false;
+                    case _swap:
+                        shuffle(2, {1, 0});
+                        return false;
+
+                    case _iadd:
+                    case _isub:
+                    case _imul:
+                    case _iand:
+                    case _ior:
+                    case _ixor: {
+                        llvm::Value* right = pop_int();
+                        llvm::Value* left = pop_int();
+                        push_int(integer_operation(opcode, left, right));
+                        return false;
+                    }
+                    case _ladd:
+                    case _lsub:
+                    case _lmul:
+                    case _land:
+                    case _lor:
+                    case _lxor: {
+                        llvm::Value* right = pop2();
+                        llvm::Value* left = pop2();
+                        push2(integer_operation(opcode - 1, left, right));
+                        return false;
+                    }
+                    case _fadd:
+                    case _fsub:
+                    case _fmul:
+                    case _fdiv:
+                    case _frem: {
+                        llvm::Value* right = pop_float();
+                        llvm::Value* left = pop_float();
+                        push_float(float_operation(opcode, left, right));
+                        return false;
+                    }
+                    case _dadd:
+                    case _dsub:
+                    case _dmul:
+                    case _ddiv:
+                    case _drem: {
+                        llvm::Value* right = pop_double();
+                        llvm::Value* left = pop_double();
+                        push_double(float_operation(opcode - 1, left, right));
+                        return false;
+                    }
+                    case _idiv:
+                        divide(i32, false);
+                        return false;
+                    case _ldiv:
+                        divide(i64, false);
+                        return false;
+                    case _irem:
+                        divide(i32, true);
+                        return false;
+                    case _lrem:
+                        divide(i64, true);
+                        return false;
+                    case _ineg:
+                        push_int(ir.CreateNeg(pop_int()));
+                        return false;
+                    case _lneg:
+                        push2(ir.CreateNeg(pop2()));
+                        return false;
+                    case _fneg:
+                        push_float(ir.CreateFNeg(pop_float()));
+                        return false;
+                    case _dneg:
+                        push_double(ir.CreateFNeg(pop_double()));
+                        return false;
+
+                    case _ishl:
+                    case _ishr:
+                    case _iushr: {
+                        llvm::Value* amount = ir.CreateAnd(pop_int(), 31);
+                        llvm::Value* value = pop_int();
+                        push_int(shift(opcode - _ishl, value, amount));
+                        return false;
+                    }
+                    case _lshl:
+                    case _lshr:
+                    case _lushr: {
+                        llvm::Value* amount = ir.CreateZExt(ir.CreateAnd(pop_int(), 63), i64);
+                        llvm::Value* value = pop2();
+                        push2(shift(opcode - _lshl, value, amount));
+                        return false;
+                    }
+                    case _iinc: {
+                        llvm::AllocaInst* slot = local(code[pc + 1]);
+                        auto increment = static_cast<std::int8_t>(code[pc + 2]);
+                        llvm::Value* value = ir.CreateTrunc(ir.CreateLoad(i64, slot), i32);
+                        value = ir.CreateAdd(value, ir.getInt32(static_cast<u4>(increment)));
+                        ir.CreateStore(ir.CreateZExt(value, i64), slot);
+                        return false;
+                    }
+
+                    case _i2l:
+                        push2(ir.CreateSExt(pop_int(), i64));
+                        return false;
+                    case _i2f:
+                        push_float(ir.CreateSIToFP(pop_int(), f32));
+                        return false;
+                    case _i2d:
+                        push_double(ir.CreateSIToFP(pop_int(), f64));
+                        return false;
+                    case _l2i:
+                        push_int(ir.CreateTrunc(pop2(), i32));
+                        return false;
+                    case _l2f:
+                        push_float(ir.CreateSIToFP(pop2(), f32));
+                        return false;
+                    case _l2d:
+                        push_double(ir.CreateSIToFP(pop2(), f64));
+                        return false;
+                    case _f2i:
+                        push_int(saturate(pop_float(), i32));
+                        return false;
+                    case _f2l:
+                        push2(saturate(pop_float(), i64));
+                        return false;
+                    case _f2d:
+                        push_double(ir.CreateFPExt(pop_float(), f64));
+                        return false;
+                    case _d2i:
+                        push_int(saturate(pop_double(), i32));
+                        return false;
+                    case _d2l:
+                        push2(saturate(pop_double(), i64));
+                        return false;
+                    case _d2f:
+                        push_float(ir.CreateFPTrunc(pop_double(), f32));
+                        return false;
+                    case _i2b:
+                        push_int(ir.CreateSExt(ir.CreateTrunc(pop_int(), i8), i32));
+                        return false;
+                    case _i2c:
+                        push_int(ir.CreateAnd(pop_int(), 0xFFFF));
+                        return false;
+                    case _i2s:
+                        push_int(ir.CreateSExt(ir.CreateTrunc(pop_int(), i16), i32));
+                        return false;
+
+                    case _lcmp: {
+                        llvm::Value* right = pop2();
+                        llvm::Value* left = pop2();
+                        push_int(ir.CreateSub(ir.CreateZExt(ir.CreateICmpSGT(left, right), i32),
+                                              ir.CreateZExt(ir.CreateICmpSLT(left, right), i32)));
+                        return false;
+                    }
+                    case _fcmpl:
+                        compare_floats(f32, -1);
+                        return false;
+                    case _fcmpg:
+                        compare_floats(f32, 1);
+                        return false;
+                    case _dcmpl:
+                        compare_floats(f64, -1);
+                        return false;
+                    case _dcmpg:
+                        compare_floats(f64, 1);
+                        return false;
+
+                    case _ifeq:
+                        return compare_zero(llvm::CmpInst::ICMP_EQ);
+                    case _ifne:
+                        return compare_zero(llvm::CmpInst::ICMP_NE);
+                    case _iflt:
+                        return compare_zero(llvm::CmpInst::ICMP_SLT);
+                    case _ifge:
+                        return compare_zero(llvm::CmpInst::ICMP_SGE);
+                    case _ifgt:
+                        return compare_zero(llvm::CmpInst::ICMP_SGT);
+                    case _ifle:
+                        return compare_zero(llvm::CmpInst::ICMP_SLE);
+                    case _if_icmpeq:
+                        return compare_ints(llvm::CmpInst::ICMP_EQ);
+                    case _if_icmpne:
+                        return compare_ints(llvm::CmpInst::ICMP_NE);
+                    case _if_icmplt:
+                        return compare_ints(llvm::CmpInst::ICMP_SLT);
+                    case _if_icmpge:
+                        return compare_ints(llvm::CmpInst::ICMP_SGE);
+                    case _if_icmpgt:
+                        return compare_ints(llvm::CmpInst::ICMP_SGT);
+                    case _if_icmple:
+                        return compare_ints(llvm::CmpInst::ICMP_SLE);
+                    case _if_acmpeq:
+                        return compare_references(llvm::CmpInst::ICMP_EQ);
+                    case _if_acmpne:
+                        return compare_references(llvm::CmpInst::ICMP_NE);
+                    case _ifnull:
+                        return compare_null(llvm::CmpInst::ICMP_EQ);
+                    case _ifnonnull:
+                        return compare_null(llvm::CmpInst::ICMP_NE);
+                    case _goto:
+                        return jump(static_cast<u4>(pc + s2_at(&code[pc + 1])));
+                    case _goto_w:
+                        return jump(static_cast<u4>(pc + s4_at(&code[pc + 1])));
+                    case _tableswitch:
+                        return table_switch();
+                    case _lookupswitch:
+                        return lookup_switch();
+
+                    case _ireturn:
+                    case _freturn:
+                    case _areturn:
+                        return return_value(1);
+                    case _lreturn:
+                    case _dreturn:
+                        return return_value(2);
+                    case _return:
+                        return return_value(0);
+
+                    case _getstatic:
+                        return static_field(false);
+                    case _putstatic:
+                        return static_field(true);
+                    case _getfield:
+                        return instance_field(false);
+                    case _putfield:
+                        return instance_field(true);
+
+                    case _invokevirtual: {
+                        const MethodWrapper* callee = instance_method();
+                        if (callee == nullptr) return interpret();
+                        return invoke(*callee, callee->vtable_index < 0 ? Direct : Virtual);
+                    }
+                    case _invokespecial: {
+                        if (instance_method() == nullptr) return interpret();
+                        return invoke(*entry()->special, Direct);
+                    }
+                    case _invokestatic: {
+                        const CpCacheEntry* target = entry();
+                        if (target == nullptr || target->method == nullptr ||
+                            !(target->method->mptr->access_flags & ACC_STATIC) ||
+                            !target->method->kls->is_initialized()) {
+                            return interpret();
+                        }
+                        return invoke(*target->method, Direct);
+                    }
+                    case _invokeinterface: {
+                        const MethodWrapper* callee = instance_method();
+                        if (callee == nullptr) return interpret();
+                        return invoke(*callee, Interface);
+                    }
+
+                    case _new:
+                        return new_instance();
+                    case _newarray: {
+                        static const raw_value_type types[] = {
+                            raw_value_type::Jboolean, raw_value_type::Jchar,
+                            raw_value_type::Jfloat,   raw_value_type::Jdouble,
+                            raw_value_type::Jbyte,    raw_value_type::Jshort,
+                            raw_value_type::Jint,     raw_value_type::Jlong};
+                        u1 type = code[pc + 1];
+                        if (type < 4 || type > 11) return interpret();
+                        new_array(PrimitiveKlass::of(types[type - 4]).array_of());
+                        return false;
+                    }
+                    case _anewarray: {
+                        const RawKlass* type = class_type(entry());
+                        if (type == nullptr) return interpret();
+                        new_array(type->array_of());
+                        return false;
+                    }
+                    case _arraylength: {
+                        llvm::Value* array = pop();
+                        null_check(array);
+                        push_int(ir.CreateAlignedLoad(
+                            i32, ir.CreateBitCast(at(array, length_offset), i32->getPointerTo()),
+                            llvm::Align(4)));
+                        return false;
+                    }
+                    case _checkcast:
+                        return check_cast(false);
+                    case _instanceof:
+                        return check_cast(true);
+
+                    default:
+                        // athrow, monitors, jsr and ret, wide, multianewarray
+                        // and invokedynamic
+                        return interpret();
+                }
+            }
+
+            // iadd to ixor; the long forms pass their opcode less one
+            llvm::Value* integer_operation(u1 opcode, llvm::Value* left, llvm::Value* right) {
+                switch (opcode) {
+                    case _iadd:
+                        return ir.CreateAdd(left, right);
+                    case _isub:
+                        return ir.CreateSub(left, right);
+                    case _imul:
+                        return ir.CreateMul(left, right);
+                    case _iand:
+                        return ir.CreateAnd(left, right);
+                    case _ior:
+                        return ir.CreateOr(left, right);
+                    default:
+                        return ir.CreateXor(left, right);
+                }
+            }
+
+            // fadd to frem; the double forms pass their opcode less one.
+            // frem is fmod, the remainder Java wants.
+            llvm::Value* float_operation(u1 opcode, llvm::Value* left, llvm::Value* right) {
+                switch (opcode) {
+                    case _fadd:
+                        return ir.CreateFAdd(left, right);
+                    case _fsub:
+                        return ir.CreateFSub(left, right);
+                    case _fmul:
+                        return ir.CreateFMul(left, right);
+                    case _fdiv:
+                        return ir.CreateFDiv(left, right);
+                    default:
+                        return ir.CreateFRem(left, right);
+                }
+            }
+
+            // shl, shr and ushr by an amount already masked
+            llvm::Value* shift(int kind, llvm::Value* value, llvm::Value* amount) {
+                if (kind == 0) return ir.CreateShl(value, amount);
+                if (kind == 2) return ir.CreateAShr(value, amount);
+                return ir.CreateLShr(value, amount);
+            }
+        };
+
+        // Baseline code: mem2reg makes SSA values of the slots, instcombine
+        // and simplifycfg clean up the conversions between slots and typed
+        // values. Optimized code goes through the whole -O2 pipeline.
+        void optimize(llvm::Module& module, llvm::Function& function, Tier tier) {
+            llvm::PassBuilder builder;
+            llvm::LoopAnalysisManager loops;
+            llvm::FunctionAnalysisManager functions;
+            llvm::CGSCCAnalysisManager sccs;
+            llvm::ModuleAnalysisManager modules;
+            builder.registerModuleAnalyses(modules);
+            builder.registerCGSCCAnalyses(sccs);
+            builder.registerFunctionAnalyses(functions);
+            builder.registerLoopAnalyses(loops);
+            builder.crossRegisterProxies(loops, functions, sccs, modules);
+
+            if (tier == Tier::Optimized) {
+                builder.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::O2)
+                    .run(module, modules);
+                return;
+            }
+            llvm::FunctionPassManager passes;
+            passes.addPass(llvm::PromotePass());
+            passes.addPass(llvm::InstCombinePass());
+            passes.addPass(llvm::SimplifyCFGPass());
+            passes.run(function, functions);
+        }
+    }; // namespace
+
+    JitCompiler::JitCompiler(rt_jvm_data::ClassLoaderDataGraph& graph_) : graph(graph_) {
+        static std::once_flag targets;
+        std::call_once(targets, [] {
+            llvm::InitializeNativeTarget();
+            llvm::InitializeNativeTargetAsmPrinter();
+        });
+        auto created = llvm::orc::LLJITBuilder().create();
+        if (!created) {
+            throw std::runtime_error("cannot create the JIT: " +
+                                     llvm::toString(created.takeError()));
+        }
+        jit = std::move(*created);
+        observer = graph.add_unloading_observer(
+            [this](std::span<const InstanceKlass* const> klasses) { unload(klasses); });
+    }
+
+    JitCompiler::~JitCompiler() {
+        graph.remove_unloading_observer(observer);
+        for (const MethodWrapper* method : installed) {
+            method->compiled.store(nullptr, std::memory_order_release);
+        }
+    }
+
+    bool JitCompiler::can_compile(const MethodWrapper& method) noexcept {
+        return method.code_info && method.verified &&
+               !(method.mptr->access_flags & ACC_SYNCHRONIZED);
+    }
+
+    bool JitCompiler::compile(const MethodWrapper& method, Tier tier,
+                              const TierThresholds* profile) {
+        if (!can_compile(method)) return false;
+        {
+            std::lock_guard lock(installed_mtx);
+            compiling.push_back(&method);
+        }
+        CompiledCode code = nullptr;
+        std::exception_ptr failure;
+        try {
+            code = build(method, tier, profile);
+        } catch (...) {
+            failure = std::current_exception();
+        }
+        {
+            // installed under the lock, so unloading finds the method either
+            // still compiling or installed
+            std::lock_guard lock(installed_mtx);
+            compiling.erase(std::find(compiling.begin(), compiling.end(), &method));
+            if (code != nullptr) {
+                if (std::find(installed.begin(), installed.end(), &method) == installed.end()) {
+                    installed.push_back(&method);
+                }
+                method.compiled.store(code, std::memory_order_release);
+            }
+        }
+        finished.notify_all();
+        if (failure) std::rethrow_exception(failure);
+        return code != nullptr;
+    }
+
+    CompiledCode JitCompiler::build(const MethodWrapper& method, Tier tier,
+                                    const TierThresholds* profile) {
+        std::string name = "jvm.compiled." + std::to_string(modules.fetch_add(1));
+        auto context = std::make_unique<llvm::LLVMContext>();
+        auto module = std::make_unique<llvm::Module>(name, *context);
+        module->setDataLayout(jit->getDataLayout());
+        module->setTargetTriple(jit->getTargetTriple().str());
+
+        Translator translator(method, *module, name, tier == Tier::Baseline ? profile : nullptr);
+        if (!translator.translate()) return nullptr;
+        optimize(*module, *module->getFunction(name), tier);
+
+        llvm::orc::ThreadSafeModule compiled(std::move(module), std::move(context));
+        if (auto error = jit->addIRModule(std::move(compiled))) {
+            throw std::runtime_error("cannot compile " + name + ": " +
+                                     llvm::toString(std::move(error)));
+        }
+        auto symbol = jit->lookup(name);
+        if (!symbol) {
+            throw std::runtime_error("cannot compile " + name + ": " +
+                                     llvm::toString(symbol.takeError()));
+        }
+        return reinterpret_cast<CompiledCode>(symbol->getAddress());
+    }
+
+    void JitCompiler::unload(std::span<const InstanceKlass* const> klasses) {
+        std::unordered_set<const InstanceKlass*> unloading(klasses.begin(), klasses.end());
+        auto unloaded = [&](const MethodWrapper* method) {
+            return unloading.contains(method->kls);
+        };
+        std::unique_lock lock(installed_mtx);
+        finished.wait(lock, [&] {
+            return std::none_of(compiling.begin(), compiling.end(), unloaded);
+        });
+        std::erase_if(installed, [&](const MethodWrapper* method) {
+            if (!unloaded(method)) return false;
+            method->compiled.store(nullptr, std::memory_order_release);
+            return true;
+        });
+    }
+}; // namespace jvm
@@ -1,157 +1,963 @@
 #include "runtime/klass.hpp"
+#include "classFile/class_archive.hpp"
 #include "classFile/class_file.hpp"
+#include "runtime/verifier.hpp"
+#include "runtime/byte_code_engine.hpp"
+#include "runtime/class_loader_data.hpp"
+#include <bit>
 #include <cassert>
+#include <cstring>
+#include <new>
 #include <spdlog/spdlog.h>
 
 using namespace rt_jvm_data;
 using namespace raw_jvm_data;
 
-AttributeWrapper::AttributeWrapper(const raw_jvm_data::AttributeInfo_ptr aaptr) : aptr(aaptr) {
-    // TODO
+AttributeWrapper::AttributeWrapper(const raw_jvm_data::AttributeInfo* aptr) noexcept : aptr(aptr) {
 }
 
-MethodWrapper::MethodWrapper(const InstanceKlass& kls, const MethodInfo_ptr mptr)
-    : mptr(mptr), code(nullptr), code_length(0) {
-    for (size_t index = 0; index < mptr->attribute_count; index++) {
-        const auto& aptr = &mptr->attributes[index];
-        const auto& name_u8ptr =
-            static_cast<ConstantUtf8_ptr>(kls.constant_pool[aptr->attribute_name_index]);
+CodeInfo::CodeInfo(const InstanceKlass& kls, AttributeWrapper code_attr)
+    : quick_code(kls.metadata), exception_table(kls.metadata), line_tables(kls.metadata) {
+    auto in = code_attr.reader();
+    u4 code_length = 0;
+    in.read_u2(&this->max_stack);
+    in.read_u2(&this->max_locals);
+    in.read_u4(&code_length);
+    if (code_length == 0 || code_length > 0xFFFF) {
+        throw ClassFormatError("invalid code length " + std::to_string(code_length));
+    }
+    this->code = {in.read_bytes(code_length), code_length};
+    // The static constraints of JVMS 4.9.1 hold for every version, the
+    // verifier only runs from 50 on: each instruction ends within the code
+    // and none is reserved. The _quick forms and superinstructions trust
+    // what quickening resolved, so only the interpreter may write them.
+    for (std::size_t pc = 0; pc < code_length;) {
+        u1 opcode = this->code[pc];
+        std::size_t length = jvm::BytecodeEngine::instruction_length(this->code, pc);
+        if (opcode > jvm::_jsr_w || length == 0) {
+            throw ClassFormatError("invalid instruction " + std::to_string(opcode) + " at " +
+                                   std::to_string(pc));
+        }
+        if (opcode == jvm::_wide) {
+            u1 modified = this->code[pc + 1];
+            if (!(modified >= jvm::_iload && modified <= jvm::_aload) &&
+                !(modified >= jvm::_istore && modified <= jvm::_astore) &&
+                modified != jvm::_ret && modified != jvm::_iinc) {
+                throw ClassFormatError("invalid wide instruction at " + std::to_string(pc));
+            }
+        }
+        pc += length;
+    }
+    this->quick_code.assign(this->code.begin(), this->code.end());
+
+    u2 exception_table_length = 0;
+    in.read_u2(&exception_table_length);
+    this->exception_table.resize(exception_table_length);
+    for (u2 index = 0; index < exception_table_length; index++) {
+        auto& handler = this->exception_table[index];
+        in.read_u2(&handler.start_pc);
+        in.read_u2(&handler.end_pc);
+        in.read_u2(&handler.handler_pc);
+        in.read_u2(&handler.catch_type);
+        handler.order = index;
+        if (handler.start_pc >= handler.end_pc || handler.end_pc > code_length ||
+            handler.handler_pc >= code_length) {
+            throw ClassFormatError("exception table entry out of code range");
+        }
+    }
 
-        assert(name_u8ptr->tag == CONSTANT_Utf8);
+    std::stable_sort(this->exception_table.begin(), this->exception_table.end(),
+                     [](const auto& lhs, const auto& rhs) { return lhs.start_pc < rhs.start_pc; });
+    u2 covered_end = 0;
+    for (auto& handler : this->exception_table) {
+        covered_end = std::max(covered_end, handler.end_pc);
+        handler.covered_end = covered_end;
+    }
 
-        std::string attr_name(reinterpret_cast<char*>(name_u8ptr->bytes), name_u8ptr->length);
-        // spdlog::info("attribute name: {}", attr_name);
-        this->attributes.emplace(std::move(attr_name), aptr);
+    // nested attributes: keep the line tables and the stack maps, skip the rest unread
+    u2 attributes_count = 0;
+    in.read_u2(&attributes_count);
+    for (u2 index = 0; index < attributes_count; index++) {
+        u2 name_index = 0;
+        u4 length = 0;
+        in.read_u2(&name_index);
+        in.read_u4(&length);
+        const u1* body = in.read_bytes(length);
+        if (name_index >= kls.constant_pool_count || kls.cp_tag(name_index) != CONSTANT_Utf8) {
+            continue;
+        }
+        auto name = kls.constant_pool[name_index].utf8.view();
+        if (name == "LineNumberTable") {
+            this->line_tables.emplace_back(body, length);
+        } else if (name == "StackMapTable") {
+            this->stack_map_table = {body, length};
+        }
     }
-    if (this->attributes.contains("Code")) {
-        const auto& code_attr = this->attributes.at("Code");
-        this->code = code_attr.aptr->info;
-        this->code_length = code_attr.aptr->attribute_length;
+}
+
+int CodeInfo::line_of(u4 pc) const noexcept {
+    // entries need not be sorted and may be split over several tables
+    int line = -1;
+    u4 best_start = 0;
+    for (auto table : this->line_tables) {
+        if (table.size() < 2) continue;
+        std::size_t count =
+            std::min<std::size_t>((table[0] << 8) | table[1], (table.size() - 2) / 4);
+        for (std::size_t index = 0; index < count; index++) {
+            const u1* entry = table.data() + 2 + index * 4;
+            u4 start_pc = (entry[0] << 8) | entry[1];
+            if (start_pc <= pc && (line < 0 || start_pc >= best_start)) {
+                best_start = start_pc;
+                line = (entry[2] << 8) | entry[3];
+            }
+        }
     }
+    return line;
 }
 
-FieldWrapper::FieldWrapper(const InstanceKlass& kls, const raw_jvm_data::FieldInfo_ptr fptr,
-                           const u2 object_field_size, const u2 static_field_offset)
-    : fptr(fptr), object_field_offset(object_field_size), static_field_offset(static_field_offset) {
-    for (size_t index = 0; index < fptr->attribute_count; index++) {
-        const auto& aptr = &fptr->attributes[index];
-        const auto& name_u8ptr =
-            static_cast<ConstantUtf8_ptr>(kls.constant_pool[aptr->attribute_name_index]);
+void MemberIndex::build(std::span<const MemberKey> keys) {
+    this->slots.clear();
+    if (keys.empty()) return;
+
+    unsigned log2 = std::bit_width(keys.size() * 2 - 1);
+    this->shift = 64 - log2;
+    this->slots.assign(std::size_t(1) << log2, Slot{});
+    for (u4 position = 0; position < keys.size(); position++) {
+        std::size_t index = this->home(keys[position]);
+        for (; this->slots[index].key.name; index = (index + 1) & (this->slots.size() - 1)) {
+            if (this->slots[index].key == keys[position]) break;
+        }
+        if (!this->slots[index].key.name) this->slots[index] = {keys[position], position};
+    }
+}
 
-        assert(name_u8ptr->tag == CONSTANT_Utf8);
+namespace {
+    MethodSignature checked_signature(Symbol descriptor, bool is_static,
+                                      std::pmr::memory_resource* metadata) {
+        auto parsed = MethodSignature::parse(descriptor.view(), is_static, metadata);
+        if (!parsed) {
+            throw ClassFormatError("invalid method descriptor " + std::string(descriptor.view()));
+        }
+        return std::move(*parsed);
+    }
+}; // namespace
 
-        std::string attr_name(reinterpret_cast<char*>(name_u8ptr->bytes), name_u8ptr->length);
-        this->attributes.emplace(std::move(attr_name), aptr);
+MethodWrapper::MethodWrapper(const InstanceKlass& kls, const MethodInfo_ptr mptr)
+    : kls(&kls), mptr(mptr), name(kls.symbol_of(mptr->name_index)),
+      descriptor(kls.symbol_of(mptr->descriptor_index)),
+      signature(checked_signature(descriptor, mptr->access_flags & ACC_STATIC, kls.metadata)) {
+    if (auto code_attr = this->get_attribute("Code")) {
+        this->code_info.emplace(kls, *code_attr);
     }
 }
 
-std::string InstanceKlass::generate_function_id(raw_jvm_data::ConstantUtf8_ptr name_u8ptr,
-                                                raw_jvm_data::ConstantUtf8_ptr descriptor_u8ptr) {
-    return std::string(reinterpret_cast<char*>(name_u8ptr->bytes), name_u8ptr->length) + ':' +
-           std::string(reinterpret_cast<char*>(descriptor_u8ptr->bytes), descriptor_u8ptr->length);
+std::optional<AttributeWrapper> MethodWrapper::get_attribute(std::string_view name) const noexcept {
+    auto aptr = kls->lookup_attribute(mptr->attributes, mptr->attribute_count, name);
+    if (aptr == nullptr) return std::nullopt;
+    return AttributeWrapper(aptr);
 }
 
-std::string InstanceKlass::generate_function_id(raw_jvm_data::ConstantNameAndType_ptr p) {
-    const auto& name_u8ptr = static_cast<ConstantUtf8_ptr>(this->constant_pool[p->name_index]);
-    const auto& descriptor_u8ptr =
-        static_cast<ConstantUtf8_ptr>(this->constant_pool[p->descriptor_index]);
+FieldWrapper::FieldWrapper(const InstanceKlass& kls, const raw_jvm_data::FieldInfo_ptr fptr,
+                           raw_value_type type)
+    : kls(&kls), fptr(fptr), name(kls.symbol_of(fptr->name_index)),
+      descriptor(kls.symbol_of(fptr->descriptor_index)), type(type) {
+}
+
+std::optional<AttributeWrapper> FieldWrapper::get_attribute(std::string_view name) const noexcept {
+    auto aptr = kls->lookup_attribute(fptr->attributes, fptr->attribute_count, name);
+    if (aptr == nullptr) return std::nullopt;
+    return AttributeWrapper(aptr);
+}
+
+Symbol InstanceKlass::symbol_of(u2 utf8_index) const {
+    const auto& u8ptr = this->get_cp_item<ConstantUtf8_ptr>(utf8_index);
+    assert(u8ptr->tag == CONSTANT_Utf8);
+    // the hash was taken while the constant was validated
+    return SymbolTable::intern(u8ptr->view(), u8ptr->hash);
+}
 
-    return this->generate_function_id(name_u8ptr, descriptor_u8ptr);
+MemberKey InstanceKlass::member_key(raw_jvm_data::ConstantNameAndType_ptr p) const {
+    return {this->symbol_of(p->name_index), this->symbol_of(p->descriptor_index)};
 }
 
-raw_value_type InstanceKlass::reslove_type(raw_jvm_data::ConstantUtf8_ptr u8ptr) {
-    assert(u8ptr->length > 0);
+InstanceKlass::InstanceKlass(std::fstream& in, ClassLoaderData* loader)
+    : raw_jvm_data::ClassFile(in, &ClassLoaderData::metaspace_of(loader)),
+      RawKlass(&ClassLoaderData::metaspace_of(loader)), loader(loader),
+      metadata(&ClassLoaderData::metaspace_of(loader)) {
+    this->build_runtime_data();
+}
 
-    const auto& first_ch = u8ptr->bytes[0];
+InstanceKlass::InstanceKlass(ClassFileSource_ptr src, ClassLoaderData* loader)
+    : raw_jvm_data::ClassFile(std::move(src), &ClassLoaderData::metaspace_of(loader)),
+      RawKlass(&ClassLoaderData::metaspace_of(loader)), loader(loader),
+      metadata(&ClassLoaderData::metaspace_of(loader)) {
+    this->build_runtime_data();
+}
+
+InstanceKlass::InstanceKlass(const raw_jvm_data::SharedClassArchive& archive,
+                             const raw_jvm_data::ArchivedClassRecord& record,
+                             ClassLoaderData* loader)
+    : raw_jvm_data::ClassFile(archive, record), RawKlass(&ClassLoaderData::metaspace_of(loader)),
+      loader(loader), metadata(&ClassLoaderData::metaspace_of(loader)) {
+    this->origin = {archive.at<u1>(0), archive.index_of(record), archive.linkage_of(record)};
+    this->build_runtime_data(archive.at<u1>(record.field_types_offset));
+}
 
-    if (!TYPE_CHAC_REC.contains(first_ch)) {
-        spdlog::error("can't reslove type {}",
-                      std::string(reinterpret_cast<char*>(u8ptr->bytes), u8ptr->length));
-        assert(false);
+InstanceKlass::~InstanceKlass() {
+    // the entries hold nothing to destroy
+    std::pmr::polymorphic_allocator<CpCacheEntry>(this->metadata)
+        .deallocate(this->cp_cache.data(), this->cp_cache.size());
+    if (this->statics != nullptr) {
+        this->metadata->deallocate(this->statics, this->field_layout.static_size);
     }
-    return TYPE_CHAC_REC[first_ch];
 }
 
-raw_value_type InstanceKlass::reslove_type(raw_jvm_data::ConstantNameAndType_ptr nat_ptr) {
-    return this->reslove_type(
-        static_cast<ConstantUtf8_ptr>(this->constant_pool[nat_ptr->descriptor_index]));
+RawKlass::~RawKlass() {
+    delete this->array_klass.load(std::memory_order_relaxed);
 }
 
-InstanceKlass::InstanceKlass(std::fstream& in) : raw_jvm_data::ClassFile(in) {
-    for (size_t index = 0; index < this->methods_count; index++) {
-        const auto& mptr = &this->methods[index];
+const ArrayKlass* RawKlass::array_of() const {
+    if (auto* made = this->array_klass.load(std::memory_order_acquire)) return made;
+
+    // [[I is one more dimension over the int of [I, not an array of [I
+    auto* made = this->kls_type == KlassType::Array
+                     ? new ArrayKlass(static_cast<const ArrayKlass*>(this)->get_element(),
+                                      static_cast<const ArrayKlass*>(this)->get_dimensions() + 1)
+                     : new ArrayKlass(this, 1);
+    ArrayKlass* expected = nullptr;
+    if (!this->array_klass.compare_exchange_strong(expected, made, std::memory_order_acq_rel)) {
+        delete made;
+        return expected;
+    }
+    return made;
+}
 
-        const auto& name_u8ptr =
-            static_cast<ConstantUtf8_ptr>(this->constant_pool[mptr->name_index]);
-        const auto& descriptor_u8ptr =
-            static_cast<ConstantUtf8_ptr>(this->constant_pool[mptr->descriptor_index]);
+const RawKlass* ArrayKlass::get_component() const {
+    const RawKlass* component = this->klass_ptr;
+    for (int dimension = 1; dimension < this->dim; dimension++) component = component->array_of();
+    return component;
+}
 
-        assert(name_u8ptr->tag == CONSTANT_Utf8);
-        assert(descriptor_u8ptr->tag == CONSTANT_Utf8);
+const PrimitiveKlass& PrimitiveKlass::of(raw_value_type type) noexcept {
+    static const PrimitiveKlass* klasses = [] {
+        // never destroyed, arrays may outlive static destruction
+        auto* made = static_cast<PrimitiveKlass*>(
+            ::operator new(sizeof(PrimitiveKlass) * std::size_t(raw_value_type::Jreference)));
+        for (int index = 0; index < int(raw_value_type::Jreference); index++) {
+            ::new (&made[index]) PrimitiveKlass(static_cast<raw_value_type>(index));
+        }
+        return made;
+    }();
+    return klasses[static_cast<int>(type)];
+}
 
-        const auto& function_id = generate_function_id(name_u8ptr, descriptor_u8ptr);
+void InstanceKlass::build_runtime_data(const u1* field_types) {
+    std::vector<MemberKey> keys;
+    keys.reserve(std::max(this->methods_count, this->fields_count));
 
-        this->rt_methods.emplace(function_id, MethodWrapper(*this, mptr));
-        // spdlog::info("reslove method {}", function_id);
+    this->rt_methods.reserve(this->methods_count);
+    for (size_t index = 0; index < this->methods_count; index++) {
+        const auto& method = this->rt_methods.emplace_back(*this, &this->methods[index]);
+        keys.push_back({method.name, method.descriptor});
     }
+    this->method_index.build(keys);
+    keys.clear();
+
+    this->rt_fields.reserve(this->fields_count);
 
-    u2 object_field_offset = 0, static_field_offset = 0;
     for (size_t index = 0; index < this->fields_count; index++) {
         const auto& fptr = &this->fields[index];
 
-        const auto& name_u8ptr =
-            static_cast<ConstantUtf8_ptr>(this->constant_pool[fptr->name_index]);
-        const auto& descriptor_u8ptr =
-            static_cast<ConstantUtf8_ptr>(this->constant_pool[fptr->descriptor_index]);
+        std::optional<raw_value_type> type;
+        if (field_types != nullptr) {
+            if (field_types[index] > u1(raw_value_type::Jreference)) {
+                throw ClassFormatError("invalid archived field type");
+            }
+            type = static_cast<raw_value_type>(field_types[index]);
+        } else {
+            const auto& descriptor_u8ptr =
+                this->get_cp_item<ConstantUtf8_ptr>(fptr->descriptor_index);
+            assert(descriptor_u8ptr->tag == CONSTANT_Utf8);
+            type = parse_field_descriptor(descriptor_u8ptr->view());
+            if (!type) {
+                throw ClassFormatError("invalid field descriptor " +
+                                       std::string(descriptor_u8ptr->view()));
+            }
+        }
+
+        const auto& field = this->rt_fields.emplace_back(*this, fptr, *type);
+        keys.push_back({field.name, field.descriptor});
+    }
+    this->field_index.build(keys);
 
-        assert(name_u8ptr->tag == CONSTANT_Utf8);
-        assert(descriptor_u8ptr->tag == CONSTANT_Utf8);
+    std::pmr::polymorphic_allocator<CpCacheEntry> allocator(this->metadata);
+    this->cp_cache = {allocator.allocate(this->constant_pool_count), this->constant_pool_count};
+    for (auto& entry : this->cp_cache) ::new (&entry) CpCacheEntry();
 
-        const auto& field_id =
-            std::string(reinterpret_cast<char*>(name_u8ptr->bytes), name_u8ptr->length);
+    ConstantClass_ptr this_kls = get_cp_item<ConstantClass_ptr>(this->this_class);
+    ConstantUtf8_ptr this_kls_name = get_cp_item<ConstantUtf8_ptr>(this_kls->name_index);
+    this->klass_name = utf8cp_to_string(this_kls_name);
+    this->kls_type = KlassType::Instance;
+}
 
-        const auto& field_type = this->reslove_type(descriptor_u8ptr);
-        const auto& field_size = TYPE_SIZE_REC[field_type];
+const MethodWrapper* InstanceKlass::get_method(std::string_view name,
+                                               std::string_view descriptor) const noexcept {
+    // a string never interned cannot name a member of a loaded class
+    Symbol name_symbol = SymbolTable::lookup(name);
+    Symbol descriptor_symbol = name_symbol ? SymbolTable::lookup(descriptor) : Symbol{};
+    return descriptor_symbol ? this->get_method(name_symbol, descriptor_symbol) : nullptr;
+}
 
-        this->rt_fields.emplace(
-            field_id, FieldWrapper(*this, fptr, static_field_offset, object_field_offset));
-        fptr->access_flags& ACC_STATIC ? static_field_offset += field_size
-                                       : object_field_offset += field_size;
-        // spdlog::info("reslove field {}", field_id);
+const FieldWrapper* InstanceKlass::get_field(std::string_view name) const noexcept {
+    Symbol symbol = SymbolTable::lookup(name);
+    if (!symbol) return nullptr;
+    for (const auto& field : this->rt_fields) {
+        if (field.name == symbol) return &field;
     }
+    return nullptr;
+}
 
-    for (size_t index = 0; index < this->attributes_count; index++) {
-        const auto& aptr = &this->attributes[index];
+void InstanceKlass::layout_fields(const InstanceKlass* super) {
+    std::vector<FieldShape> shapes;
+    shapes.reserve(this->rt_fields.size());
+    for (const auto& field : this->rt_fields) {
+        shapes.push_back({type_size_of(field.type), field.type == raw_value_type::Jreference,
+                          field.is_static()});
+    }
 
-        const auto& name_u8ptr =
-            static_cast<ConstantUtf8_ptr>(this->constant_pool[aptr->attribute_name_index]);
+    std::vector<u4> offsets(shapes.size());
+    this->field_layout = rt_jvm_data::layout_fields(
+        shapes, super == nullptr ? nullptr : &super->field_layout, offsets);
+    for (std::size_t index = 0; index < offsets.size(); index++) {
+        this->rt_fields[index].offset = offsets[index];
+    }
+}
 
-        std::string attr_name(reinterpret_cast<char*>(name_u8ptr->bytes), name_u8ptr->length);
+namespace {
+    // runtime package of a class: its internal name up to the last '/'
+    std::string_view package_of(std::string_view name) noexcept {
+        auto slash = name.rfind('/');
+        return slash == std::string_view::npos ? std::string_view{} : name.substr(0, slash);
+    }
 
-        // spdlog::info("resolve attribute name {}", attr_name);
+    bool has_flag(const MethodWrapper& method, u2 flag) noexcept {
+        return method.mptr->access_flags & flag;
+    }
 
-        this->rt_attributes.emplace(std::move(attr_name), aptr);
+    // instance methods other than <init>, the only ones a vtable or itable holds
+    bool is_dispatched(const MethodWrapper& method) noexcept {
+        return !has_flag(method, ACC_STATIC) && !has_flag(method, ACC_PRIVATE) &&
+               !method.name.view().starts_with('<');
+    }
+}; // namespace
+
+void InstanceKlass::build_itable(std::span<const InstanceKlass* const> interfaces) {
+    // a link that failed half way is redone from scratch
+    this->itable.clear();
+    this->itable_methods.clear();
+    this->local_interfaces.assign(interfaces.begin(), interfaces.end());
+    if (this->is_interface()) {
+        int next = 0;
+        for (auto& method : this->rt_methods) {
+            if (is_dispatched(method)) method.itable_index = next++;
+        }
     }
 
-    ConstantClass_ptr this_kls = get_cp_item<ConstantClass_ptr>(this->this_class);
-    ConstantUtf8_ptr this_kls_name = get_cp_item<ConstantUtf8_ptr>(this_kls->name_index);
-    this->klass_name = utf8cp_to_string(this_kls_name);
+    std::vector<const InstanceKlass*> implemented;
+    auto add = [&](const InstanceKlass* interface) {
+        if (std::find(implemented.begin(), implemented.end(), interface) == implemented.end()) {
+            implemented.push_back(interface);
+        }
+    };
+    if (this->super_klass != nullptr) {
+        for (const auto& block : this->super_klass->itable) add(block.interface);
+    }
+    for (const auto* interface : interfaces) {
+        assert(interface->is_interface() && interface->is_linked());
+        add(interface);
+        for (const auto& block : interface->itable) add(block.interface);
+    }
+
+    for (const auto* interface : implemented) {
+        this->itable.push_back({interface, static_cast<u4>(this->itable_methods.size())});
+        for (const auto& method : interface->rt_methods) {
+            if (method.itable_index >= 0) this->itable_methods.push_back(nullptr);
+        }
+    }
+}
+
+void InstanceKlass::build_vtable() {
+    this->vtable.clear();
+    if (this->super_klass != nullptr) this->vtable = this->super_klass->vtable;
+    for (auto& method : this->rt_methods) method.vtable_index = -1;
+
+    std::unordered_map<MemberKey, std::vector<u4>> slots;
+    for (u4 index = 0; index < this->vtable.size(); index++) {
+        slots[{this->vtable[index]->name, this->vtable[index]->descriptor}].push_back(index);
+    }
+    auto append = [&](const MethodWrapper& method) {
+        u4 index = static_cast<u4>(this->vtable.size());
+        this->vtable.push_back(&method);
+        slots[{method.name, method.descriptor}].push_back(index);
+        return static_cast<int>(index);
+    };
+
+    // Interfaces keep only the inherited java/lang/Object slots: their own
+    // methods are reached through the itables of the implementing classes.
+    if (this->is_interface()) return;
+
+    std::string_view package = package_of(this->klass_name);
+    for (auto& method : this->rt_methods) {
+        if (!is_dispatched(method)) continue;
+
+        // JVMS 5.4.5: a package private method is overridden only from its own package
+        auto it = slots.find({method.name, method.descriptor});
+        if (it != slots.end()) {
+            for (u4 index : it->second) {
+                const MethodWrapper& inherited = *this->vtable[index];
+                if (!has_flag(inherited, ACC_PUBLIC | ACC_PROTECTED) &&
+                    package_of(inherited.kls->klass_name) != package) {
+                    continue;
+                }
+                if (has_flag(inherited, ACC_FINAL)) {
+                    throw VerifyError(std::string(this->klass_name) + "." +
+                                      std::string(method.name.view()) +
+                                      " overrides a final method");
+                }
+                this->vtable[index] = &method;
+                if (method.vtable_index < 0) method.vtable_index = static_cast<int>(index);
+            }
+        }
+        if (method.vtable_index < 0) method.vtable_index = append(method);
+    }
+
+    // interface methods without an implementation in the class hierarchy get
+    // a slot of their own, a default method winning over an abstract one
+    for (const auto& block : this->itable) {
+        for (const auto& method : block.interface->rt_methods) {
+            if (method.itable_index < 0) continue;
+            auto it = slots.find({method.name, method.descriptor});
+            if (it == slots.end()) {
+                append(method);
+                continue;
+            }
+            for (u4 index : it->second) {
+                const MethodWrapper& current = *this->vtable[index];
+                if (current.kls->is_interface() && has_flag(current, ACC_ABSTRACT) &&
+                    !has_flag(method, ACC_ABSTRACT)) {
+                    this->vtable[index] = &method;
+                }
+            }
+        }
+    }
+
+    // the itable points at whatever the finished vtable selects
+    for (const auto& block : this->itable) {
+        for (const auto& method : block.interface->rt_methods) {
+            if (method.itable_index < 0) continue;
+            auto it = slots.find({method.name, method.descriptor});
+            if (it == slots.end()) continue;
+            for (u4 index : it->second) {
+                // a package private method never implements an interface method
+                const MethodWrapper* selected = this->vtable[index];
+                if (has_flag(*selected, ACC_PUBLIC)) {
+                    this->itable_methods[block.first + method.itable_index] = selected;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+namespace {
+    template <class T> const T* archived(const u1* base, u8 offset) noexcept {
+        return reinterpret_cast<const T*>(base + offset);
+    }
+}; // namespace
+
+bool InstanceKlass::restore_linkage(const InstanceKlass* super,
+                                    std::span<const InstanceKlass* const> interfaces) {
+    const ArchivedLinkage* linkage = this->origin.linkage;
+    if (linkage == nullptr) return false;
+    const u1* base = this->origin.base;
+
+    // every class the linkage names is among those this one is linked against
+    std::vector<const InstanceKlass*> known{this};
+    for (const InstanceKlass* kls = super; kls != nullptr; kls = kls->super_klass) {
+        known.push_back(kls);
+        for (const auto& block : kls->itable) known.push_back(block.interface);
+    }
+    for (const auto* interface : interfaces) {
+        known.push_back(interface);
+        for (const auto& block : interface->itable) known.push_back(block.interface);
+    }
+    auto klass_of = [&](u4 record) -> const InstanceKlass* {
+        for (const auto* kls : known) {
+            if (kls->origin.base == base && kls->origin.record == record) return kls;
+        }
+        return nullptr;
+    };
+    auto method_of = [&](const ArchivedMethodRef& ref) -> std::optional<const MethodWrapper*> {
+        if (ref.klass == ArchivedLinkage::NO_RECORD) return nullptr;
+        const InstanceKlass* kls = klass_of(ref.klass);
+        if (kls == nullptr || ref.method >= kls->rt_methods.size()) return std::nullopt;
+        return &kls->rt_methods[ref.method];
+    };
+
+    if (super == nullptr ? linkage->super != ArchivedLinkage::NO_RECORD
+                         : klass_of(linkage->super) != super) {
+        return false;
+    }
+    if (interfaces.size() != linkage->interfaces_count) return false;
+    const u4* interface_records = archived<u4>(base, linkage->interfaces_offset);
+    for (std::size_t index = 0; index < interfaces.size(); index++) {
+        if (klass_of(interface_records[index]) != interfaces[index]) return false;
+    }
+
+    // resolve and bound everything first, a mismatch leaves the klass untouched
+    std::vector<ItableBlock> itable;
+    for (u4 index = 0; index < linkage->itable_length; index++) {
+        const auto& block = archived<ArchivedItableBlock>(base, linkage->itable_offset)[index];
+        const InstanceKlass* interface = klass_of(block.interface);
+        if (interface == nullptr || !interface->is_interface()) return false;
+        auto slots = std::count_if(interface->rt_methods.begin(), interface->rt_methods.end(),
+                                   [](const MethodWrapper& m) { return m.itable_index >= 0; });
+        if (linkage->itable_methods_length - block.first < u8(slots)) return false;
+        itable.push_back({interface, block.first});
+    }
+    auto methods_of = [&](u8 offset, u4 length, std::vector<const MethodWrapper*>& methods) {
+        for (u4 index = 0; index < length; index++) {
+            auto method = method_of(archived<ArchivedMethodRef>(base, offset)[index]);
+            if (!method) return false;
+            methods.push_back(*method);
+        }
+        return true;
+    };
+    std::vector<const MethodWrapper*> vtable, itable_methods;
+    if (!methods_of(linkage->vtable_offset, linkage->vtable_length, vtable) ||
+        !methods_of(linkage->itable_methods_offset, linkage->itable_methods_length,
+                    itable_methods) ||
+        std::find(vtable.begin(), vtable.end(), nullptr) != vtable.end()) {
+        return false;
+    }
+
+    const auto* indices = archived<std::int32_t>(base, linkage->method_indices_offset);
+    for (std::size_t index = 0; index < this->rt_methods.size(); index++) {
+        if (indices[2 * index] >= std::int32_t(vtable.size()) ||
+            indices[2 * index + 1] >= std::int32_t(this->rt_methods.size())) {
+            return false;
+        }
+    }
+    const u4* offsets = archived<u4>(base, linkage->field_offsets_offset);
+    for (std::size_t index = 0; index < this->rt_fields.size(); index++) {
+        const auto& field = this->rt_fields[index];
+        u4 limit = field.is_static() ? linkage->static_size : linkage->instance_size;
+        if (offsets[index] > limit || limit - offsets[index] < type_size_of(field.type)) {
+            return false;
+        }
+    }
+    const u4* oop_maps = archived<u4>(base, linkage->oop_maps_offset);
+    std::vector<OopMapBlock> blocks;
+    for (u4 index = 0; index < linkage->oop_map_count; index++) {
+        OopMapBlock block{oop_maps[2 * index], oop_maps[2 * index + 1]};
+        if (block.offset > linkage->instance_size ||
+            (linkage->instance_size - block.offset) / 8 < block.count) {
+            return false;
+        }
+        blocks.push_back(block);
+    }
+    if (linkage->static_size / 8 < linkage->static_oop_count) return false;
+
+    this->field_layout.instance_size = linkage->instance_size;
+    this->field_layout.static_size = linkage->static_size;
+    this->field_layout.oop_maps = std::move(blocks);
+    this->field_layout.static_oop_count = linkage->static_oop_count;
+    for (std::size_t index = 0; index < this->rt_fields.size(); index++) {
+        this->rt_fields[index].offset = offsets[index];
+    }
+    for (std::size_t index = 0; index < this->rt_methods.size(); index++) {
+        this->rt_methods[index].vtable_index = indices[2 * index];
+        this->rt_methods[index].itable_index = indices[2 * index + 1];
+    }
+    this->vtable.assign(vtable.begin(), vtable.end());
+    this->itable.assign(itable.begin(), itable.end());
+    this->itable_methods.assign(itable_methods.begin(), itable_methods.end());
+    this->local_interfaces.assign(interfaces.begin(), interfaces.end());
+    return true;
+}
+
+Symbol InstanceKlass::get_super_name() const {
+    if (this->super_class == 0) return {};
+    return this->symbol_of(this->get_cp_item<ConstantClass_ptr>(this->super_class)->name_index);
+}
+
+std::vector<Symbol> InstanceKlass::get_interface_names() const {
+    std::vector<Symbol> names;
+    names.reserve(this->interfaces_count);
+    for (u2 index = 0; index < this->interfaces_count; index++) {
+        auto interface = this->get_cp_item<ConstantClass_ptr>(this->interfaces[index]);
+        names.push_back(this->symbol_of(interface->name_index));
+    }
+    return names;
+}
+
+const MethodWrapper* InstanceKlass::resolve_method(Symbol name, Symbol descriptor) const noexcept {
+    for (const InstanceKlass* kls = this; kls != nullptr; kls = kls->super_klass) {
+        if (const auto* method = kls->get_method(name, descriptor)) return method;
+    }
+
+    // among the superinterfaces a default method wins over an abstract one
+    const MethodWrapper* abstract = nullptr;
+    for (const auto& block : this->itable) {
+        const auto* method = block.interface->get_method(name, descriptor);
+        if (method == nullptr || !is_dispatched(*method)) continue;
+        if (!has_flag(*method, ACC_ABSTRACT)) return method;
+        if (abstract == nullptr) abstract = method;
+    }
+    return abstract;
+}
+
+const FieldWrapper* InstanceKlass::resolve_field(Symbol name, Symbol descriptor) const noexcept {
+    if (const auto* field = this->get_field(name, descriptor)) return field;
+    for (const auto* interface : this->local_interfaces) {
+        if (const auto* field = interface->resolve_field(name, descriptor)) return field;
+    }
+    return this->super_klass ? this->super_klass->resolve_field(name, descriptor) : nullptr;
+}
+
+bool InstanceKlass::known_assignable(std::string_view from, std::string_view to) const {
+    for (const InstanceKlass* source = this; source != nullptr; source = source->super_klass) {
+        if (source->get_klass_name() != from) continue;
+        for (const InstanceKlass* kls = source; kls != nullptr; kls = kls->super_klass) {
+            if (kls->get_klass_name() == to) return true;
+        }
+        return std::any_of(source->itable.begin(), source->itable.end(),
+                           [&](const ItableBlock& block) {
+                               return block.interface->get_klass_name() == to;
+                           });
+    }
+    return false;
+}
+
+void InstanceKlass::link(const InstanceKlass* super,
+                         std::span<const InstanceKlass* const> interfaces,
+                         const AssignabilityCheck& assignable) {
+    assert(super == nullptr || super->is_linked());
+    // a throwing call leaves the flag unset, so a failed link is retried and fails again
+    std::call_once(this->link_once, [&] {
+        this->super_klass = super;
+        this->record_dependency(super);
+        for (const auto* interface : interfaces) this->record_dependency(interface);
+        if (!this->restore_linkage(super, interfaces)) {
+            this->layout_fields(super);
+            this->build_itable(interfaces);
+            this->build_vtable();
+        }
+        if (u4 size = this->field_layout.static_size) {
+            this->statics = static_cast<std::byte*>(this->metadata->allocate(size, 8));
+            std::memset(this->statics, 0, size);
+        }
+        AssignabilityCheck known = [this](std::string_view from, std::string_view to) {
+            return this->known_assignable(from, to);
+        };
+        Verifier verifier(*this, assignable ? assignable : known);
+        for (auto& method : this->rt_methods) {
+            if (!method.code_info) continue;
+            verifier.verify(method);
+            method.verified = true;
+        }
+        for (const auto& method : this->rt_methods) {
+            if (method.code_info) jvm::BytecodeEngine::fuse(*method.code_info);
+        }
+        this->linked.store(true, std::memory_order_release);
+    });
+}
+
+Symbol InstanceKlass::get_class_name(u2 class_index) const {
+    assert(this->cp_tag(class_index) == CONSTANT_Class);
+    return this->symbol_of(this->get_cp_item<ConstantClass_ptr>(class_index)->name_index);
+}
+
+void InstanceKlass::set_constant_values(const ConstantPoolResolver& resolver) const {
+    for (const auto& field : this->rt_fields) {
+        if (!field.is_static()) continue;
+        auto attribute = field.get_attribute("ConstantValue");
+        if (!attribute) continue;
+        u2 index = 0;
+        auto reader = attribute->reader();
+        reader.read_u2(&index);
+        std::byte* at = this->statics + field.offset;
+
+        switch (field.type) {
+            case raw_value_type::Jlong:
+            case raw_value_type::Jdouble: {
+                u8 bits = this->get_constant_wide_bits(index);
+                std::memcpy(at, &bits, sizeof(bits));
+                break;
+            }
+            case raw_value_type::Jreference: {
+                // only String constants are allowed on reference fields
+                oop::BasicOop* string = nullptr;
+                if (resolver.string) {
+                    auto constant = this->get_cp_item<ConstantString_ptr>(index);
+                    string = resolver.string(this->symbol_of(constant->string_index)).get();
+                }
+                std::memcpy(at, &string, sizeof(string));
+                break;
+            }
+            default: {
+                // narrow ints keep the low bytes of the Integer constant
+                u4 bits = this->get_constant_bits(index);
+                std::memcpy(at, &bits, type_size_of(field.type));
+                break;
+            }
+        }
+    }
+}
+
+void InstanceKlass::initialize(const ConstantPoolResolver& resolver,
+                               const std::function<void(const MethodWrapper&)>& run_clinit) const {
+    using State = InitState;
+    assert(this->is_linked());
+    for (;;) {
+        State state = this->init_state.load(std::memory_order_acquire);
+        if (state == State::Initialized) return;
+        if (state == State::Erroneous) {
+            throw NoClassDefFoundError("could not initialize class " + this->get_klass_name());
+        }
+        if (state == State::BeingInitialized) {
+            // a recursive request from the initializing thread sees the class as it is
+            if (this->init_thread.load(std::memory_order_relaxed) == std::this_thread::get_id()) {
+                return;
+            }
+            this->init_state.wait(State::BeingInitialized, std::memory_order_acquire);
+            continue;
+        }
+        if (this->init_state.compare_exchange_strong(state, State::BeingInitialized,
+                                                     std::memory_order_acquire)) {
+            break;
+        }
+    }
+
+    this->init_thread.store(std::this_thread::get_id(), std::memory_order_relaxed);
+    auto finish = [&](State outcome) {
+        this->init_thread.store(std::thread::id{}, std::memory_order_relaxed);
+        this->init_state.store(outcome, std::memory_order_release);
+        this->init_state.notify_all();
+    };
+    try {
+        // interfaces do not initialize their superinterfaces
+        if (this->super_klass != nullptr && !this->is_interface()) {
+            this->super_klass->initialize(resolver, run_clinit);
+        }
+        this->set_constant_values(resolver);
+        static const Symbol clinit = SymbolTable::intern("<clinit>");
+        static const Symbol void_descriptor = SymbolTable::intern("()V");
+        const MethodWrapper* method = this->get_method(clinit, void_descriptor);
+        if (method != nullptr && method->code_info) run_clinit(*method);
+    } catch (...) {
+        finish(State::Erroneous);
+        throw;
+    }
+    finish(State::Initialized);
+}
+
+const InstanceKlass* InstanceKlass::klass_at(u2 class_index,
+                                             const ConstantPoolResolver& resolver) const {
+    assert(this->cp_tag(class_index) == CONSTANT_Class);
+    if (class_index == this->this_class) return this;
+    Symbol name = this->symbol_of(this->get_cp_item<ConstantClass_ptr>(class_index)->name_index);
+    const InstanceKlass* kls = resolver.klass ? resolver.klass(name) : nullptr;
+    assert(kls == nullptr || kls->is_linked());
+    this->record_dependency(kls);
+    return kls;
+}
+
+const ArrayKlass* InstanceKlass::array_klass_at(std::string_view descriptor,
+                                                const ConstantPoolResolver& resolver) const {
+    auto dimensions = descriptor.find_first_not_of('[');
+    if (dimensions == 0 || dimensions == std::string_view::npos) return nullptr;
+
+    const RawKlass* element = nullptr;
+    std::string_view rest = descriptor.substr(dimensions);
+    if (rest.size() > 2 && rest.front() == 'L' && rest.back() == ';') {
+        Symbol name = SymbolTable::intern(rest.substr(1, rest.size() - 2));
+        const InstanceKlass* kls = resolver.klass ? resolver.klass(name) : nullptr;
+        this->record_dependency(kls);
+        element = kls;
+    } else if (rest.size() == 1 && std::string_view("ZBCSIJFD").find(rest[0]) != rest.npos) {
+        element = &PrimitiveKlass::of(char_to_raw_type(rest[0]));
+    }
+    if (element == nullptr) return nullptr;
+
+    const ArrayKlass* array = element->array_of();
+    for (std::size_t dimension = 1; dimension < dimensions; dimension++) array = array->array_of();
+    return array;
+}
+
+void InstanceKlass::record_dependency(const InstanceKlass* kls) const {
+    if (this->loader != nullptr && kls != nullptr) this->loader->record_dependency(kls->loader);
+}
+
+bool InstanceKlass::resolve_entry(u2 index, CpCacheEntry& entry,
+                                  const ConstantPoolResolver& resolver) const {
+    switch (this->cp_tag(index)) {
+        case CONSTANT_Class: {
+            Symbol name = this->get_class_name(index);
+            if (name.view().starts_with('[')) {
+                entry.array_klass = this->array_klass_at(name.view(), resolver);
+            } else {
+                entry.klass = this->klass_at(index, resolver);
+            }
+            if (entry.klass == nullptr && entry.array_klass == nullptr) {
+                entry.error = "java/lang/NoClassDefFoundError";
+                return false;
+            }
+            return true;
+        }
+        case CONSTANT_String: {
+            if (!resolver.string) return false;
+            auto string = this->get_cp_item<ConstantString_ptr>(index);
+            entry.string = resolver.string(this->symbol_of(string->string_index));
+            return static_cast<bool>(entry.string);
+        }
+        case CONSTANT_Fieldref: {
+            // name_index of a member reference holds its class_index
+            auto ref = this->get_cp_item<ConstantFieldRef_ptr>(index);
+            const InstanceKlass* owner = this->klass_at(ref->name_index, resolver);
+            if (owner == nullptr) {
+                entry.error = "java/lang/NoClassDefFoundError";
+                return false;
+            }
+            MemberKey key = this->member_key(
+                this->get_cp_item<ConstantNameAndType_ptr>(ref->name_and_type_index));
+
+            const FieldWrapper* field = owner->resolve_field(key.name, key.descriptor);
+            if (field == nullptr) {
+                entry.error = "java/lang/NoSuchFieldError";
+                return false;
+            }
+            entry.klass = field->kls;
+            entry.field = field;
+            entry.offset = field->offset;
+            entry.type = field->type;
+            return true;
+        }
+        case CONSTANT_Methodref:
+        case CONSTANT_InterfaceMethodref: {
+            // both layouts match ConstantMethodRef
+            auto ref = this->get_cp_item<ConstantMethodRef_ptr>(index);
+            // arrays have the methods of java/lang/Object, clone() among them
+            const InstanceKlass* owner = nullptr;
+            if (this->get_class_name(ref->name_index).view().starts_with('[')) {
+                owner = resolver.klass ? resolver.klass(SymbolTable::intern("java/lang/Object"))
+                                       : nullptr;
+            } else {
+                owner = this->klass_at(ref->name_index, resolver);
+            }
+            if (owner == nullptr) {
+                entry.error = "java/lang/NoClassDefFoundError";
+                return false;
+            }
+            MemberKey key = this->member_key(
+                this->get_cp_item<ConstantNameAndType_ptr>(ref->name_and_type_index));
+            const MethodWrapper* method = owner->resolve_method(key.name, key.descriptor);
+            if (method == nullptr) {
+                entry.error = "java/lang/NoSuchMethodError";
+                return false;
+            }
+            entry.klass = method->kls;
+            entry.method = method;
+            entry.vtable_index = method->vtable_index;
+            // JVMS 6.5 invokespecial: a superclass method is looked up again
+            // from the direct superclass of this class
+            entry.special = method;
+            const InstanceKlass* super = this->get_super();
+            if ((this->get_access_flags() & ACC_SUPER) && method->name.view() != "<init>" &&
+                !method->kls->is_interface() && method->kls != this) {
+                for (auto* kls = super; kls != nullptr; kls = kls->get_super()) {
+                    if (kls != method->kls) continue;
+                    entry.special = super->resolve_method(method->name, method->descriptor);
+                    break;
+                }
+            }
+            return true;
+        }
+        default:
+            assert(false && "constant has no cache entry");
+            return false;
+    }
+}
+
+const CpCacheEntry* InstanceKlass::resolve_slow(u2 index,
+                                                const ConstantPoolResolver& resolver) const {
+    using State = CpCacheEntry::State;
+    CpCacheEntry& entry = this->cp_cache[index];
+    for (;;) {
+        State state = entry.state.load(std::memory_order_acquire);
+        if (state == State::Resolved) return &entry;
+        if (state == State::Failed) {
+            if (entry.thrown) std::rethrow_exception(entry.thrown);
+            return nullptr;
+        }
+        if (state == State::Resolving) {
+            entry.state.wait(State::Resolving, std::memory_order_acquire);
+            continue;
+        }
+        if (!entry.state.compare_exchange_strong(state, State::Resolving,
+                                                 std::memory_order_acquire)) {
+            continue;
+        }
+
+        // this thread owns the entry until it stores the outcome
+        bool resolved = false;
+        try {
+            resolved = this->resolve_entry(index, entry, resolver);
+        } catch (const std::bad_alloc&) {
+            // a VirtualMachineError, not a LinkageError: the next call tries again
+            entry.state.store(State::Unresolved, std::memory_order_release);
+            entry.state.notify_all();
+            throw;
+        } catch (...) {
+            // loading or linking the class failed, ClassFormatError and the like
+            entry.thrown = std::current_exception();
+            entry.state.store(State::Failed, std::memory_order_release);
+            entry.state.notify_all();
+            throw;
+        }
+        State outcome = resolved ? State::Resolved
+                        : entry.error != nullptr ? State::Failed
+                                                 : State::Unresolved;
+        entry.state.store(outcome, std::memory_order_release);
+        entry.state.notify_all();
+        return resolved ? &entry : nullptr;
+    }
+}
+
+std::optional<AttributeWrapper> InstanceKlass::get_attribute(std::string_view name) const noexcept {
+    auto aptr = this->lookup_attribute(this->attributes, this->attributes_count, name);
+    if (aptr == nullptr) return std::nullopt;
+    return AttributeWrapper(aptr);
 }
 
 std::string InstanceKlass::utf8cp_to_string(raw_jvm_data::ConstantUtf8_ptr ptr) {
-    return std::string(reinterpret_cast<char*>(ptr->bytes), ptr->length);
+    return std::string(ptr->view());
 }
 
 std::string PrimitiveKlass::generate_primitive_klass_name() {
     switch (type) {
+        case raw_value_type::Jboolean:
+            return "boolean";
         case raw_value_type::Jbyte:
             return "byte";
         case raw_value_type::Jchar:
             return "char";
         case raw_value_type::Jshort:
-            return "int";
+            return "short";
         case raw_value_type::Jint:
             return "int";
+        case raw_value_type::Jlong:
+            return "long";
         case raw_value_type::Jfloat:
             return "float";
         case raw_value_type::Jdouble:
@@ -0,0 +1,143 @@
+#include "runtime/metaspace.hpp"
+#include <algorithm>
+
+using namespace rt_jvm_data;
+
+namespace {
+    constexpr std::size_t round_up(std::size_t value, std::size_t to) noexcept {
+        return (value + to - 1) & ~(to - 1);
+    }
+
+    constexpr std::size_t large_threshold = Metaspace::chunk_size / 4;
+}; // namespace
+
+Metaspace::Metaspace(std::pmr::memory_resource* upstream) : upstream(upstream) {
+}
+
+Metaspace::~Metaspace() {
+    // everything at once: blocks still handed out die with the loader
+    while (chunks != nullptr) {
+        Chunk* next = chunks->next;
+        upstream->deallocate(chunks, chunks->size, granule);
+        chunks = next;
+    }
+    while (large != nullptr) {
+        Large* next = large->next;
+        free_large(large);
+        large = next;
+    }
+}
+
+Metaspace& Metaspace::boot() {
+    static Metaspace* metaspace = new Metaspace();
+    return *metaspace;
+}
+
+Metaspace::Stats Metaspace::stats() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return counters;
+}
+
+void Metaspace::release(std::byte* block, std::size_t size) noexcept {
+    auto* free_block = reinterpret_cast<FreeBlock*>(block);
+    free_block->size = size;
+    if (size <= small_limit) {
+        auto& head = small_free[size / granule - 1];
+        free_block->next = head;
+        head = free_block;
+    } else {
+        free_block->next = medium_free;
+        medium_free = free_block;
+    }
+    counters.free += size;
+}
+
+std::byte* Metaspace::take_medium(std::size_t size) noexcept {
+    for (FreeBlock** link = &medium_free; *link != nullptr; link = &(*link)->next) {
+        FreeBlock* block = *link;
+        if (block->size < size) continue;
+        *link = block->next;
+        counters.free -= block->size;
+
+        // the rest of a bigger block goes back on a list
+        auto* bytes = reinterpret_cast<std::byte*>(block);
+        if (block->size > size) release(bytes + size, block->size - size);
+        return bytes;
+    }
+    return nullptr;
+}
+
+std::byte* Metaspace::bump(std::size_t size) {
+    if (cursor == nullptr || static_cast<std::size_t>(limit - cursor) < size) {
+        // the tail of the old chunk stays usable through the free lists
+        if (cursor != nullptr && cursor != limit) {
+            release(cursor, static_cast<std::size_t>(limit - cursor));
+        }
+        auto* chunk = static_cast<Chunk*>(upstream->allocate(chunk_size, granule));
+        chunk->next = chunks;
+        chunk->size = chunk_size;
+        chunks = chunk;
+        cursor = reinterpret_cast<std::byte*>(chunk) + round_up(sizeof(Chunk), granule);
+        limit = reinterpret_cast<std::byte*>(chunk) + chunk_size;
+        counters.reserved += chunk_size;
+        counters.chunks += 1;
+    }
+    std::byte* block = cursor;
+    cursor += size;
+    return block;
+}
+
+void Metaspace::free_large(Large* node) noexcept {
+    auto* base = reinterpret_cast<std::byte*>(node + 1) - round_up(sizeof(Large), node->align);
+    upstream->deallocate(base, node->total, node->align);
+}
+
+void* Metaspace::do_allocate(std::size_t bytes, std::size_t alignment) {
+    std::size_t size = round_up(std::max<std::size_t>(bytes, 1), granule);
+    std::lock_guard<std::mutex> lock(mtx);
+
+    if (size > large_threshold || alignment > granule) {
+        std::size_t align = std::max(alignment, granule);
+        std::size_t header = round_up(sizeof(Large), align);
+        auto* base = static_cast<std::byte*>(upstream->allocate(header + size, align));
+        auto* node = reinterpret_cast<Large*>(base + header) - 1;
+        *node = {nullptr, large, header + size, align};
+        if (large != nullptr) large->prev = node;
+        large = node;
+        counters.reserved += node->total;
+        counters.used += size;
+        return base + header;
+    }
+
+    std::byte* block = nullptr;
+    if (size <= small_limit) {
+        auto& head = small_free[size / granule - 1];
+        if (head != nullptr) {
+            block = reinterpret_cast<std::byte*>(head);
+            head = head->next;
+            counters.free -= size;
+        }
+    } else {
+        block = take_medium(size);
+    }
+    if (block == nullptr) block = bump(size);
+    counters.used += size;
+    return block;
+}
+
+void Metaspace::do_deallocate(void* p, std::size_t bytes, std::size_t alignment) {
+    std::size_t size = round_up(std::max<std::size_t>(bytes, 1), granule);
+    std::lock_guard<std::mutex> lock(mtx);
+    counters.used -= size;
+
+    if (size > large_threshold || alignment > granule) {
+        auto* node = static_cast<Large*>(p) - 1;
+        if (node->prev != nullptr) node->prev->next = node->next;
+        if (node->next != nullptr) node->next->prev = node->prev;
+        if (large == node) large = node->next;
+        counters.reserved -= node->total;
+        free_large(node);
+        return;
+    }
+    release(static_cast<std::byte*>(p), size);
+}
@@ -1,4 +1,38 @@
 #include "runtime/oop.hpp"
+#include <cstring>
 
 using namespace oop;
 
+void* Heap::allocate(std::size_t bytes) {
+    std::lock_guard<std::mutex> lock(mtx);
+    void* block = memory.allocate(bytes, alignof(std::max_align_t));
+    std::memset(block, 0, bytes);
+    return block;
+}
+
+Ref Heap::allocate_instance(Klass_ptr kls, raw_jvm_type::u4 field_bytes) {
+    auto* object = static_cast<InstanceOop*>(allocate(sizeof(InstanceOop) + field_bytes));
+    object->kls_ptr = kls;
+    return Ref(object);
+}
+
+Ref Heap::allocate_array(Klass_ptr array_klass, std::int32_t length,
+                         raw_jvm_type::u4 component_size) {
+    assert(length >= 0);
+    std::size_t bytes = sizeof(ArrayOop) + static_cast<std::size_t>(length) * component_size;
+    auto* array = static_cast<ArrayOop*>(allocate(bytes));
+    array->kls_ptr = array_klass;
+    array->length = length;
+    return Ref(array);
+}
+
+Monitor& Heap::monitor_of(Ref object) {
+    std::atomic_ref<Monitor_ptr> monitor(object.get()->word.monitor_p);
+    if (Monitor_ptr inflated = monitor.load(std::memory_order_acquire)) return *inflated;
+
+    std::lock_guard<std::mutex> lock(mtx);
+    if (Monitor_ptr inflated = monitor.load(std::memory_order_relaxed)) return *inflated;
+    Monitor_ptr inflated = monitors.emplace_back(std::make_unique<Monitor>()).get();
+    monitor.store(inflated, std::memory_order_release);
+    return *inflated;
+}
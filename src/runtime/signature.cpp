@@ -0,0 +1,81 @@
+#include "runtime/signature.hpp"
+
+using namespace rt_jvm_data;
+using namespace raw_jvm_type;
+
+namespace {
+    bool is_wide(raw_value_type type) noexcept {
+        return type == raw_value_type::Jlong || type == raw_value_type::Jdouble;
+    }
+}; // namespace
+
+std::optional<raw_value_type> rt_jvm_data::next_field_type(std::string_view desc,
+                                                           std::size_t& pos) {
+    if (pos >= desc.size()) return std::nullopt;
+    switch (desc[pos++]) {
+        case 'Z':
+            return raw_value_type::Jboolean;
+        case 'B':
+            return raw_value_type::Jbyte;
+        case 'C':
+            return raw_value_type::Jchar;
+        case 'S':
+            return raw_value_type::Jshort;
+        case 'I':
+            return raw_value_type::Jint;
+        case 'J':
+            return raw_value_type::Jlong;
+        case 'F':
+            return raw_value_type::Jfloat;
+        case 'D':
+            return raw_value_type::Jdouble;
+        case 'L': {
+            auto end = desc.find(';', pos);
+            if (end == std::string_view::npos || end == pos) return std::nullopt;
+            pos = end + 1;
+            return raw_value_type::Jreference;
+        }
+        case '[': {
+            std::size_t dims = 1;
+            while (pos < desc.size() && desc[pos] == '[') pos++, dims++;
+            if (dims > 255 || !next_field_type(desc, pos)) return std::nullopt;
+            return raw_value_type::Jreference;
+        }
+        default:
+            return std::nullopt;
+    }
+}
+
+std::optional<MethodSignature> MethodSignature::parse(std::string_view descriptor, bool is_static,
+                                                      std::pmr::memory_resource* metadata) {
+    if (descriptor.empty() || descriptor[0] != '(') return std::nullopt;
+    MethodSignature signature{std::pmr::vector<raw_value_type>(metadata), std::nullopt, 0, {}};
+    std::size_t slots = 0;
+    if (!is_static) signature.reference_slots.set(slots++);
+
+    std::size_t pos = 1;
+    while (pos < descriptor.size() && descriptor[pos] != ')') {
+        auto type = next_field_type(descriptor, pos);
+        if (!type) return std::nullopt;
+        signature.arguments.push_back(*type);
+        if (slots >= signature.reference_slots.size()) return std::nullopt;
+        if (*type == raw_value_type::Jreference) signature.reference_slots.set(slots);
+        slots += is_wide(*type) ? 2 : 1;
+    }
+    // JVMS 4.3.3: at most 255 slots, the receiver counted
+    if (pos >= descriptor.size() || slots > 255) return std::nullopt;
+    signature.argument_slots = static_cast<u2>(slots);
+
+    pos++;
+    if (pos + 1 == descriptor.size() && descriptor[pos] == 'V') return signature;
+    signature.return_type = next_field_type(descriptor, pos);
+    if (!signature.return_type || pos != descriptor.size()) return std::nullopt;
+    return signature;
+}
+
+std::optional<raw_value_type> rt_jvm_data::parse_field_descriptor(std::string_view descriptor) {
+    std::size_t pos = 0;
+    auto type = next_field_type(descriptor, pos);
+    if (pos != descriptor.size()) return std::nullopt;
+    return type;
+}
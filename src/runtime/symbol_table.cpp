@@ -0,0 +1,106 @@
+#include "runtime/symbol_table.hpp"
+#include <cstring>
+#include <stdexcept>
+
+using namespace raw_jvm_type;
+
+namespace {
+    // grow past half full, probes stay short with linear probing
+    constexpr unsigned initial_log2 = 12;
+
+    constexpr u8 pack(u4 hash, u4 id) noexcept {
+        return static_cast<u8>(hash) << 32 | id;
+    }
+}; // namespace
+
+SymbolTable::State SymbolTable::state;
+
+SymbolTable::Table::Table(unsigned log2)
+    : shift(log2), mask((std::size_t(1) << log2) - 1),
+      slots(std::make_unique<std::atomic<u8>[]>(std::size_t(1) << log2)) {
+}
+
+SymbolTable::State::State() {
+    tables.push_back(std::make_unique<Table>(initial_log2));
+    table.store(tables.back().get(), std::memory_order_release);
+}
+
+SymbolTable::State::~State() {
+    for (auto& segment : segments) delete[] segment.load(std::memory_order_relaxed);
+}
+
+Symbol SymbolTable::find(const Table& table, std::string_view str, u4 hash) noexcept {
+    for (std::size_t index = table.home(hash);; index = (index + 1) & table.mask) {
+        u8 slot = table.slots[index].load(std::memory_order_acquire);
+        if (slot == 0) return {};
+        if (static_cast<u4>(slot >> 32) != hash) continue;
+
+        u4 id = static_cast<u4>(slot);
+        const Entry& candidate = entry(id);
+        if (candidate.length == str.size() &&
+            std::memcmp(candidate.bytes, str.data(), str.size()) == 0) {
+            return {id};
+        }
+    }
+}
+
+Symbol SymbolTable::intern(std::string_view str, u4 hash) {
+    Symbol symbol = find(*state.table.load(std::memory_order_acquire), str, hash);
+    return symbol ? symbol : insert(str, hash);
+}
+
+Symbol SymbolTable::lookup(std::string_view str) noexcept {
+    u4 hash = mutf8::hash({reinterpret_cast<const u1*>(str.data()), str.size()});
+    Symbol symbol = find(*state.table.load(std::memory_order_acquire), str, hash);
+    if (symbol) return symbol;
+
+    // the table may have grown under us, the lock orders us after that
+    std::lock_guard<std::mutex> lock(state.insert_mtx);
+    return find(*state.table.load(std::memory_order_relaxed), str, hash);
+}
+
+void SymbolTable::grow() {
+    const Table& old = *state.tables.back();
+    auto grown = std::make_unique<Table>(old.shift + 1);
+    for (std::size_t index = 0; index <= old.mask; index++) {
+        u8 slot = old.slots[index].load(std::memory_order_relaxed);
+        if (slot == 0) continue;
+        std::size_t at = grown->home(static_cast<u4>(slot >> 32));
+        while (grown->slots[at].load(std::memory_order_relaxed) != 0) at = (at + 1) & grown->mask;
+        grown->slots[at].store(slot, std::memory_order_relaxed);
+    }
+    state.table.store(grown.get(), std::memory_order_release);
+    state.tables.push_back(std::move(grown));
+}
+
+Symbol SymbolTable::insert(std::string_view str, u4 hash) {
+    std::lock_guard<std::mutex> lock(state.insert_mtx);
+    // another thread may have inserted it since our probe
+    if (Symbol symbol = find(*state.tables.back(), str, hash)) return symbol;
+
+    u4 count = state.count.load(std::memory_order_relaxed);
+    if (count == UINT32_MAX) throw std::length_error("symbol table is full");
+    if ((std::size_t(count) + 1) * 2 > state.tables.back()->mask + 1) grow();
+
+    auto* bytes = static_cast<char*>(state.bytes.allocate(str.size() + 1, 1));
+    std::memcpy(bytes, str.data(), str.size());
+    bytes[str.size()] = '\0';
+
+    u4 id = count + 1;
+    u8 biased = static_cast<u8>(id) + (1u << segment_base_log2) - 1;
+    unsigned top = std::bit_width(biased) - 1;
+    auto& segment = state.segments[top - segment_base_log2];
+    if (segment.load(std::memory_order_relaxed) == nullptr) {
+        segment.store(new Entry[std::size_t(1) << top], std::memory_order_release);
+    }
+    segment.load(std::memory_order_relaxed)[biased - (u8(1) << top)] =
+        Entry{bytes, static_cast<u4>(str.size()), hash};
+
+    // publishing the slot releases the entry and its bytes to lock free readers
+    Table& table = *state.tables.back();
+    std::size_t at = table.home(hash);
+    while (table.slots[at].load(std::memory_order_relaxed) != 0) at = (at + 1) & table.mask;
+    table.slots[at].store(pack(hash, id), std::memory_order_release);
+    state.count.store(id, std::memory_order_relaxed);
+    return {id};
+}
@@ -0,0 +1,194 @@
+#include "runtime/system_dictionary.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+
+using namespace rt_jvm_data;
+using namespace raw_jvm_type;
+
+namespace {
+    constexpr std::size_t initial_capacity = 16;
+}; // namespace
+
+void SystemDictionary::Table::place(Entry* entry) noexcept {
+    std::size_t index = entry->hash & mask;
+    while (slots[index].load(std::memory_order_relaxed) != nullptr) index = (index + 1) & mask;
+    slots[index].store(entry, std::memory_order_release);
+}
+
+SystemDictionary::Table::Table(std::size_t capacity)
+    : mask(capacity - 1), slots(std::make_unique<std::atomic<Entry*>[]>(capacity)) {
+}
+
+SystemDictionary::Shard::Shard() {
+    tables.push_back(std::make_unique<Table>(initial_capacity));
+    table.store(tables.back().get(), std::memory_order_release);
+}
+
+u4 SystemDictionary::hash_of(const ClassLoaderData* loader, Symbol name) noexcept {
+    // the top bits pick the shard, the low bits the home slot within it
+    auto word = static_cast<u8>(reinterpret_cast<std::uintptr_t>(loader)) ^ name.hash();
+    return static_cast<u4>((word * 0x9E3779B97F4A7C15ull) >> 32);
+}
+
+SystemDictionary::Entry* SystemDictionary::Shard::find(const ClassLoaderData* loader, Symbol name,
+                                                       u4 hash) const noexcept {
+    const Table& current = *table.load(std::memory_order_acquire);
+    for (std::size_t index = hash & current.mask;; index = (index + 1) & current.mask) {
+        Entry* entry = current.slots[index].load(std::memory_order_acquire);
+        if (entry == nullptr) return nullptr;
+        if (entry->name == name && entry->loader == loader) return entry;
+    }
+}
+
+SystemDictionary::Entry& SystemDictionary::Shard::find_or_add(const ClassLoaderData* loader,
+                                                              Symbol name, u4 hash) {
+    std::lock_guard<std::mutex> lock(insert_mtx);
+    // a reader of an older table may have missed an entry added since
+    if (Entry* entry = find(loader, name, hash)) return *entry;
+
+    Table* current = table.load(std::memory_order_relaxed);
+    // stay at most half full
+    if ((entries.size() + 1) * 2 > current->mask + 1) {
+        tables.push_back(std::make_unique<Table>((current->mask + 1) * 2));
+        current = tables.back().get();
+        for (const auto& entry : entries) current->place(entry.get());
+        table.store(current, std::memory_order_release);
+    }
+
+    Entry* entry = entries.emplace_back(std::make_unique<Entry>(loader, name, hash)).get();
+    current->place(entry);
+    return *entry;
+}
+
+void SystemDictionary::Shard::rebuild() {
+    // as small as find_or_add lets it be, so a shard shrinks with its loaders
+    auto capacity = std::max(initial_capacity, std::bit_ceil(entries.size() * 2));
+    auto fresh = std::make_unique<Table>(capacity);
+    for (const auto& entry : entries) fresh->place(entry.get());
+    table.store(fresh.get(), std::memory_order_release);
+    tables.clear();
+    tables.push_back(std::move(fresh));
+}
+
+InstanceKlass_ptr SystemDictionary::find(const ClassLoaderData* loader,
+                                         Symbol name) const noexcept {
+    u4 hash = hash_of(loader, name);
+    const Entry* entry = shard_of(hash).find(loader, name, hash);
+    return entry == nullptr ? nullptr : entry->klass.load(std::memory_order_acquire);
+}
+
+InstanceKlass_ptr SystemDictionary::find(std::string_view name) const noexcept {
+    // a name never interned cannot have been loaded
+    Symbol symbol = SymbolTable::lookup(name);
+    return symbol ? find(nullptr, symbol) : nullptr;
+}
+
+InstanceKlass_ptr SystemDictionary::resolve_or_load(const ClassLoaderData* loader, Symbol name,
+                                                    const LoadFunction& load) {
+    using State = Entry::State;
+    u4 hash = hash_of(loader, name);
+    Shard& shard = shard_of(hash);
+    Entry* entry = shard.find(loader, name, hash);
+    if (entry != nullptr) {
+        if (auto* kls = entry->klass.load(std::memory_order_acquire)) return kls;
+    } else {
+        entry = &shard.find_or_add(loader, name, hash);
+    }
+
+    for (;;) {
+        State state = entry->state.load(std::memory_order_acquire);
+        if (state == State::Loaded) return entry->klass.load(std::memory_order_acquire);
+        if (state == State::Loading) {
+            if (entry->owner.load(std::memory_order_relaxed) == std::this_thread::get_id()) {
+                throw ClassCircularityError(std::string(name.view()));
+            }
+            entry->state.wait(State::Loading, std::memory_order_acquire);
+            continue;
+        }
+        if (!entry->state.compare_exchange_strong(state, State::Loading,
+                                                  std::memory_order_acquire)) {
+            continue;
+        }
+        break;
+    }
+
+    // the placeholder is ours; hand it back to the next caller on any failure
+    entry->owner.store(std::this_thread::get_id(), std::memory_order_relaxed);
+    auto release = [&](State outcome) {
+        entry->owner.store(std::thread::id{}, std::memory_order_relaxed);
+        entry->state.store(outcome, std::memory_order_release);
+        entry->state.notify_all();
+    };
+
+    std::unique_ptr<InstanceKlass> kls;
+    try {
+        kls = load();
+    } catch (...) {
+        release(State::Free);
+        throw;
+    }
+    if (kls == nullptr) {
+        release(State::Free);
+        return nullptr;
+    }
+    if (kls->get_klass_name() != name.view()) {
+        release(State::Free);
+        throw NoClassDefFoundError(std::string(name.view()) + " (wrong name: " +
+                                   kls->get_klass_name() + ")");
+    }
+
+    InstanceKlass* raw = kls.get();
+    entry->owned = std::move(kls);
+    entry->klass.store(raw, std::memory_order_release);
+    release(State::Loaded);
+    return raw;
+}
+
+InstanceKlass_ptr SystemDictionary::publish(std::unique_ptr<InstanceKlass> kls) {
+    Symbol name = SymbolTable::intern(kls->get_klass_name());
+    const ClassLoaderData* loader = kls->get_loader();
+    return resolve_or_load(loader, name, [&] { return std::move(kls); });
+}
+
+std::size_t SystemDictionary::size() const {
+    std::size_t total = 0;
+    for (const auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.insert_mtx);
+        for (const auto& entry : shard.entries) {
+            if (entry->klass.load(std::memory_order_acquire) != nullptr) total++;
+        }
+    }
+    return total;
+}
+
+std::vector<InstanceKlass_ptr> SystemDictionary::snapshot() const {
+    std::vector<InstanceKlass_ptr> klasses;
+    for (const auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.insert_mtx);
+        for (const auto& entry : shard.entries) {
+            if (auto* kls = entry->klass.load(std::memory_order_acquire)) klasses.push_back(kls);
+        }
+    }
+    return klasses;
+}
+
+std::vector<std::unique_ptr<InstanceKlass>>
+SystemDictionary::unlink(const std::function<bool(const ClassLoaderData*)>& is_unloading) {
+    std::vector<std::unique_ptr<InstanceKlass>> unlinked;
+    for (auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.insert_mtx);
+        auto dead = std::stable_partition(shard.entries.begin(), shard.entries.end(),
+                                          [&](const auto& entry) {
+                                              return entry->loader == nullptr ||
+                                                     !is_unloading(entry->loader);
+                                          });
+        if (dead == shard.entries.end() && shard.tables.size() == 1) continue;
+        for (auto it = dead; it != shard.entries.end(); ++it) {
+            if ((*it)->owned) unlinked.push_back(std::move((*it)->owned));
+        }
+        shard.entries.erase(dead, shard.entries.end());
+        shard.rebuild();
+    }
+    return unlinked;
+}
@@ -0,0 +1,1261 @@
+#include "runtime/verifier.hpp"
+#include "runtime/symbol_table.hpp"
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace rt_jvm_data;
+using namespace raw_jvm_data;
+
+namespace {
+    enum class Kind : u1 { Top, Int, Float, Long, Double, Null, UninitThis, Uninit, Ref };
+
+    // One verification type. Long and double take two slots, the second is a Top
+    // so that splitting them apart is caught like any other type error. Ref names
+    // are internal class names or array descriptors.
+    struct VType {
+        Kind kind = Kind::Top;
+        // pc of the `new` creating an Uninit value
+        u2 offset = 0;
+        std::string_view name;
+
+        static VType ref(std::string_view name) noexcept {
+            return {Kind::Ref, 0, name};
+        }
+
+        bool is_wide() const noexcept {
+            return kind == Kind::Long || kind == Kind::Double;
+        }
+
+        bool is_reference() const noexcept {
+            return kind >= Kind::Null;
+        }
+
+        bool operator==(const VType& other) const noexcept {
+            if (kind != other.kind) return false;
+            if (kind == Kind::Uninit) return offset == other.offset;
+            if (kind == Kind::Ref) return name == other.name;
+            return true;
+        }
+    };
+
+    const VType top{Kind::Top, 0, {}};
+    const VType int_{Kind::Int, 0, {}};
+    const VType float_{Kind::Float, 0, {}};
+    const VType long_{Kind::Long, 0, {}};
+    const VType double_{Kind::Double, 0, {}};
+    const VType null{Kind::Null, 0, {}};
+    const VType object = VType::ref("java/lang/Object");
+    const VType throwable = VType::ref("java/lang/Throwable");
+
+    // operand kinds of the xload_<n> and xstore_<n> groups, in opcode order
+    const Kind typed_kinds[] = {Kind::Int, Kind::Long, Kind::Float, Kind::Double, Kind::Ref};
+
+    struct Frame {
+        std::vector<VType> locals;
+        std::vector<VType> stack;
+        // set while `this` is an UninitializedThis in some local
+        bool this_uninit = false;
+    };
+
+    struct MethodType {
+        std::vector<VType> args;
+        std::optional<VType> ret;
+    };
+
+    // the verification type of the field type at `pos`, advancing past it;
+    // empty on a malformed descriptor
+    std::optional<VType> parse_field_type(std::string_view desc, std::size_t& pos) {
+        std::size_t start = pos;
+        auto type = next_field_type(desc, pos);
+        if (!type) return std::nullopt;
+        switch (*type) {
+            case raw_value_type::Jfloat:
+                return float_;
+            case raw_value_type::Jlong:
+                return long_;
+            case raw_value_type::Jdouble:
+                return double_;
+            case raw_value_type::Jreference:
+                // a class by its internal name, an array by its descriptor
+                if (desc[start] == 'L') return VType::ref(desc.substr(start + 1, pos - start - 2));
+                return VType::ref(desc.substr(start, pos - start));
+            default:
+                return int_;
+        }
+    }
+
+    // The verification types of the method descriptor `signature` was parsed
+    // from. The signature has the shape of the descriptor checked already,
+    // the descriptor adds the class names.
+    MethodType method_type(const MethodSignature& signature, std::string_view desc) {
+        MethodType type;
+        std::size_t pos = 1;
+        for (std::size_t index = 0; index < signature.arguments.size(); index++) {
+            type.args.push_back(*parse_field_type(desc, pos));
+        }
+        pos++;
+        if (signature.return_type) type.ret = parse_field_type(desc, pos);
+        return type;
+    }
+
+    // element type of an array descriptor: a Ref, or Int/Float/... for primitives
+    VType component_of(std::string_view array) {
+        std::size_t pos = 1;
+        return parse_field_type(array, pos).value_or(top);
+    }
+
+    bool is_array(const VType& t) noexcept {
+        return t.kind == Kind::Ref && !t.name.empty() && t.name[0] == '[';
+    }
+
+} // namespace
+
+// One method's check; nested in Verifier to share its access to the class file.
+class rt_jvm_data::Verifier::MethodVerifier {
+  private:
+    const InstanceKlass& kls;
+    const AssignabilityCheck& hierarchy;
+    const MethodWrapper& method;
+    const CodeInfo& info;
+    std::span<const u1> code;
+    std::string_view this_name;
+    std::string_view method_name;
+    std::string_view method_desc;
+    MethodType type;
+
+    // frame index per pc, -1 where the stack map has none
+    std::vector<int> frame_at;
+    std::vector<Frame> frames;
+    std::vector<bool> starts;
+
+    // Class files older than 50 have no stack maps: the frame on entry to
+    // each instruction is inferred instead, merging every path that reaches
+    // it until nothing changes (JVMS 4.10.2). `pending` marks the
+    // instructions whose entry frame changed since they were last run.
+    bool inferring = false;
+    std::vector<std::optional<Frame>> inferred;
+    std::vector<bool> pending;
+
+    [[noreturn]] void fail(u4 pc, const std::string& why) const {
+        throw VerifyError(std::string(this_name) + "." + std::string(method_name) +
+                          std::string(method_desc) + " at pc " + std::to_string(pc) + ": " +
+                          why);
+    }
+
+    // === constant pool ===
+
+    const ConstantPoolEntry& cp(u4 pc, u2 index, u1 tag) const {
+        if (index == 0 || index >= kls.constant_pool_count || kls.cp_tag(index) != tag) {
+            fail(pc, "bad constant pool reference #" + std::to_string(index));
+        }
+        return kls.constant_pool[index];
+    }
+
+    std::string_view utf8(u4 pc, u2 index) const {
+        return cp(pc, index, CONSTANT_Utf8).utf8.view();
+    }
+
+    std::string_view class_name(u4 pc, u2 index) const {
+        return utf8(pc, cp(pc, index, CONSTANT_Class).klass.name_index);
+    }
+
+    // Ref for a CONSTANT_Class, whose name is already a descriptor for arrays
+    VType class_type(u4 pc, u2 index) const {
+        return VType::ref(class_name(pc, index));
+    }
+
+    // class, name and descriptor of a field or method reference
+    struct MemberRef {
+        std::string_view owner;
+        std::string_view name;
+        std::string_view desc;
+    };
+
+    MemberRef member_ref(u4 pc, u2 index, u1 tag) const {
+        const auto& entry = cp(pc, index, tag);
+        // every ref kind shares the layout of ConstantFieldRef
+        const auto& nat = cp(pc, entry.field_ref.name_and_type_index, CONSTANT_NameAndType);
+        return {class_name(pc, entry.field_ref.name_index),
+                utf8(pc, nat.name_and_type.name_index),
+                utf8(pc, nat.name_and_type.descriptor_index)};
+    }
+
+    // === types ===
+
+    bool class_assignable(std::string_view from, std::string_view to) const {
+        if (from == to || to == "java/lang/Object") return true;
+        if (from[0] == '[') {
+            if (to == "java/lang/Cloneable" || to == "java/io/Serializable") return true;
+            if (to[0] != '[') return false;
+            VType from_elem = component_of(from), to_elem = component_of(to);
+            if (from_elem.kind != Kind::Ref || to_elem.kind != Kind::Ref) {
+                return from_elem == to_elem;
+            }
+            return class_assignable(from_elem.name, to_elem.name);
+        }
+        if (to[0] == '[') return false;
+        return hierarchy && hierarchy(from, to);
+    }
+
+    bool assignable(const VType& from, const VType& to) const {
+        switch (to.kind) {
+            case Kind::Top:
+                return true;
+            case Kind::Ref:
+                if (from.kind == Kind::Null) return true;
+                return from.kind == Kind::Ref && class_assignable(from.name, to.name);
+            default:
+                return from == to;
+        }
+    }
+
+    bool frame_assignable(const Frame& from, const Frame& to) const {
+        if (from.stack.size() != to.stack.size()) return false;
+        if (from.this_uninit && !to.this_uninit) return false;
+        for (std::size_t index = 0; index < from.locals.size(); index++) {
+            if (!assignable(from.locals[index], to.locals[index])) return false;
+        }
+        for (std::size_t index = 0; index < from.stack.size(); index++) {
+            if (!assignable(from.stack[index], to.stack[index])) return false;
+        }
+        return true;
+    }
+
+    // === frames ===
+
+    Frame expand(u4 pc, const std::vector<VType>& locals, std::vector<VType> stack) const {
+        Frame frame;
+        for (const auto& local : locals) {
+            frame.locals.push_back(local);
+            if (local.is_wide()) frame.locals.push_back(top);
+            if (local.kind == Kind::UninitThis) frame.this_uninit = true;
+        }
+        if (frame.locals.size() > info.max_locals) fail(pc, "stack map exceeds max_locals");
+        frame.locals.resize(info.max_locals, top);
+
+        for (const auto& item : stack) {
+            frame.stack.push_back(item);
+            if (item.is_wide()) frame.stack.push_back(top);
+        }
+        if (frame.stack.size() > info.max_stack) fail(pc, "stack map exceeds max_stack");
+        return frame;
+    }
+
+    // locals of the method entry, one entry per value as stack maps count them
+    std::vector<VType> entry_locals() const {
+        std::vector<VType> locals;
+        if (!(method.mptr->access_flags & ACC_STATIC)) {
+            bool constructing = method_name == "<init>" && this_name != "java/lang/Object";
+            locals.push_back(constructing ? VType{Kind::UninitThis, 0, {}} : VType::ref(this_name));
+        }
+        locals.insert(locals.end(), type.args.begin(), type.args.end());
+        return locals;
+    }
+
+    VType read_stack_map_type(ByteCodeReader& in, u4 pc) const {
+        u1 tag = 0;
+        in.read_u1(&tag);
+        switch (tag) {
+            case 0:
+                return top;
+            case 1:
+                return int_;
+            case 2:
+                return float_;
+            case 3:
+                return double_;
+            case 4:
+                return long_;
+            case 5:
+                return null;
+            case 6:
+                return {Kind::UninitThis, 0, {}};
+            case 7: {
+                u2 index = 0;
+                in.read_u2(&index);
+                return class_type(pc, index);
+            }
+            case 8: {
+                u2 offset = 0;
+                in.read_u2(&offset);
+                if (offset >= code.size() || !starts[offset] || code[offset] != 0xBB) {
+                    fail(pc, "uninitialized type does not name a new instruction");
+                }
+                return {Kind::Uninit, offset, {}};
+            }
+            default:
+                fail(pc, "bad verification type tag " + std::to_string(tag));
+        }
+    }
+
+    void read_stack_maps() {
+        frame_at.assign(code.size(), -1);
+        if (info.stack_map_table.empty()) return;
+
+        ByteCodeReader in(info.stack_map_table);
+        u2 count = 0;
+        in.read_u2(&count);
+
+        std::vector<VType> locals = entry_locals();
+        int pc = -1;
+        for (u2 index = 0; index < count; index++) {
+            u1 frame_type = 0;
+            in.read_u1(&frame_type);
+
+            u2 delta = 0;
+            std::vector<VType> stack;
+            if (frame_type <= 63) {
+                delta = frame_type;
+            } else if (frame_type <= 127) {
+                delta = frame_type - 64;
+                stack.push_back(read_stack_map_type(in, pc + delta + 1));
+            } else if (frame_type < 247) {
+                fail(pc + 1, "reserved stack map frame type " + std::to_string(frame_type));
+            } else {
+                in.read_u2(&delta);
+                if (frame_type == 247) {
+                    stack.push_back(read_stack_map_type(in, pc + delta + 1));
+                } else if (frame_type <= 250) {
+                    std::size_t chop = 251 - frame_type;
+                    if (chop > locals.size()) {
+                        fail(pc + delta + 1, "stack map chops too many locals");
+                    }
+                    locals.resize(locals.size() - chop);
+                } else if (frame_type >= 252 && frame_type <= 254) {
+                    for (int added = 0; added < frame_type - 251; added++) {
+                        locals.push_back(read_stack_map_type(in, pc + delta + 1));
+                    }
+                } else if (frame_type == 255) {
+                    u2 local_count = 0, stack_count = 0;
+                    in.read_u2(&local_count);
+                    locals.clear();
+                    for (u2 local = 0; local < local_count; local++) {
+                        locals.push_back(read_stack_map_type(in, pc + delta + 1));
+                    }
+                    in.read_u2(&stack_count);
+                    for (u2 item = 0; item < stack_count; item++) {
+                        stack.push_back(read_stack_map_type(in, pc + delta + 1));
+                    }
+                }
+            }
+
+            pc += delta + 1;
+            if (static_cast<std::size_t>(pc) >= code.size() || !starts[pc]) {
+                fail(pc, "stack map frame is not at an instruction");
+            }
+            frame_at[pc] = static_cast<int>(frames.size());
+            frames.push_back(expand(pc, locals, std::move(stack)));
+        }
+    }
+
+    // === instruction stream ===
+
+    u1 u1_at(u4 pc) const {
+        if (pc >= code.size()) fail(pc, "truncated instruction");
+        return code[pc];
+    }
+
+    u2 u2_at(u4 pc) const {
+        return static_cast<u2>(u1_at(pc) << 8 | u1_at(pc + 1));
+    }
+
+    int32_t s4_at(u4 pc) const {
+        return static_cast<int32_t>(static_cast<u4>(u2_at(pc)) << 16 | u2_at(pc + 2));
+    }
+
+    u4 instruction_length(u4 pc) const {
+        u1 op = code[pc];
+        switch (op) {
+            case 0x10: case 0x12: case 0x15: case 0x16: case 0x17: case 0x18: case 0x19:
+            case 0x36: case 0x37: case 0x38: case 0x39: case 0x3a: case 0xa9: case 0xbc:
+                return 2;
+            case 0x11: case 0x13: case 0x14: case 0x84: case 0xb2: case 0xb3: case 0xb4:
+            case 0xb5: case 0xb6: case 0xb7: case 0xb8: case 0xbb: case 0xbd: case 0xc0:
+            case 0xc1: case 0xc6: case 0xc7:
+                return 3;
+            case 0xc5:
+                return 4;
+            case 0xb9: case 0xba: case 0xc8: case 0xc9:
+                return 5;
+            case 0xaa: {
+                u4 base = (pc + 4) & ~3u;
+                int32_t low = s4_at(base + 4), high = s4_at(base + 8);
+                if (low > high) fail(pc, "tableswitch low exceeds high");
+                return base - pc + 12 + 4 * (static_cast<int64_t>(high) - low + 1);
+            }
+            case 0xab: {
+                u4 base = (pc + 4) & ~3u;
+                int32_t pairs = s4_at(base + 4);
+                if (pairs < 0) fail(pc, "negative lookupswitch size");
+                return base - pc + 8 + 8 * static_cast<u4>(pairs);
+            }
+            case 0xc4: {
+                u1 widened = u1_at(pc + 1);
+                if (widened == 0x84) return 6;
+                if ((widened >= 0x15 && widened <= 0x19) || (widened >= 0x36 && widened <= 0x3a)) {
+                    return 4;
+                }
+                fail(pc, "bad wide instruction");
+            }
+            default:
+                if (op > 0xc9) fail(pc, "illegal opcode " + std::to_string(op));
+                // 0xa0..0xa8 conditional and unconditional branches
+                if (op >= 0x99 && op <= 0xa8) return 3;
+                return 1;
+        }
+    }
+
+    void find_instruction_starts() {
+        starts.assign(code.size(), false);
+        for (u4 pc = 0; pc < code.size();) {
+            starts[pc] = true;
+            u4 length = instruction_length(pc);
+            if (length == 0 || pc + length > code.size()) {
+                fail(pc, "instruction runs past code end");
+            }
+            pc += length;
+        }
+    }
+
+    // === operand stack and locals ===
+
+    Frame cur;
+
+    void push(u4 pc, const VType& t) {
+        if (t.kind == Kind::Top) fail(pc, "pushing top");
+        cur.stack.push_back(t);
+        if (t.is_wide()) cur.stack.push_back(top);
+        if (cur.stack.size() > info.max_stack) fail(pc, "operand stack overflow");
+    }
+
+    VType pop(u4 pc) {
+        if (cur.stack.empty()) fail(pc, "operand stack underflow");
+        VType t = cur.stack.back();
+        cur.stack.pop_back();
+        if (t.kind == Kind::Top) {
+            if (cur.stack.empty() || !cur.stack.back().is_wide()) fail(pc, "broken wide value");
+            t = cur.stack.back();
+            cur.stack.pop_back();
+        }
+        return t;
+    }
+
+    VType pop(u4 pc, const VType& expected) {
+        VType t = pop(pc);
+        if (!assignable(t, expected)) fail(pc, "operand stack has the wrong type");
+        return t;
+    }
+
+    // any reference, initialized or not
+    VType pop_reference(u4 pc) {
+        VType t = pop(pc);
+        if (!t.is_reference()) fail(pc, "expected a reference on the operand stack");
+        return t;
+    }
+
+    VType pop_initialized(u4 pc) {
+        VType t = pop_reference(pc);
+        if (t.kind == Kind::UninitThis || t.kind == Kind::Uninit) {
+            fail(pc, "use of an uninitialized object");
+        }
+        return t;
+    }
+
+    // the top `depth` slots can be moved as a unit without splitting a wide value
+    bool boundary(std::size_t depth) const {
+        return cur.stack.size() >= depth && cur.stack[cur.stack.size() - depth].kind != Kind::Top;
+    }
+
+    // dup family: copy the top `count` slots below the `skip` slots under them
+    void dup(u4 pc, std::size_t count, std::size_t skip) {
+        if (!boundary(count) || !boundary(count + skip)) fail(pc, "bad dup operands");
+        std::vector<VType> copied(cur.stack.end() - count, cur.stack.end());
+        cur.stack.insert(cur.stack.end() - count - skip, copied.begin(), copied.end());
+        if (cur.stack.size() > info.max_stack) fail(pc, "operand stack overflow");
+    }
+
+    void check_local(u4 pc, u4 index, bool wide) const {
+        if (index + (wide ? 1 : 0) >= info.max_locals) fail(pc, "local index out of range");
+    }
+
+    void load(u4 pc, u4 index, const VType& expected) {
+        check_local(pc, index, expected.is_wide());
+        const VType& t = cur.locals[index];
+        if (expected.kind == Kind::Ref) {
+            if (!t.is_reference()) fail(pc, "aload of a non reference local");
+            push(pc, t);
+            return;
+        }
+        if (!(t == expected)) fail(pc, "local has the wrong type");
+        push(pc, t);
+    }
+
+    void store(u4 pc, u4 index, const VType& t) {
+        check_local(pc, index, t.is_wide());
+        if (index > 0 && cur.locals[index - 1].is_wide()) cur.locals[index - 1] = top;
+        cur.locals[index] = t;
+        if (t.is_wide()) cur.locals[index + 1] = top;
+    }
+
+    void store(u4 pc, u4 index, Kind kind) {
+        VType t = kind == Kind::Ref ? pop_reference(pc) : pop(pc, VType{kind, 0, {}});
+        store(pc, index, t);
+    }
+
+    // === type inference ===
+
+    // the type both `a` and `b` are assignable to, Top when there is none
+    VType merge(const VType& a, const VType& b) const {
+        if (a == b) return a;
+        bool initialized_a = a.kind == Kind::Ref || a.kind == Kind::Null;
+        bool initialized_b = b.kind == Kind::Ref || b.kind == Kind::Null;
+        if (!initialized_a || !initialized_b) return top;
+        if (assignable(a, b)) return b;
+        if (assignable(b, a)) return a;
+        // the common superclass needs the hierarchy, Object holds either
+        return object;
+    }
+
+    // merges `incoming` into the frame inferred at `target`
+    void flow(u4 pc, int64_t target, const Frame& incoming) {
+        if (target < 0 || static_cast<u8>(target) >= code.size() || !starts[target]) {
+            fail(pc, "branch target " + std::to_string(target) + " is not an instruction");
+        }
+        auto& known = inferred[target];
+        if (!known) {
+            known = incoming;
+            pending[target] = true;
+            return;
+        }
+        if (known->stack.size() != incoming.stack.size()) {
+            fail(pc, "operand stack height differs at " + std::to_string(target));
+        }
+        bool changed = false;
+        auto merge_into = [&](VType& slot, const VType& other, bool on_stack) {
+            VType merged = merge(slot, other);
+            if (on_stack && merged.kind == Kind::Top && !(slot == other)) {
+                fail(pc, "operand stack types differ at " + std::to_string(target));
+            }
+            if (!(merged == slot)) {
+                slot = merged;
+                changed = true;
+            }
+        };
+        for (std::size_t index = 0; index < known->locals.size(); index++) {
+            merge_into(known->locals[index], incoming.locals[index], false);
+        }
+        for (std::size_t index = 0; index < known->stack.size(); index++) {
+            merge_into(known->stack[index], incoming.stack[index], true);
+        }
+        if (incoming.this_uninit && !known->this_uninit) {
+            known->this_uninit = true;
+            changed = true;
+        }
+        if (changed) pending[target] = true;
+    }
+
+    void infer() {
+        inferred.assign(code.size(), std::nullopt);
+        pending.assign(code.size(), false);
+        inferred[0] = expand(0, entry_locals(), {});
+        pending[0] = true;
+
+        // passes in code order until no entry frame changes
+        for (bool again = true; again;) {
+            again = false;
+            for (u4 pc = 0; pc < code.size(); pc += instruction_length(pc)) {
+                if (!pending[pc]) continue;
+                pending[pc] = false;
+                cur = *inferred[pc];
+                check_handlers(pc);
+                bool falls_through = execute(pc);
+                check_handlers(pc);
+                if (!falls_through) continue;
+
+                u4 next = pc + instruction_length(pc);
+                if (next >= code.size()) fail(next, "control falls off the end of the code");
+                flow(pc, next, cur);
+            }
+            // a backward edge changed an instruction already passed
+            for (u4 pc = 0; pc < code.size() && !again; pc++) again = pending[pc];
+        }
+    }
+
+    // === control flow ===
+
+    const Frame& frame_for(u4 pc, u4 target) const {
+        if (target >= code.size() || frame_at[target] < 0) {
+            fail(pc, "branch target " + std::to_string(target) + " has no stack map frame");
+        }
+        return frames[frame_at[target]];
+    }
+
+    void branch(u4 pc, int64_t target) {
+        if (inferring) return flow(pc, target, cur);
+        if (target < 0) fail(pc, "branch before code start");
+        if (!frame_assignable(cur, frame_for(pc, static_cast<u4>(target)))) {
+            fail(pc, "frame does not match the stack map at " + std::to_string(target));
+        }
+    }
+
+    void check_handlers(u4 pc) {
+        for (const auto& handler : info.exception_table) {
+            if (pc < handler.start_pc || pc >= handler.end_pc) continue;
+            Frame thrown{cur.locals, {}, cur.this_uninit};
+            thrown.stack.push_back(handler.catch_type == 0 ? throwable
+                                                           : class_type(pc, handler.catch_type));
+            if (!class_assignable(thrown.stack[0].name, throwable.name)) {
+                fail(pc, "handler catches a non throwable");
+            }
+            if (inferring) {
+                flow(pc, handler.handler_pc, thrown);
+                continue;
+            }
+            if (!frame_assignable(thrown, frame_for(pc, handler.handler_pc))) {
+                fail(pc, "frame does not match the handler at " +
+                             std::to_string(handler.handler_pc));
+            }
+        }
+    }
+
+    // === instructions ===
+
+    void arith(u4 pc, const VType& t, int operands) {
+        for (int index = 0; index < operands; index++) pop(pc, t);
+        push(pc, t);
+    }
+
+    void convert(u4 pc, const VType& from, const VType& to) {
+        pop(pc, from);
+        push(pc, to);
+    }
+
+    // element type an array load produces, Null for a null array
+    VType pop_array(u4 pc, const VType& element) {
+        pop(pc, int_);
+        VType array = pop_reference(pc);
+        if (array.kind == Kind::Null) return element.kind == Kind::Ref ? null : element;
+        if (!is_array(array)) fail(pc, "not an array");
+        VType actual = component_of(array.name);
+        if (element.kind == Kind::Ref) {
+            if (actual.kind != Kind::Ref) fail(pc, "not an array of references");
+            return actual;
+        }
+        // baload and bastore work on both byte and boolean arrays
+        if (element.kind == Kind::Int && element.name == "B") {
+            if (array.name != "[B" && array.name != "[Z") fail(pc, "not a byte or boolean array");
+            return int_;
+        }
+        if (array.name != element.name) fail(pc, "array of the wrong element type");
+        return actual;
+    }
+
+    void array_load(u4 pc, const VType& element) {
+        push(pc, pop_array(pc, element));
+    }
+
+    void array_store(u4 pc, const VType& element) {
+        VType value = element.kind == Kind::Ref ? pop_initialized(pc) : pop(pc, element);
+        (void)value;
+        pop_array(pc, element);
+    }
+
+    void ldc(u4 pc, u2 index, bool wide_value) {
+        if (index == 0 || index >= kls.constant_pool_count) fail(pc, "bad ldc index");
+        u1 tag = kls.cp_tag(index);
+        if (wide_value) {
+            if (tag == CONSTANT_Long) return push(pc, long_);
+            if (tag == CONSTANT_Double) return push(pc, double_);
+            fail(pc, "ldc2_w of a narrow constant");
+        }
+        switch (tag) {
+            case CONSTANT_Integer:
+                return push(pc, int_);
+            case CONSTANT_Float:
+                return push(pc, float_);
+            case CONSTANT_String:
+                return push(pc, VType::ref("java/lang/String"));
+            case CONSTANT_Class:
+                return push(pc, VType::ref("java/lang/Class"));
+            case CONSTANT_MethodType:
+                return push(pc, VType::ref("java/lang/invoke/MethodType"));
+            case CONSTANT_MethodHandle:
+                return push(pc, VType::ref("java/lang/invoke/MethodHandle"));
+            default:
+                fail(pc, "ldc of an unloadable constant");
+        }
+    }
+
+    void field_access(u4 pc, u1 op) {
+        auto ref = member_ref(pc, u2_at(pc + 1), CONSTANT_Fieldref);
+        std::size_t pos = 0;
+        auto field = parse_field_type(ref.desc, pos);
+        if (!field || pos != ref.desc.size()) fail(pc, "bad field descriptor");
+
+        switch (op) {
+            case 0xb2:
+                return push(pc, *field);
+            case 0xb3:
+                pop(pc, *field);
+                return;
+            case 0xb4:
+                pop(pc, VType::ref(ref.owner));
+                return push(pc, *field);
+            case 0xb5: {
+                pop(pc, *field);
+                VType target = pop_reference(pc);
+                // a constructor may set its own fields before calling super()
+                if (target.kind == Kind::UninitThis && ref.owner == this_name) return;
+                if (!assignable(target, VType::ref(ref.owner))) fail(pc, "putfield on wrong type");
+                return;
+            }
+        }
+    }
+
+    // every occurrence of an object being constructed becomes the initialized type
+    void initialize(const VType& uninit, const VType& initialized) {
+        for (auto& local : cur.locals) {
+            if (local == uninit) local = initialized;
+        }
+        for (auto& item : cur.stack) {
+            if (item == uninit) item = initialized;
+        }
+        if (uninit.kind == Kind::UninitThis) cur.this_uninit = false;
+    }
+
+    void invoke(u4 pc, u1 op) {
+        u2 index = u2_at(pc + 1);
+        MemberRef ref;
+        if (op == 0xba) {
+            const auto& indy = cp(pc, index, CONSTANT_InvokeDynamic).invoke_dynamic;
+            const auto& nat = cp(pc, indy.name_and_type_index, CONSTANT_NameAndType);
+            ref = {"", utf8(pc, nat.name_and_type.name_index),
+                   utf8(pc, nat.name_and_type.descriptor_index)};
+            if (u1_at(pc + 3) != 0 || u1_at(pc + 4) != 0) fail(pc, "invokedynamic padding");
+        } else if (op == 0xb9) {
+            ref = member_ref(pc, index, CONSTANT_InterfaceMethodref);
+            if (u1_at(pc + 4) != 0) fail(pc, "invokeinterface padding");
+        } else if (op == 0xb6) {
+            ref = member_ref(pc, index, CONSTANT_Methodref);
+        } else {
+            // invokespecial and invokestatic may name interface methods since Java 8
+            u1 tag = index < kls.constant_pool_count ? kls.cp_tag(index) : 0;
+            ref = member_ref(pc, index,
+                             tag == CONSTANT_InterfaceMethodref ? tag : CONSTANT_Methodref);
+        }
+
+        auto signature = MethodSignature::parse(ref.desc, true);
+        if (!signature) fail(pc, "bad method descriptor");
+        auto callee = method_type(*signature, ref.desc);
+        bool is_init = ref.name == "<init>";
+        if ((is_init && op != 0xb7) || ref.name == "<clinit>") {
+            fail(pc, "bad call to " + std::string(ref.name));
+        }
+        if (is_init && callee.ret) fail(pc, "<init> must return void");
+
+        for (auto arg = callee.args.rbegin(); arg != callee.args.rend(); ++arg) pop(pc, *arg);
+
+        if (op == 0xb9) {
+            // interfaces are treated as Object when verifying, like HotSpot does
+            pop_initialized(pc);
+            // the receiver and the arguments
+            if (u1_at(pc + 3) != signature->argument_slots + 1) {
+                fail(pc, "invokeinterface count mismatch");
+            }
+        } else if (op == 0xb7 && is_init) {
+            VType receiver = pop_reference(pc);
+            if (receiver.kind == Kind::UninitThis) {
+                initialize(receiver, VType::ref(this_name));
+            } else if (receiver.kind == Kind::Uninit) {
+                VType created = class_type(pc, u2_at(receiver.offset + 1));
+                if (created.name != ref.owner) fail(pc, "<init> of another class");
+                initialize(receiver, created);
+            } else {
+                fail(pc, "<init> on an initialized object");
+            }
+        } else if (op == 0xb6 || op == 0xb7) {
+            VType receiver = pop_initialized(pc);
+            if (!assignable(receiver, VType::ref(ref.owner))) {
+                fail(pc, "receiver has the wrong type");
+            }
+        }
+
+        if (callee.ret) push(pc, *callee.ret);
+    }
+
+    void return_(u4 pc, std::optional<VType> value) {
+        if (!value) {
+            if (type.ret) fail(pc, "return without a value");
+            if (cur.this_uninit) fail(pc, "constructor returns before super()");
+            return;
+        }
+        if (!type.ret) fail(pc, "value returned from a void method");
+        VType expected = *type.ret;
+        if (value->kind == Kind::Ref) {
+            VType actual = pop_initialized(pc);
+            if (!assignable(actual, expected)) fail(pc, "wrong return type");
+            return;
+        }
+        if (!(expected == *value)) fail(pc, "wrong return instruction");
+        pop(pc, expected);
+    }
+
+    // runs the instruction at pc; returns false when control cannot fall through
+    bool execute(u4 pc) {
+        u1 op = code[pc];
+        if (op >= 0x1a && op <= 0x2d) {
+            // xload_<n>
+            Kind kind = typed_kinds[(op - 0x1a) / 4];
+            load(pc, (op - 0x1a) % 4, kind == Kind::Ref ? object : VType{kind, 0, {}});
+            return true;
+        }
+        if (op >= 0x3b && op <= 0x4e) {
+            // xstore_<n>
+            store(pc, (op - 0x3b) % 4, typed_kinds[(op - 0x3b) / 4]);
+            return true;
+        }
+        if (op >= 0x60 && op <= 0x73) {
+            // add, sub, mul, div, rem in int, long, float, double order
+            static const VType* types[] = {&int_, &long_, &float_, &double_};
+            arith(pc, *types[(op - 0x60) % 4], 2);
+            return true;
+        }
+        if (op >= 0x74 && op <= 0x77) {
+            static const VType* types[] = {&int_, &long_, &float_, &double_};
+            arith(pc, *types[op - 0x74], 1);
+            return true;
+        }
+        if (op >= 0x99 && op <= 0x9e) {
+            pop(pc, int_);
+            branch(pc, pc + static_cast<int16_t>(u2_at(pc + 1)));
+            return true;
+        }
+        if (op >= 0x9f && op <= 0xa4) {
+            pop(pc, int_);
+            pop(pc, int_);
+            branch(pc, pc + static_cast<int16_t>(u2_at(pc + 1)));
+            return true;
+        }
+
+        switch (op) {
+            case 0x00:
+                return true;
+            case 0x01:
+                push(pc, null);
+                return true;
+            case 0x02: case 0x03: case 0x04: case 0x05: case 0x06: case 0x07: case 0x08:
+            case 0x10: case 0x11:
+                push(pc, int_);
+                return true;
+            case 0x09: case 0x0a:
+                push(pc, long_);
+                return true;
+            case 0x0b: case 0x0c: case 0x0d:
+                push(pc, float_);
+                return true;
+            case 0x0e: case 0x0f:
+                push(pc, double_);
+                return true;
+            case 0x12:
+                ldc(pc, u1_at(pc + 1), false);
+                return true;
+            case 0x13:
+                ldc(pc, u2_at(pc + 1), false);
+                return true;
+            case 0x14:
+                ldc(pc, u2_at(pc + 1), true);
+                return true;
+            case 0x15:
+                load(pc, u1_at(pc + 1), int_);
+                return true;
+            case 0x16:
+                load(pc, u1_at(pc + 1), long_);
+                return true;
+            case 0x17:
+                load(pc, u1_at(pc + 1), float_);
+                return true;
+            case 0x18:
+                load(pc, u1_at(pc + 1), double_);
+                return true;
+            case 0x19:
+                load(pc, u1_at(pc + 1), object);
+                return true;
+            case 0x2e:
+                array_load(pc, VType{Kind::Int, 0, "[I"});
+                return true;
+            case 0x2f:
+                array_load(pc, VType{Kind::Long, 0, "[J"});
+                return true;
+            case 0x30:
+                array_load(pc, VType{Kind::Float, 0, "[F"});
+                return true;
+            case 0x31:
+                array_load(pc, VType{Kind::Double, 0, "[D"});
+                return true;
+            case 0x32:
+                array_load(pc, object);
+                return true;
+            case 0x33:
+                array_load(pc, VType{Kind::Int, 0, "B"});
+                return true;
+            case 0x34:
+                array_load(pc, VType{Kind::Int, 0, "[C"});
+                return true;
+            case 0x35:
+                array_load(pc, VType{Kind::Int, 0, "[S"});
+                return true;
+            case 0x36:
+                store(pc, u1_at(pc + 1), Kind::Int);
+                return true;
+            case 0x37:
+                store(pc, u1_at(pc + 1), Kind::Long);
+                return true;
+            case 0x38:
+                store(pc, u1_at(pc + 1), Kind::Float);
+                return true;
+            case 0x39:
+                store(pc, u1_at(pc + 1), Kind::Double);
+                return true;
+            case 0x3a:
+                store(pc, u1_at(pc + 1), Kind::Ref);
+                return true;
+            case 0x4f:
+                array_store(pc, VType{Kind::Int, 0, "[I"});
+                return true;
+            case 0x50:
+                array_store(pc, VType{Kind::Long, 0, "[J"});
+                return true;
+            case 0x51:
+                array_store(pc, VType{Kind::Float, 0, "[F"});
+                return true;
+            case 0x52:
+                array_store(pc, VType{Kind::Double, 0, "[D"});
+                return true;
+            case 0x53:
+                array_store(pc, object);
+                return true;
+            case 0x54:
+                array_store(pc, VType{Kind::Int, 0, "B"});
+                return true;
+            case 0x55:
+                array_store(pc, VType{Kind::Int, 0, "[C"});
+                return true;
+            case 0x56:
+                array_store(pc, VType{Kind::Int, 0, "[S"});
+                return true;
+            case 0x57:
+                if (!boundary(1)) fail(pc, "pop of a wide value");
+                cur.stack.pop_back();
+                return true;
+            case 0x58:
+                if (!boundary(2)) fail(pc, "pop2 splits a wide value");
+                cur.stack.resize(cur.stack.size() - 2);
+                return true;
+            case 0x59:
+                dup(pc, 1, 0);
+                return true;
+            case 0x5a:
+                dup(pc, 1, 1);
+                return true;
+            case 0x5b:
+                dup(pc, 1, 2);
+                return true;
+            case 0x5c:
+                dup(pc, 2, 0);
+                return true;
+            case 0x5d:
+                dup(pc, 2, 1);
+                return true;
+            case 0x5e:
+                dup(pc, 2, 2);
+                return true;
+            case 0x5f:
+                if (!boundary(1) || !boundary(2)) fail(pc, "swap of a wide value");
+                std::swap(cur.stack[cur.stack.size() - 1], cur.stack[cur.stack.size() - 2]);
+                return true;
+            case 0x78: case 0x7a: case 0x7c:
+                arith(pc, int_, 2);
+                return true;
+            case 0x79: case 0x7b: case 0x7d:
+                pop(pc, int_);
+                arith(pc, long_, 1);
+                return true;
+            case 0x7e: case 0x80: case 0x82:
+                arith(pc, int_, 2);
+                return true;
+            case 0x7f: case 0x81: case 0x83:
+                arith(pc, long_, 2);
+                return true;
+            case 0x84: {
+                u1 index = u1_at(pc + 1);
+                check_local(pc, index, false);
+                if (!(cur.locals[index] == int_)) fail(pc, "iinc of a non int local");
+                return true;
+            }
+            case 0x85:
+                convert(pc, int_, long_);
+                return true;
+            case 0x86:
+                convert(pc, int_, float_);
+                return true;
+            case 0x87:
+                convert(pc, int_, double_);
+                return true;
+            case 0x88:
+                convert(pc, long_, int_);
+                return true;
+            case 0x89:
+                convert(pc, long_, float_);
+                return true;
+            case 0x8a:
+                convert(pc, long_, double_);
+                return true;
+            case 0x8b:
+                convert(pc, float_, int_);
+                return true;
+            case 0x8c:
+                convert(pc, float_, long_);
+                return true;
+            case 0x8d:
+                convert(pc, float_, double_);
+                return true;
+            case 0x8e:
+                convert(pc, double_, int_);
+                return true;
+            case 0x8f:
+                convert(pc, double_, long_);
+                return true;
+            case 0x90:
+                convert(pc, double_, float_);
+                return true;
+            case 0x91: case 0x92: case 0x93:
+                convert(pc, int_, int_);
+                return true;
+            case 0x94:
+                pop(pc, long_);
+                convert(pc, long_, int_);
+                return true;
+            case 0x95: case 0x96:
+                pop(pc, float_);
+                convert(pc, float_, int_);
+                return true;
+            case 0x97: case 0x98:
+                pop(pc, double_);
+                convert(pc, double_, int_);
+                return true;
+            case 0xa5: case 0xa6:
+                pop_reference(pc);
+                pop_reference(pc);
+                branch(pc, pc + static_cast<int16_t>(u2_at(pc + 1)));
+                return true;
+            case 0xa7:
+                branch(pc, pc + static_cast<int16_t>(u2_at(pc + 1)));
+                return false;
+            case 0xc8:
+                branch(pc, static_cast<int64_t>(pc) + s4_at(pc + 1));
+                return false;
+            case 0xa8: case 0xa9: case 0xc9:
+                fail(pc, inferring ? "jsr/ret subroutines are not supported"
+                                   : "jsr/ret are not allowed in type checked class files");
+            case 0xaa: {
+                pop(pc, int_);
+                u4 base = (pc + 4) & ~3u;
+                branch(pc, static_cast<int64_t>(pc) + s4_at(base));
+                int32_t low = s4_at(base + 4), high = s4_at(base + 8);
+                for (int64_t key = low; key <= high; key++) {
+                    branch(pc, static_cast<int64_t>(pc) + s4_at(base + 12 + 4 * (key - low)));
+                }
+                return false;
+            }
+            case 0xab: {
+                pop(pc, int_);
+                u4 base = (pc + 4) & ~3u;
+                branch(pc, static_cast<int64_t>(pc) + s4_at(base));
+                int32_t pairs = s4_at(base + 4);
+                for (int32_t pair = 0; pair < pairs; pair++) {
+                    u4 at = base + 8 + 8 * pair;
+                    if (pair > 0 && s4_at(at - 8) >= s4_at(at)) {
+                        fail(pc, "lookupswitch keys unsorted");
+                    }
+                    branch(pc, static_cast<int64_t>(pc) + s4_at(at + 4));
+                }
+                return false;
+            }
+            case 0xac:
+                return_(pc, int_);
+                return false;
+            case 0xad:
+                return_(pc, long_);
+                return false;
+            case 0xae:
+                return_(pc, float_);
+                return false;
+            case 0xaf:
+                return_(pc, double_);
+                return false;
+            case 0xb0:
+                return_(pc, object);
+                return false;
+            case 0xb1:
+                return_(pc, std::nullopt);
+                return false;
+            case 0xb2: case 0xb3: case 0xb4: case 0xb5:
+                field_access(pc, op);
+                return true;
+            case 0xb6: case 0xb7: case 0xb8: case 0xb9: case 0xba:
+                invoke(pc, op);
+                return true;
+            case 0xbb: {
+                VType created = class_type(pc, u2_at(pc + 1));
+                if (created.name[0] == '[') fail(pc, "new of an array class");
+                // an object created in a loop must not survive to the next iteration
+                for (const auto& item : cur.stack) {
+                    if (item.kind == Kind::Uninit && item.offset == pc) {
+                        fail(pc, "uninitialized object reused");
+                    }
+                }
+                push(pc, VType{Kind::Uninit, static_cast<u2>(pc), {}});
+                return true;
+            }
+            case 0xbc: {
+                static const char* arrays[] = {"[Z", "[C", "[F", "[D", "[B", "[S", "[I", "[J"};
+                u1 atype = u1_at(pc + 1);
+                if (atype < 4 || atype > 11) fail(pc, "bad newarray type");
+                convert(pc, int_, VType::ref(arrays[atype - 4]));
+                return true;
+            }
+            case 0xbd: {
+                std::string_view element = class_name(pc, u2_at(pc + 1));
+                std::string name = element[0] == '[' ? "[" + std::string(element)
+                                                     : "[L" + std::string(element) + ";";
+                convert(pc, int_, VType::ref(SymbolTable::intern(name).view()));
+                return true;
+            }
+            case 0xbe: {
+                VType array = pop_reference(pc);
+                if (array.kind != Kind::Null && !is_array(array)) {
+                    fail(pc, "arraylength of a non array");
+                }
+                push(pc, int_);
+                return true;
+            }
+            case 0xbf:
+                pop(pc, throwable);
+                return false;
+            case 0xc0:
+                pop_initialized(pc);
+                push(pc, class_type(pc, u2_at(pc + 1)));
+                return true;
+            case 0xc1:
+                pop_initialized(pc);
+                class_type(pc, u2_at(pc + 1));
+                push(pc, int_);
+                return true;
+            case 0xc2: case 0xc3:
+                pop_initialized(pc);
+                return true;
+            case 0xc4: {
+                u1 widened = code[pc + 1];
+                u2 index = u2_at(pc + 2);
+                switch (widened) {
+                    case 0x15: load(pc, index, int_); break;
+                    case 0x16: load(pc, index, long_); break;
+                    case 0x17: load(pc, index, float_); break;
+                    case 0x18: load(pc, index, double_); break;
+                    case 0x19: load(pc, index, object); break;
+                    case 0x36: store(pc, index, Kind::Int); break;
+                    case 0x37: store(pc, index, Kind::Long); break;
+                    case 0x38: store(pc, index, Kind::Float); break;
+                    case 0x39: store(pc, index, Kind::Double); break;
+                    case 0x3a: store(pc, index, Kind::Ref); break;
+                    case 0x84:
+                        check_local(pc, index, false);
+                        if (!(cur.locals[index] == int_)) fail(pc, "iinc of a non int local");
+                        break;
+                }
+                return true;
+            }
+            case 0xc5: {
+                VType array = class_type(pc, u2_at(pc + 1));
+                u1 dims = u1_at(pc + 3);
+                std::size_t depth = array.name.find_first_not_of('[');
+                if (dims == 0 || depth == std::string_view::npos || dims > depth) {
+                    fail(pc, "bad multianewarray dimensions");
+                }
+                for (u1 dim = 0; dim < dims; dim++) pop(pc, int_);
+                push(pc, array);
+                return true;
+            }
+            case 0xc6: case 0xc7:
+                pop_reference(pc);
+                branch(pc, pc + static_cast<int16_t>(u2_at(pc + 1)));
+                return true;
+            default:
+                fail(pc, "illegal opcode " + std::to_string(op));
+        }
+    }
+
+  public:
+    MethodVerifier(const InstanceKlass& kls, const AssignabilityCheck& hierarchy,
+                   const MethodWrapper& method, std::string_view this_name,
+                   std::string_view method_name, std::string_view method_desc)
+        : kls(kls), hierarchy(hierarchy), method(method), info(*method.code_info),
+          code(info.code), this_name(this_name), method_name(method_name),
+          method_desc(method_desc) {
+    }
+
+    void run() {
+        // the descriptor was checked when the method was created
+        type = method_type(method.signature, method_desc);
+
+        find_instruction_starts();
+        for (const auto& handler : info.exception_table) {
+            if (!starts[handler.start_pc] || !starts[handler.handler_pc] ||
+                (handler.end_pc < code.size() && !starts[handler.end_pc])) {
+                fail(handler.start_pc, "exception range is not on instruction boundaries");
+            }
+        }
+        if (kls.major_version < 50) {
+            // a StackMapTable in an older class file is ignored
+            inferring = true;
+            return infer();
+        }
+        read_stack_maps();
+
+        cur = expand(0, entry_locals(), {});
+        bool reachable = true;
+        for (u4 pc = 0; pc < code.size(); pc += instruction_length(pc)) {
+            if (frame_at[pc] >= 0) {
+                const Frame& mapped = frames[frame_at[pc]];
+                if (reachable && !frame_assignable(cur, mapped)) {
+                    fail(pc, "frame does not match the stack map");
+                }
+                cur = mapped;
+            } else if (!reachable) {
+                fail(pc, "no stack map frame after an unconditional branch");
+            }
+
+            check_handlers(pc);
+            reachable = execute(pc);
+            // stores inside a protected range reach the handler as well
+            check_handlers(pc);
+        }
+        if (reachable) fail(static_cast<u4>(code.size()), "control falls off the end of the code");
+    }
+};
+
+Verifier::Verifier(const InstanceKlass& kls, AssignabilityCheck assignable)
+    : kls(kls), assignable(std::move(assignable)) {
+}
+
+void Verifier::verify(const MethodWrapper& method) const {
+    if (!method.code_info) return;
+
+    const auto& this_kls = kls.constant_pool[kls.this_class].klass;
+    std::string_view this_name = kls.constant_pool[this_kls.name_index].utf8.view();
+    std::string_view name = kls.constant_pool[method.mptr->name_index].utf8.view();
+    std::string_view desc = kls.constant_pool[method.mptr->descriptor_index].utf8.view();
+
+    MethodVerifier(kls, assignable, method, this_name, name, desc).run();
+}
@@ -0,0 +1,240 @@
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <malloc.h>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <benchmark/benchmark.h>
+
+#include "../../include/runtime/klass.hpp"
+#include "../../include/runtime/symbol_table.hpp"
+#include "class_builder.hpp"
+
+using namespace class_builder;
+
+static const std::string test_class_file_dir = "/workspace/JavaVirtualMachine/resource";
+
+// === allocation accounting ===
+// Every operator new of the process is counted. Arenas take their chunks from
+// malloc directly, so retained sizes add Arena::reserved() on top.
+
+static std::atomic<std::size_t> allocation_count{0};
+static std::atomic<std::size_t> live_bytes{0};
+
+void* operator new(std::size_t size) {
+    void* p = std::malloc(size == 0 ? 1 : size);
+    if (p == nullptr) throw std::bad_alloc();
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    live_bytes.fetch_add(malloc_usable_size(p), std::memory_order_relaxed);
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    if (p == nullptr) return;
+    live_bytes.fetch_sub(malloc_usable_size(p), std::memory_order_relaxed);
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    operator delete(p);
+}
+
+// === inputs ===
+
+static std::vector<ClassFileSource_ptr> load_corpus() {
+    std::vector<ClassFileSource_ptr> corpus;
+    for (const auto& entry : std::filesystem::directory_iterator(test_class_file_dir)) {
+        if (entry.path().extension() != ".class") continue;
+        corpus.push_back(ClassFileSource::map(entry.path()));
+    }
+    return corpus;
+}
+
+static const std::vector<ClassFileSource_ptr>& corpus() {
+    static const auto images = load_corpus();
+    return images;
+}
+
+// A class with `count` int fields f<i> and `count` static void methods m<i>
+// whose body is a single return.
+static ClassFileSource_ptr make_huge_class(u2 count) {
+    ClassBuilder builder(52);
+    for (u2 index = 0; index < count; index++) {
+        builder.add_field(PRIVATE, "f" + std::to_string(index), "I");
+        builder.add_method(PUBLIC | STATIC, "m" + std::to_string(index), "()V", 0, 0,
+                           Code().op(jvm::_return));
+    }
+    return builder.build("bench/Huge", "java/lang/Object");
+}
+
+// allocations and bytes retained per class, measured once outside the timed loop
+template <class Build>
+static void report_footprint(benchmark::State& state,
+                             const std::vector<ClassFileSource_ptr>& images, Build&& build) {
+    std::size_t allocs_before = allocation_count.load();
+    std::size_t live_before = live_bytes.load();
+    std::size_t arena_bytes = 0;
+    {
+        std::vector<std::invoke_result_t<Build&, const ClassFileSource_ptr&>> kept;
+        for (const auto& image : images) {
+            kept.push_back(build(image));
+            arena_bytes += kept.back()->get_arena().reserved();
+        }
+        state.counters["allocs/class"] =
+            double(allocation_count.load() - allocs_before) / images.size();
+        state.counters["retained/class"] = benchmark::Counter(
+            double(live_bytes.load() - live_before + arena_bytes) / images.size(),
+            benchmark::Counter::kDefaults, benchmark::Counter::kIs1024);
+    }
+}
+
+template <class Build>
+static void run_over(benchmark::State& state, const std::vector<ClassFileSource_ptr>& images,
+                     Build&& build) {
+    std::size_t bytes = 0;
+    for (const auto& image : images) bytes += image->size();
+
+    for (auto _ : state) {
+        for (const auto& image : images) benchmark::DoNotOptimize(build(image));
+    }
+    state.SetItemsProcessed(state.iterations() * images.size());
+    state.SetBytesProcessed(state.iterations() * bytes);
+    report_footprint(state, images, build);
+}
+
+static std::unique_ptr<raw_jvm_data::ClassFile> parse(const ClassFileSource_ptr& image) {
+    return std::make_unique<raw_jvm_data::ClassFile>(image);
+}
+
+static std::unique_ptr<rt_jvm_data::InstanceKlass> build_klass(const ClassFileSource_ptr& image) {
+    return std::make_unique<rt_jvm_data::InstanceKlass>(image);
+}
+
+// === class parsing and linking ===
+
+static void BM_ParseCorpus(benchmark::State& state) {
+    run_over(state, corpus(), parse);
+}
+BENCHMARK(BM_ParseCorpus);
+
+static void BM_BuildKlassCorpus(benchmark::State& state) {
+    run_over(state, corpus(), build_klass);
+}
+BENCHMARK(BM_BuildKlassCorpus);
+
+static void BM_ParseHuge(benchmark::State& state) {
+    run_over(state, {make_huge_class(static_cast<u2>(state.range(0)))}, parse);
+}
+BENCHMARK(BM_ParseHuge)->Arg(1000)->Arg(10000)->Arg(30000);
+
+static void BM_BuildKlassHuge(benchmark::State& state) {
+    run_over(state, {make_huge_class(static_cast<u2>(state.range(0)))}, build_klass);
+}
+BENCHMARK(BM_BuildKlassHuge)->Arg(1000)->Arg(10000)->Arg(30000);
+
+// === symbols ===
+
+static std::vector<std::string> corpus_symbols() {
+    std::vector<std::string> symbols;
+    for (const auto& image : corpus()) {
+        rt_jvm_data::InstanceKlass kls(image);
+        for (const auto& method : kls.get_methods()) {
+            symbols.push_back(std::string(method.name.view()) + ":" +
+                              std::string(method.descriptor.view()));
+        }
+    }
+    return symbols;
+}
+
+static void BM_SymbolIntern(benchmark::State& state) {
+    static const auto symbols = corpus_symbols();
+    for (auto _ : state) {
+        for (const auto& symbol : symbols) benchmark::DoNotOptimize(SymbolTable::intern(symbol));
+    }
+    state.SetItemsProcessed(state.iterations() * symbols.size());
+}
+BENCHMARK(BM_SymbolIntern)->ThreadRange(1, 8);
+
+static void BM_SymbolInternHashed(benchmark::State& state) {
+    auto symbols = corpus_symbols();
+    std::vector<u4> hashes;
+    for (const auto& symbol : symbols) {
+        hashes.push_back(mutf8::hash({reinterpret_cast<const u1*>(symbol.data()), symbol.size()}));
+    }
+    for (auto _ : state) {
+        for (std::size_t index = 0; index < symbols.size(); index++) {
+            benchmark::DoNotOptimize(SymbolTable::intern(symbols[index], hashes[index]));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * symbols.size());
+}
+BENCHMARK(BM_SymbolInternHashed);
+
+static void BM_SymbolCompare(benchmark::State& state) {
+    auto names = corpus_symbols();
+    std::vector<Symbol> symbols;
+    for (const auto& name : names) symbols.push_back(SymbolTable::intern(name));
+    for (auto _ : state) {
+        std::size_t equal = 0;
+        for (std::size_t index = 1; index < symbols.size(); index++) {
+            equal += symbols[index] == symbols[index - 1];
+        }
+        benchmark::DoNotOptimize(equal);
+    }
+    state.SetItemsProcessed(state.iterations() * symbols.size());
+}
+BENCHMARK(BM_SymbolCompare);
+
+// === member lookup ===
+
+// resolution has the symbols at hand already, from the resolved constant
+static void BM_MethodLookup(benchmark::State& state) {
+    u2 count = static_cast<u2>(state.range(0));
+    rt_jvm_data::InstanceKlass kls(make_huge_class(count));
+    Symbol descriptor = SymbolTable::intern("()V");
+    std::vector<Symbol> names;
+    for (u2 index = 0; index < count; index++) {
+        names.push_back(SymbolTable::intern("m" + std::to_string(index)));
+    }
+
+    std::size_t allocs_before = allocation_count.load();
+    for (auto _ : state) {
+        for (auto name : names) benchmark::DoNotOptimize(kls.get_method(name, descriptor));
+    }
+    state.counters["allocs"] = double(allocation_count.load() - allocs_before);
+    state.SetItemsProcessed(state.iterations() * names.size());
+}
+BENCHMARK(BM_MethodLookup)->Arg(100)->Arg(10000);
+
+static void BM_MethodLookupByName(benchmark::State& state) {
+    u2 count = static_cast<u2>(state.range(0));
+    rt_jvm_data::InstanceKlass kls(make_huge_class(count));
+    std::vector<std::string> names;
+    for (u2 index = 0; index < count; index++) names.push_back("m" + std::to_string(index));
+
+    for (auto _ : state) {
+        for (const auto& name : names) benchmark::DoNotOptimize(kls.get_method(name, "()V"));
+    }
+    state.SetItemsProcessed(state.iterations() * names.size());
+}
+BENCHMARK(BM_MethodLookupByName)->Arg(100)->Arg(10000);
+
+static void BM_FieldLookup(benchmark::State& state) {
+    u2 count = static_cast<u2>(state.range(0));
+    rt_jvm_data::InstanceKlass kls(make_huge_class(count));
+    Symbol descriptor = SymbolTable::intern("I");
+    std::vector<Symbol> names;
+    for (u2 index = 0; index < count; index++) {
+        names.push_back(SymbolTable::intern("f" + std::to_string(index)));
+    }
+
+    for (auto _ : state) {
+        for (auto name : names) benchmark::DoNotOptimize(kls.get_field(name, descriptor));
+    }
+    state.SetItemsProcessed(state.iterations() * names.size());
+}
+BENCHMARK(BM_FieldLookup)->Arg(100)->Arg(10000);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,309 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <initializer_list>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../../include/classFile/class_file.hpp"
+#include "../../include/classFile/class_file_source.hpp"
+#include "../../include/runtime/byte_code_engine.hpp"
+
+// Class files written by the tests, so that they need no javac.
+namespace class_builder {
+    using raw_jvm_type::u1;
+    using raw_jvm_type::u2;
+    using raw_jvm_type::u4;
+    using raw_jvm_type::u8;
+
+    constexpr u2 PUBLIC = raw_jvm_data::ACC_PUBLIC;
+    constexpr u2 PRIVATE = raw_jvm_data::ACC_PRIVATE;
+    constexpr u2 STATIC = raw_jvm_data::ACC_STATIC;
+    constexpr u2 FINAL = raw_jvm_data::ACC_FINAL;
+    constexpr u2 SUPER = raw_jvm_data::ACC_SUPER;
+    constexpr u2 INTERFACE = raw_jvm_data::ACC_INTERFACE;
+    constexpr u2 ABSTRACT = raw_jvm_data::ACC_ABSTRACT;
+
+    inline void put_u2(std::vector<u1>& out, u2 value) {
+        out.push_back(value >> 8);
+        out.push_back(value & 0xFF);
+    }
+    inline void put_u4(std::vector<u1>& out, u4 value) {
+        put_u2(out, value >> 16);
+        put_u2(out, value & 0xFFFF);
+    }
+
+    // Bytecode with named branch targets, patched when the method is added.
+    class Code {
+      private:
+        struct Fixup {
+            std::size_t at;
+            std::size_t from;
+            std::string label;
+            bool wide;
+        };
+        struct Handler {
+            std::string start, end, handler;
+            u2 catch_type;
+        };
+
+        std::vector<u1> bytes;
+        std::map<std::string, std::size_t> labels;
+        std::vector<Fixup> fixups;
+        std::vector<Handler> handlers;
+
+        void target(std::size_t from, const std::string& label, bool wide) {
+            fixups.push_back({bytes.size(), from, label, wide});
+            bytes.insert(bytes.end(), wide ? 4 : 2, 0);
+        }
+        void align() {
+            while (bytes.size() % 4 != 0) bytes.push_back(0);
+        }
+
+      public:
+        Code() = default;
+        // raw bytes, branch offsets and all
+        explicit Code(std::vector<u1> raw) : bytes(std::move(raw)) {
+        }
+
+        Code& op(u1 opcode, std::initializer_list<u1> operands = {}) {
+            bytes.push_back(opcode);
+            bytes.insert(bytes.end(), operands);
+            return *this;
+        }
+        // an opcode with a constant pool index or a sipush value
+        Code& op2(u1 opcode, u2 operand) {
+            bytes.push_back(opcode);
+            put_u2(bytes, operand);
+            return *this;
+        }
+        Code& branch(u1 opcode, const std::string& label) {
+            std::size_t from = bytes.size();
+            bytes.push_back(opcode);
+            target(from, label, false);
+            return *this;
+        }
+        Code& label(const std::string& name) {
+            labels[name] = bytes.size();
+            return *this;
+        }
+        Code& tableswitch(const std::string& otherwise, std::int32_t low,
+                          const std::vector<std::string>& targets) {
+            std::size_t from = bytes.size();
+            bytes.push_back(jvm::_tableswitch);
+            align();
+            target(from, otherwise, true);
+            put_u4(bytes, low);
+            put_u4(bytes, low + static_cast<std::int32_t>(targets.size()) - 1);
+            for (const auto& label : targets) target(from, label, true);
+            return *this;
+        }
+        Code& lookupswitch(const std::string& otherwise,
+                           const std::vector<std::pair<std::int32_t, std::string>>& pairs) {
+            std::size_t from = bytes.size();
+            bytes.push_back(jvm::_lookupswitch);
+            align();
+            target(from, otherwise, true);
+            put_u4(bytes, static_cast<u4>(pairs.size()));
+            for (const auto& [match, label] : pairs) {
+                put_u4(bytes, match);
+                target(from, label, true);
+            }
+            return *this;
+        }
+        Code& handler(const std::string& start, const std::string& end,
+                      const std::string& handler, u2 catch_type) {
+            handlers.push_back({start, end, handler, catch_type});
+            return *this;
+        }
+
+        // the code, then the exception table
+        std::pair<std::vector<u1>, std::vector<u1>> finish() const {
+            std::vector<u1> code = bytes;
+            for (const auto& fixup : fixups) {
+                auto offset = static_cast<std::int32_t>(labels.at(fixup.label) - fixup.from);
+                std::vector<u1> operand;
+                if (fixup.wide) {
+                    put_u4(operand, static_cast<u4>(offset));
+                } else {
+                    put_u2(operand, static_cast<u2>(offset));
+                }
+                std::copy(operand.begin(), operand.end(), code.begin() + fixup.at);
+            }
+            std::vector<u1> table;
+            put_u2(table, static_cast<u2>(handlers.size()));
+            for (const auto& entry : handlers) {
+                put_u2(table, static_cast<u2>(labels.at(entry.start)));
+                put_u2(table, static_cast<u2>(labels.at(entry.end)));
+                put_u2(table, static_cast<u2>(labels.at(entry.handler)));
+                put_u2(table, entry.catch_type);
+            }
+            return {code, table};
+        }
+    };
+
+    // A class file of `major_version`. Constants are added on first use and
+    // shared afterwards; each returns its constant pool index.
+    class ClassBuilder {
+      private:
+        u2 major_version;
+        std::vector<u1> pool;
+        u2 count = 1;
+        std::map<std::string, u2> known;
+        std::vector<u1> fields, methods;
+        u2 field_count = 0, method_count = 0;
+
+        u2 add(const std::string& key, const std::vector<u1>& entry, u2 slots = 1) {
+            if (auto it = known.find(key); it != known.end()) return it->second;
+            pool.insert(pool.end(), entry.begin(), entry.end());
+            known[key] = count;
+            count += slots;
+            return count - slots;
+        }
+        u2 ref(u1 tag, const std::string& owner, const std::string& name,
+               const std::string& descriptor) {
+            std::vector<u1> entry{tag};
+            put_u2(entry, cls(owner));
+            put_u2(entry, name_and_type(name, descriptor));
+            return add(std::to_string(tag) + owner + "." + name + ":" + descriptor, entry);
+        }
+
+      public:
+        explicit ClassBuilder(u2 major_version = 49) : major_version(major_version) {
+        }
+
+        u2 utf8(const std::string& text) {
+            std::vector<u1> entry{raw_jvm_data::CONSTANT_Utf8};
+            put_u2(entry, static_cast<u2>(text.size()));
+            entry.insert(entry.end(), text.begin(), text.end());
+            return add("U" + text, entry);
+        }
+        u2 cls(const std::string& name) {
+            std::vector<u1> entry{raw_jvm_data::CONSTANT_Class};
+            put_u2(entry, utf8(name));
+            return add("C" + name, entry);
+        }
+        u2 string(const std::string& text) {
+            std::vector<u1> entry{raw_jvm_data::CONSTANT_String};
+            put_u2(entry, utf8(text));
+            return add("S" + text, entry);
+        }
+        u2 integer(std::int32_t value) {
+            std::vector<u1> entry{raw_jvm_data::CONSTANT_Integer};
+            put_u4(entry, static_cast<u4>(value));
+            return add("I" + std::to_string(value), entry);
+        }
+        u2 long_(std::int64_t value) {
+            std::vector<u1> entry{raw_jvm_data::CONSTANT_Long};
+            put_u4(entry, static_cast<u4>(static_cast<u8>(value) >> 32));
+            put_u4(entry, static_cast<u4>(value));
+            return add("J" + std::to_string(value), entry, 2);
+        }
+        u2 name_and_type(const std::string& name, const std::string& descriptor) {
+            std::vector<u1> entry{raw_jvm_data::CONSTANT_NameAndType};
+            put_u2(entry, utf8(name));
+            put_u2(entry, utf8(descriptor));
+            return add("T" + name + ":" + descriptor, entry);
+        }
+        u2 field(const std::string& owner, const std::string& name, const std::string& descriptor) {
+            return ref(raw_jvm_data::CONSTANT_Fieldref, owner, name, descriptor);
+        }
+        u2 method(const std::string& owner, const std::string& name,
+                  const std::string& descriptor) {
+            return ref(raw_jvm_data::CONSTANT_Methodref, owner, name, descriptor);
+        }
+        u2 interface_method(const std::string& owner, const std::string& name,
+                            const std::string& descriptor) {
+            return ref(raw_jvm_data::CONSTANT_InterfaceMethodref, owner, name, descriptor);
+        }
+
+        void add_field(u2 flags, const std::string& name, const std::string& descriptor,
+                       std::optional<u2> constant = std::nullopt) {
+            put_u2(fields, flags);
+            put_u2(fields, utf8(name));
+            put_u2(fields, utf8(descriptor));
+            put_u2(fields, constant ? 1 : 0);
+            if (constant) {
+                put_u2(fields, utf8("ConstantValue"));
+                put_u4(fields, 2);
+                put_u2(fields, *constant);
+            }
+            field_count++;
+        }
+
+        // a method without code: abstract, or native when `flags` say so
+        void add_method(u2 flags, const std::string& name, const std::string& descriptor) {
+            put_u2(methods, flags);
+            put_u2(methods, utf8(name));
+            put_u2(methods, utf8(descriptor));
+            put_u2(methods, 0);
+            method_count++;
+        }
+
+        void add_native(u2 flags, const std::string& name, const std::string& descriptor) {
+            add_method(flags | raw_jvm_data::ACC_NATIVE, name, descriptor);
+        }
+
+        // `stack_map` is the raw body of a StackMapTable attribute, none when empty
+        void add_method(u2 flags, const std::string& name, const std::string& descriptor,
+                        u2 max_stack, u2 max_locals, const Code& code,
+                        const std::vector<u1>& stack_map = {}) {
+            auto [bytes, table] = code.finish();
+            u4 stack_map_size = stack_map.empty() ? 0 : 6 + static_cast<u4>(stack_map.size());
+            put_u2(methods, flags);
+            put_u2(methods, utf8(name));
+            put_u2(methods, utf8(descriptor));
+            put_u2(methods, 1);
+            put_u2(methods, utf8("Code"));
+            put_u4(methods,
+                   static_cast<u4>(12 + bytes.size() + table.size() - 2 + stack_map_size));
+            put_u2(methods, max_stack);
+            put_u2(methods, max_locals);
+            put_u4(methods, static_cast<u4>(bytes.size()));
+            methods.insert(methods.end(), bytes.begin(), bytes.end());
+            methods.insert(methods.end(), table.begin(), table.end());
+            put_u2(methods, stack_map.empty() ? 0 : 1);
+            if (!stack_map.empty()) {
+                put_u2(methods, utf8("StackMapTable"));
+                put_u4(methods, static_cast<u4>(stack_map.size()));
+                methods.insert(methods.end(), stack_map.begin(), stack_map.end());
+            }
+            method_count++;
+        }
+
+        // `super` is empty for java/lang/Object
+        ClassFileSource_ptr build(const std::string& name, const std::string& super,
+                                  u2 flags = PUBLIC | SUPER,
+                                  const std::vector<std::string>& interfaces = {}) {
+            u2 this_class = cls(name);
+            u2 super_class = super.empty() ? 0 : cls(super);
+            std::vector<u2> interface_classes;
+            for (const auto& interface : interfaces) interface_classes.push_back(cls(interface));
+
+            std::vector<u1> out;
+            put_u4(out, 0xCAFEBABE);
+            put_u2(out, 0);
+            put_u2(out, major_version);
+            put_u2(out, count);
+            out.insert(out.end(), pool.begin(), pool.end());
+            put_u2(out, flags);
+            put_u2(out, this_class);
+            put_u2(out, super_class);
+            put_u2(out, static_cast<u2>(interface_classes.size()));
+            for (u2 interface : interface_classes) put_u2(out, interface);
+            put_u2(out, field_count);
+            out.insert(out.end(), fields.begin(), fields.end());
+            put_u2(out, method_count);
+            out.insert(out.end(), methods.begin(), methods.end());
+            put_u2(out, 0);
+
+            auto bytes = std::make_shared<std::vector<u1>>(std::move(out));
+            return ClassFileSource::borrow(*bytes, bytes);
+        }
+    };
+}; // namespace class_builder
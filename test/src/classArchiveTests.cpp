@@ -0,0 +1,192 @@
+#include <bit>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#include <gtest/gtest.h>
+
+#include "../../include/classFile/class_archive.hpp"
+#include "../../include/runtime/class_loader.hpp"
+
+static const std::string test_class_file_dir = "/workspace/JavaVirtualMachine/resource";
+
+static bool any_assignable(std::string_view, std::string_view) {
+    return true;
+}
+
+// Pair on its own and Demo over it, the way classUnloadingTests links them
+static void link_pair_and_demo(rt_jvm_data::SystemDictionary& dictionary) {
+    auto* pair = dictionary.find("com/example/demo/utils/Pair");
+    auto* demo = dictionary.find("resource/Demo");
+    ASSERT_NE(pair, nullptr);
+    ASSERT_NE(demo, nullptr);
+    pair->link(nullptr, {}, any_assignable);
+    demo->link(pair, {}, any_assignable);
+}
+
+static std::filesystem::path dump_resource_archive(rt_jvm_data::SystemDictionary& dictionary,
+                                                   bool linked = false) {
+    rt_jvm_data::BatchClassLoader loader(dictionary, 2);
+    auto result = loader.load_directory(test_class_file_dir);
+    EXPECT_TRUE(result.failures.empty());
+    if (linked) link_pair_and_demo(dictionary);
+
+    std::vector<const rt_jvm_data::InstanceKlass*> classes;
+    for (auto kls : dictionary.snapshot()) classes.push_back(kls);
+
+    auto path = std::filesystem::temp_directory_path() /
+                ("classes-" + std::to_string(::getpid()) + ".jsa");
+    raw_jvm_data::SharedClassArchive::dump(path, classes);
+    return path;
+}
+
+TEST(CLASS_ARCHIVE_TEST, DUMP_AND_LOAD_TEST) {
+    rt_jvm_data::SystemDictionary parsed;
+    auto path = dump_resource_archive(parsed);
+
+    {
+        raw_jvm_data::SharedClassArchive archive(path);
+        EXPECT_EQ(archive.get_records().size(), parsed.size());
+
+        auto pair = archive.find("com/example/demo/utils/Pair");
+        ASSERT_NE(pair, nullptr);
+        EXPECT_EQ(archive.name_of(*pair), "com/example/demo/utils/Pair");
+        EXPECT_EQ(archive.image_of(*pair)->size(),
+                  std::filesystem::file_size(test_class_file_dir + "/Pair.class"));
+        EXPECT_EQ(archive.find("java/lang/Object"), nullptr);
+
+        rt_jvm_data::SystemDictionary shared;
+        rt_jvm_data::BatchClassLoader loader(shared, 2);
+        auto result = loader.load_archive(archive);
+        EXPECT_TRUE(result.failures.empty());
+        EXPECT_EQ(result.loaded, parsed.size());
+
+        for (auto kls : parsed.snapshot()) {
+            auto archived = shared.find(kls->get_klass_name());
+            ASSERT_NE(archived, nullptr);
+            // nothing was decoded, the tables are used from the mapping
+            EXPECT_EQ(archived->get_arena().used(), 0u);
+        }
+    }
+    std::filesystem::remove(path);
+}
+
+TEST(CLASS_ARCHIVE_TEST, RESTORE_LINKAGE_TEST) {
+    rt_jvm_data::SystemDictionary parsed;
+    auto path = dump_resource_archive(parsed, true);
+
+    {
+        raw_jvm_data::SharedClassArchive archive(path);
+        auto pair = archive.find("com/example/demo/utils/Pair");
+        auto demo = archive.find("resource/Demo");
+        ASSERT_NE(pair, nullptr);
+        ASSERT_NE(demo, nullptr);
+        EXPECT_NE(archive.linkage_of(*pair), nullptr);
+        ASSERT_NE(archive.linkage_of(*demo), nullptr);
+        EXPECT_EQ(archive.linkage_of(*demo)->super, archive.index_of(*pair));
+        EXPECT_EQ(archive.linkage_of(*archive.find("com/example/demo/utils/ResourcesUtils")),
+                  nullptr);
+
+        rt_jvm_data::SystemDictionary shared;
+        rt_jvm_data::BatchClassLoader loader(shared, 2);
+        EXPECT_TRUE(loader.load_archive(archive).failures.empty());
+        link_pair_and_demo(shared);
+
+        // what was restored is what linking built before the dump
+        for (auto name : {"com/example/demo/utils/Pair", "resource/Demo"}) {
+            auto* built = parsed.find(name);
+            auto* restored = shared.find(name);
+            const auto& built_layout = built->get_field_layout();
+            const auto& restored_layout = restored->get_field_layout();
+            EXPECT_EQ(restored_layout.instance_size, built_layout.instance_size) << name;
+            EXPECT_EQ(restored_layout.static_size, built_layout.static_size) << name;
+            EXPECT_EQ(restored_layout.oop_maps, built_layout.oop_maps) << name;
+            for (std::size_t index = 0; index < built->get_fields().size(); index++) {
+                EXPECT_EQ(restored->get_fields()[index].offset, built->get_fields()[index].offset);
+                EXPECT_EQ(restored->get_fields()[index].type, built->get_fields()[index].type);
+            }
+            for (std::size_t index = 0; index < built->get_methods().size(); index++) {
+                EXPECT_EQ(restored->get_methods()[index].vtable_index,
+                          built->get_methods()[index].vtable_index);
+            }
+            ASSERT_EQ(restored->get_vtable().size(), built->get_vtable().size()) << name;
+            for (std::size_t index = 0; index < built->get_vtable().size(); index++) {
+                const auto* method = restored->get_vtable()[index];
+                const auto* expected = built->get_vtable()[index];
+                EXPECT_EQ(method->kls, shared.find(expected->kls->get_klass_name()));
+                EXPECT_EQ(method->name, expected->name);
+            }
+        }
+    }
+    std::filesystem::remove(path);
+}
+
+TEST(CLASS_ARCHIVE_TEST, REJECT_CORRUPT_ARCHIVE_TEST) {
+    rt_jvm_data::SystemDictionary parsed;
+    auto path = dump_resource_archive(parsed);
+
+    auto patch = [&](std::streamoff offset, char byte) {
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(offset);
+        file.put(byte);
+    };
+
+    // version lives right after the 8 byte magic
+    patch(8, 0x7F);
+    EXPECT_THROW(raw_jvm_data::SharedClassArchive{path}, ClassFormatError);
+    patch(8, raw_jvm_data::SharedClassArchive::VERSION);
+    EXPECT_NO_THROW(raw_jvm_data::SharedClassArchive{path});
+
+    // a full name index would leave a missed lookup nothing to stop at
+    using Header = raw_jvm_data::SharedClassArchive::Header;
+    raw_jvm_data::ArchivedClassRecord record{};
+    std::uint64_t record_offset = 0;
+    std::uint32_t class_count = 0, bucket_count = 0;
+    {
+        raw_jvm_data::SharedClassArchive archive(path);
+        const auto* pair = archive.find("com/example/demo/utils/Pair");
+        record = *pair;
+        record_offset =
+            archive.at<Header>(0)->records_offset + sizeof(record) * archive.index_of(*pair);
+        class_count = archive.at<Header>(0)->class_count;
+        bucket_count = archive.at<Header>(0)->bucket_count;
+    }
+    auto patch_value = [&](std::streamoff offset, auto value) {
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(offset);
+        file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    };
+    patch_value(offsetof(Header, bucket_count), std::bit_floor(class_count));
+    EXPECT_THROW(raw_jvm_data::SharedClassArchive{path}, ClassFormatError);
+    patch_value(offsetof(Header, bucket_count), bucket_count);
+    EXPECT_NO_THROW(raw_jvm_data::SharedClassArchive{path});
+
+    auto record_field = [&](std::size_t field) {
+        return static_cast<std::streamoff>(record_offset + field);
+    };
+    patch_value(record_field(offsetof(raw_jvm_data::ArchivedClassRecord, interfaces_offset)),
+                std::uint64_t(std::filesystem::file_size(path)));
+    patch_value(record_field(offsetof(raw_jvm_data::ArchivedClassRecord, interfaces_count)),
+                std::uint16_t(1));
+    EXPECT_THROW(raw_jvm_data::SharedClassArchive{path}, ClassFormatError);
+    patch_value(record_field(offsetof(raw_jvm_data::ArchivedClassRecord, interfaces_offset)),
+                record.interfaces_offset);
+    patch_value(record_field(offsetof(raw_jvm_data::ArchivedClassRecord, interfaces_count)),
+                record.interfaces_count);
+    EXPECT_NO_THROW(raw_jvm_data::SharedClassArchive{path});
+
+    // the attribute table of a method pointing past the end of the archive
+    ASSERT_GT(record.methods_count, 0);
+    auto attributes = static_cast<std::streamoff>(
+        record.methods_offset + offsetof(raw_jvm_data::MethodInfo, attributes));
+    patch_value(attributes, std::int64_t(1) << 40);
+    EXPECT_THROW(raw_jvm_data::SharedClassArchive{path}, ClassFormatError);
+
+    patch(0, 'X');
+    EXPECT_THROW(raw_jvm_data::SharedClassArchive{path}, ClassFormatError);
+
+    std::filesystem::resize_file(path, 16);
+    EXPECT_THROW(raw_jvm_data::SharedClassArchive{path}, ClassFormatError);
+    std::filesystem::remove(path);
+}
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cstdio>
 #include <fstream>
 #include <memory>
@@ -45,6 +46,138 @@ TEST(CLASS_FILE_TEST, CLASS_FILE_INPUT_TEST) {
     EXPECT_TRUE(pass);
 }
 
+TEST(CLASS_FILE_TEST, CLASS_FILE_MAPPED_INPUT_TEST) {
+    namespace fs = std::filesystem;
+    using std::fstream;
+    using std::string;
+
+    for (const auto& entry : fs::directory_iterator(test_class_file_dir)) {
+        auto p = entry.path();
+        if (!string(p).ends_with(".class")) continue;
+
+        auto src = ClassFileSource::map(p);
+        EXPECT_EQ(src->get_storage(), ClassFileSource::Storage::Mapped);
+        EXPECT_EQ(src->size(), fs::file_size(p));
+        rt_jvm_data::InstanceKlass mapped(src);
+
+        fstream ifs(p, std::ios::binary | std::ios::in);
+        rt_jvm_data::InstanceKlass streamed(ifs);
+        EXPECT_EQ(mapped.get_klass_name(), streamed.get_klass_name());
+    }
+}
+
+TEST(CLASS_FILE_TEST, CLASS_FILE_ARENA_TEST) {
+    namespace fs = std::filesystem;
+
+    for (const auto& entry : fs::directory_iterator(test_class_file_dir)) {
+        auto p = entry.path();
+        if (!std::string(p).ends_with(".class")) continue;
+
+        rt_jvm_data::InstanceKlass kls(ClassFileSource::map(p));
+        // all parsed tables of a class come from one bulk allocation
+        EXPECT_EQ(kls.get_arena().chunk_count(), 1u) << p;
+        EXPECT_LE(kls.get_arena().used(), kls.get_arena().reserved());
+        // sized from the constant pool and a chunk of room, not from the image
+        EXPECT_LE(kls.get_arena().reserved(), kls.get_arena().used() + Arena::min_chunk_size)
+            << p;
+    }
+}
+
+TEST(CLASS_FILE_TEST, CLASS_FILE_TRUNCATED_INPUT_TEST) {
+    auto image = ClassFileSource::map(test_class_file);
+    for (std::size_t cut : {std::size_t{0}, std::size_t{3}, image->size() / 2, image->size() - 1}) {
+        auto truncated = ClassFileSource::borrow(image->bytes().first(cut), image);
+        EXPECT_THROW(rt_jvm_data::InstanceKlass kls(truncated), ClassFormatError);
+    }
+}
+
+TEST(CLASS_FILE_TEST, CLASS_FILE_LAZY_ATTRIBUTE_TEST) {
+    rt_jvm_data::InstanceKlass kls(ClassFileSource::map(test_class_file_dir + "/Demo.class"));
+
+    // SourceFile is a single constant pool index
+    auto source_file = kls.get_attribute("SourceFile");
+    ASSERT_TRUE(source_file.has_value());
+    EXPECT_EQ(source_file->bytes().size(), 2u);
+    EXPECT_FALSE(kls.get_attribute("NoSuchAttribute").has_value());
+
+    auto init = kls.get_method("<init>", "()V");
+    ASSERT_NE(init, nullptr);
+    auto code = init->get_attribute("Code");
+    ASSERT_TRUE(code.has_value());
+    ASSERT_TRUE(init->code_info.has_value());
+    EXPECT_EQ(init->code_info->code.data(), code->bytes().data() + 8);
+
+    // max_stack, max_locals and code_length lead the body
+    auto reader = code->reader();
+    raw_jvm_type::u2 max_stack = 0, max_locals = 0;
+    raw_jvm_type::u4 code_length = 0;
+    reader.read_u2(&max_stack);
+    reader.read_u2(&max_locals);
+    reader.read_u4(&code_length);
+    EXPECT_GE(max_locals, 1);
+    EXPECT_LE(code_length, reader.remaining());
+}
+
+TEST(CLASS_FILE_TEST, CLASS_FILE_CODE_INFO_TEST) {
+    namespace fs = std::filesystem;
+
+    std::size_t handlers = 0;
+    for (const auto& entry : fs::directory_iterator(test_class_file_dir)) {
+        auto p = entry.path();
+        if (!std::string(p).ends_with(".class")) continue;
+
+        rt_jvm_data::InstanceKlass kls(ClassFileSource::map(p));
+        for (const auto& method : kls.get_methods()) {
+            if (!method.code_info) continue;
+            std::string id = std::string(method.name.view()) + ":" +
+                             std::string(method.descriptor.view());
+            const auto& info = *method.code_info;
+            EXPECT_GT(info.code.size(), 0u) << id;
+            EXPECT_GE(info.line_of(0), 1) << p << " " << id;
+
+            // the binary search agrees with a scan of the table in class file order
+            auto any = [](raw_jvm_type::u2) { return true; };
+            for (raw_jvm_type::u4 pc = 0; pc < info.code.size(); pc++) {
+                const rt_jvm_data::ExceptionHandler* expected = nullptr;
+                for (const auto& h : info.exception_table) {
+                    if (h.start_pc <= pc && pc < h.end_pc &&
+                        (expected == nullptr || h.order < expected->order)) {
+                        expected = &h;
+                    }
+                }
+                EXPECT_EQ(info.find_handler(pc, any), expected) << id << " pc " << pc;
+            }
+            handlers += info.exception_table.size();
+        }
+    }
+    EXPECT_GT(handlers, 0u);
+}
+
+TEST(CLASS_FILE_TEST, CLASS_FILE_MEMBER_LOOKUP_TEST) {
+    namespace fs = std::filesystem;
+
+    for (const auto& entry : fs::directory_iterator(test_class_file_dir)) {
+        auto p = entry.path();
+        if (!std::string(p).ends_with(".class")) continue;
+
+        rt_jvm_data::InstanceKlass kls(ClassFileSource::map(p));
+        for (const auto& method : kls.get_methods()) {
+            EXPECT_EQ(kls.get_method(method.name, method.descriptor), &method);
+            EXPECT_EQ(kls.get_method(method.name.view(), method.descriptor.view()), &method);
+        }
+        for (const auto& field : kls.get_fields()) {
+            EXPECT_EQ(kls.get_field(field.name, field.descriptor), &field);
+            EXPECT_NE(kls.get_field(field.name.view()), nullptr);
+        }
+
+        // an interned name with a descriptor the class does not use
+        EXPECT_EQ(kls.get_method(SymbolTable::intern("<init>"), SymbolTable::intern("(JJJ)J")),
+                  nullptr);
+        EXPECT_EQ(kls.get_method("member/lookup/NeverInterned", "()V"), nullptr);
+        EXPECT_EQ(kls.get_field("member/lookup/NeverInterned"), nullptr);
+    }
+}
+
 int main(int argc, char** argv) {
     testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
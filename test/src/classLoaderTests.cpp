@@ -0,0 +1,47 @@
+#include <filesystem>
+#include <string>
+#include <gtest/gtest.h>
+
+#include "../../include/runtime/class_loader.hpp"
+
+static const std::string test_class_file_dir = "/workspace/JavaVirtualMachine/resource";
+
+TEST(CLASS_LOADER_TEST, BATCH_LOAD_DIRECTORY_TEST) {
+    namespace fs = std::filesystem;
+
+    std::size_t class_files = 0;
+    for (const auto& entry : fs::directory_iterator(test_class_file_dir)) {
+        if (entry.path().extension() == ".class") class_files++;
+    }
+
+    rt_jvm_data::SystemDictionary dictionary;
+    rt_jvm_data::BatchClassLoader loader(dictionary, 4);
+    auto result = loader.load_directory(test_class_file_dir);
+
+    EXPECT_TRUE(result.failures.empty());
+    EXPECT_EQ(result.loaded, class_files);
+    EXPECT_EQ(dictionary.size(), class_files);
+
+    // keyed by the name inside the class file, not by the file name
+    auto demo = dictionary.find("resource/Demo");
+    ASSERT_NE(demo, nullptr);
+    EXPECT_EQ(demo->get_klass_name(), "resource/Demo");
+    EXPECT_NE(dictionary.find("com/example/demo/utils/Pair"), nullptr);
+    EXPECT_EQ(dictionary.find("java/lang/Object"), nullptr);
+}
+
+TEST(CLASS_LOADER_TEST, BATCH_LOAD_CLASSPATH_ORDER_TEST) {
+    rt_jvm_data::SystemDictionary dictionary;
+    rt_jvm_data::BatchClassLoader loader(dictionary, 2);
+
+    // the same directory twice: the second entry is shadowed, not reparsed
+    auto cp = ClassPath::parse(test_class_file_dir + ":" + test_class_file_dir);
+    ASSERT_EQ(cp.get_entries().size(), 2u);
+    auto result = loader.load_classpath(cp);
+
+    EXPECT_TRUE(result.failures.empty());
+    EXPECT_EQ(result.duplicates, 0u);
+    EXPECT_EQ(result.loaded, dictionary.size());
+    EXPECT_NE(cp.open("Pair"), nullptr);
+    EXPECT_EQ(cp.open("NoSuchClass"), nullptr);
+}
@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "../../include/runtime/class_loader_data.hpp"
+#include "../../include/runtime/system_dictionary.hpp"
+
+using rt_jvm_data::ClassLoaderData;
+using rt_jvm_data::ClassLoaderDataGraph;
+using rt_jvm_data::InstanceKlass;
+using rt_jvm_data::SystemDictionary;
+
+static const std::string test_class_file_dir = "/workspace/JavaVirtualMachine/resource";
+
+static std::unique_ptr<InstanceKlass> parse(const std::string& file, ClassLoaderData* loader) {
+    return std::make_unique<InstanceKlass>(ClassFileSource::map(test_class_file_dir + "/" + file),
+                                           loader);
+}
+
+namespace {
+    // stands in for the collector's marking: a mirror is alive while listed
+    struct Marks {
+        std::vector<oop::Ref> live;
+
+        ClassLoaderDataGraph::IsAlive is_alive() const {
+            return [this](oop::Ref mirror) {
+                return std::find(live.begin(), live.end(), mirror) != live.end();
+            };
+        }
+    };
+}; // namespace
+
+TEST(CLASS_UNLOADING_TEST, UNLOAD_TEST) {
+    // the loaders outlive the dictionary holding their klasses
+    ClassLoaderDataGraph graph;
+    SystemDictionary dictionary;
+    oop::BasicOop mirrors[2]{};
+    Marks marks;
+    marks.live = {oop::Ref(&mirrors[0]), oop::Ref(&mirrors[1])};
+
+    std::vector<const InstanceKlass*> seen;
+    graph.add_unloading_observer([&](std::span<const InstanceKlass* const> klasses) {
+        // still intact while the observers run
+        for (const auto* kls : klasses) EXPECT_FALSE(kls->get_klass_name().empty());
+        seen.insert(seen.end(), klasses.begin(), klasses.end());
+    });
+
+    auto* kept = graph.add(oop::Ref(&mirrors[0]));
+    auto* dropped = graph.add(oop::Ref(&mirrors[1]));
+    auto* boot_demo = dictionary.publish(parse("Demo.class", nullptr));
+    auto* kept_demo = dictionary.publish(parse("Demo.class", kept));
+    auto* dropped_demo = dictionary.publish(parse("Demo.class", dropped));
+    dictionary.publish(parse("Pair.class", dropped));
+    EXPECT_GT(dropped->get_metaspace().stats().used, 0u);
+    EXPECT_EQ(dictionary.size(), 4u);
+
+    // every mirror still reachable
+    EXPECT_EQ(graph.do_unloading(marks.is_alive(), dictionary), 0u);
+    EXPECT_EQ(graph.size(), 2u);
+    EXPECT_TRUE(seen.empty());
+
+    marks.live.pop_back();
+    EXPECT_EQ(graph.do_unloading(marks.is_alive(), dictionary), 1u);
+    EXPECT_EQ(graph.size(), 1u);
+    EXPECT_EQ(seen.size(), 2u);
+    EXPECT_NE(std::find(seen.begin(), seen.end(), dropped_demo), seen.end());
+    EXPECT_EQ(dictionary.size(), 2u);
+    Symbol demo = SymbolTable::intern("resource/Demo");
+    EXPECT_EQ(dictionary.find(nullptr, demo), boot_demo);
+    EXPECT_EQ(dictionary.find(kept, demo), kept_demo);
+
+    // loaders coming and going leave nothing behind
+    for (int round = 0; round < 50; round++) {
+        oop::BasicOop mirror{};
+        auto* loader = graph.add(oop::Ref(&mirror));
+        dictionary.publish(parse("Demo.class", loader));
+        dictionary.publish(parse("Pair.class", loader));
+        EXPECT_EQ(graph.do_unloading(marks.is_alive(), dictionary), 1u);
+    }
+    EXPECT_EQ(graph.size(), 1u);
+    EXPECT_EQ(dictionary.size(), 2u);
+    EXPECT_EQ(seen.size(), 102u);
+    EXPECT_EQ(dictionary.find(kept, demo), kept_demo);
+}
+
+TEST(CLASS_UNLOADING_TEST, DEPENDENCY_TEST) {
+    // the loaders outlive the dictionary holding their klasses
+    ClassLoaderDataGraph graph;
+    SystemDictionary dictionary;
+    oop::BasicOop mirrors[2]{};
+    Marks marks;
+    marks.live = {oop::Ref(&mirrors[0])};
+
+    // a class of the first loader linked against one the second defines
+    auto* child = graph.add(oop::Ref(&mirrors[0]));
+    auto* parent = graph.add(oop::Ref(&mirrors[1]));
+    auto* pair = dictionary.publish(parse("Pair.class", parent));
+    pair->link();
+    auto* demo = dictionary.publish(parse("Demo.class", child));
+    demo->link(pair);
+    EXPECT_EQ(child->get_dependencies(), std::vector<const ClassLoaderData*>{parent});
+    EXPECT_TRUE(parent->get_dependencies().empty());
+
+    // the parent's mirror is gone, but the child still needs its classes
+    EXPECT_EQ(graph.do_unloading(marks.is_alive(), dictionary), 0u);
+    EXPECT_EQ(dictionary.size(), 2u);
+
+    // both go once the child does
+    marks.live.clear();
+    EXPECT_EQ(graph.do_unloading(marks.is_alive(), dictionary), 2u);
+    EXPECT_EQ(graph.size(), 0u);
+    EXPECT_EQ(dictionary.size(), 0u);
+
+    // a loader without a mirror stays
+    graph.add(oop::Ref::null());
+    EXPECT_EQ(graph.do_unloading(marks.is_alive(), dictionary), 0u);
+    EXPECT_EQ(graph.size(), 1u);
+}
@@ -0,0 +1,194 @@
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "../../include/runtime/klass.hpp"
+#include "class_builder.hpp"
+
+using namespace class_builder;
+using rt_jvm_data::ConstantPoolResolver;
+using rt_jvm_data::CpCacheEntry;
+using rt_jvm_data::InstanceKlass;
+
+namespace {
+    // pkg/Base { int x; public void m() { return; } }
+    ClassFileSource_ptr base_class() {
+        ClassBuilder builder(52);
+        builder.add_field(0, "x", "I");
+        builder.add_method(PUBLIC, "m", "()V", 1, 1, Code().op(jvm::_return));
+        return builder.build("pkg/Base", "java/lang/Object", PUBLIC);
+    }
+
+    // pkg/Main extends pkg/Base { Object r; } with references to members of
+    // both classes, a string literal and a class that never loads
+    struct MainClass {
+        ClassBuilder builder{52};
+        u2 self = builder.cls("pkg/Main");
+        u2 base = builder.cls("pkg/Base");
+        u2 x = builder.field("pkg/Main", "x", "I");
+        u2 m = builder.method("pkg/Main", "m", "()V");
+        u2 hello = builder.string("hello");
+        u2 missing = builder.cls("pkg/Missing");
+        u2 missing_x = builder.field("pkg/Missing", "x", "I");
+        u2 r = builder.field("pkg/Main", "r", "Ljava/lang/Object;");
+
+        ClassFileSource_ptr build() {
+            builder.add_field(0, "r", "Ljava/lang/Object;");
+            return builder.build("pkg/Main", "pkg/Base", PUBLIC);
+        }
+    };
+
+    // interface pkg/I { int x = 0; }
+    ClassFileSource_ptr interface_class() {
+        ClassBuilder builder(52);
+        builder.add_field(PUBLIC | STATIC | FINAL, "x", "I");
+        return builder.build("pkg/I", "java/lang/Object", PUBLIC | INTERFACE | ABSTRACT);
+    }
+
+    struct Classes {
+        MainClass constants;
+        InstanceKlass base{base_class()};
+        InstanceKlass main{constants.build()};
+        oop::BasicOop hello{};
+        std::atomic<int> klass_calls{0};
+        std::atomic<int> string_calls{0};
+
+        ConstantPoolResolver resolver{
+            [this](Symbol name) -> const InstanceKlass* {
+                klass_calls++;
+                // long enough for the other threads to find the entry being resolved
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                return name == SymbolTable::intern("pkg/Base") ? &base : nullptr;
+            },
+            [this](Symbol literal) {
+                string_calls++;
+                return literal == SymbolTable::intern("hello") ? oop::Ref(&hello) : oop::Ref{};
+            }};
+
+        Classes() {
+            base.link();
+            main.link(&base);
+        }
+    };
+}; // namespace
+
+TEST(CP_CACHE_TEST, RESOLVE_TEST) {
+    Classes c;
+
+    const CpCacheEntry* x = c.main.resolve(c.constants.x, c.resolver);
+    ASSERT_NE(x, nullptr);
+    EXPECT_EQ(x->klass, &c.base);
+    EXPECT_EQ(x->field, c.base.get_field("x"));
+    EXPECT_EQ(x->offset, c.base.get_field("x")->offset);
+    EXPECT_EQ(x->type, rt_jvm_data::raw_value_type::Jint);
+
+    const CpCacheEntry* r = c.main.resolve(c.constants.r, c.resolver);
+    ASSERT_NE(r, nullptr);
+    EXPECT_EQ(r->field, c.main.get_field("r"));
+    EXPECT_EQ(r->type, rt_jvm_data::raw_value_type::Jreference);
+
+    const CpCacheEntry* m = c.main.resolve(c.constants.m, c.resolver);
+    ASSERT_NE(m, nullptr);
+    EXPECT_EQ(m->method, c.base.get_method("m", "()V"));
+    EXPECT_EQ(m->vtable_index, 0);
+    EXPECT_EQ(m->klass, &c.base);
+
+    // the class's own name never reaches the resolver
+    EXPECT_EQ(c.klass_calls, 0);
+    EXPECT_EQ(c.main.resolve(c.constants.self, c.resolver)->klass, &c.main);
+    EXPECT_EQ(c.main.resolve(c.constants.base, c.resolver)->klass, &c.base);
+    EXPECT_EQ(c.klass_calls, 1);
+    EXPECT_EQ(c.main.resolve(c.constants.hello, c.resolver)->string, oop::Ref(&c.hello));
+
+    // resolved entries are served from the cache
+    EXPECT_EQ(c.main.resolve(c.constants.x, c.resolver), x);
+    EXPECT_EQ(c.main.resolve(c.constants.base, c.resolver)->klass, &c.base);
+    EXPECT_EQ(c.main.resolve(c.constants.hello, c.resolver)->string, oop::Ref(&c.hello));
+    EXPECT_EQ(c.klass_calls, 1);
+    EXPECT_EQ(c.string_calls, 1);
+
+    // failures are cached too, with their error (JVMS 5.4.3)
+    EXPECT_EQ(c.main.resolution_error(c.constants.missing), nullptr);
+    EXPECT_EQ(c.main.resolve(c.constants.missing, c.resolver), nullptr);
+    EXPECT_EQ(c.main.resolve(c.constants.missing_x, c.resolver), nullptr);
+    EXPECT_EQ(c.main.resolve(c.constants.missing, c.resolver), nullptr);
+    EXPECT_EQ(c.main.resolve(c.constants.missing_x, c.resolver), nullptr);
+    EXPECT_EQ(c.klass_calls, 3);
+    EXPECT_STREQ(c.main.resolution_error(c.constants.missing), "java/lang/NoClassDefFoundError");
+    EXPECT_STREQ(c.main.resolution_error(c.constants.missing_x), "java/lang/NoClassDefFoundError");
+    EXPECT_EQ(c.main.resolution_error(c.constants.x), nullptr);
+    EXPECT_EQ(c.main.resolve(c.constants.base, ConstantPoolResolver{})->klass, &c.base);
+}
+
+// what the resolver throws, loading a class that fails to link say, is thrown
+// again by later attempts without asking the resolver
+TEST(CP_CACHE_TEST, FAILED_RESOLVE_TEST) {
+    Classes c;
+    int calls = 0;
+    ConstantPoolResolver failing{
+        [&](Symbol) -> const InstanceKlass* {
+            calls++;
+            throw rt_jvm_data::NoClassDefFoundError("pkg/Missing");
+        },
+        {}};
+    EXPECT_THROW(c.main.resolve(c.constants.missing, failing), rt_jvm_data::NoClassDefFoundError);
+    EXPECT_THROW(c.main.resolve(c.constants.missing, c.resolver),
+                 rt_jvm_data::NoClassDefFoundError);
+    EXPECT_EQ(calls, 1);
+    EXPECT_EQ(c.klass_calls, 0);
+
+    // a string is no LinkageError, and is tried again
+    EXPECT_EQ(c.main.resolve(c.constants.hello, ConstantPoolResolver{}), nullptr);
+    EXPECT_EQ(c.main.resolution_error(c.constants.hello), nullptr);
+    EXPECT_EQ(c.main.resolve(c.constants.hello, c.resolver)->string, oop::Ref(&c.hello));
+}
+
+// JVMS 5.4.3.2 looks in the superinterfaces before the superclass, so the
+// constant of pkg/I hides the instance field of pkg/Base
+TEST(CP_CACHE_TEST, FIELD_HIDING_TEST) {
+    Classes c;
+    InstanceKlass interface{interface_class()};
+    interface.link();
+    // pkg/Sub extends pkg/Base implements pkg/I, with a reference to Sub.x
+    ClassBuilder builder(52);
+    u2 sub_x = builder.field("pkg/Sub", "x", "I");
+    InstanceKlass sub{builder.build("pkg/Sub", "pkg/Base", PUBLIC | SUPER, {"pkg/I"})};
+    const InstanceKlass* interfaces[] = {&interface};
+    sub.link(&c.base, interfaces);
+
+    const CpCacheEntry* x = sub.resolve(sub_x, c.resolver);
+    ASSERT_NE(x, nullptr);
+    EXPECT_EQ(x->klass, &interface);
+    EXPECT_EQ(x->field, interface.get_field("x"));
+    EXPECT_EQ(c.klass_calls, 0);
+}
+
+TEST(CP_CACHE_TEST, CONCURRENT_RESOLVE_TEST) {
+    Classes c;
+    constexpr int thread_count = 8;
+    std::vector<const CpCacheEntry*> classes(thread_count), strings(thread_count);
+    std::atomic<int> ready{0};
+    {
+        std::vector<std::jthread> threads;
+        for (int index = 0; index < thread_count; index++) {
+            threads.emplace_back([&, index] {
+                ready++;
+                while (ready < thread_count) std::this_thread::yield();
+                classes[index] = c.main.resolve(c.constants.base, c.resolver);
+                strings[index] = c.main.resolve(c.constants.hello, c.resolver);
+            });
+        }
+    }
+
+    EXPECT_EQ(c.klass_calls, 1);
+    EXPECT_EQ(c.string_calls, 1);
+    for (int index = 0; index < thread_count; index++) {
+        ASSERT_NE(classes[index], nullptr);
+        EXPECT_EQ(classes[index]->klass, &c.base);
+        EXPECT_EQ(strings[index]->string, oop::Ref(&c.hello));
+    }
+}
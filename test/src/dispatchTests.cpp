@@ -0,0 +1,134 @@
+#include <memory>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "../../include/runtime/klass.hpp"
+#include "../../include/runtime/verifier.hpp"
+#include "class_builder.hpp"
+
+using namespace class_builder;
+using rt_jvm_data::InstanceKlass;
+using rt_jvm_data::MethodWrapper;
+
+namespace {
+    struct MethodSpec {
+        std::string name;
+        u2 flags;
+    };
+
+    // A class with ()V methods; those that are not abstract just return.
+    ClassFileSource_ptr make_class(const std::string& name, const std::string& super,
+                                   const std::vector<std::string>& interfaces, u2 flags,
+                                   const std::vector<MethodSpec>& methods) {
+        ClassBuilder builder(52);
+        for (const auto& method : methods) {
+            if (method.flags & ABSTRACT) {
+                builder.add_method(method.flags, method.name, "()V");
+            } else {
+                builder.add_method(method.flags, method.name, "()V", 0,
+                                   (method.flags & STATIC) ? 0 : 1, Code().op(jvm::_return));
+            }
+        }
+        return builder.build(name, super, flags, interfaces);
+    }
+
+    const MethodWrapper& method_of(const InstanceKlass& kls, const std::string& name) {
+        const auto* method = kls.get_method(name, "()V");
+        EXPECT_NE(method, nullptr) << name;
+        return *method;
+    }
+
+    struct Hierarchy {
+        InstanceKlass object{make_class("java/lang/Object", "", {}, PUBLIC,
+                                        {{"<init>", PUBLIC}, {"toString", PUBLIC}})};
+        InstanceKlass a{make_class("pkg/A", "java/lang/Object", {}, PUBLIC,
+                                   {{"m", PUBLIC},
+                                    {"p", 0},
+                                    {"q", PRIVATE},
+                                    {"s", PUBLIC | STATIC},
+                                    {"f", PUBLIC | FINAL}})};
+
+        Hierarchy() {
+            object.link();
+            a.link(&object);
+        }
+    };
+}; // namespace
+
+TEST(DISPATCH_TEST, VTABLE_TEST) {
+    Hierarchy h;
+    // Object's slot, then A's dispatched methods in declaration order
+    ASSERT_EQ(h.a.get_vtable().size(), 4u);
+    EXPECT_EQ(h.a.get_vtable()[0], &method_of(h.object, "toString"));
+    EXPECT_EQ(method_of(h.a, "m").vtable_index, 1);
+    EXPECT_EQ(method_of(h.a, "p").vtable_index, 2);
+    EXPECT_EQ(method_of(h.a, "f").vtable_index, 3);
+    EXPECT_EQ(method_of(h.a, "q").vtable_index, -1);
+    EXPECT_EQ(method_of(h.a, "s").vtable_index, -1);
+    EXPECT_EQ(method_of(h.object, "<init>").vtable_index, -1);
+
+    // same package: m and p are both overridden in place
+    InstanceKlass b(make_class("pkg/B", "pkg/A", {}, PUBLIC, {{"p", 0}, {"m", PUBLIC}}));
+    b.link(&h.a);
+    ASSERT_EQ(b.get_vtable().size(), 4u);
+    EXPECT_EQ(b.select_virtual(method_of(h.a, "m").vtable_index), &method_of(b, "m"));
+    EXPECT_EQ(b.select_virtual(method_of(h.a, "p").vtable_index), &method_of(b, "p"));
+    EXPECT_EQ(method_of(b, "m").vtable_index, 1);
+    EXPECT_EQ(b.resolve_method(SymbolTable::intern("f"), SymbolTable::intern("()V")),
+              &method_of(h.a, "f"));
+
+    // another package cannot override the package private p, it gets a new slot
+    InstanceKlass c(make_class("other/C", "pkg/A", {}, PUBLIC, {{"p", PUBLIC}, {"m", PUBLIC}}));
+    c.link(&h.a);
+    ASSERT_EQ(c.get_vtable().size(), 5u);
+    EXPECT_EQ(c.select_virtual(2), &method_of(h.a, "p"));
+    EXPECT_EQ(method_of(c, "p").vtable_index, 4);
+    EXPECT_EQ(c.select_virtual(1), &method_of(c, "m"));
+
+    InstanceKlass overrides_final(make_class("pkg/D", "pkg/A", {}, PUBLIC, {{"f", PUBLIC}}));
+    EXPECT_THROW(overrides_final.link(&h.a), rt_jvm_data::VerifyError);
+    EXPECT_FALSE(overrides_final.is_linked());
+}
+
+TEST(DISPATCH_TEST, ITABLE_TEST) {
+    Hierarchy h;
+    u2 interface = PUBLIC | INTERFACE | ABSTRACT;
+    InstanceKlass i(make_class("pkg/I", "java/lang/Object", {}, interface,
+                               {{"run", PUBLIC | ABSTRACT}, {"walk", PUBLIC}}));
+    i.link(&h.object);
+    InstanceKlass j(make_class("pkg/J", "java/lang/Object", {"pkg/I"}, interface,
+                               {{"jump", PUBLIC | ABSTRACT}}));
+    const InstanceKlass* i_ptr = &i;
+    j.link(&h.object, {&i_ptr, 1});
+    EXPECT_EQ(method_of(i, "run").itable_index, 0);
+    EXPECT_EQ(method_of(i, "walk").itable_index, 1);
+    EXPECT_EQ(method_of(j, "jump").itable_index, 0);
+    EXPECT_TRUE(j.implements(&i));
+
+    InstanceKlass k(make_class("pkg/K", "pkg/A", {"pkg/J"}, PUBLIC, {{"run", PUBLIC}}));
+    const InstanceKlass* j_ptr = &j;
+    k.link(&h.a, {&j_ptr, 1});
+    EXPECT_TRUE(k.implements(&i));
+    EXPECT_TRUE(k.implements(&j));
+    EXPECT_EQ(k.get_interface_names(), std::vector<Symbol>{SymbolTable::intern("pkg/J")});
+    EXPECT_EQ(k.get_super_name(), SymbolTable::intern("pkg/A"));
+
+    EXPECT_EQ(k.select_interface(method_of(i, "run")), &method_of(k, "run"));
+    // the default method and the abstract one come from the interfaces
+    EXPECT_EQ(k.select_interface(method_of(i, "walk")), &method_of(i, "walk"));
+    EXPECT_EQ(k.select_interface(method_of(j, "jump")), &method_of(j, "jump"));
+    EXPECT_EQ(k.select_interface(method_of(h.object, "toString")), nullptr);
+
+    // invokevirtual K.walk resolves to the default method, which has its own slot
+    Symbol walk = SymbolTable::intern("walk"), void_ = SymbolTable::intern("()V");
+    EXPECT_EQ(k.resolve_method(walk, void_), &method_of(i, "walk"));
+    EXPECT_EQ(k.get_vtable().size(), 7u);
+    EXPECT_EQ(k.get_vtable().back(), &method_of(i, "walk"));
+
+    // a subclass inherits the itable and the default slot
+    InstanceKlass l(make_class("pkg/L", "pkg/K", {}, PUBLIC, {{"walk", PUBLIC}}));
+    l.link(&k);
+    EXPECT_EQ(l.select_interface(method_of(i, "walk")), &method_of(l, "walk"));
+    EXPECT_EQ(method_of(l, "walk").vtable_index, 6);
+}
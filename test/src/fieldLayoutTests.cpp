@@ -0,0 +1,99 @@
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "../../include/runtime/field_layout.hpp"
+#include "../../include/runtime/klass.hpp"
+
+using raw_jvm_type::u4;
+using rt_jvm_data::FieldShape;
+using rt_jvm_data::OopMapBlock;
+
+static const std::string test_class_file_dir = "/workspace/JavaVirtualMachine/resource";
+
+static constexpr FieldShape ref{8, true, false};
+static constexpr FieldShape long_{8, false, false};
+static constexpr FieldShape int_{4, false, false};
+static constexpr FieldShape short_{2, false, false};
+static constexpr FieldShape byte_{1, false, false};
+
+TEST(FIELD_LAYOUT_TEST, PACKING_TEST) {
+    std::vector<FieldShape> fields = {byte_, long_, ref, int_, short_, ref, byte_};
+    std::vector<u4> offsets(fields.size());
+    auto layout = rt_jvm_data::layout_fields(fields, nullptr, offsets);
+
+    // references first and together, then widest first with no holes
+    EXPECT_EQ(offsets, (std::vector<u4>{30, 16, 0, 24, 28, 8, 31}));
+    EXPECT_EQ(layout.instance_size, 32u);
+    EXPECT_EQ(layout.object_size(), 32u);
+    EXPECT_EQ(layout.oop_maps, (std::vector<OopMapBlock>{{0, 2}}));
+    EXPECT_EQ(layout.static_size, 0u);
+}
+
+TEST(FIELD_LAYOUT_TEST, INHERITANCE_TEST) {
+    std::vector<FieldShape> super_fields = {int_, byte_};
+    std::vector<u4> super_offsets(super_fields.size());
+    auto super = rt_jvm_data::layout_fields(super_fields, nullptr, super_offsets);
+    EXPECT_EQ(super.instance_size, 5u);
+    EXPECT_EQ(super.object_size(), 8u);
+
+    // the tail of the superclass is filled before the 8 byte group starts
+    std::vector<FieldShape> fields = {long_, short_, byte_, ref};
+    std::vector<u4> offsets(fields.size());
+    auto layout = rt_jvm_data::layout_fields(fields, &super, offsets);
+    EXPECT_EQ(offsets, (std::vector<u4>{16, 6, 5, 8}));
+    EXPECT_EQ(layout.instance_size, 24u);
+    EXPECT_EQ(layout.oop_maps, (std::vector<OopMapBlock>{{8, 1}}));
+
+    // a subclass whose references follow the superclass's extends its block
+    std::vector<FieldShape> refs = {ref};
+    std::vector<u4> ref_offsets(1);
+    auto holder = rt_jvm_data::layout_fields(refs, nullptr, ref_offsets);
+    auto extended = rt_jvm_data::layout_fields(refs, &holder, ref_offsets);
+    EXPECT_EQ(ref_offsets[0], 8u);
+    EXPECT_EQ(extended.oop_maps, (std::vector<OopMapBlock>{{0, 2}}));
+}
+
+TEST(FIELD_LAYOUT_TEST, STATIC_TEST) {
+    std::vector<FieldShape> fields = {{4, false, true}, int_, {8, true, true}, {2, false, true}};
+    std::vector<u4> offsets(fields.size());
+    auto layout = rt_jvm_data::layout_fields(fields, nullptr, offsets);
+
+    EXPECT_EQ(offsets, (std::vector<u4>{8, 0, 0, 12}));
+    EXPECT_EQ(layout.instance_size, 4u);
+    EXPECT_TRUE(layout.oop_maps.empty());
+    EXPECT_EQ(layout.static_size, 14u);
+    EXPECT_EQ(layout.static_oop_count, 1u);
+}
+
+TEST(FIELD_LAYOUT_TEST, CORPUS_TEST) {
+    for (const auto& entry : std::filesystem::directory_iterator(test_class_file_dir)) {
+        if (entry.path().extension() != ".class") continue;
+        rt_jvm_data::InstanceKlass kls(ClassFileSource::map(entry.path()));
+        // the corpus refers to a class library that is not loaded here
+        kls.link(nullptr, {}, [](std::string_view, std::string_view) { return true; });
+        const auto& layout = kls.get_field_layout();
+
+        std::vector<bool> instance_bytes(layout.instance_size), static_bytes(layout.static_size);
+        u4 references = 0;
+        for (const auto& field : kls.get_fields()) {
+            u4 size = rt_jvm_data::type_size_of(field.type);
+            EXPECT_EQ(field.offset % size, 0u) << entry.path() << " " << field.name.view();
+
+            auto& bytes = field.is_static() ? static_bytes : instance_bytes;
+            ASSERT_LE(field.offset + size, bytes.size());
+            for (u4 at = field.offset; at < field.offset + size; at++) {
+                EXPECT_FALSE(bytes[at]) << entry.path() << " " << field.name.view();
+                bytes[at] = true;
+            }
+            if (!field.is_static() && field.type == rt_jvm_data::raw_value_type::Jreference) {
+                references++;
+            }
+        }
+
+        u4 mapped = 0;
+        for (const auto& block : layout.oop_maps) mapped += block.count;
+        EXPECT_EQ(mapped, references) << entry.path();
+    }
+}
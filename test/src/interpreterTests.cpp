@@ -0,0 +1,1435 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "../../include/runtime/byte_code_engine.hpp"
+#include "../../include/runtime/class_loader_data.hpp"
+#include "../../include/runtime/compile_broker.hpp"
+#include "../../include/runtime/jit_compiler.hpp"
+#include "../../include/runtime/klass.hpp"
+#include "../../include/runtime/system_dictionary.hpp"
+#include "class_builder.hpp"
+
+using namespace raw_jvm_type;
+using namespace jvm;
+using namespace class_builder;
+using rt_jvm_data::InstanceKlass;
+using rt_jvm_data::MethodWrapper;
+
+static const std::string test_class_file_dir = "/workspace/JavaVirtualMachine/resource";
+
+namespace {
+    // java/lang/Object, a Throwable hierarchy made on demand, and the
+    // classes a test defines; strings are instances of java/lang/Object.
+    struct Vm {
+        oop::Heap heap;
+        std::map<std::string, std::unique_ptr<InstanceKlass>> classes;
+        std::map<std::string, oop::Ref> strings;
+        Runtime runtime;
+
+        Vm() {
+            ClassBuilder object;
+            object.add_method(PUBLIC, "<init>", "()V", 0, 1, Code().op(_return));
+            define(object.build("java/lang/Object", ""));
+            ClassBuilder throwable;
+            throwable.add_method(PUBLIC, "<init>", "()V", 1, 1,
+                                 Code()
+                                     .op(_aload_0)
+                                     .op2(_invokespecial, throwable.method("java/lang/Object",
+                                                                           "<init>", "()V"))
+                                     .op(_return));
+            define(throwable.build("java/lang/Throwable", "java/lang/Object"));
+            define(ClassBuilder().build("java/lang/Exception", "java/lang/Throwable"));
+            define(ClassBuilder().build("java/lang/RuntimeException", "java/lang/Exception"));
+
+            runtime.heap = &heap;
+            runtime.resolver.klass = [this](Symbol name) -> const InstanceKlass* {
+                std::string text(name.view());
+                if (auto it = classes.find(text); it != classes.end()) return it->second.get();
+                if (!text.starts_with("java/lang/")) return nullptr;
+                return &define(ClassBuilder().build(text, "java/lang/RuntimeException"));
+            };
+            runtime.resolver.string = [this](Symbol literal) {
+                auto [it, added] = strings.try_emplace(std::string(literal.view()));
+                if (added) it->second = heap.allocate_instance(klass("java/lang/Object"), 0);
+                return it->second;
+            };
+        }
+
+        const InstanceKlass& define(ClassFileSource_ptr source) {
+            auto kls = std::make_unique<InstanceKlass>(source);
+            const InstanceKlass* super = nullptr;
+            if (Symbol name = kls->get_super_name()) {
+                super = classes.at(std::string(name.view())).get();
+            }
+            kls->link(super, {}, [](std::string_view, std::string_view) { return true; });
+            auto& slot = classes[kls->get_klass_name()];
+            slot = std::move(kls);
+            return *slot;
+        }
+
+        const InstanceKlass* klass(const std::string& name) {
+            return runtime.resolver.klass(SymbolTable::intern(name));
+        }
+
+        std::int32_t call(const InstanceKlass& kls, const std::string& name,
+                          const std::string& descriptor, std::vector<Slot> arguments = {}) {
+            const MethodWrapper* method = kls.get_method(name, descriptor);
+            EXPECT_NE(method, nullptr) << name;
+            return static_cast<std::int32_t>(
+                BytecodeEngine::invoke(*method, arguments, runtime).raw);
+        }
+
+        // the class of the exception an invocation threw
+        std::string thrown(const InstanceKlass& kls, const std::string& name,
+                           const std::string& descriptor, std::vector<Slot> arguments = {}) {
+            try {
+                call(kls, name, descriptor, arguments);
+            } catch (const JavaException& e) {
+                return e.get_exception().as<oop::InstanceOop>()->kls_ptr->get_klass_name();
+            }
+            return "nothing";
+        }
+    };
+
+    Slot int_slot(std::int32_t value) {
+        return Slot(static_cast<u4>(value));
+    }
+
+    const Runtime::Dispatch dispatches[] = {Runtime::Dispatch::Threaded, Runtime::Dispatch::Table,
+                                            Runtime::Dispatch::Cached};
+}; // namespace
+
+TEST(INTERPRETER_TEST, ARITHMETIC_TEST) {
+    Vm vm;
+    ClassBuilder b;
+    u2 fib = b.method("test/Math", "fib", "(I)I");
+    b.add_method(PUBLIC | STATIC, "fib", "(I)I", 3, 1,
+                 Code()
+                     .op(_iload_0)
+                     .op(_iconst_2)
+                     .branch(_if_icmpge, "recurse")
+                     .op(_iload_0)
+                     .op(_ireturn)
+                     .label("recurse")
+                     .op(_iload_0)
+                     .op(_iconst_1)
+                     .op(_isub)
+                     .op2(_invokestatic, fib)
+                     .op(_iload_0)
+                     .op(_iconst_2)
+                     .op(_isub)
+                     .op2(_invokestatic, fib)
+                     .op(_iadd)
+                     .op(_ireturn));
+    // (a * b + a / b) ^ (a >>> 3), as an int
+    b.add_method(PUBLIC | STATIC, "longs", "(JJ)I", 6, 4,
+                 Code()
+                     .op(_lload_0)
+                     .op(_lload_2)
+                     .op(_lmul)
+                     .op(_lload_0)
+                     .op(_lload_2)
+                     .op(_ldiv)
+                     .op(_ladd)
+                     .op(_lload_0)
+                     .op(_iconst_3)
+                     .op(_lushr)
+                     .op(_lxor)
+                     .op2(_ldc2_w, b.long_(0xFFFFFFFFll))
+                     .op(_land)
+                     .op(_l2i)
+                     .op(_ireturn));
+    // (int) (a / i + 1.5), and f2i of NaN added
+    b.add_method(PUBLIC | STATIC, "doubles", "(DI)I", 6, 3,
+                 Code()
+                     .op(_dload_0)
+                     .op(_iload_2)
+                     .op(_i2d)
+                     .op(_ddiv)
+                     .op(_dconst_1)
+                     .op(_dadd)
+                     .op(_fconst_1)
+                     .op(_f2d)
+                     .op(_fconst_2)
+                     .op(_f2d)
+                     .op(_ddiv)
+                     .op(_dadd)
+                     .op(_d2i)
+                     .op(_fconst_0)
+                     .op(_fconst_0)
+                     .op(_fdiv)
+                     .op(_f2i)
+                     .op(_iadd)
+                     .op(_ireturn));
+    b.add_method(PUBLIC | STATIC, "div", "(II)I", 2, 2,
+                 Code().op(_iload_0).op(_iload_1).op(_idiv).op(_ireturn));
+    b.add_method(PUBLIC | STATIC, "saturate", "(D)J", 2, 2,
+                 Code().op(_dload_0).op(_d2l).op(_lreturn));
+    const InstanceKlass& math = vm.define(b.build("test/Math", "java/lang/Object"));
+
+    std::int64_t a = 123456789012345, c = -977;
+    auto expected = static_cast<std::int32_t>(
+        static_cast<u4>((static_cast<u8>(a * c + a / c)) ^ (static_cast<u8>(a) >> 3)));
+    for (auto dispatch : dispatches) {
+        vm.runtime.dispatch = dispatch;
+        EXPECT_EQ(vm.call(math, "fib", "(I)I", {int_slot(20)}), 6765);
+        EXPECT_EQ(vm.call(math, "longs", "(JJ)I",
+                          {Slot(static_cast<u8>(a)), Slot(), Slot(static_cast<u8>(c)), Slot()}),
+                  expected);
+        EXPECT_EQ(vm.call(math, "doubles", "(DI)I",
+                          {Slot(std::bit_cast<u8>(10.0)), Slot(), int_slot(4)}),
+                  4);
+        EXPECT_EQ(vm.call(math, "div", "(II)I",
+                          {int_slot(std::numeric_limits<std::int32_t>::min()), int_slot(-1)}),
+                  std::numeric_limits<std::int32_t>::min());
+        EXPECT_EQ(vm.call(math, "div", "(II)I", {int_slot(-7), int_slot(2)}), -3);
+    }
+    Slot huge = BytecodeEngine::invoke(*math.get_method("saturate", "(D)J"),
+                                       std::vector<Slot>{Slot(std::bit_cast<u8>(1e300)), Slot()},
+                                       vm.runtime);
+    EXPECT_EQ(static_cast<std::int64_t>(huge.raw), std::numeric_limits<std::int64_t>::max());
+}
+
+TEST(INTERPRETER_TEST, OBJECT_TEST) {
+    Vm vm;
+    ClassBuilder base;
+    u2 created = base.field("test/Base", "created", "I");
+    u2 value = base.field("test/Base", "value", "I");
+    base.add_field(0, "value", "I");
+    base.add_field(STATIC, "created", "I", base.integer(5));
+    base.add_method(STATIC, "<clinit>", "()V", 2, 0,
+                    Code()
+                        .op2(_getstatic, created)
+                        .op(_bipush, {10})
+                        .op(_iadd)
+                        .op2(_putstatic, created)
+                        .op(_return));
+    base.add_method(PUBLIC, "<init>", "(I)V", 2, 2,
+                    Code()
+                        .op(_aload_0)
+                        .op2(_invokespecial, base.method("java/lang/Object", "<init>", "()V"))
+                        .op(_aload_0)
+                        .op(_iload_1)
+                        .op2(_putfield, value)
+                        .op2(_getstatic, created)
+                        .op(_iconst_1)
+                        .op(_iadd)
+                        .op2(_putstatic, created)
+                        .op(_return));
+    base.add_method(PUBLIC, "get", "()I", 1, 1,
+                    Code().op(_aload_0).op2(_getfield, value).op(_ireturn));
+    // new Derived(v).get() + created
+    base.add_method(PUBLIC | STATIC, "run", "(I)I", 3, 2,
+                    Code()
+                        .op2(_new, base.cls("test/Derived"))
+                        .op(_dup)
+                        .op(_iload_0)
+                        .op2(_invokespecial, base.method("test/Derived", "<init>", "(I)V"))
+                        .op(_astore_1)
+                        .op(_aload_1)
+                        .op2(_invokevirtual, base.method("test/Base", "get", "()I"))
+                        .op2(_getstatic, created)
+                        .op(_iadd)
+                        .op(_ireturn));
+    const InstanceKlass& base_klass = vm.define(base.build("test/Base", "java/lang/Object"));
+
+    ClassBuilder derived;
+    u2 wide = derived.field("test/Derived", "wide", "J");
+    derived.add_field(0, "wide", "J");
+    derived.add_method(PUBLIC, "<init>", "(I)V", 3, 2,
+                       Code()
+                           .op(_aload_0)
+                           .op(_iload_1)
+                           .op2(_invokespecial, derived.method("test/Base", "<init>", "(I)V"))
+                           .op(_aload_0)
+                           .op2(_ldc2_w, derived.long_(1ll << 40))
+                           .op2(_putfield, wide)
+                           .op(_return));
+    // super.get() * 2 + (int) (wide >>> 40)
+    derived.add_method(PUBLIC, "get", "()I", 4, 1,
+                       Code()
+                           .op(_aload_0)
+                           .op2(_invokespecial, derived.method("test/Base", "get", "()I"))
+                           .op(_iconst_2)
+                           .op(_imul)
+                           .op(_aload_0)
+                           .op2(_getfield, wide)
+                           .op(_bipush, {40})
+                           .op(_lushr)
+                           .op(_l2i)
+                           .op(_iadd)
+                           .op(_ireturn));
+    const InstanceKlass& derived_klass = vm.define(derived.build("test/Derived", "test/Base"));
+
+    EXPECT_FALSE(base_klass.is_initialized());
+    // created is 5, then 15 after <clinit>, then 16 after the constructor
+    EXPECT_EQ(vm.call(base_klass, "run", "(I)I", {int_slot(20)}), 41 + 16);
+    EXPECT_TRUE(base_klass.is_initialized());
+    // super.get() is quickened to the method selected for test/Derived
+    EXPECT_EQ(derived_klass.get_method("get", "()I")->code_info->quick_code[1],
+              _invokenonvirtual_quick);
+    vm.runtime.dispatch = Runtime::Dispatch::Table;
+    EXPECT_EQ(vm.call(base_klass, "run", "(I)I", {int_slot(1)}), 3 + 17);
+}
+
+TEST(INTERPRETER_TEST, ARRAY_TEST) {
+    Vm vm;
+    ClassBuilder b;
+    // 0 + 1 + ... + n - 1 through an int[n]
+    b.add_method(PUBLIC | STATIC, "sum", "(I)I", 4, 4,
+                 Code()
+                     .op(_iload_0)
+                     .op(_newarray, {10})
+                     .op(_astore_1)
+                     .op(_iconst_0)
+                     .op(_istore_2)
+                     .label("fill")
+                     .op(_iload_2)
+                     .op(_iload_0)
+                     .branch(_if_icmpge, "filled")
+                     .op(_aload_1)
+                     .op(_iload_2)
+                     .op(_iload_2)
+                     .op(_iastore)
+                     .op(_iinc, {2, 1})
+                     .branch(_goto, "fill")
+                     .label("filled")
+                     .op(_iconst_0)
+                     .op(_istore_3)
+                     .op(_iconst_0)
+                     .op(_istore_2)
+                     .label("add")
+                     .op(_iload_2)
+                     .op(_aload_1)
+                     .op(_arraylength)
+                     .branch(_if_icmpge, "done")
+                     .op(_iload_3)
+                     .op(_aload_1)
+                     .op(_iload_2)
+                     .op(_iaload)
+                     .op(_iadd)
+                     .op(_istore_3)
+                     .op(_iinc, {2, 1})
+                     .branch(_goto, "add")
+                     .label("done")
+                     .op(_iload_3)
+                     .op(_ireturn));
+    // new byte[4][i], -1 when i is out of bounds
+    b.add_method(PUBLIC | STATIC, "at", "(I)I", 2, 1,
+                 Code()
+                     .label("start")
+                     .op(_iconst_4)
+                     .op(_newarray, {8})
+                     .op(_iload_0)
+                     .op(_baload)
+                     .op(_ireturn)
+                     .label("end")
+                     .op(_pop)
+                     .op(_iconst_m1)
+                     .op(_ireturn)
+                     .handler("start", "end", "end",
+                              b.cls("java/lang/ArrayIndexOutOfBoundsException")));
+    // long[3][4] a; a[2][3] = 7; a[2][3] + a.length + (a instanceof Object[])
+    b.add_method(PUBLIC | STATIC, "multi", "()I", 6, 1,
+                 Code()
+                     .op(_iconst_3)
+                     .op(_iconst_4)
+                     .op2(_multianewarray, b.cls("[[J"))
+                     .op(2)
+                     .op(_astore_0)
+                     .op(_aload_0)
+                     .op(_iconst_2)
+                     .op(_aaload)
+                     .op(_iconst_3)
+                     .op2(_ldc2_w, b.long_(7))
+                     .op(_lastore)
+                     .op(_aload_0)
+                     .op(_iconst_2)
+                     .op(_aaload)
+                     .op(_iconst_3)
+                     .op(_laload)
+                     .op(_l2i)
+                     .op(_aload_0)
+                     .op(_arraylength)
+                     .op(_iadd)
+                     .op(_aload_0)
+                     .op2(_instanceof, b.cls("[Ljava/lang/Object;"))
+                     .op(_iadd)
+                     .op(_aload_0)
+                     .op2(_checkcast, b.cls("[[J"))
+                     .op(_pop)
+                     .op(_ireturn));
+    // an Object into a test/Store[] seen as Object[]
+    b.add_method(PUBLIC | STATIC, "store", "()V", 5, 1,
+                 Code()
+                     .op(_iconst_1)
+                     .op2(_anewarray, b.cls("test/Store"))
+                     .op2(_checkcast, b.cls("[Ljava/lang/Object;"))
+                     .op(_iconst_0)
+                     .op2(_new, b.cls("java/lang/Object"))
+                     .op(_dup)
+                     .op2(_invokespecial, b.method("java/lang/Object", "<init>", "()V"))
+                     .op(_aastore)
+                     .op(_return));
+    b.add_method(PUBLIC | STATIC, "cast", "()V", 2, 0,
+                 Code()
+                     .op2(_new, b.cls("java/lang/Object"))
+                     .op(_dup)
+                     .op2(_invokespecial, b.method("java/lang/Object", "<init>", "()V"))
+                     .op2(_checkcast, b.cls("test/Store"))
+                     .op(_return));
+    const InstanceKlass& store = vm.define(b.build("test/Store", "java/lang/Object"));
+
+    for (auto dispatch : dispatches) {
+        vm.runtime.dispatch = dispatch;
+        EXPECT_EQ(vm.call(store, "sum", "(I)I", {int_slot(100)}), 4950);
+        EXPECT_EQ(vm.call(store, "at", "(I)I", {int_slot(3)}), 0);
+        EXPECT_EQ(vm.call(store, "at", "(I)I", {int_slot(4)}), -1);
+        EXPECT_EQ(vm.call(store, "at", "(I)I", {int_slot(-1)}), -1);
+        EXPECT_EQ(vm.call(store, "multi", "()I"), 11);
+        EXPECT_EQ(vm.thrown(store, "sum", "(I)I", {int_slot(-1)}),
+                  "java/lang/NegativeArraySizeException");
+        EXPECT_EQ(vm.thrown(store, "store", "()V"), "java/lang/ArrayStoreException");
+        EXPECT_EQ(vm.thrown(store, "cast", "()V"), "java/lang/ClassCastException");
+    }
+}
+
+TEST(INTERPRETER_TEST, SWITCH_TEST) {
+    Vm vm;
+    ClassBuilder b;
+    b.add_method(PUBLIC | STATIC, "pick", "(I)I", 1, 1,
+                 Code()
+                     .op(_iload_0)
+                     .tableswitch("sparse", 1, {"one", "two", "three"})
+                     .label("one")
+                     .op(_bipush, {10})
+                     .op(_ireturn)
+                     .label("two")
+                     .op(_bipush, {20})
+                     .op(_ireturn)
+                     .label("three")
+                     .op(_bipush, {30})
+                     .op(_ireturn)
+                     .label("sparse")
+                     .op(_iload_0)
+                     .lookupswitch("none", {{-5, "minus"}, {1000, "big"}})
+                     .label("minus")
+                     .op(_bipush, {50})
+                     .op(_ireturn)
+                     .label("big")
+                     .op2(_sipush, 600)
+                     .op(_ireturn)
+                     .label("none")
+                     .op(_iconst_m1)
+                     .op(_ireturn));
+    const InstanceKlass& kls = vm.define(b.build("test/Switch", "java/lang/Object"));
+
+    const std::pair<std::int32_t, std::int32_t> cases[] = {
+        {1, 10}, {2, 20}, {3, 30}, {-5, 50}, {1000, 600}, {0, -1}, {4, -1}, {999, -1}};
+    for (auto dispatch : dispatches) {
+        vm.runtime.dispatch = dispatch;
+        for (auto [key, expected] : cases) {
+            EXPECT_EQ(vm.call(kls, "pick", "(I)I", {int_slot(key)}), expected) << key;
+        }
+    }
+}
+
+TEST(INTERPRETER_TEST, EXCEPTION_TEST) {
+    Vm vm;
+    ClassBuilder b;
+    u2 value = b.field("test/Throws", "value", "I");
+    b.add_field(0, "value", "I");
+    // a / b, -1 on ArithmeticException
+    b.add_method(PUBLIC | STATIC, "div", "(II)I", 2, 3,
+                 Code()
+                     .label("start")
+                     .op(_iload_0)
+                     .op(_iload_1)
+                     .op(_idiv)
+                     .op(_ireturn)
+                     .label("end")
+                     .op(_astore_2)
+                     .op(_iconst_m1)
+                     .op(_ireturn)
+                     .handler("start", "end", "end", b.cls("java/lang/ArithmeticException")));
+    b.add_method(PUBLIC | STATIC, "deref", "(Ltest/Throws;)I", 1, 1,
+                 Code().op(_aload_0).op2(_getfield, value).op(_ireturn));
+    // the NullPointerException of a callee, caught as a RuntimeException
+    b.add_method(PUBLIC | STATIC, "caller", "()I", 1, 0,
+                 Code()
+                     .label("start")
+                     .op(_aconst_null)
+                     .op2(_invokestatic, b.method("test/Throws", "deref", "(Ltest/Throws;)I"))
+                     .op(_ireturn)
+                     .label("end")
+                     .op(_pop)
+                     .op(_bipush, {42})
+                     .op(_ireturn)
+                     .handler("start", "end", "end", b.cls("java/lang/RuntimeException")));
+    b.add_method(PUBLIC | STATIC, "boom", "()V", 2, 0,
+                 Code()
+                     .op2(_new, b.cls("java/lang/IllegalStateException"))
+                     .op(_dup)
+                     .op2(_invokespecial,
+                          b.method("java/lang/IllegalStateException", "<init>", "()V"))
+                     .op(_athrow));
+    b.add_method(PUBLIC | STATIC, "unlock", "()V", 2, 0,
+                 Code()
+                     .op2(_new, b.cls("java/lang/Object"))
+                     .op(_dup)
+                     .op2(_invokespecial, b.method("java/lang/Object", "<init>", "()V"))
+                     .op(_dup)
+                     .op(_monitorenter)
+                     .op(_dup)
+                     .op(_monitorexit)
+                     .op(_monitorexit)
+                     .op(_return));
+    b.add_method(PUBLIC | STATIC, "deep", "()V", 0, 0,
+                 Code().op2(_invokestatic, b.method("test/Throws", "deep", "()V")).op(_return));
+    b.add_native(PUBLIC | STATIC, "twice", "(I)I");
+    const InstanceKlass& kls = vm.define(b.build("test/Throws", "java/lang/Object"));
+
+    for (auto dispatch : dispatches) {
+        vm.runtime.dispatch = dispatch;
+        EXPECT_EQ(vm.call(kls, "div", "(II)I", {int_slot(7), int_slot(2)}), 3);
+        EXPECT_EQ(vm.call(kls, "div", "(II)I", {int_slot(7), int_slot(0)}), -1);
+        EXPECT_EQ(vm.call(kls, "caller", "()I"), 42);
+        EXPECT_EQ(vm.thrown(kls, "boom", "()V"), "java/lang/IllegalStateException");
+        EXPECT_EQ(vm.thrown(kls, "unlock", "()V"), "java/lang/IllegalMonitorStateException");
+        EXPECT_EQ(vm.thrown(kls, "deep", "()V"), "java/lang/StackOverflowError");
+    }
+
+    // natives go through the runtime, or raise UnsatisfiedLinkError without it
+    EXPECT_EQ(vm.thrown(kls, "twice", "(I)I", {int_slot(4)}), "java/lang/UnsatisfiedLinkError");
+    vm.runtime.native = [](const MethodWrapper&, std::span<const Slot> arguments) {
+        return int_slot(2 * static_cast<std::int32_t>(arguments[0].raw));
+    };
+    EXPECT_EQ(vm.call(kls, "twice", "(I)I", {int_slot(4)}), 8);
+
+    // code of a class never linked was never verified, and is not run
+    ClassBuilder unlinked;
+    unlinked.add_method(PUBLIC | STATIC, "m", "()I", 1, 0, Code().op(_iconst_1).op(_ireturn));
+    InstanceKlass unverified(unlinked.build("test/Unlinked", "java/lang/Object"));
+    StackFrame frame(*unverified.get_method("m", "()I"), oop::Ref::null());
+    oop::Ref refused = BytecodeEngine::execute(frame, vm.runtime).exception;
+    EXPECT_EQ(refused.as<oop::InstanceOop>()->kls_ptr->get_klass_name(), "java/lang/VerifyError");
+}
+
+// getstatic, putstatic, getfield and putfield of fields that do not resolve
+// or are of the other kind; a failed resolution fails the same way again
+TEST(INTERPRETER_TEST, LINKAGE_ERROR_TEST) {
+    Vm vm;
+    ClassBuilder b;
+    u2 instance = b.field("test/Linkage", "i", "I");
+    u2 shared = b.field("test/Linkage", "s", "I");
+    b.add_field(0, "i", "I");
+    b.add_field(STATIC, "s", "I");
+    b.add_method(PUBLIC | STATIC, "missingClass", "()I", 1, 0,
+                 Code().op2(_getstatic, b.field("test/Missing", "x", "I")).op(_ireturn));
+    b.add_method(PUBLIC | STATIC, "missingField", "()I", 1, 0,
+                 Code().op2(_getstatic, b.field("test/Linkage", "nope", "I")).op(_ireturn));
+    b.add_method(PUBLIC | STATIC, "getInstance", "()I", 1, 0,
+                 Code().op2(_getstatic, instance).op(_ireturn));
+    b.add_method(PUBLIC | STATIC, "putInstance", "()V", 1, 0,
+                 Code().op(_iconst_0).op2(_putstatic, instance).op(_return));
+    b.add_method(PUBLIC | STATIC, "getStatic", "()I", 1, 0,
+                 Code().op(_aconst_null).op2(_getfield, shared).op(_ireturn));
+    b.add_method(PUBLIC | STATIC, "putStatic", "()V", 2, 0,
+                 Code().op(_aconst_null).op(_iconst_0).op2(_putfield, shared).op(_return));
+    // instance invokes of a static method, which takes no receiver
+    u2 helper = b.method("test/Linkage", "helper", "()V");
+    u2 interface_helper = b.interface_method("test/Linkage", "helper", "()V");
+    b.add_method(PUBLIC | STATIC, "helper", "()V", 0, 0, Code().op(_return));
+    b.add_method(PUBLIC | STATIC, "virtualStatic", "()V", 1, 0,
+                 Code().op(_aconst_null).op2(_invokevirtual, helper).op(_return));
+    b.add_method(PUBLIC | STATIC, "specialStatic", "()V", 1, 0,
+                 Code().op(_aconst_null).op2(_invokespecial, helper).op(_return));
+    b.add_method(PUBLIC | STATIC, "interfaceStatic", "()V", 1, 0,
+                 Code()
+                     .op(_aconst_null)
+                     .op(_invokeinterface, {static_cast<u1>(interface_helper >> 8),
+                                            static_cast<u1>(interface_helper), 1, 0})
+                     .op(_return));
+    const InstanceKlass& kls = vm.define(b.build("test/Linkage", "java/lang/Object"));
+
+    const std::string incompatible = "java/lang/IncompatibleClassChangeError";
+    auto check = [&] {
+        EXPECT_EQ(vm.thrown(kls, "missingClass", "()I"), "java/lang/NoClassDefFoundError");
+        EXPECT_EQ(vm.thrown(kls, "missingField", "()I"), "java/lang/NoSuchFieldError");
+        EXPECT_EQ(vm.thrown(kls, "getInstance", "()I"), incompatible);
+        EXPECT_EQ(vm.thrown(kls, "putInstance", "()V"), incompatible);
+        EXPECT_EQ(vm.thrown(kls, "getStatic", "()I"), incompatible);
+        EXPECT_EQ(vm.thrown(kls, "putStatic", "()V"), incompatible);
+        EXPECT_EQ(vm.thrown(kls, "virtualStatic", "()V"), incompatible);
+        EXPECT_EQ(vm.thrown(kls, "specialStatic", "()V"), incompatible);
+        EXPECT_EQ(vm.thrown(kls, "interfaceStatic", "()V"), incompatible);
+    };
+    for (auto dispatch : dispatches) {
+        vm.runtime.dispatch = dispatch;
+        check();
+    }
+    // compiled code leaves them to the interpreter
+    JitCompiler jit;
+    for (const auto& method : kls.get_methods()) EXPECT_TRUE(jit.compile(method));
+    check();
+}
+
+// Int and float kernels of the cached loop entered in every cache state
+TEST(INTERPRETER_TEST, CACHED_TEST) {
+    Vm vm;
+    ClassBuilder b;
+    // for (i = 0; i < n; i++)
+    //     sum = 2 * (sum + ((a * i) ^ (i << 3)) % 7 + (byte) (i * 37) - (int) (i / 2f));
+    b.add_method(PUBLIC | STATIC, "mix", "(II)I", 4, 4,
+                 Code()
+                     .op(_iconst_0)
+                     .op(_istore_2)
+                     .op(_iconst_0)
+                     .op(_istore_3)
+                     .label("loop")
+                     .op(_iload_3)
+                     .op(_iload_1)
+                     .branch(_if_icmpge, "done")
+                     .op(_iload_2)
+                     .op(_iload_0)
+                     .op(_iload_3)
+                     .op(_imul)
+                     .op(_iload_3)
+                     .op(_iconst_3)
+                     .op(_ishl)
+                     .op(_ixor)
+                     .op(_bipush, {7})
+                     .op(_irem)
+                     .op(_iadd)
+                     .op(_iload_3)
+                     .op(_bipush, {37})
+                     .op(_imul)
+                     .op(_i2b)
+                     .op(_iadd)
+                     .op(_iload_3)
+                     .op(_i2f)
+                     .op(_fconst_2)
+                     .op(_fdiv)
+                     .op(_f2i)
+                     .op(_isub)
+                     .op(_dup)
+                     .op(_iadd)
+                     .op(_istore_2)
+                     .op(_iinc, {3, 1})
+                     .branch(_goto, "loop")
+                     .label("done")
+                     .op(_iload_2)
+                     .op(_ireturn));
+    const InstanceKlass& math = vm.define(b.build("test/Mix", "java/lang/Object"));
+
+    auto mix = [](std::int32_t a, std::int32_t n) {
+        std::uint32_t sum = 0;
+        for (std::int32_t i = 0; i < n; i++) {
+            auto product = static_cast<std::int32_t>(static_cast<std::uint32_t>(a) * i);
+            std::int32_t term = (product ^ (i << 3)) % 7;
+            term += static_cast<std::int8_t>(i * 37);
+            term -= static_cast<std::int32_t>(static_cast<float>(i) / 2.0f);
+            sum = 2 * (sum + static_cast<std::uint32_t>(term));
+        }
+        return static_cast<std::int32_t>(sum);
+    };
+    for (auto dispatch : dispatches) {
+        vm.runtime.dispatch = dispatch;
+        EXPECT_EQ(vm.call(math, "mix", "(II)I", {int_slot(-12345), int_slot(100)}),
+                  mix(-12345, 100));
+        EXPECT_EQ(vm.call(math, "mix", "(II)I", {int_slot(7), int_slot(0)}), 0);
+    }
+}
+
+TEST(INTERPRETER_TEST, DEMO_TEST) {
+    Vm vm;
+    const InstanceKlass& demo =
+        vm.define(ClassFileSource::map(test_class_file_dir + "/Demo.class"));
+    const MethodWrapper* init = demo.get_method("<init>", "()V");
+    ASSERT_NE(init, nullptr);
+
+    auto field = [&](oop::Ref object, const char* name, auto value) {
+        std::memcpy(&value, object.as<oop::InstanceOop>()->bytes + demo.get_field(name)->offset,
+                    sizeof(value));
+        return value;
+    };
+    for (auto dispatch : dispatches) {
+        vm.runtime.dispatch = dispatch;
+        oop::Ref object = vm.heap.allocate_instance(&demo, demo.get_field_layout().object_size());
+        std::vector<Slot> arguments{Slot(reinterpret_cast<u8>(object.get()))};
+        BytecodeEngine::invoke(*init, arguments, vm.runtime);
+
+        EXPECT_EQ(field(object, "s2", u2{}), 0x597D);
+        EXPECT_EQ(field(object, "s4", std::int32_t{-1}), 0);
+        EXPECT_EQ(field(object, "s5", float{}), 5.0f);
+        EXPECT_EQ(field(object, "s6", double{}), 5.0);
+        EXPECT_EQ(field(object, "s7", static_cast<oop::BasicOop*>(nullptr)),
+                  vm.strings.at("123").get());
+    }
+}
+
+namespace {
+    // test/Point, whose static run(I)I goes through every instruction the
+    // interpreter quickens and returns x + 1020 for x
+    const InstanceKlass& define_point(Vm& vm) {
+        ClassBuilder b;
+        u2 x = b.field("test/Point", "x", "I");
+        u2 w = b.field("test/Point", "w", "J");
+        u2 next = b.field("test/Point", "next", "Ltest/Point;");
+        u2 small = b.field("test/Point", "small", "B");
+        u2 count = b.field("test/Point", "count", "I");
+        u2 point = b.cls("test/Point");
+        b.add_field(0, "x", "I");
+        b.add_field(0, "w", "J");
+        b.add_field(0, "next", "Ltest/Point;");
+        b.add_field(0, "small", "B");
+        b.add_field(STATIC, "count", "I");
+        b.add_method(STATIC, "<clinit>", "()V", 1, 0,
+                     Code().op(_bipush, {7}).op2(_putstatic, count).op(_return));
+        b.add_method(PUBLIC, "<init>", "()V", 1, 1,
+                     Code()
+                         .op(_aload_0)
+                         .op2(_invokespecial, b.method("java/lang/Object", "<init>", "()V"))
+                         .op(_return));
+        b.add_method(PUBLIC, "get", "()I", 1, 1,
+                     Code().op(_aload_0).op2(_getfield, x).op(_ireturn));
+        b.add_method(PUBLIC | STATIC, "twice", "(I)I", 2, 1,
+                     Code().op(_iload_0).op(_iload_0).op(_iadd).op(_ireturn));
+        auto thousand = static_cast<u1>(b.integer(1000));
+        auto text = static_cast<u1>(b.string("text"));
+        b.add_method(PUBLIC | STATIC, "run", "(I)I", 4, 2,
+                     Code()
+                         .op2(_new, point)
+                         .op(_dup)
+                         .op2(_invokespecial, b.method("test/Point", "<init>", "()V"))
+                         .op(_astore_1)
+                         .op(_aload_1)
+                         .op(_iload_0)
+                         .op2(_putfield, x)
+                         .op(_aload_1)
+                         .op2(_ldc2_w, b.long_(5))
+                         .op2(_putfield, w)
+                         .op(_aload_1)
+                         .op(_aload_1)
+                         .op2(_putfield, next)
+                         .op(_aload_1)
+                         .op(_iconst_3)
+                         .op2(_putfield, small)
+                         // x + (int) w + small + count
+                         .op(_aload_1)
+                         .op2(_getfield, next)
+                         .op2(_invokevirtual, b.method("test/Point", "get", "()I"))
+                         .op(_aload_1)
+                         .op2(_getfield, w)
+                         .op(_l2i)
+                         .op(_iadd)
+                         .op(_aload_1)
+                         .op2(_getfield, small)
+                         .op(_iadd)
+                         .op2(_getstatic, count)
+                         .op(_iadd)
+                         // + 1000 + twice(1) + (aload_1 instanceof Point)
+                         .op(_ldc, {thousand})
+                         .op(_iadd)
+                         .op(_iconst_1)
+                         .op2(_invokestatic, b.method("test/Point", "twice", "(I)I"))
+                         .op(_iadd)
+                         .op(_aload_1)
+                         .op2(_checkcast, point)
+                         .op2(_instanceof, point)
+                         .op(_iadd)
+                         // + new Point[2].length, with a String constant in between
+                         .op(_ldc, {text})
+                         .op(_pop)
+                         .op(_iconst_2)
+                         .op2(_anewarray, point)
+                         .op(_arraylength)
+                         .op(_iadd)
+                         .op(_ireturn));
+        return vm.define(b.build("test/Point", "java/lang/Object"));
+    }
+
+    // the opcodes of `code`, which has no switches
+    std::vector<u1> opcodes(std::span<const u1> code) {
+        std::vector<u1> result;
+        for (std::size_t pc = 0; pc < code.size(); pc += BytecodeEngine::opcode_length(code[pc])) {
+            result.push_back(code[pc]);
+        }
+        return result;
+    }
+}; // namespace
+
+TEST(INTERPRETER_TEST, QUICKENING_TEST) {
+    for (auto dispatch : dispatches) {
+        Vm vm;
+        vm.runtime.dispatch = dispatch;
+        const InstanceKlass& point = define_point(vm);
+        const rt_jvm_data::CodeInfo& run = *point.get_method("run", "(I)I")->code_info;
+        std::vector<u1> original = opcodes(run.code);
+
+        EXPECT_EQ(vm.call(point, "run", "(I)I", {int_slot(3)}), 3 + 1020);
+        EXPECT_EQ(opcodes(run.code), original);
+        std::vector<u1> quick = opcodes(run.quick_code);
+        std::vector<u1> expected = original;
+        // new, dup and invokespecial make a superinstruction once quickened
+        const std::pair<u1, u1> rewrites[] = {
+            {_new, _new_quick_dup_invokenonvirtual_quick},
+            {_invokespecial, _invokenonvirtual_quick},
+            {_putfield, _putfield_quick},
+            {_putfield, _putfield2_quick},
+            {_putfield, _aputfield_quick},
+            {_putfield, _putfield_quick_w},
+            {_getfield, _agetfield_quick},
+            {_invokevirtual, _invokevirtual_quick},
+            {_getfield, _getfield2_quick},
+            {_getfield, _getfield_quick_w},
+            {_getstatic, _getstatic_quick},
+            {_ldc, _ldc_quick},
+            {_invokestatic, _invokestatic_quick},
+            {_checkcast, _checkcast_quick},
+            {_instanceof, _instanceof_quick},
+            {_ldc, _aldc_quick},
+            {_anewarray, _anewarray_quick},
+        };
+        auto at = expected.begin();
+        for (auto [from, to] : rewrites) {
+            at = std::find(at, expected.end(), from);
+            ASSERT_NE(at, expected.end()) << BytecodeEngine::opcode_name(from);
+            *at = to;
+        }
+        EXPECT_EQ(quick, expected);
+        EXPECT_EQ(opcodes(point.get_method("get", "()I")->code_info->quick_code),
+                  (std::vector<u1>{_aload_0, _getfield_quick, _ireturn}));
+
+        // the quickened code gives the same answers
+        EXPECT_EQ(vm.call(point, "run", "(I)I", {int_slot(-40)}), -40 + 1020);
+        EXPECT_EQ(opcodes(run.quick_code), quick);
+    }
+}
+
+TEST(INTERPRETER_TEST, CONCURRENT_QUICKENING_TEST) {
+    Vm vm;
+    const InstanceKlass& point = define_point(vm);
+    const MethodWrapper& run = *point.get_method("run", "(I)I");
+    std::atomic<int> wrong{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < 200; i++) {
+                std::vector<Slot> arguments{int_slot(t * 1000 + i)};
+                Slot result = BytecodeEngine::invoke(run, arguments, vm.runtime);
+                if (static_cast<std::int32_t>(result.raw) != t * 1000 + i + 1020) wrong++;
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    EXPECT_EQ(wrong.load(), 0);
+}
+
+// A version 49 class is not verified, yet its code may hold neither the
+// interpreter's private forms nor a truncated instruction
+TEST(INTERPRETER_TEST, RESERVED_OPCODE_TEST) {
+    const std::vector<std::pair<std::string, Code>> codes = {
+        {"quick", Code().op(_aload_0).op(_getfield_quick, {0, 16}).op(_ireturn)},
+        {"leave", Code().op(_aload_0).op(_leave)},
+        {"breakpoint", Code().op(0xca).op(_iconst_0).op(_ireturn)},
+        {"truncated", Code().op(_aload_0).op(_getfield, {0})},
+        {"wide", Code().op(_wide, {_iadd, 0, 1}).op(_iconst_0).op(_ireturn)},
+    };
+    for (const auto& [name, code] : codes) {
+        ClassBuilder builder;
+        builder.add_method(PUBLIC | STATIC, "run", "(Ljava/lang/Object;)I", 1, 1, code);
+        EXPECT_THROW(InstanceKlass{builder.build("test/Reserved", "")}, ClassFormatError)
+            << name;
+    }
+}
+
+// Superinstructions written when the class is linked and when quickening
+// completes a sequence, entered at their start and in the middle
+TEST(INTERPRETER_TEST, SUPERINSTRUCTION_TEST) {
+    for (auto dispatch : dispatches) {
+        Vm vm;
+        vm.runtime.dispatch = dispatch;
+        ClassBuilder b;
+        b.add_method(PUBLIC, "<init>", "()V", 1, 1,
+                     Code()
+                         .op(_aload_0)
+                         .op2(_invokespecial, b.method("java/lang/Object", "<init>", "()V"))
+                         .op(_return));
+        b.add_method(PUBLIC, "self", "()Ltest/Fuse;", 1, 1, Code().op(_aload_0).op(_areturn));
+        // how often `object` is seen in n rounds, the first entering after astore
+        b.add_method(PUBLIC | STATIC, "count", "(Ljava/lang/Object;I)I", 1, 4,
+                     Code()
+                         .op(_iconst_0)
+                         .op(_istore_3)
+                         .op(_aload, {0})
+                         .op(_astore, {2})
+                         .branch(_goto, "middle")
+                         .label("top")
+                         .op(_aload, {0})
+                         .op(_astore, {2})
+                         .label("middle")
+                         .op(_aload, {2})
+                         .branch(_ifnull, "done")
+                         .op(_iinc, {3, 1})
+                         .op(_iinc, {1, 0xff})
+                         .op(_iload_1)
+                         .branch(_ifgt, "top")
+                         .label("done")
+                         .op(_iload_3)
+                         .op(_ireturn));
+        // 1 when fuse.self() is fuse, 0 when not, -1 on the NullPointerException of a null fuse
+        b.add_method(PUBLIC | STATIC, "call", "(Ltest/Fuse;)I", 2, 2,
+                     Code()
+                         .label("start")
+                         .op(_aload_0)
+                         .op2(_invokevirtual, b.method("test/Fuse", "self", "()Ltest/Fuse;"))
+                         .op(_astore, {1})
+                         .op(_aload, {1})
+                         .op(_aload_0)
+                         .branch(_if_acmpne, "other")
+                         .op(_iconst_1)
+                         .op(_ireturn)
+                         .label("end")
+                         .op(_pop)
+                         .op(_iconst_m1)
+                         .op(_ireturn)
+                         .label("other")
+                         .op(_iconst_0)
+                         .op(_ireturn)
+                         .handler("start", "end", "end",
+                                  b.cls("java/lang/NullPointerException")));
+        const InstanceKlass& kls = vm.define(b.build("test/Fuse", "java/lang/Object"));
+
+        // linking fused the astore and aload in the loop, not the ones before the goto
+        const auto& count = *kls.get_method("count", "(Ljava/lang/Object;I)I")->code_info;
+        std::vector<u1> fused = opcodes(count.code);
+        *std::find(std::find(fused.begin(), fused.end(), _goto), fused.end(), _astore) =
+            _astore_aload;
+        EXPECT_EQ(opcodes(count.quick_code), fused);
+        EXPECT_EQ(vm.call(kls, "count", "(Ljava/lang/Object;I)I", {Slot(), int_slot(5)}), 0);
+
+        oop::Ref fuse = vm.heap.allocate_instance(&kls, kls.get_field_layout().object_size());
+        Slot object(reinterpret_cast<u8>(fuse.get()));
+        EXPECT_EQ(vm.call(kls, "count", "(Ljava/lang/Object;I)I", {object, int_slot(5)}), 5);
+
+        // linking fused the astore and aload; the invokevirtual, quickened on
+        // the first call, starts a longer sequence over them
+        const auto& call = *kls.get_method("call", "(Ltest/Fuse;)I")->code_info;
+        std::vector<u1> linked = opcodes(call.code);
+        linked[2] = _astore_aload;
+        EXPECT_EQ(opcodes(call.quick_code), linked);
+        EXPECT_EQ(vm.call(kls, "call", "(Ltest/Fuse;)I", {object}), 1);
+        EXPECT_EQ(opcodes(call.quick_code)[1], _invokevirtual_quick_astore_aload);
+        EXPECT_EQ(vm.call(kls, "call", "(Ltest/Fuse;)I", {object}), 1);
+        // the invoke throws before the rest of the sequence
+        EXPECT_EQ(vm.call(kls, "call", "(Ltest/Fuse;)I", {Slot()}), -1);
+    }
+}
+
+TEST(JIT_TEST, COMPILED_TEST) {
+    Vm vm;
+    ClassBuilder b;
+    b.add_field(0, "value", "I");
+    b.add_method(PUBLIC, "<init>", "()V", 1, 1,
+                 Code().op(_aload_0).op2(_invokespecial, b.method("java/lang/Object", "<init>",
+                                                                  "()V")).op(_return));
+    b.add_method(PUBLIC, "get", "()I", 1, 1,
+                 Code().op(_aload_0).op2(_getfield, b.field("test/Jit", "value", "I")).op(
+                     _ireturn));
+    u2 fib = b.method("test/Jit", "fib", "(I)I");
+    b.add_method(PUBLIC | STATIC, "fib", "(I)I", 3, 1,
+                 Code()
+                     .op(_iload_0)
+                     .op(_iconst_2)
+                     .branch(_if_icmpge, "recurse")
+                     .op(_iload_0)
+                     .op(_ireturn)
+                     .label("recurse")
+                     .op(_iload_0)
+                     .op(_iconst_1)
+                     .op(_isub)
+                     .op2(_invokestatic, fib)
+                     .op(_iload_0)
+                     .op(_iconst_2)
+                     .op(_isub)
+                     .op2(_invokestatic, fib)
+                     .op(_iadd)
+                     .op(_ireturn));
+    // the squares below n stored in an int array, then summed as a long
+    b.add_method(PUBLIC | STATIC, "squares", "(I)J", 4, 5,
+                 Code()
+                     .op(_iload_0)
+                     .op(_newarray, {10})
+                     .op(_astore_1)
+                     .op(_iconst_0)
+                     .op(_istore_2)
+                     .label("fill")
+                     .op(_iload_2)
+                     .op(_iload_0)
+                     .branch(_if_icmpge, "filled")
+                     .op(_aload_1)
+                     .op(_iload_2)
+                     .op(_iload_2)
+                     .op(_iload_2)
+                     .op(_imul)
+                     .op(_iastore)
+                     .op(_iinc, {2, 1})
+                     .branch(_goto, "fill")
+                     .label("filled")
+                     .op(_lconst_0)
+                     .op(_lstore, {3})
+                     .op(_iconst_0)
+                     .op(_istore_2)
+                     .label("add")
+                     .op(_iload_2)
+                     .op(_aload_1)
+                     .op(_arraylength)
+                     .branch(_if_icmpge, "done")
+                     .op(_lload, {3})
+                     .op(_aload_1)
+                     .op(_iload_2)
+                     .op(_iaload)
+                     .op(_i2l)
+                     .op(_ladd)
+                     .op(_lstore, {3})
+                     .op(_iinc, {2, 1})
+                     .branch(_goto, "add")
+                     .label("done")
+                     .op(_lload, {3})
+                     .op(_lreturn));
+    // a / b + a % b + (a >> 3) + (a >>> 28) + (b << 33)
+    b.add_method(PUBLIC | STATIC, "ints", "(II)I", 3, 2,
+                 Code()
+                     .op(_iload_0)
+                     .op(_iload_1)
+                     .op(_idiv)
+                     .op(_iload_0)
+                     .op(_iload_1)
+                     .op(_irem)
+                     .op(_iadd)
+                     .op(_iload_0)
+                     .op(_iconst_3)
+                     .op(_ishr)
+                     .op(_iadd)
+                     .op(_iload_0)
+                     .op(_bipush, {28})
+                     .op(_iushr)
+                     .op(_iadd)
+                     .op(_iload_1)
+                     .op(_bipush, {33})
+                     .op(_ishl)
+                     .op(_iadd)
+                     .op(_ireturn));
+    // (int) (a / i + 1.5), and f2i of NaN added
+    b.add_method(PUBLIC | STATIC, "doubles", "(DI)I", 6, 3,
+                 Code()
+                     .op(_dload_0)
+                     .op(_iload_2)
+                     .op(_i2d)
+                     .op(_ddiv)
+                     .op(_dconst_1)
+                     .op(_dadd)
+                     .op(_fconst_1)
+                     .op(_f2d)
+                     .op(_fconst_2)
+                     .op(_f2d)
+                     .op(_ddiv)
+                     .op(_dadd)
+                     .op(_d2i)
+                     .op(_fconst_0)
+                     .op(_fconst_0)
+                     .op(_fdiv)
+                     .op(_f2i)
+                     .op(_iadd)
+                     .op(_ireturn));
+    // 10, 20 or 30 for 1 to 3, else 7 for 100, else -1
+    b.add_method(PUBLIC | STATIC, "choose", "(I)I", 1, 1,
+                 Code()
+                     .op(_iload_0)
+                     .tableswitch("lookup", 1, {"one", "two", "three"})
+                     .label("one")
+                     .op(_bipush, {10})
+                     .op(_ireturn)
+                     .label("two")
+                     .op(_bipush, {20})
+                     .op(_ireturn)
+                     .label("three")
+                     .op(_bipush, {30})
+                     .op(_ireturn)
+                     .label("lookup")
+                     .op(_iload_0)
+                     .lookupswitch("other", {{100, "hundred"}})
+                     .label("hundred")
+                     .op(_bipush, {7})
+                     .op(_ireturn)
+                     .label("other")
+                     .op(_iconst_m1)
+                     .op(_ireturn));
+    // new Jit with value n, then value.get() + (value instanceof Jit)
+    b.add_method(PUBLIC | STATIC, "make", "(I)I", 3, 2,
+                 Code()
+                     .op2(_new, b.cls("test/Jit"))
+                     .op(_dup)
+                     .op2(_invokespecial, b.method("test/Jit", "<init>", "()V"))
+                     .op(_astore_1)
+                     .op(_aload_1)
+                     .op(_iload_0)
+                     .op2(_putfield, b.field("test/Jit", "value", "I"))
+                     .op(_aload_1)
+                     .op2(_checkcast, b.cls("test/Jit"))
+                     .op2(_invokevirtual, b.method("test/Jit", "get", "()I"))
+                     .op(_aload_1)
+                     .op2(_instanceof, b.cls("test/Jit"))
+                     .op(_iadd)
+                     .op(_ireturn));
+    // n stored in a boolean array and read back
+    b.add_method(PUBLIC | STATIC, "flag", "(I)I", 3, 2,
+                 Code()
+                     .op(_iconst_1)
+                     .op(_newarray, {4})
+                     .op(_astore_1)
+                     .op(_aload_1)
+                     .op(_iconst_0)
+                     .op(_iload_0)
+                     .op(_bastore)
+                     .op(_aload_1)
+                     .op(_iconst_0)
+                     .op(_baload)
+                     .op(_ireturn));
+    // left to the interpreter, which holds the monitor
+    b.add_method(PUBLIC | raw_jvm_data::ACC_SYNCHRONIZED, "locked", "()I", 1, 1,
+                 Code().op(_iconst_1).op(_ireturn));
+    const InstanceKlass& kls = vm.define(b.build("test/Jit", "java/lang/Object"));
+
+    struct Call {
+        std::string name, descriptor;
+        std::vector<Slot> arguments;
+        std::int32_t expected;
+    };
+    const std::int32_t min = std::numeric_limits<std::int32_t>::min();
+    std::vector<Call> calls = {
+        {"fib", "(I)I", {int_slot(20)}, 6765},
+        {"squares", "(I)J", {int_slot(1000)}, 332833500},
+        {"ints", "(II)I", {int_slot(-1000), int_slot(7)}, -142 - 6 - 125 + 15 + 14},
+        // MIN_VALUE / -1 is MIN_VALUE, the remainder 0; the sum wraps around
+        {"ints", "(II)I", {int_slot(min), int_slot(-1)}, 0x70000006},
+        {"doubles", "(DI)I", {Slot(std::bit_cast<u8>(9.0)), Slot(), int_slot(2)}, 6},
+        {"choose", "(I)I", {int_slot(2)}, 20},
+        {"choose", "(I)I", {int_slot(100)}, 7},
+        {"choose", "(I)I", {int_slot(5)}, -1},
+        {"make", "(I)I", {int_slot(41)}, 42},
+        {"flag", "(I)I", {int_slot(6)}, 0},
+        {"flag", "(I)I", {int_slot(7)}, 1},
+    };
+    // interpreted first, which resolves what the compiled code uses
+    for (const auto& call : calls) {
+        EXPECT_EQ(vm.call(kls, call.name, call.descriptor, call.arguments), call.expected)
+            << call.name;
+    }
+    {
+        JitCompiler jit;
+        for (const auto& method : kls.get_methods()) {
+            bool synchronized = method.mptr->access_flags & raw_jvm_data::ACC_SYNCHRONIZED;
+            EXPECT_EQ(jit.compile(method), !synchronized) << method.name.view();
+            EXPECT_EQ(method.compiled.load() != nullptr, !synchronized) << method.name.view();
+        }
+        for (const auto& call : calls) {
+            EXPECT_EQ(vm.call(kls, call.name, call.descriptor, call.arguments), call.expected)
+                << call.name;
+        }
+    }
+    // the compiler took its code along
+    for (const auto& method : kls.get_methods()) EXPECT_EQ(method.compiled.load(), nullptr);
+    EXPECT_EQ(vm.call(kls, "fib", "(I)I", {int_slot(10)}), 55);
+}
+
+TEST(JIT_TEST, DEOPTIMIZATION_TEST) {
+    Vm vm;
+    ClassBuilder lazy;
+    lazy.add_field(STATIC, "value", "I");
+    lazy.add_method(STATIC, "<clinit>", "()V", 1, 0,
+                    Code().op(_iconst_5).op2(_putstatic, lazy.field("test/Lazy", "value", "I"))
+                        .op(_return));
+    vm.define(lazy.build("test/Lazy", "java/lang/Object"));
+
+    ClassBuilder b;
+    u2 div = b.method("test/Deopt", "div", "(II)I");
+    u2 arithmetic = b.cls("java/lang/ArithmeticException");
+    b.add_method(PUBLIC | STATIC, "div", "(II)I", 2, 2,
+                 Code().op(_iload_0).op(_iload_1).op(_idiv).op(_ireturn));
+    // a / b, -1 when that throws
+    b.add_method(PUBLIC | STATIC, "safe", "(II)I", 2, 2,
+                 Code()
+                     .label("start")
+                     .op(_iload_0)
+                     .op(_iload_1)
+                     .op(_idiv)
+                     .op(_ireturn)
+                     .label("end")
+                     .op(_pop)
+                     .op(_iconst_m1)
+                     .op(_ireturn)
+                     .handler("start", "end", "end", arithmetic));
+    // div(a, 0), -2 when the callee throws
+    b.add_method(PUBLIC | STATIC, "guarded", "(I)I", 2, 1,
+                 Code()
+                     .label("start")
+                     .op(_iload_0)
+                     .op(_iconst_0)
+                     .op2(_invokestatic, div)
+                     .op(_ireturn)
+                     .label("end")
+                     .op(_pop)
+                     .op(_bipush, {0xfe})
+                     .op(_ireturn)
+                     .handler("start", "end", "end", arithmetic));
+    b.add_method(PUBLIC | STATIC, "unguarded", "(I)I", 2, 1,
+                 Code().op(_iload_0).op(_iconst_0).op2(_invokestatic, div).op(_ireturn));
+    b.add_method(PUBLIC | STATIC, "raise", "()I", 2, 0,
+                 Code()
+                     .op2(_new, b.cls("java/lang/IllegalStateException"))
+                     .op(_dup)
+                     .op2(_invokespecial,
+                          b.method("java/lang/IllegalStateException", "<init>", "()V"))
+                     .op(_athrow));
+    b.add_method(PUBLIC | STATIC, "lazy", "()I", 1, 0,
+                 Code().op2(_getstatic, b.field("test/Lazy", "value", "I")).op(_ireturn));
+    const InstanceKlass& kls = vm.define(b.build("test/Deopt", "java/lang/Object"));
+
+    JitCompiler jit;
+    // compiled before anything ran: the getstatic leaves initializing
+    // test/Lazy to the interpreter
+    EXPECT_TRUE(jit.compile(*kls.get_method("lazy", "()I")));
+    EXPECT_EQ(vm.call(kls, "lazy", "()I"), 5);
+    EXPECT_TRUE(jit.compile(*kls.get_method("lazy", "()I")));
+    EXPECT_EQ(vm.call(kls, "lazy", "()I"), 5);
+
+    EXPECT_EQ(vm.call(kls, "guarded", "(I)I", {int_slot(1)}), -2);
+    for (const auto& method : kls.get_methods()) EXPECT_TRUE(jit.compile(method));
+    EXPECT_EQ(vm.call(kls, "div", "(II)I", {int_slot(7), int_slot(2)}), 3);
+    EXPECT_EQ(vm.thrown(kls, "div", "(II)I", {int_slot(7), int_slot(0)}),
+              "java/lang/ArithmeticException");
+    EXPECT_EQ(vm.call(kls, "safe", "(II)I", {int_slot(7), int_slot(0)}), -1);
+    EXPECT_EQ(vm.call(kls, "safe", "(II)I", {int_slot(8), int_slot(2)}), 4);
+    // the exception leaves the compiled callee and is caught by the caller
+    EXPECT_EQ(vm.call(kls, "guarded", "(I)I", {int_slot(1)}), -2);
+    EXPECT_EQ(vm.thrown(kls, "unguarded", "(I)I", {int_slot(1)}),
+              "java/lang/ArithmeticException");
+    EXPECT_EQ(vm.thrown(kls, "raise", "()I"), "java/lang/IllegalStateException");
+}
+
+TEST(JIT_TEST, UNLOADING_TEST) {
+    Vm vm;
+    ClassBuilder b;
+    b.add_method(PUBLIC | STATIC, "answer", "()I", 1, 0, Code().op(_bipush, {42}).op(_ireturn));
+
+    // the loaders outlive the dictionary holding their klasses
+    rt_jvm_data::ClassLoaderDataGraph graph;
+    rt_jvm_data::SystemDictionary dictionary;
+    oop::BasicOop mirror{};
+    auto owned = std::make_unique<InstanceKlass>(b.build("test/Unloaded", "java/lang/Object"),
+                                                 graph.add(oop::Ref(&mirror)));
+    owned->link(vm.klass("java/lang/Object"), {},
+                [](std::string_view, std::string_view) { return true; });
+    const InstanceKlass* kls = dictionary.publish(std::move(owned));
+    const MethodWrapper* answer = kls->get_method("answer", "()I");
+
+    // the compiler, added later, drops the method while its class is still there
+    bool uninstalled = false;
+    graph.add_unloading_observer([&](std::span<const InstanceKlass* const> klasses) {
+        EXPECT_EQ(klasses.size(), 1u);
+        uninstalled = answer->compiled.load(std::memory_order_acquire) == nullptr;
+    });
+
+    auto jit = std::make_unique<JitCompiler>(graph);
+    ASSERT_TRUE(jit->compile(*answer));
+    EXPECT_EQ(vm.call(*kls, "answer", "()I"), 42);
+    EXPECT_EQ(graph.do_unloading([](oop::Ref) { return false; }, dictionary), 1u);
+    EXPECT_TRUE(uninstalled);
+    // and leaves the freed method alone when it goes away
+    jit.reset();
+}
+
+TEST(JIT_TEST, BROKER_UNLOADING_TEST) {
+    Vm vm;
+    ClassBuilder b;
+    constexpr int count = 64;
+    for (int i = 0; i < count; i++) {
+        b.add_method(PUBLIC | STATIC, "m" + std::to_string(i), "()I", 1, 0,
+                     Code().op(_bipush, {static_cast<u1>(i)}).op(_ireturn));
+    }
+
+    rt_jvm_data::ClassLoaderDataGraph graph;
+    rt_jvm_data::SystemDictionary dictionary;
+    oop::BasicOop mirror{};
+    auto owned = std::make_unique<InstanceKlass>(b.build("test/Queued", "java/lang/Object"),
+                                                 graph.add(oop::Ref(&mirror)));
+    owned->link(vm.klass("java/lang/Object"), {},
+                [](std::string_view, std::string_view) { return true; });
+    const InstanceKlass* kls = dictionary.publish(std::move(owned));
+
+    // whatever was queued, compiling or compiled, no code is left behind
+    std::size_t installed = 0;
+    graph.add_unloading_observer([&](std::span<const InstanceKlass* const>) {
+        for (const auto& method : kls->get_methods()) {
+            if (method.compiled.load(std::memory_order_acquire) != nullptr) installed++;
+        }
+    });
+
+    CompilePolicy policy;
+    policy.baseline = {1, 1000};
+    policy.threads = 2;
+    CompileBroker broker(policy, graph);
+    vm.runtime.compiler = &broker;
+    for (int i = 0; i < count; i++) {
+        EXPECT_EQ(vm.call(*kls, "m" + std::to_string(i), "()I"), i);
+    }
+    EXPECT_EQ(graph.do_unloading([](oop::Ref) { return false; }, dictionary), 1u);
+    EXPECT_EQ(installed, 0u);
+    broker.wait_idle();
+}
+
+TEST(JIT_TEST, TIERED_TEST) {
+    Vm vm;
+    ClassBuilder b;
+    b.add_method(PUBLIC | STATIC, "twice", "(I)I", 2, 1,
+                 Code().op(_iload_0).op(_iconst_2).op(_imul).op(_ireturn));
+    // the ints below n added up
+    b.add_method(PUBLIC | STATIC, "sum", "(I)I", 2, 3,
+                 Code()
+                     .op(_iconst_0)
+                     .op(_istore_1)
+                     .op(_iconst_0)
+                     .op(_istore_2)
+                     .label("loop")
+                     .op(_iload_2)
+                     .op(_iload_0)
+                     .branch(_if_icmpge, "done")
+                     .op(_iload_1)
+                     .op(_iload_2)
+                     .op(_iadd)
+                     .op(_istore_1)
+                     .op(_iinc, {2, 1})
+                     .branch(_goto, "loop")
+                     .label("done")
+                     .op(_iload_1)
+                     .op(_ireturn));
+    const InstanceKlass& kls = vm.define(b.build("test/Tiered", "java/lang/Object"));
+    const MethodWrapper& twice = *kls.get_method("twice", "(I)I");
+    const MethodWrapper& sum = *kls.get_method("sum", "(I)I");
+
+    CompilePolicy policy;
+    policy.baseline = {5, 200};
+    policy.optimized = {20, 2000};
+    {
+        CompileBroker broker(policy);
+        vm.runtime.compiler = &broker;
+        // counts look at the tier at the thresholds and powers of two only
+        EXPECT_TRUE(broker.due(5));
+        EXPECT_TRUE(broker.due(2000));
+        EXPECT_TRUE(broker.due(64));
+        EXPECT_FALSE(broker.due(6));
+        EXPECT_FALSE(broker.due(1999));
+
+        // cold: counted, but still interpreted
+        for (int i = 0; i < 4; i++) EXPECT_EQ(vm.call(kls, "twice", "(I)I", {int_slot(i)}), 2 * i);
+        broker.wait_idle();
+        EXPECT_EQ(twice.invocations.load(), 4u);
+        EXPECT_EQ(twice.tier.load(), rt_jvm_data::Tier::Interpreted);
+        EXPECT_EQ(twice.compiled.load(), nullptr);
+
+        EXPECT_EQ(vm.call(kls, "twice", "(I)I", {int_slot(4)}), 8);
+        broker.wait_idle();
+        EXPECT_EQ(twice.tier.load(), rt_jvm_data::Tier::Baseline);
+        auto baseline = twice.compiled.load();
+        EXPECT_NE(baseline, nullptr);
+
+        // baseline code counts on to the optimized threshold
+        for (int i = 5; i < 20; i++) EXPECT_EQ(vm.call(kls, "twice", "(I)I", {int_slot(i)}), 2 * i);
+        broker.wait_idle();
+        EXPECT_EQ(twice.invocations.load(), 20u);
+        EXPECT_EQ(twice.tier.load(), rt_jvm_data::Tier::Optimized);
+        EXPECT_NE(twice.compiled.load(), nullptr);
+        EXPECT_NE(twice.compiled.load(), baseline);
+        EXPECT_EQ(vm.call(kls, "twice", "(I)I", {int_slot(-21)}), -42);
+
+        // a single call that loops long enough queues the method; the call
+        // itself finishes interpreted
+        EXPECT_EQ(vm.call(kls, "sum", "(I)I", {int_slot(1000)}), 499500);
+        EXPECT_EQ(sum.backedges.load(), 1000u);
+        broker.wait_idle();
+        EXPECT_EQ(sum.tier.load(), rt_jvm_data::Tier::Baseline);
+        EXPECT_EQ(vm.call(kls, "sum", "(I)I", {int_slot(1000)}), 499500);
+        broker.wait_idle();
+        EXPECT_EQ(sum.backedges.load(), 2000u);
+        EXPECT_EQ(sum.tier.load(), rt_jvm_data::Tier::Optimized);
+        EXPECT_EQ(vm.call(kls, "sum", "(I)I", {int_slot(100)}), 4950);
+        EXPECT_EQ(sum.backedges.load(), 2000u);
+    }
+    // the broker took its code along
+    EXPECT_EQ(twice.compiled.load(), nullptr);
+    EXPECT_EQ(sum.compiled.load(), nullptr);
+    EXPECT_EQ(vm.call(kls, "sum", "(I)I", {int_slot(10)}), 45);
+}
+
+TEST(JIT_TEST, CONCURRENT_TIERED_TEST) {
+    Vm vm;
+    ClassBuilder b;
+    u2 fib = b.method("test/Busy", "fib", "(I)I");
+    b.add_method(PUBLIC | STATIC, "fib", "(I)I", 3, 1,
+                 Code()
+                     .op(_iload_0)
+                     .op(_iconst_2)
+                     .branch(_if_icmpge, "recurse")
+                     .op(_iload_0)
+                     .op(_ireturn)
+                     .label("recurse")
+                     .op(_iload_0)
+                     .op(_iconst_1)
+                     .op(_isub)
+                     .op2(_invokestatic, fib)
+                     .op(_iload_0)
+                     .op(_iconst_2)
+                     .op(_isub)
+                     .op2(_invokestatic, fib)
+                     .op(_iadd)
+                     .op(_ireturn));
+    const InstanceKlass& kls = vm.define(b.build("test/Busy", "java/lang/Object"));
+    const MethodWrapper& method = *kls.get_method("fib", "(I)I");
+
+    CompilePolicy policy;
+    policy.baseline = {50, 1000};
+    policy.optimized = {5000, 100000};
+    policy.threads = 2;
+    CompileBroker broker(policy);
+    vm.runtime.compiler = &broker;
+
+    // the threads go on calling while the method is compiled under them
+    std::atomic<int> wrong{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 100; i++) {
+                Slot argument = int_slot(12);
+                Slot result = BytecodeEngine::invoke(method, {&argument, 1}, vm.runtime);
+                if (result.raw != 144) wrong++;
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    broker.wait_idle();
+    EXPECT_EQ(wrong.load(), 0);
+    EXPECT_EQ(method.tier.load(), rt_jvm_data::Tier::Optimized);
+    EXPECT_NE(method.compiled.load(), nullptr);
+    EXPECT_EQ(vm.call(kls, "fib", "(I)I", {int_slot(20)}), 6765);
+}
@@ -0,0 +1,116 @@
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "../../include/classFile/jar_file.hpp"
+#include "../../include/runtime/class_loader.hpp"
+
+static const std::string test_class_file_dir = "/workspace/JavaVirtualMachine/resource";
+
+static const std::string test_jar_file = "/workspace/JavaVirtualMachine/resource/classes.jar";
+
+TEST(JAR_FILE_TEST, JAR_MEMBER_MATCHES_CLASS_FILE_TEST) {
+    zip::JarFile jar(test_jar_file);
+    ASSERT_NE(jar.find("resource/Demo.class"), nullptr);
+
+    auto loose = ClassFileSource::map(test_class_file_dir + "/Demo.class");
+    auto member = jar.open("resource/Demo.class");
+    ASSERT_NE(member, nullptr);
+    EXPECT_EQ(jar.find("resource/Demo.class")->method, zip::JarFile::METHOD_DEFLATED);
+    ASSERT_EQ(member->size(), loose->size());
+    EXPECT_TRUE(std::equal(member->bytes().begin(), member->bytes().end(), loose->bytes().begin()));
+
+    // stored members are served straight out of the archive mapping
+    auto stored = jar.open("com/example/demo/utils/Pair.class");
+    ASSERT_NE(stored, nullptr);
+    EXPECT_EQ(stored->get_storage(), ClassFileSource::Storage::Borrowed);
+    rt_jvm_data::InstanceKlass pair(stored);
+    EXPECT_EQ(pair.get_klass_name(), "com/example/demo/utils/Pair");
+
+    EXPECT_EQ(jar.open("no/such/Member.class"), nullptr);
+}
+
+TEST(JAR_FILE_TEST, JAR_LARGE_DEFLATED_MEMBER_TEST) {
+    zip::JarFile jar(test_jar_file);
+    auto notice = jar.open("META-INF/NOTICE.txt");
+    ASSERT_NE(notice, nullptr);
+    EXPECT_EQ(notice->size(), jar.find("META-INF/NOTICE.txt")->uncompressed_size);
+    std::string text(reinterpret_cast<const char*>(notice->data()), notice->size());
+    EXPECT_TRUE(text.starts_with("line 0: the quick brown fox"));
+    EXPECT_TRUE(text.ends_with("line 3999: the quick brown fox jumps over the lazy dog 96\n"));
+}
+
+TEST(JAR_FILE_TEST, JAR_CORRUPT_MEMBER_TEST) {
+    zip::JarFile jar(test_jar_file);
+    const auto* entry = jar.find("resource/Demo.class");
+    ASSERT_NE(entry, nullptr);
+
+    std::vector<raw_jvm_type::u1> garbage(entry->compressed_size, 0xFF);
+    std::vector<raw_jvm_type::u1> out(entry->uncompressed_size);
+    EXPECT_THROW(zip::inflate(garbage, out), zip::ZipFormatError);
+    EXPECT_THROW(zip::JarFile("/workspace/JavaVirtualMachine/resource/Demo.java"),
+                 zip::ZipFormatError);
+}
+
+// a copy of the test jar with the bytes at `offset` overwritten
+static std::filesystem::path patched_jar(const std::string& name, std::size_t offset,
+                                         const std::vector<raw_jvm_type::u1>& patch) {
+    std::ifstream in(test_jar_file, std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::copy(patch.begin(), patch.end(), bytes.begin() + offset);
+    auto path = std::filesystem::temp_directory_path() / name;
+    std::ofstream(path, std::ios::binary).write(bytes.data(), bytes.size());
+    return path;
+}
+
+TEST(JAR_FILE_TEST, JAR_TAMPERED_MEMBER_TEST) {
+    zip::JarFile jar(test_jar_file);
+    const auto* stored = jar.find("com/example/demo/utils/Pair.class");
+    ASSERT_NE(stored, nullptr);
+    ASSERT_EQ(stored->method, zip::JarFile::METHOD_STORED);
+    auto data = jar.open("com/example/demo/utils/Pair.class")->bytes();
+    auto flipped = static_cast<raw_jvm_type::u1>(data[data.size() / 2] ^ 0xFF);
+
+    // the offset of the member data inside the archive
+    std::ifstream in(test_jar_file, std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    auto at = std::search(bytes.begin(), bytes.end(), data.begin(), data.end(),
+                          [](char a, raw_jvm_type::u1 b) {
+                              return static_cast<raw_jvm_type::u1>(a) == b;
+                          });
+    ASSERT_NE(at, bytes.end());
+
+    auto corrupt = patched_jar("tampered_stored.jar", (at - bytes.begin()) + data.size() / 2,
+                               {flipped});
+    EXPECT_THROW(zip::JarFile(corrupt).open("com/example/demo/utils/Pair.class"),
+                 zip::ZipFormatError);
+
+    // a central directory claiming a huge deflated member
+    const auto* deflated = jar.find("resource/Demo.class");
+    ASSERT_NE(deflated, nullptr);
+    std::string name = "resource/Demo.class";
+    auto central = std::search(bytes.rbegin(), bytes.rend(), name.rbegin(), name.rend()).base() -
+                   name.size();
+    auto oversized = patched_jar("tampered_size.jar", (central - bytes.begin()) - 46 + 24,
+                                 {0xFF, 0xFF, 0xFF, 0x7F});
+    EXPECT_THROW(zip::JarFile(oversized).open("resource/Demo.class"), zip::ZipFormatError);
+
+    std::filesystem::remove(corrupt);
+    std::filesystem::remove(oversized);
+}
+
+TEST(JAR_FILE_TEST, JAR_BATCH_LOAD_TEST) {
+    auto cp = ClassPath::parse(test_jar_file);
+    ASSERT_EQ(cp.get_entries().size(), 1u);
+
+    rt_jvm_data::SystemDictionary dictionary;
+    rt_jvm_data::BatchClassLoader loader(dictionary, 4);
+    auto result = loader.load_classpath(cp);
+
+    EXPECT_TRUE(result.failures.empty());
+    EXPECT_EQ(result.loaded, 18u);
+    EXPECT_NE(dictionary.find("resource/Demo"), nullptr);
+    EXPECT_NE(dictionary.find("com/example/fakephoenix/controller/SoftwareController"), nullptr);
+}
@@ -0,0 +1,149 @@
+#include <memory>
+#include <memory_resource>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "../../include/runtime/class_loader_data.hpp"
+#include "../../include/runtime/klass.hpp"
+#include "../../include/runtime/metaspace.hpp"
+
+using rt_jvm_data::ClassLoaderData;
+using rt_jvm_data::Metaspace;
+
+static const std::string test_class_file_dir = "/workspace/JavaVirtualMachine/resource";
+
+namespace {
+    // upstream that counts what is still outstanding
+    struct CountingResource : std::pmr::memory_resource {
+        std::size_t live = 0;
+        std::size_t blocks = 0;
+
+        void* do_allocate(std::size_t bytes, std::size_t align) override {
+            live += bytes;
+            blocks++;
+            return std::pmr::new_delete_resource()->allocate(bytes, align);
+        }
+        void do_deallocate(void* p, std::size_t bytes, std::size_t align) override {
+            live -= bytes;
+            blocks--;
+            std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+        }
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+    };
+}; // namespace
+
+TEST(METASPACE_TEST, FREE_LIST_TEST) {
+    CountingResource upstream;
+    {
+        Metaspace metaspace(&upstream);
+        void* a = metaspace.allocate(40);
+        void* b = metaspace.allocate(40);
+        EXPECT_EQ(metaspace.stats().used, 96u);
+        EXPECT_EQ(metaspace.stats().chunks, 1u);
+        // neighbours in one chunk
+        EXPECT_EQ(static_cast<std::byte*>(b) - static_cast<std::byte*>(a), 48);
+
+        // an exact size class comes back first
+        metaspace.deallocate(a, 40);
+        EXPECT_EQ(metaspace.stats().free, 48u);
+        EXPECT_EQ(metaspace.allocate(33), a);
+        EXPECT_EQ(metaspace.stats().free, 0u);
+
+        // a medium block is split for a smaller medium request
+        void* medium = metaspace.allocate(4096);
+        metaspace.deallocate(medium, 4096);
+        EXPECT_EQ(metaspace.allocate(2048), medium);
+        EXPECT_EQ(metaspace.stats().free, 2048u);
+
+        // large requests bypass the chunks and go straight back upstream
+        std::size_t reserved = metaspace.stats().reserved;
+        void* large = metaspace.allocate(Metaspace::chunk_size);
+        EXPECT_GT(metaspace.stats().reserved, reserved + Metaspace::chunk_size - 1);
+        metaspace.deallocate(large, Metaspace::chunk_size);
+        EXPECT_EQ(metaspace.stats().reserved, reserved);
+
+        void* aligned = metaspace.allocate(64, 64);
+        EXPECT_EQ(reinterpret_cast<std::uintptr_t>(aligned) % 64, 0u);
+
+        // filling past one chunk starts another, the tail is kept for reuse
+        for (int index = 0; index < 40; index++) {
+            void* block = metaspace.allocate(2000);
+            EXPECT_NE(block, nullptr);
+        }
+        EXPECT_EQ(metaspace.stats().chunks, 2u);
+
+        // the outstanding blocks are never freed one by one
+        void* outstanding = metaspace.allocate(Metaspace::chunk_size);
+        EXPECT_NE(outstanding, nullptr);
+        EXPECT_EQ(upstream.live, metaspace.stats().reserved);
+    }
+    EXPECT_EQ(upstream.live, 0u);
+    EXPECT_EQ(upstream.blocks, 0u);
+}
+
+TEST(METASPACE_TEST, CONCURRENT_TEST) {
+    Metaspace metaspace;
+    constexpr int thread_count = 4, rounds = 2000;
+    std::vector<std::vector<void*>> blocks(thread_count);
+    {
+        std::vector<std::jthread> threads;
+        for (int index = 0; index < thread_count; index++) {
+            threads.emplace_back([&, index] {
+                for (int round = 0; round < rounds; round++) {
+                    std::size_t size = 16 + (round % 7) * 24;
+                    void* p = metaspace.allocate(size);
+                    if (round % 3 == 0) {
+                        metaspace.deallocate(p, size);
+                    } else {
+                        blocks[index].push_back(p);
+                    }
+                }
+            });
+        }
+    }
+
+    std::set<void*> distinct;
+    for (const auto& list : blocks) distinct.insert(list.begin(), list.end());
+    EXPECT_EQ(distinct.size(), thread_count * (rounds - (rounds + 2) / 3));
+}
+
+TEST(METASPACE_TEST, CLASS_LOADER_DATA_TEST) {
+    ClassLoaderData loader;
+    const auto& metaspace = loader.get_metaspace();
+    EXPECT_EQ(metaspace.stats().used, 0u);
+
+    std::size_t used = 0;
+    {
+        rt_jvm_data::InstanceKlass kls(ClassFileSource::map(test_class_file_dir + "/Demo.class"),
+                                       &loader);
+        kls.link();
+        EXPECT_EQ(kls.get_loader(), &loader);
+        used = metaspace.stats().used;
+        // the parsed tables and the runtime member arrays
+        EXPECT_GT(used, kls.get_arena().reserved());
+
+        rt_jvm_data::InstanceKlass other(ClassFileSource::map(test_class_file_dir + "/Pair.class"),
+                                         &loader);
+        EXPECT_GT(metaspace.stats().used, used);
+    }
+    // both classes gave everything back; the blocks stay with the loader
+    EXPECT_EQ(metaspace.stats().used, 0u);
+    EXPECT_GT(metaspace.stats().free, 0u);
+
+    // the same class again reuses the freed blocks
+    auto reserved = metaspace.stats().reserved;
+    rt_jvm_data::InstanceKlass again(ClassFileSource::map(test_class_file_dir + "/Demo.class"),
+                                     &loader);
+    EXPECT_EQ(metaspace.stats().reserved, reserved);
+
+    // the bootstrap loader's classes use the boot metaspace
+    auto boot_used = Metaspace::boot().stats().used;
+    rt_jvm_data::InstanceKlass boot(ClassFileSource::map(test_class_file_dir + "/Demo.class"));
+    EXPECT_EQ(boot.get_loader(), nullptr);
+    EXPECT_GT(Metaspace::boot().stats().used, boot_used);
+}
@@ -0,0 +1,87 @@
+#include <random>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "../../include/classFile/modified_utf8.hpp"
+#include "../../include/classFile/byte_code_reader.hpp"
+#include "../../include/runtime/symbol_table.hpp"
+
+using raw_jvm_type::u1;
+using raw_jvm_type::u4;
+
+static std::span<const u1> as_bytes(std::string_view s) {
+    return {reinterpret_cast<const u1*>(s.data()), s.size()};
+}
+
+TEST(MODIFIED_UTF8_TEST, VALIDATE_TEST) {
+    EXPECT_TRUE(mutf8::scan(as_bytes("java/lang/Object")).valid);
+    EXPECT_TRUE(mutf8::scan(as_bytes("")).valid);
+    // encoded NUL, é, a lone high surrogate
+    EXPECT_TRUE(mutf8::scan(as_bytes("\xC0\x80")).valid);
+    EXPECT_TRUE(mutf8::scan(as_bytes("\xC3\xA9")).valid);
+    EXPECT_TRUE(mutf8::scan(as_bytes("\xED\xA0\x80")).valid);
+
+    EXPECT_FALSE(mutf8::scan(as_bytes(std::string_view("a\0b", 3))).valid);
+    EXPECT_FALSE(mutf8::scan(as_bytes("\xC1\x81")).valid);
+    EXPECT_FALSE(mutf8::scan(as_bytes("\xE0\x80\x80")).valid);
+    EXPECT_FALSE(mutf8::scan(as_bytes("\xF0\x9F\x98\x80")).valid);
+    EXPECT_FALSE(mutf8::scan(as_bytes("\x80")).valid);
+    EXPECT_FALSE(mutf8::scan(as_bytes("abc\xE4\xB8")).valid);
+}
+
+TEST(MODIFIED_UTF8_TEST, HASH_TEST) {
+    // "hello".hashCode() and "java/lang/Object".hashCode() in Java
+    EXPECT_EQ(mutf8::scan(as_bytes("hello")).hash, 99162322u);
+    EXPECT_EQ(mutf8::hash(as_bytes("java/lang/Object")), 2080463411u);
+
+    u4 hash = mutf8::hash(as_bytes("Ljava/lang/String;"));
+    Symbol a = SymbolTable::intern("Ljava/lang/String;");
+    EXPECT_EQ(a, SymbolTable::intern("Ljava/lang/String;", hash));
+    EXPECT_EQ(a.hash(), hash);
+}
+
+TEST(MODIFIED_UTF8_TEST, KERNELS_AGREE_TEST) {
+    std::mt19937 rng(42);
+    // the last three pieces are malformed
+    const std::vector<std::string> pieces = {"a",        "Z",        "/",
+                                             "\xC0\x80", "\xC3\xA9", "\xE4\xB8\xAD",
+                                             "\xED\xA0\xBD\xED\xB8\x80",  "\x80",
+                                             "\xF5",     "\xC1\xBF"};
+
+    for (int round = 0; round < 2000; round++) {
+        std::string s;
+        int count = rng() % 80;
+        bool may_break = round % 3 == 0;
+        for (int index = 0; index < count; index++) {
+            std::size_t pick = rng() % (may_break ? pieces.size() : pieces.size() - 3);
+            // long ascii runs exercise the vector blocks
+            s += rng() % 2 ? std::string(rng() % 40, 'x') : pieces[pick];
+        }
+
+        auto scalar = mutf8::detail::scan_scalar(as_bytes(s));
+        for (auto kernel : {&mutf8::detail::scan_sse41, &mutf8::detail::scan_avx2}) {
+            if (kernel == &mutf8::detail::scan_sse41 && !mutf8::detail::has_sse41()) continue;
+            if (kernel == &mutf8::detail::scan_avx2 && !mutf8::detail::has_avx2()) continue;
+            auto vector = kernel(as_bytes(s));
+            ASSERT_EQ(vector.valid, scalar.valid) << s;
+            if (!scalar.valid) continue;
+            EXPECT_EQ(vector.ascii, scalar.ascii);
+            EXPECT_EQ(vector.hash, scalar.hash);
+            EXPECT_EQ(vector.utf16_length, scalar.utf16_length);
+        }
+        if (scalar.valid) {
+            EXPECT_EQ(scalar.hash, mutf8::hash(as_bytes(s)));
+        }
+    }
+}
+
+TEST(MODIFIED_UTF8_TEST, UTF16_TEST) {
+    std::string ascii(100, 'q');
+    EXPECT_EQ(mutf8::to_utf16(as_bytes(ascii)), std::u16string(100, u'q'));
+    EXPECT_EQ(mutf8::to_utf16(as_bytes("a\xC0\x80" "b")), std::u16string(u"a\0b", 3));
+    EXPECT_EQ(mutf8::to_utf16(as_bytes("\xC3\xA9\xE4\xB8\xAD")), u"é中");
+    // U+1F600 as two encoded surrogates
+    EXPECT_EQ(mutf8::to_utf16(as_bytes("\xED\xA0\xBD\xED\xB8\x80")), u"\U0001F600");
+    EXPECT_THROW(mutf8::to_utf16(as_bytes("\xF0\x9F\x98\x80")), ClassFormatError);
+}
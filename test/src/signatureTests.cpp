@@ -0,0 +1,86 @@
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <gtest/gtest.h>
+
+#include "../../include/runtime/klass.hpp"
+#include "../../include/runtime/signature.hpp"
+
+using rt_jvm_data::MethodSignature;
+using rt_jvm_data::raw_value_type;
+
+static const std::string test_class_file_dir = "/workspace/JavaVirtualMachine/resource";
+
+TEST(SIGNATURE_TEST, METHOD_SIGNATURE_TEST) {
+    auto instance = MethodSignature::parse("(IJLjava/lang/String;[D)V", false);
+    ASSERT_TRUE(instance.has_value());
+    EXPECT_EQ(instance->arguments,
+              (std::pmr::vector<raw_value_type>{raw_value_type::Jint, raw_value_type::Jlong,
+                                           raw_value_type::Jreference,
+                                           raw_value_type::Jreference}));
+    EXPECT_FALSE(instance->return_type.has_value());
+    EXPECT_EQ(instance->return_slots(), 0);
+    // this, int, long (two slots), String, double[]
+    EXPECT_EQ(instance->argument_slots, 6);
+    EXPECT_EQ(instance->reference_slots.to_ulong(), 0b110001ul);
+
+    auto static_ = MethodSignature::parse("(D[[I)J", true);
+    ASSERT_TRUE(static_.has_value());
+    EXPECT_EQ(static_->argument_slots, 3);
+    EXPECT_EQ(static_->reference_slots.to_ulong(), 0b100ul);
+    EXPECT_EQ(static_->return_type, raw_value_type::Jlong);
+    EXPECT_EQ(static_->return_slots(), 2);
+
+    for (auto bad : {"", "I", "(I", "()", "(Q)V", "(L;)V", "()VV", "(V)V", "()Ljava/lang/Object"}) {
+        EXPECT_FALSE(MethodSignature::parse(bad, true).has_value()) << bad;
+    }
+
+    // at most 255 slots, the receiver included
+    std::string ints(255, 'I');
+    EXPECT_TRUE(MethodSignature::parse("(" + ints + ")V", true).has_value());
+    EXPECT_FALSE(MethodSignature::parse("(" + ints + ")V", false).has_value());
+    EXPECT_FALSE(MethodSignature::parse("(" + ints + "J)V", true).has_value());
+}
+
+TEST(SIGNATURE_TEST, FIELD_TYPE_TEST) {
+    EXPECT_EQ(rt_jvm_data::parse_field_descriptor("Z"), raw_value_type::Jboolean);
+    EXPECT_EQ(rt_jvm_data::parse_field_descriptor("Ljava/lang/String;"),
+              raw_value_type::Jreference);
+    EXPECT_EQ(rt_jvm_data::parse_field_descriptor("[[J"), raw_value_type::Jreference);
+    for (auto bad : {"", "V", "II", "Ljava/lang/String", "["}) {
+        EXPECT_FALSE(rt_jvm_data::parse_field_descriptor(bad).has_value()) << bad;
+    }
+}
+
+// the walk the verifier takes the class names along with
+TEST(SIGNATURE_TEST, NEXT_FIELD_TYPE_TEST) {
+    std::string_view desc = "(ILjava/lang/String;[[J)V";
+    std::size_t pos = 1;
+    EXPECT_EQ(rt_jvm_data::next_field_type(desc, pos), raw_value_type::Jint);
+    EXPECT_EQ(pos, 2u);
+    EXPECT_EQ(rt_jvm_data::next_field_type(desc, pos), raw_value_type::Jreference);
+    EXPECT_EQ(desc.substr(2, pos - 2), "Ljava/lang/String;");
+    std::size_t start = pos;
+    EXPECT_EQ(rt_jvm_data::next_field_type(desc, pos), raw_value_type::Jreference);
+    EXPECT_EQ(desc.substr(start, pos - start), "[[J");
+    EXPECT_FALSE(rt_jvm_data::next_field_type(desc, pos).has_value());
+}
+
+TEST(SIGNATURE_TEST, CORPUS_TEST) {
+    for (const auto& entry : std::filesystem::directory_iterator(test_class_file_dir)) {
+        if (entry.path().extension() != ".class") continue;
+        rt_jvm_data::InstanceKlass kls(ClassFileSource::map(entry.path()));
+        for (const auto& method : kls.get_methods()) {
+            const auto& signature = method.signature;
+            bool is_static = method.mptr->access_flags & raw_jvm_data::ACC_STATIC;
+            bool first_is_reference =
+                !is_static || (!signature.arguments.empty() &&
+                               signature.arguments[0] == raw_value_type::Jreference);
+            EXPECT_EQ(signature.reference_slots[0], first_is_reference);
+            if (method.code_info) {
+                EXPECT_LE(signature.argument_slots, method.code_info->max_locals)
+                    << entry.path() << " " << method.name.view() << method.descriptor.view();
+            }
+        }
+    }
+}
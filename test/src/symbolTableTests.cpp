@@ -0,0 +1,67 @@
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "../../include/runtime/symbol_table.hpp"
+
+TEST(SYMBOL_TABLE_TEST, INTERN_TEST) {
+    Symbol object = SymbolTable::intern("java/lang/Object");
+    EXPECT_TRUE(object);
+    EXPECT_EQ(object, SymbolTable::intern(std::string("java/lang/") + "Object"));
+    EXPECT_EQ(object.view(), "java/lang/Object");
+    EXPECT_EQ(object.hash(), 2080463411u);
+    EXPECT_NE(object, SymbolTable::intern("java/lang/Objec"));
+
+    EXPECT_EQ(SymbolTable::lookup("java/lang/Object"), object);
+    EXPECT_FALSE(SymbolTable::lookup("symbol/table/NeverInterned"));
+    EXPECT_FALSE(Symbol{});
+    EXPECT_TRUE(Symbol{}.view().empty());
+
+    // embedded NULs are bytes like any other
+    Symbol nul = SymbolTable::intern(std::string_view("a\0b", 3));
+    EXPECT_EQ(nul.view().size(), 3u);
+    EXPECT_NE(nul, SymbolTable::intern("a"));
+}
+
+TEST(SYMBOL_TABLE_TEST, GROWTH_TEST) {
+    // enough symbols to grow the index and fill several entry segments
+    std::vector<Symbol> symbols;
+    std::vector<std::string_view> views;
+    for (int index = 0; index < 50000; index++) {
+        symbols.push_back(SymbolTable::intern("growth/S" + std::to_string(index)));
+        views.push_back(symbols.back().view());
+    }
+    for (int index = 0; index < 50000; index++) {
+        std::string name = "growth/S" + std::to_string(index);
+        EXPECT_EQ(SymbolTable::intern(name), symbols[index]);
+        // bytes never move once interned
+        EXPECT_EQ(symbols[index].view().data(), views[index].data());
+        EXPECT_EQ(views[index], name);
+    }
+}
+
+TEST(SYMBOL_TABLE_TEST, CONCURRENT_TEST) {
+    constexpr int thread_count = 8, per_thread = 20000;
+    std::vector<std::vector<Symbol>> seen(thread_count);
+    std::vector<std::thread> threads;
+    for (int thread = 0; thread < thread_count; thread++) {
+        threads.emplace_back([&, thread] {
+            // every thread walks the same names from a different start
+            for (int step = 0; step < per_thread; step++) {
+                int index = (step + thread * 997) % per_thread;
+                seen[thread].push_back(SymbolTable::intern("concurrent/S" + std::to_string(index)));
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+
+    for (int index = 0; index < per_thread; index++) {
+        Symbol expected = SymbolTable::lookup("concurrent/S" + std::to_string(index));
+        ASSERT_TRUE(expected);
+        for (int thread = 0; thread < thread_count; thread++) {
+            int step = ((index - thread * 997) % per_thread + per_thread) % per_thread;
+            EXPECT_EQ(seen[thread][step], expected);
+        }
+    }
+}
@@ -0,0 +1,141 @@
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "../../include/runtime/system_dictionary.hpp"
+
+using rt_jvm_data::ClassLoaderData;
+using rt_jvm_data::InstanceKlass;
+using rt_jvm_data::SystemDictionary;
+
+static const std::string test_class_file_dir = "/workspace/JavaVirtualMachine/resource";
+
+static std::unique_ptr<InstanceKlass> parse(const std::string& file) {
+    return std::make_unique<InstanceKlass>(ClassFileSource::map(test_class_file_dir + "/" + file));
+}
+
+TEST(SYSTEM_DICTIONARY_TEST, LOAD_ONCE_TEST) {
+    SystemDictionary dictionary;
+    Symbol demo = SymbolTable::intern("resource/Demo");
+    constexpr int thread_count = 8;
+    std::atomic<int> loads{0};
+    std::atomic<int> ready{0};
+    std::vector<InstanceKlass*> results(thread_count);
+
+    {
+        std::vector<std::jthread> threads;
+        for (int index = 0; index < thread_count; index++) {
+            threads.emplace_back([&, index] {
+                ready++;
+                while (ready < thread_count) std::this_thread::yield();
+                results[index] = dictionary.resolve_or_load(nullptr, demo, [&] {
+                    loads++;
+                    // keep the placeholder held while the others arrive
+                    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                    return parse("Demo.class");
+                });
+            });
+        }
+    }
+
+    EXPECT_EQ(loads, 1);
+    ASSERT_NE(results[0], nullptr);
+    for (auto* kls : results) EXPECT_EQ(kls, results[0]);
+    EXPECT_EQ(dictionary.find(nullptr, demo), results[0]);
+    EXPECT_EQ(dictionary.find("resource/Demo"), results[0]);
+    EXPECT_EQ(dictionary.size(), 1u);
+
+    // the key includes the defining loader
+    ClassLoaderData app;
+    EXPECT_EQ(dictionary.find(&app, demo), nullptr);
+    auto* app_demo = dictionary.resolve_or_load(&app, demo, [] { return parse("Demo.class"); });
+    EXPECT_NE(app_demo, results[0]);
+    EXPECT_EQ(dictionary.find(&app, demo), app_demo);
+    EXPECT_EQ(dictionary.size(), 2u);
+}
+
+TEST(SYSTEM_DICTIONARY_TEST, INDEPENDENT_LOADS_TEST) {
+    SystemDictionary dictionary;
+    Symbol demo = SymbolTable::intern("resource/Demo");
+    Symbol pair = SymbolTable::intern("com/example/demo/utils/Pair");
+    std::atomic<bool> pair_loaded{false};
+
+    // the load of Demo only finishes once Pair is loaded by another thread,
+    // which could not happen if loading held a lock that Pair needs
+    std::jthread first([&] {
+        dictionary.resolve_or_load(nullptr, demo, [&] {
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+            while (!pair_loaded && std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::yield();
+            }
+            return parse("Demo.class");
+        });
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    EXPECT_NE(dictionary.resolve_or_load(nullptr, pair, [] { return parse("Pair.class"); }),
+              nullptr);
+    pair_loaded = true;
+    first.join();
+    EXPECT_NE(dictionary.find("resource/Demo"), nullptr);
+
+    // many names from many threads
+    std::vector<std::string> files = {"Pair.class", "Demo.class", "DockerUtils.class",
+                                      "ResponseBody.class", "KubernetesUtils.class"};
+    {
+        std::vector<std::jthread> threads;
+        for (int index = 0; index < 8; index++) {
+            threads.emplace_back([&, index] {
+                for (const auto& file : files) {
+                    auto parsed = parse(file);
+                    auto name = parsed->get_klass_name();
+                    auto* kls = dictionary.publish(std::move(parsed));
+                    EXPECT_EQ(kls->get_klass_name(), name) << index;
+                }
+            });
+        }
+    }
+    EXPECT_EQ(dictionary.size(), files.size());
+    EXPECT_EQ(dictionary.snapshot().size(), files.size());
+}
+
+TEST(SYSTEM_DICTIONARY_TEST, FAILED_LOAD_TEST) {
+    SystemDictionary dictionary;
+    Symbol demo = SymbolTable::intern("resource/Demo");
+    int loads = 0;
+
+    // neither a missing class nor a throwing load leaves the name taken
+    EXPECT_EQ(dictionary.resolve_or_load(nullptr, demo, [&] {
+        loads++;
+        return std::unique_ptr<InstanceKlass>();
+    }), nullptr);
+    EXPECT_THROW(dictionary.resolve_or_load(nullptr, demo,
+                                            [&]() -> std::unique_ptr<InstanceKlass> {
+                                                loads++;
+                                                throw std::runtime_error("unreadable");
+                                            }),
+                 std::runtime_error);
+    EXPECT_THROW(dictionary.resolve_or_load(nullptr, demo, [&] {
+        loads++;
+        return parse("Pair.class");
+    }), rt_jvm_data::NoClassDefFoundError);
+    EXPECT_EQ(dictionary.find(nullptr, demo), nullptr);
+
+    // a load that asks for its own class
+    EXPECT_THROW(dictionary.resolve_or_load(nullptr, demo, [&] {
+        loads++;
+        dictionary.resolve_or_load(nullptr, demo, [] { return parse("Demo.class"); });
+        return parse("Demo.class");
+    }), rt_jvm_data::ClassCircularityError);
+
+    EXPECT_NE(dictionary.resolve_or_load(nullptr, demo, [&] {
+        loads++;
+        return parse("Demo.class");
+    }), nullptr);
+    EXPECT_EQ(loads, 5);
+    EXPECT_EQ(dictionary.size(), 1u);
+}
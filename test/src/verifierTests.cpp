@@ -0,0 +1,146 @@
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "../../include/runtime/klass.hpp"
+#include "../../include/runtime/verifier.hpp"
+#include "class_builder.hpp"
+
+using namespace class_builder;
+
+static const std::string test_class_file_dir = "/workspace/JavaVirtualMachine/resource";
+
+// A class test/Bad with one static method m, its Code built from `code` and,
+// when given, a StackMapTable attribute with the raw `stack_map` body.
+static ClassFileSource_ptr make_method_class(const std::string& descriptor, u2 max_stack,
+                                             u2 max_locals, const std::vector<u1>& code,
+                                             const std::vector<u1>& stack_map = {}) {
+    ClassBuilder builder(52);
+    builder.add_method(PUBLIC | STATIC, "m", descriptor, max_stack, max_locals, Code(code),
+                       stack_map);
+    return builder.build("test/Bad", "java/lang/Object");
+}
+
+// make_method_class as a version 49 class file, whose frames are inferred
+static ClassFileSource_ptr make_old_class(const std::string& descriptor, u2 max_stack,
+                                          u2 max_locals, const std::vector<u1>& code) {
+    ClassBuilder builder(49);
+    builder.add_method(PUBLIC | STATIC, "m", descriptor, max_stack, max_locals, Code(code));
+    return builder.build("test/Old", "java/lang/Object");
+}
+
+// what a loader with the whole class library would answer for the corpus
+static const rt_jvm_data::AssignabilityCheck library = [](std::string_view, std::string_view) {
+    return true;
+};
+
+TEST(VERIFIER_TEST, CORPUS_LINKS_TEST) {
+    for (const auto& entry : std::filesystem::directory_iterator(test_class_file_dir)) {
+        if (entry.path().extension() != ".class") continue;
+        rt_jvm_data::InstanceKlass kls(ClassFileSource::map(entry.path()));
+        // no class library here: the hook stands in for its hierarchy
+        ASSERT_NO_THROW(kls.link(nullptr, {}, library)) << entry.path();
+        EXPECT_TRUE(kls.is_linked());
+        for (const auto& method : kls.get_methods()) {
+            EXPECT_EQ(method.verified, method.code_info.has_value()) << method.name.view();
+        }
+    }
+}
+
+TEST(VERIFIER_TEST, ACCEPT_TEST) {
+    // iconst_1; iconst_2; iadd; ireturn
+    rt_jvm_data::InstanceKlass add(make_method_class("()I", 2, 0, {0x04, 0x05, 0x60, 0xAC}));
+    EXPECT_NO_THROW(add.link());
+
+    // goto 3; return -- the target carries a same frame
+    rt_jvm_data::InstanceKlass jump(
+        make_method_class("()V", 0, 0, {0xA7, 0x00, 0x03, 0xB1}, {0x00, 0x01, 0x03}));
+    EXPECT_NO_THROW(jump.link());
+    EXPECT_TRUE(jump.get_method("m", "()V")->verified);
+}
+
+TEST(VERIFIER_TEST, REJECT_TEST) {
+    // iadd on an empty stack
+    rt_jvm_data::InstanceKlass underflow(make_method_class("()I", 2, 0, {0x60, 0xAC}));
+    EXPECT_THROW(underflow.link(), rt_jvm_data::VerifyError);
+    EXPECT_FALSE(underflow.is_linked());
+
+    // ireturn from a void method
+    rt_jvm_data::InstanceKlass bad_return(make_method_class("()V", 1, 0, {0x03, 0xAC}));
+    EXPECT_THROW(bad_return.link(), rt_jvm_data::VerifyError);
+
+    // lload_0 of an int argument
+    rt_jvm_data::InstanceKlass bad_local(make_method_class("(I)J", 2, 2, {0x1E, 0xAD}));
+    EXPECT_THROW(bad_local.link(), rt_jvm_data::VerifyError);
+
+    // goto 4; nop; return -- the dead nop has no frame to start from
+    rt_jvm_data::InstanceKlass dead_code(
+        make_method_class("()V", 0, 0, {0xA7, 0x00, 0x04, 0x00, 0xB1}, {0x00, 0x01, 0x04}));
+    EXPECT_THROW(dead_code.link(), rt_jvm_data::VerifyError);
+
+    // goto 3 without any stack map
+    rt_jvm_data::InstanceKlass no_frame(make_method_class("()V", 0, 0, {0xA7, 0x00, 0x03, 0xB1}));
+    EXPECT_THROW(no_frame.link(), rt_jvm_data::VerifyError);
+}
+
+TEST(VERIFIER_TEST, HIERARCHY_TEST) {
+    // aload_0; areturn -- a String returned as a CharSequence
+    auto source = [] {
+        return make_method_class("(Ljava/lang/String;)Ljava/lang/CharSequence;", 1, 1,
+                                 {0x2A, 0xB0});
+    };
+    // neither class is in the hierarchy link knows, so nothing vouches for it
+    rt_jvm_data::InstanceKlass unknown(source());
+    EXPECT_THROW(unknown.link(), rt_jvm_data::VerifyError);
+
+    rt_jvm_data::InstanceKlass checked(source());
+    std::vector<std::pair<std::string, std::string>> asked;
+    EXPECT_NO_THROW(checked.link(nullptr, {}, [&](std::string_view from, std::string_view to) {
+        asked.emplace_back(from, to);
+        return true;
+    }));
+    EXPECT_EQ(asked, (std::vector<std::pair<std::string, std::string>>{
+                         {"java/lang/String", "java/lang/CharSequence"}}));
+}
+
+TEST(VERIFIER_TEST, INFERENCE_TEST) {
+    // iconst_0; istore_1; top: iload_0; ifle done; iload_1; iload_0; iadd; istore_1;
+    // iinc 0 -1; goto top; done: iload_1; ireturn -- a loop with no stack maps
+    rt_jvm_data::InstanceKlass sum(make_old_class(
+        "(I)I", 2, 2,
+        {0x03, 0x3C, 0x1A, 0x9E, 0x00, 0x0D, 0x1B, 0x1A, 0x60, 0x3C, 0x84, 0x00, 0xFF, 0xA7,
+         0xFF, 0xF5, 0x1B, 0xAC}));
+    EXPECT_NO_THROW(sum.link());
+    EXPECT_TRUE(sum.get_method("m", "(I)I")->verified);
+
+    // iload_0; ifeq 8; aconst_null; goto 9; aload_1; areturn -- null and a
+    // String argument merge into a String
+    rt_jvm_data::InstanceKlass merged(make_old_class(
+        "(ILjava/lang/String;)Ljava/lang/Object;", 1, 2,
+        {0x1A, 0x99, 0x00, 0x07, 0x01, 0xA7, 0x00, 0x04, 0x2B, 0xB0}));
+    EXPECT_NO_THROW(merged.link());
+
+    // iload 200 with one local
+    rt_jvm_data::InstanceKlass far_local(make_old_class("(I)I", 1, 1, {0x15, 0xC8, 0xAC}));
+    EXPECT_THROW(far_local.link(), rt_jvm_data::VerifyError);
+    EXPECT_FALSE(far_local.get_method("m", "(I)I")->verified);
+
+    // iconst_0; iconst_0; pop2; return -- two pushes with max_stack 1
+    rt_jvm_data::InstanceKlass deep(make_old_class("()V", 1, 0, {0x03, 0x03, 0x58, 0xB1}));
+    EXPECT_THROW(deep.link(), rt_jvm_data::VerifyError);
+
+    // iload_0; ifeq 5; iconst_1; return -- the paths reach return with
+    // different stack heights
+    rt_jvm_data::InstanceKlass uneven(
+        make_old_class("(I)V", 1, 1, {0x1A, 0x99, 0x00, 0x04, 0x04, 0xB1}));
+    EXPECT_THROW(uneven.link(), rt_jvm_data::VerifyError);
+
+    // jsr 3; return -- subroutines are not inferred
+    rt_jvm_data::InstanceKlass subroutine(
+        make_old_class("()V", 1, 0, {0xA8, 0x00, 0x03, 0xB1}));
+    EXPECT_THROW(subroutine.link(), rt_jvm_data::VerifyError);
+}
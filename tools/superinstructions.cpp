@@ -0,0 +1,382 @@
+#include "classFile/class_file.hpp"
+#include "classFile/class_path.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+ * Picks the superinstructions of the interpreter from the bytecode of a class
+ * path and writes them as the entries of byte_code_superinstructions.def:
+ *
+ *   bin/superinstructions -cp resource [-n 16] \
+ *       > include/runtime/byte_code_superinstructions.def
+ *
+ * It counts every sequence of two and three instructions inside a basic block
+ * of every method, with the instructions the interpreter quickens counted as
+ * their _quick form, and keeps the ones that save the most dispatches. The
+ * interpreter makes the handler of each entry out of the handlers of its
+ * instructions, so the entries are all there is to generate.
+ */
+
+using namespace raw_jvm_type;
+
+namespace {
+    enum Bytecode : u1 {
+#define X(code, name, length) _##name = code,
+#include "runtime/byte_code_engine.def"
+#undef X
+    };
+
+    constexpr std::array<const char*, 256> names = [] {
+        std::array<const char*, 256> table{};
+#define X(code, name, length) table[code] = #name;
+#include "runtime/byte_code_engine.def"
+#undef X
+        return table;
+    }();
+
+    constexpr std::array<u1, 256> lengths = [] {
+        std::array<u1, 256> table{};
+#define X(code, name, length) table[code] = length;
+#include "runtime/byte_code_engine.def"
+#undef X
+        return table;
+    }();
+
+    // the opcodes the interpreter leaves to superinstructions
+    constexpr unsigned first_free = 0xe2, last_free = 0xfe;
+
+    inline u2 u2_at(const u1* at) noexcept {
+        return static_cast<u2>(at[0] << 8 | at[1]);
+    }
+    inline std::int32_t s4_at(const u1* at) noexcept {
+        return static_cast<std::int32_t>(static_cast<u4>(at[0]) << 24 | at[1] << 16 | at[2] << 8 |
+                                         at[3]);
+    }
+
+    // instructions after which the next one never runs
+    bool ends_block(u1 opcode) noexcept {
+        switch (opcode) {
+            case _goto:
+            case _goto_w:
+            case _jsr:
+            case _jsr_w:
+            case _ret:
+            case _tableswitch:
+            case _lookupswitch:
+            case _ireturn:
+            case _lreturn:
+            case _freturn:
+            case _dreturn:
+            case _areturn:
+            case _return:
+            case _athrow:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    struct Instruction {
+        u4 pc;
+        // as the interpreter runs it once quickened
+        u1 opcode;
+        // control reaches it other than from the instruction before
+        bool leader = false;
+        // how often it runs against code outside loops, 8 per enclosing loop
+        u4 weight = 1;
+    };
+
+    struct Branch {
+        u4 from;
+        u4 to;
+    };
+
+    // A class file as the counter reads it: the tables ClassFile keeps to
+    // itself are all it needs.
+    class CorpusClass : public raw_jvm_data::ClassFile {
+      private:
+        std::string_view utf8(u2 index) const noexcept {
+            return this->constant_pool[index].utf8.view();
+        }
+
+        std::string_view field_descriptor(u2 index) const noexcept {
+            u2 name_and_type = this->constant_pool[index].field_ref.name_and_type_index;
+            return utf8(this->constant_pool[name_and_type].name_and_type.descriptor_index);
+        }
+
+        // the form of a get- or putfield the interpreter rewrites it to
+        u1 field_form(const u1* operands, const u1 (&forms)[4]) const noexcept {
+            switch (field_descriptor(u2_at(operands))[0]) {
+                case 'I':
+                case 'F':
+                    return forms[0];
+                case 'J':
+                case 'D':
+                    return forms[1];
+                case 'L':
+                case '[':
+                    return forms[2];
+                default:
+                    return forms[3];
+            }
+        }
+
+        u1 constant_form(u2 index, u1 value, u1 reference, u1 other) const noexcept {
+            switch (cp_tag(index)) {
+                case raw_jvm_data::CONSTANT_Integer:
+                case raw_jvm_data::CONSTANT_Float:
+                    return value;
+                case raw_jvm_data::CONSTANT_String:
+                case raw_jvm_data::CONSTANT_Class:
+                    return reference;
+                default:
+                    return other;
+            }
+        }
+
+        // what the interpreter rewrites the instruction at `at` to
+        u1 quickened(const u1* at) const noexcept {
+            static constexpr u1 getfield[] = {_getfield_quick, _getfield2_quick, _agetfield_quick,
+                                              _getfield_quick_w};
+            static constexpr u1 putfield[] = {_putfield_quick, _putfield2_quick, _aputfield_quick,
+                                              _putfield_quick_w};
+            switch (at[0]) {
+                case _ldc:
+                    return constant_form(at[1], _ldc_quick, _aldc_quick, _ldc);
+                case _ldc_w:
+                    return constant_form(u2_at(at + 1), _ldc_w_quick, _aldc_w_quick, _ldc_w);
+                case _getfield:
+                    return field_form(at + 1, getfield);
+                case _putfield:
+                    return field_form(at + 1, putfield);
+                case _getstatic:
+                    return _getstatic_quick;
+                case _putstatic:
+                    return _putstatic_quick;
+                case _invokevirtual:
+                    return _invokevirtual_quick;
+                case _invokespecial:
+                    return _invokenonvirtual_quick;
+                case _invokestatic:
+                    return _invokestatic_quick;
+                case _invokeinterface:
+                    return _invokeinterface_quick;
+                case _new:
+                    return _new_quick;
+                case _anewarray:
+                    return _anewarray_quick;
+                case _checkcast:
+                    return _checkcast_quick;
+                case _instanceof:
+                    return _instanceof_quick;
+                default:
+                    return at[0];
+            }
+        }
+
+        // The instructions of `code` and the branches between them, the
+        // exception handlers left out. Empty when the code does not decode.
+        std::vector<Instruction> decode(std::span<const u1> code,
+                                        std::vector<Branch>& branches) const {
+            std::vector<Instruction> instructions;
+            auto branch = [&](std::size_t pc, std::int64_t offset) {
+                branches.push_back({static_cast<u4>(pc), static_cast<u4>(pc + offset)});
+            };
+            for (std::size_t pc = 0; pc < code.size();) {
+                const u1* at = code.data() + pc;
+                std::size_t length = lengths[at[0]];
+                if (at[0] == _wide) {
+                    length = pc + 1 < code.size() && at[1] == _iinc ? 6 : 4;
+                } else if (at[0] == _tableswitch || at[0] == _lookupswitch) {
+                    // past the padding: the default, then low and high and the
+                    // offsets, or the count and match-offset pairs
+                    std::size_t operands = (pc + 4) & ~std::size_t{3};
+                    if (operands + 8 > code.size()) return {};
+                    const u1* table = code.data() + operands;
+                    bool dense = at[0] == _tableswitch;
+                    std::int64_t count = s4_at(table + 4);
+                    if (dense) count = std::int64_t{s4_at(table + 8)} - count + 1;
+                    std::size_t stride = dense ? 4 : 8;
+                    if (count < 0 || (dense && operands + 12 > code.size())) return {};
+                    length = operands + (dense ? 12 : 8) + stride * count - pc;
+                    if (pc + length > code.size()) return {};
+                    branch(pc, s4_at(table));
+                    for (std::int64_t index = 0; index < count; index++) {
+                        branch(pc, s4_at(table + 12 + stride * index));
+                    }
+                }
+                if (length == 0 || at[0] > _jsr_w || pc + length > code.size()) return {};
+                if (at[0] == _goto_w || at[0] == _jsr_w) {
+                    branch(pc, s4_at(at + 1));
+                } else if ((at[0] >= _ifeq && at[0] <= _jsr) || at[0] == _ifnull ||
+                           at[0] == _ifnonnull) {
+                    branch(pc, static_cast<std::int16_t>(u2_at(at + 1)));
+                }
+                instructions.push_back({static_cast<u4>(pc), quickened(at)});
+                pc += length;
+            }
+            return instructions;
+        }
+
+      public:
+        using ClassFile::ClassFile;
+
+        // the instructions of every method with code that decodes
+        std::vector<std::vector<Instruction>> method_code() const {
+            std::vector<std::vector<Instruction>> result;
+            for (u2 index = 0; index < this->methods_count; index++) {
+                const auto& method = this->methods[index];
+                const auto* code = lookup_attribute(method.attributes.get(),
+                                                    method.attribute_count, "Code");
+                if (code == nullptr || code->attribute_length < 8) continue;
+                const u1* body = code->info.get();
+                u4 length = static_cast<u4>(u2_at(body + 4)) << 16 | u2_at(body + 6);
+                if (length == 0 || 8 + length > code->attribute_length) continue;
+                std::vector<Branch> branches;
+                auto instructions = decode({body + 8, length}, branches);
+                if (instructions.empty()) continue;
+
+                // exception handlers start blocks as well
+                const u1* table = body + 8 + length;
+                if (8 + length + 2 <= code->attribute_length) {
+                    u2 handlers = u2_at(table);
+                    for (u2 handler = 0; handler < handlers; handler++) {
+                        if (8 + length + 2 + 8 * (handler + 1) > code->attribute_length) break;
+                        u2 handler_pc = u2_at(table + 2 + 8 * handler + 4);
+                        branches.push_back({handler_pc, handler_pc});
+                    }
+                }
+
+                // a backward branch closes a loop over the instructions in between
+                auto at = [&](u4 pc) {
+                    return std::lower_bound(instructions.begin(), instructions.end(), pc,
+                                            [](const Instruction& i, u4 pc) { return i.pc < pc; });
+                };
+                for (const Branch& branch : branches) {
+                    auto target = at(branch.to);
+                    if (target == instructions.end() || target->pc != branch.to) continue;
+                    target->leader = true;
+                    if (branch.to >= branch.from) continue;
+                    for (auto it = target; it != at(branch.from + 1); ++it) {
+                        it->weight = std::min<u4>(it->weight * 8, 512);
+                    }
+                }
+                result.push_back(std::move(instructions));
+            }
+            return result;
+        }
+    };
+
+    using Sequence = std::vector<u1>;
+
+    std::string name_of(const Sequence& sequence) {
+        std::string name;
+        for (u1 opcode : sequence) {
+            if (!name.empty()) name += '_';
+            name += names[opcode];
+        }
+        return name;
+    }
+}; // namespace
+
+int main(int argc, char** argv) {
+    std::string classpath;
+    std::size_t wanted = 16;
+
+    for (int index = 1; index < argc; index++) {
+        std::string_view arg = argv[index];
+        if ((arg == "-cp" || arg == "-classpath") && index + 1 < argc) {
+            classpath = argv[++index];
+        } else if (arg == "-n" && index + 1 < argc) {
+            wanted = std::stoul(argv[++index]);
+        } else {
+            spdlog::error("unrecognized option {}", arg);
+            return 1;
+        }
+    }
+    wanted = std::min<std::size_t>(wanted, last_free - first_free + 1);
+
+    std::vector<std::vector<Instruction>> methods;
+    std::size_t classes = 0;
+    ClassPath path = ClassPath::parse(classpath);
+    for (const auto& entry : path.get_entries()) {
+        for (const auto& name : entry->class_names()) {
+            try {
+                CorpusClass kls(entry->open(name));
+                for (auto& method : kls.method_code()) methods.push_back(std::move(method));
+                classes++;
+            } catch (const std::exception& e) {
+                spdlog::warn("skipping {} in {}: {}", name, entry->describe(), e.what());
+            }
+        }
+    }
+
+    // Grows the set the way the interpreter fuses: at each instruction the
+    // longest sequence chosen so far covers it and the ones after it, and
+    // every sequence starting there not chosen yet saves its weight for each
+    // dispatch less. The one saving the most is chosen next.
+    std::vector<std::pair<Sequence, std::size_t>> chosen;
+    auto is_chosen = [&](const Sequence& sequence) {
+        return std::any_of(chosen.begin(), chosen.end(),
+                           [&](const auto& entry) { return entry.first == sequence; });
+    };
+    while (chosen.size() < wanted) {
+        std::map<Sequence, std::size_t> savings;
+        for (const auto& instructions : methods) {
+            for (std::size_t first = 0; first < instructions.size();) {
+                std::size_t covered = 1;
+                Sequence sequence{instructions[first].opcode};
+                for (std::size_t next = first + 1;
+                     next < instructions.size() && sequence.size() < 3; next++) {
+                    const Instruction& instruction = instructions[next];
+                    if (ends_block(sequence.back()) || instruction.leader) break;
+                    if (lengths[sequence.front()] == 0 || lengths[instruction.opcode] == 0) break;
+                    sequence.push_back(instruction.opcode);
+                    if (is_chosen(sequence)) {
+                        covered = sequence.size();
+                    } else {
+                        savings[sequence] += instructions[first].weight * (sequence.size() - 1);
+                    }
+                }
+                first += covered;
+            }
+        }
+        auto best = std::max_element(savings.begin(), savings.end(), [](const auto& lhs,
+                                                                         const auto& rhs) {
+            return lhs.second < rhs.second;
+        });
+        // a sequence found once is not worth an opcode
+        if (best == savings.end() || best->second < 2) break;
+        chosen.emplace_back(best->first, best->second);
+    }
+
+    fmt::print("// Generated by tools/superinstructions.cpp from {} methods of {} classes; do not\n"
+               "// edit. S(code, name, length, instructions...) stands for the instructions\n"
+               "// run one after the other, `length` is the length of the first. In the order\n"
+               "// chosen, with the dispatches each saves over the class path, loops weighing\n"
+               "// 8 times as much per level.\n",
+               methods.size(), classes);
+    unsigned code = first_free;
+    for (const auto& [sequence, saved] : chosen) {
+        std::string line = fmt::format("S({:#04x}, {}, {},", code++, name_of(sequence),
+                                       lengths[sequence.front()]);
+        std::string instructions;
+        for (u1 opcode : sequence) instructions += fmt::format(" {},", names[opcode]);
+        instructions.back() = ')';
+        if (line.size() + instructions.size() > 100) {
+            fmt::print("{}\n", line);
+            line = "  " + instructions.substr(1);
+        } else {
+            line += instructions;
+        }
+        std::string note = fmt::format(" // {}", saved);
+        if (line.size() + note.size() <= 100) line += note;
+        fmt::print("{}\n", line);
+    }
+    return 0;
+}